@@ -104,6 +104,13 @@ DYNAMIC_EXPORT viennamesh_error viennamesh_context_load_plugin(viennamesh_contex
 DYNAMIC_EXPORT viennamesh_error viennamesh_context_load_plugins_in_directory(viennamesh_context context,
                                                                 const char * directory_name);
 /* DYNAMIC_EXPORT viennamesh_error viennamesh_context_unload_plugin(viennamesh_context context, viennamesh_plugin * plugin); */
+DYNAMIC_EXPORT viennamesh_error viennamesh_context_write_plugin_manifest(viennamesh_context context,
+                                                                        const char * plugin_filename,
+                                                                        const char * manifest_filename);
+DYNAMIC_EXPORT viennamesh_error viennamesh_context_get_plugin_statistics(viennamesh_context context,
+                                                                         int * loaded_plugin_count,
+                                                                         int * pending_plugin_count,
+                                                                         double * plugin_loading_time);
 
 DYNAMIC_EXPORT viennamesh_error viennamesh_context_get_error(viennamesh_context context,
                                                              viennamesh_error * error_code,
@@ -307,6 +314,7 @@ DYNAMIC_EXPORT viennamesh_error viennamesh_log_set_stack_level(int log_level);
 
 
 DYNAMIC_EXPORT viennamesh_error viennamesh_log_add_logging_file(char const * filename, viennamesh_log_callback_handle * handle);
+DYNAMIC_EXPORT viennamesh_error viennamesh_log_flush();
 
 
 
@@ -28,6 +28,9 @@ namespace viennamesh
   public:
 
     context_handle();
+    // creates a context with the built-in data types, the plugins in the
+    // default plugin directories are only registered if load_default_plugins is set
+    explicit context_handle(bool load_default_plugins);
     context_handle(viennamesh_context ctx_);
     context_handle(context_handle const & handle_);
 
@@ -110,6 +113,7 @@ namespace viennamesh
     algorithm_handle make_algorithm(std::string const & algorithm_name);
     void load_plugin(std::string const & plugin_filename);
     void load_plugins_in_directories(std::string const & directory_name, std::string const & delimiter);
+    void write_plugin_manifest(std::string const & plugin_filename, std::string const & manifest_filename);
 
     viennamesh_context internal() const;
 
@@ -118,6 +122,7 @@ namespace viennamesh
     void retain();
     void release();
     void make();
+    void init(bool load_default_plugins);
 
     viennamesh_context ctx;
     std::vector<void *> loaded_plugins;
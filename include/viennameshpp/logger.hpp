@@ -7,33 +7,75 @@
 
 namespace viennamesh
 {
+  typedef viennamesh_error (*viennamesh_log_level_function_type)(int *);
+
+  // Returns true if a message of the given level passes the level returned
+  // by level_function, used to skip suppressed messages before any
+  // formatting happens
+  inline bool log_enabled(viennamesh_log_level_function_type level_function, int log_level)
+  {
+    int current_level;
+    level_function(&current_level);
+    return log_level <= current_level;
+  }
+
+  inline bool info_enabled(int log_level)
+  { return log_enabled(viennamesh_log_get_info_level, log_level); }
+  inline bool error_enabled(int log_level)
+  { return log_enabled(viennamesh_log_get_error_level, log_level); }
+  inline bool warning_enabled(int log_level)
+  { return log_enabled(viennamesh_log_get_warning_level, log_level); }
+  inline bool debug_enabled(int log_level)
+  { return log_enabled(viennamesh_log_get_debug_level, log_level); }
+  inline bool stack_enabled(int log_level)
+  { return log_enabled(viennamesh_log_get_stack_level, log_level); }
+
+
+
   class log_instance
   {
   public:
     typedef std::ostringstream collector_stream_type;
     typedef viennamesh_error (*viennamesh_log_function_type)(const char *, int);
 
-    log_instance(viennamesh_log_function_type function, int log_level_) :
-      os_( new collector_stream_type() ),
+    // The collector stream is only created if the message is not suppressed,
+    // otherwise all output goes to a stream without buffer which discards
+    // it without formatting
+    log_instance(viennamesh_log_function_type function, int log_level_, bool enabled) :
+      os_( enabled ? new collector_stream_type() : 0 ),
       function_(function),
       log_level(log_level_) {}
 
     ~log_instance()
     {
-      function_( os_->str().c_str(), log_level );
-      delete os_;
+      if (os_)
+      {
+        function_( os_->str().c_str(), log_level );
+        delete os_;
+      }
     }
 
     template <typename T>
-    collector_stream_type & operator<<(const T & x )
+    std::ostream & operator<<(const T & x )
     {
       get() << x;
       return get();
     }
 
+    std::ostream & operator<<( std::ostream & (*manipulator)(std::ostream &) )
+    {
+      return manipulator( get() );
+    }
+
   private:
 
-    collector_stream_type & get() { return *os_; }
+    static std::ostream & null_stream()
+    {
+      static thread_local std::ostream stream(0);
+      return stream;
+    }
+
+    std::ostream & get() { return os_ ? *os_ : null_stream(); }
 
     log_instance & operator =(const log_instance &) { return *this; }
 
@@ -48,18 +90,20 @@ namespace viennamesh
 
 
   inline log_instance info(int log_level)
-  { return log_instance(viennamesh_log_info_line, log_level); }
+  { return log_instance(viennamesh_log_info_line, log_level, info_enabled(log_level)); }
   inline log_instance error(int log_level)
-  { return log_instance(viennamesh_log_error_line, log_level); }
+  { return log_instance(viennamesh_log_error_line, log_level, error_enabled(log_level)); }
   inline log_instance warning(int log_level)
-  { return log_instance(viennamesh_log_warning_line, log_level); }
+  { return log_instance(viennamesh_log_warning_line, log_level, warning_enabled(log_level)); }
   inline log_instance debug(int log_level)
-  { return log_instance(viennamesh_log_debug_line, log_level); }
+  { return log_instance(viennamesh_log_debug_line, log_level, debug_enabled(log_level)); }
   inline log_instance stack(int log_level)
-  { return log_instance(viennamesh_log_stack_line, log_level); }
-
-
+  { return log_instance(viennamesh_log_stack_line, log_level, stack_enabled(log_level)); }
 
+  // Writes all pending log messages of the calling thread and waits until
+  // asynchronous log files are written, e.g. before calling _exit
+  inline void flush_log()
+  { viennamesh_log_flush(); }
 
 
 
@@ -115,4 +159,10 @@ namespace viennamesh
 
 }
 
+// Like viennamesh::info(level) etc. but the streamed expressions are not even
+// evaluated if the message is suppressed. Use this in hot loops:
+//   VIENNAMESH_LOG(info, 10) << "Refining cell " << expensive_to_compute() << std::endl;
+#define VIENNAMESH_LOG(type, log_level) \
+  if ( !viennamesh::type##_enabled(log_level) ) {} else viennamesh::type(log_level)
+
 #endif
@@ -0,0 +1,225 @@
+#ifndef VIENNAMESH_CORE_SPATIAL_HASH_HPP
+#define VIENNAMESH_CORE_SPATIAL_HASH_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <atomic>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#include "viennameshpp/union_find.hpp"
+
+namespace viennamesh
+{
+
+  // Uniform hash grid over a flat, interleaved coordinate array
+  // (x0 y0 [z0] x1 y1 [z1] ...). The grid spacing is the tolerance, so all
+  // points closer than the tolerance to a query point are found in the 3^dim
+  // grid cells around the query. Grid cells are hashed into a bucket table
+  // stored in CSR layout; the table is built in parallel and is read-only
+  // afterwards, so queries can be issued concurrently.
+  class spatial_hash
+  {
+  public:
+
+    typedef std::ptrdiff_t index_type;
+
+    spatial_hash() : coords(0), point_count(0), dimension(0), tol(0), cell_size(1), bucket_count(0) {}
+
+    spatial_hash(double const * coords_, std::size_t point_count_, int dimension_, double tolerance_)
+    { init(coords_, point_count_, dimension_, tolerance_); }
+
+    void init(double const * coords_, std::size_t point_count_, int dimension_, double tolerance_)
+    {
+      coords = coords_;
+      point_count = point_count_;
+      dimension = dimension_;
+      tol = tolerance_;
+      cell_size = tol > 0 ? tol : 1.0;
+
+      bucket_count = 1;
+      while (bucket_count < 2*point_count)
+        bucket_count *= 2;
+
+      std::vector<index_type> point_bucket(point_count);
+      std::vector< std::atomic<index_type> > bucket_fill(bucket_count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(bucket_count); ++i)
+        bucket_fill[i].store(0, std::memory_order_relaxed);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(point_count); ++i)
+      {
+        long cell[3];
+        grid_cell(coords + dimension*i, cell);
+        point_bucket[i] = bucket(cell);
+        bucket_fill[ point_bucket[i] ].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      bucket_offsets.resize(bucket_count+1);
+      bucket_offsets[0] = 0;
+      for (std::size_t i = 0; i != bucket_count; ++i)
+      {
+        bucket_offsets[i+1] = bucket_offsets[i] + bucket_fill[i].load(std::memory_order_relaxed);
+        bucket_fill[i].store(bucket_offsets[i], std::memory_order_relaxed);
+      }
+
+      bucket_points.resize(point_count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(point_count); ++i)
+        bucket_points[ bucket_fill[point_bucket[i]].fetch_add(1, std::memory_order_relaxed) ] = i;
+
+      // keep each bucket sorted so that queries are deterministic
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type i = 0; i < static_cast<index_type>(bucket_count); ++i)
+        std::sort( bucket_points.begin() + bucket_offsets[i], bucket_points.begin() + bucket_offsets[i+1] );
+    }
+
+
+    std::size_t size() const { return point_count; }
+    int geometric_dimension() const { return dimension; }
+    double tolerance() const { return tol; }
+    double const * point(index_type i) const { return coords + dimension*i; }
+
+
+    // Calls f(index) for every stored point within distance < radius of p,
+    // radius has to be <= the cell size of the hash grid
+    template<typename FunctorT>
+    void for_each_close_point(double const * p, double radius, FunctorT f) const
+    {
+      long cell[3];
+      grid_cell(p, cell);
+
+      std::size_t visited[27];
+      int visited_count = 0;
+
+      long d[3] = {0, 0, 0};
+      long range[3] = {0, 0, 0};
+      for (int i = 0; i != dimension; ++i)
+        range[i] = 1;
+
+      for (d[2] = -range[2]; d[2] <= range[2]; ++d[2])
+        for (d[1] = -range[1]; d[1] <= range[1]; ++d[1])
+          for (d[0] = -range[0]; d[0] <= range[0]; ++d[0])
+          {
+            long neighbor[3] = { cell[0]+d[0], cell[1]+d[1], cell[2]+d[2] };
+            std::size_t b = bucket(neighbor);
+
+            // different grid cells may share a bucket
+            if (std::find(visited, visited+visited_count, b) != visited+visited_count)
+              continue;
+            visited[visited_count++] = b;
+
+            for (index_type j = bucket_offsets[b]; j != bucket_offsets[b+1]; ++j)
+            {
+              index_type index = bucket_points[j];
+              if (distance_2(p, point(index)) < radius*radius)
+                f(index);
+            }
+          }
+    }
+
+    template<typename FunctorT>
+    void for_each_close_point(double const * p, FunctorT f) const
+    { for_each_close_point(p, tol, f); }
+
+    // returns the smallest index of all stored points within the tolerance
+    // of p or -1 if there is no such point
+    index_type find(double const * p) const
+    {
+      index_type result = -1;
+      for_each_close_point(p, [&result](index_type index)
+      {
+        if (result < 0 || index < result)
+          result = index;
+      });
+      return result;
+    }
+
+  private:
+
+    double distance_2(double const * a, double const * b) const
+    {
+      double result = 0;
+      for (int i = 0; i != dimension; ++i)
+        result += (a[i]-b[i])*(a[i]-b[i]);
+      return result;
+    }
+
+    void grid_cell(double const * p, long * cell) const
+    {
+      cell[0] = cell[1] = cell[2] = 0;
+      for (int i = 0; i != dimension; ++i)
+        cell[i] = static_cast<long>( std::floor(p[i] / cell_size) );
+    }
+
+    std::size_t bucket(long const * cell) const
+    {
+      std::size_t h = static_cast<std::size_t>(cell[0]) * 73856093u ^
+                      static_cast<std::size_t>(cell[1]) * 19349663u ^
+                      static_cast<std::size_t>(cell[2]) * 83492791u;
+      return h & (bucket_count-1);
+    }
+
+    double const * coords;
+    std::size_t point_count;
+    int dimension;
+    double tol;
+    double cell_size;
+
+    std::size_t bucket_count;
+    std::vector<index_type> bucket_offsets;
+    std::vector<index_type> bucket_points;
+  };
+
+
+
+  // Clusters all points which are (transitively) closer than tolerance.
+  // On return, representatives[i] is the smallest point index of the cluster
+  // containing point i; the return value is the number of clusters.
+  template<typename IndexT>
+  IndexT weld_points(double const * coords, std::size_t point_count, int dimension, double tolerance,
+                     std::vector<IndexT> & representatives)
+  {
+    spatial_hash hash(coords, point_count, dimension, tolerance);
+    concurrent_union_find clusters(point_count);
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(point_count); ++i)
+    {
+      hash.for_each_close_point(coords + dimension*i, [&clusters, i](std::ptrdiff_t j)
+      {
+        if (j < i)
+          clusters.unite(i, j);
+      });
+    }
+
+    clusters.representatives(representatives);
+
+    IndexT cluster_count = 0;
+    for (std::size_t i = 0; i != representatives.size(); ++i)
+      if (representatives[i] == static_cast<IndexT>(i))
+        ++cluster_count;
+
+    return cluster_count;
+  }
+
+}
+
+#endif
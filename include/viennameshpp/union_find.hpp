@@ -0,0 +1,134 @@
+#ifndef VIENNAMESH_CORE_UNION_FIND_HPP
+#define VIENNAMESH_CORE_UNION_FIND_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace viennamesh
+{
+
+  // Lock-free disjoint set forest. unite() may be called concurrently from
+  // several threads. Roots are always linked towards the smaller index, so
+  // after all unions are done find(i) is the smallest index of the set
+  // containing i, independent of the order in which the unions happened.
+  class concurrent_union_find
+  {
+  public:
+
+    typedef std::ptrdiff_t index_type;
+
+    concurrent_union_find() {}
+    explicit concurrent_union_find(std::size_t size_) { init(size_); }
+
+    void init(std::size_t size_)
+    {
+      std::vector< std::atomic<index_type> > tmp(size_);
+      parents.swap(tmp);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(size_); ++i)
+        parents[i].store(i, std::memory_order_relaxed);
+    }
+
+    std::size_t size() const { return parents.size(); }
+
+    index_type find(index_type i)
+    {
+      index_type parent = parents[i].load(std::memory_order_relaxed);
+      while (parent != i)
+      {
+        // path halving, losing the race only means less compression
+        index_type grand_parent = parents[parent].load(std::memory_order_relaxed);
+        if (grand_parent != parent)
+          parents[i].compare_exchange_weak(parent, grand_parent, std::memory_order_relaxed);
+
+        i = parent;
+        parent = parents[i].load(std::memory_order_relaxed);
+      }
+
+      return i;
+    }
+
+    // returns true if i and j were in different sets
+    bool unite(index_type i, index_type j)
+    {
+      while (true)
+      {
+        i = find(i);
+        j = find(j);
+
+        if (i == j)
+          return false;
+
+        if (i < j)
+          std::swap(i, j);
+
+        // i is the larger root, hang it below j
+        index_type expected = i;
+        if (parents[i].compare_exchange_strong(expected, j, std::memory_order_relaxed))
+          return true;
+      }
+    }
+
+    bool same(index_type i, index_type j)
+    {
+      return find(i) == find(j);
+    }
+
+    // Fully compresses the forest and writes the root of each element to
+    // representatives. Must not run concurrently to unite().
+    template<typename IndexT>
+    void representatives(std::vector<IndexT> & result)
+    {
+      result.resize( parents.size() );
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(parents.size()); ++i)
+        result[i] = static_cast<IndexT>( find(i) );
+    }
+
+    // Maps each set to a consecutive label [0, set_count) ordered by the
+    // smallest element of the set and returns set_count.
+    template<typename IndexT>
+    IndexT labels(std::vector<IndexT> & result)
+    {
+      representatives(result);
+
+      IndexT set_count = 0;
+      for (std::size_t i = 0; i != result.size(); ++i)
+      {
+        if (result[i] == static_cast<IndexT>(i))
+          result[i] = set_count++;
+        else
+          result[i] = result[ result[i] ];
+      }
+
+      return set_count;
+    }
+
+  private:
+
+    concurrent_union_find(concurrent_union_find const &);
+    concurrent_union_find & operator=(concurrent_union_find const &);
+
+    std::vector< std::atomic<index_type> > parents;
+  };
+
+}
+
+#endif
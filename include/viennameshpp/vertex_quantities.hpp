@@ -0,0 +1,122 @@
+#ifndef VIENNAMESH_CORE_VERTEX_QUANTITIES_HPP
+#define VIENNAMESH_CORE_VERTEX_QUANTITIES_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <vector>
+#include <cstddef>
+
+#include "viennagrid/viennagrid.hpp"
+#include "viennameshpp/core.hpp"
+
+namespace viennamesh
+{
+
+  // Vertex quantity fields in a flat per-node buffer. The values of all
+  // fields of a node are stored consecutively, field after field with all
+  // components of a field:
+  //   f0(n0) f1(n0) ... f0(n1) f1(n1) ...
+  // Node i is the vertex with index i, so meshes which keep the vertex
+  // order (e.g. pragmatic meshes converted from viennagrid) can carry the
+  // buffer along with their nodes.
+
+
+  // the vertex fields of quantities, cell fields cannot be carried by
+  // nodes and are skipped
+  inline std::vector<viennagrid::quantity_field> vertex_quantities(data_handle<viennagrid_quantity_field> const & quantities)
+  {
+    std::vector<viennagrid::quantity_field> fields;
+    if (!quantities.valid())
+      return fields;
+
+    for (int i = 0; i != quantities.size(); ++i)
+    {
+      viennagrid::quantity_field field = quantities(i);
+      if (field.topologic_dimension() != 0)
+      {
+        info(1) << "Quantity field \"" << field.get_name() << "\" is not a vertex field and is not carried through adaptation" << std::endl;
+        continue;
+      }
+
+      fields.push_back(field);
+    }
+
+    return fields;
+  }
+
+  // number of values per node
+  inline std::size_t vertex_quantity_values(std::vector<viennagrid::quantity_field> const & fields)
+  {
+    std::size_t count = 0;
+    for (std::size_t j = 0; j != fields.size(); ++j)
+      count += fields[j].values_per_quantity();
+    return count;
+  }
+
+  // gathers the values of the first node_count vertices, vertices without
+  // a value are zero
+  inline void gather_vertex_quantities(std::vector<viennagrid::quantity_field> const & fields,
+                                       int node_count,
+                                       std::vector<double> & values)
+  {
+    std::size_t per_node = vertex_quantity_values(fields);
+    values.assign(node_count*per_node, 0.0);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < node_count; ++i)
+    {
+      std::size_t offset = i*per_node;
+      for (std::size_t j = 0; j != fields.size(); ++j)
+      {
+        int components = fields[j].values_per_quantity();
+
+        void * value;
+        if (viennagrid_quantity_field_value_get(fields[j].internal(), i, &value) == VIENNAGRID_SUCCESS && value)
+          for (int k = 0; k < components; ++k)
+            values[offset+k] = static_cast<viennagrid_numeric*>(value)[k];
+
+        offset += components;
+      }
+    }
+  }
+
+  // empty vertex fields with the names and component counts of fields
+  inline std::vector<viennagrid::quantity_field> make_vertex_quantities(std::vector<viennagrid::quantity_field> const & fields)
+  {
+    std::vector<viennagrid::quantity_field> result(fields.size());
+    for (std::size_t j = 0; j != fields.size(); ++j)
+    {
+      result[j].init(0, fields[j].values_per_quantity());
+      result[j].set_name( fields[j].get_name() );
+    }
+    return result;
+  }
+
+  // scatters the buffer values of one node to vertex of fields
+  inline void scatter_vertex_quantities(std::vector<viennagrid::quantity_field> & fields,
+                                        viennagrid_int vertex,
+                                        double const * node_values)
+  {
+    std::size_t offset = 0;
+    for (std::size_t j = 0; j != fields.size(); ++j)
+    {
+      viennagrid_quantity_field_value_set(fields[j].internal(), vertex, const_cast<double*>(node_values+offset));
+      offset += fields[j].values_per_quantity();
+    }
+  }
+
+}
+
+#endif
@@ -1,6 +1,11 @@
 #include "color_refinement.hpp"
 #include "pragmatic_mesh.hpp"
 #include "mesh_partitions.hpp"
+#include "viennameshpp/vertex_quantities.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <boost/algorithm/string.hpp>
 
 namespace viennamesh
 {
@@ -15,6 +20,13 @@ namespace viennamesh
 			data_handle<bool> single_mesh_output = get_input<bool>("single_mesh_output");
 			string_handle input_file = get_input<string_handle>("filename");
 			string_handle algorithm = get_input<string_handle>("algorithm");
+			string_handle adapt_operations = get_input<string_handle>("adapt_operations");
+			data_handle<double> swap_quality = get_input<double>("swap_quality");
+			data_handle<int> smoothing_passes = get_input<int>("smoothing_passes");
+
+			//optional: carry the vertex quantity fields through healing, refinement and adaptation and output them with the partitions
+			quantity_field_handle quantities = get_input<viennagrid::quantity_field>("quantities");
+			data_handle<bool> carry_quantities = get_input<bool>("carry_quantities");
 
 			Mesh<double> * in_mesh = input_mesh().mesh;
 		
@@ -53,8 +65,54 @@ namespace viennamesh
 				return false;
 			}				
 
+			//optional coarsening, swapping and smoothing after the refinement, e.g. "coarsen,swap,smooth"
+			std::vector<std::string> operations;
+
+			if (adapt_operations.valid())
+			{
+				std::string operations_string = adapt_operations();
+				boost::algorithm::split( operations, operations_string, boost::is_any_of(", "), boost::token_compress_on );
+				operations.erase( std::remove(operations.begin(), operations.end(), std::string()), operations.end() );
+
+				for (auto const& operation : operations)
+				{
+					if (operation != "coarsen" && operation != "swap" && operation != "smooth")
+					{
+						viennamesh::error(1) << "'" << operation << "'" << " is not a valid adaptation operation!" << std::endl;
+						return false;
+					}
+				}
+
+				if (!operations.empty() && algo != "pragmatic")
+				{
+					viennamesh::error(1) << "Adaptation operations are only supported with the pragmatic algorithm!" << std::endl;
+					return false;
+				}
+			}
+
 			MeshPartitions InputMesh(input_mesh().mesh, num_partitions(), input_file().substr(found+1), num_threads()); 
 
+			//the pragmatic node ids are the vertex indices of the input mesh, so the quantity values are indexed by node id
+			std::vector<viennagrid::quantity_field> carried_quantities;
+
+			if (carry_quantities.valid() && carry_quantities() && quantities.valid())
+			{
+				if (algo != "pragmatic")
+				{
+					viennamesh::error(1) << "Quantities can only be carried with the pragmatic algorithm!" << std::endl;
+					return false;
+				}
+
+				carried_quantities = viennamesh::vertex_quantities(quantities);
+
+				if (!carried_quantities.empty())
+				{
+					std::vector<double> values;
+					viennamesh::gather_vertex_quantities(carried_quantities, in_mesh->get_number_nodes(), values);
+					InputMesh.SetFields(&(values[0]), viennamesh::vertex_quantity_values(carried_quantities));
+				}
+			}
+
 			//SERIAL PART
 			auto overall_tic = std::chrono::system_clock::now();
 			
@@ -81,15 +139,36 @@ namespace viennamesh
 			std::vector<double> call_refine_log;
 			std::vector<double> refine_log;
 			std::vector<double> mesh_log;
+			std::vector<int> heal_edges_log;
 
 			
 			wall_tic = std::chrono::system_clock::now();
 			/*InputMesh.CreatePragmaticDataStructures_par(threads_log, refine_times, l2g_build, l2g_access, g2l_build, g2l_access, 
 														algo, options, triangulate_log, int_check_log);//, build_tri_ds); //*/
-			InputMesh.CreatePragmaticDataStructures_par(algo, threads_log, mesh_log, heal_log, metric_log, call_refine_log, refine_log);
+			InputMesh.CreatePragmaticDataStructures_par(algo, threads_log, heal_log, metric_log, call_refine_log, refine_log, mesh_log,
+														heal_edges_log);
 														
 			std::chrono::duration<double> cpds_duration = std::chrono::system_clock::now() - wall_tic;	
 
+			//healing benchmark: accumulated healing time of all threads per thousand healed interface edges
+			double heal_time = std::accumulate(heal_log.begin(), heal_log.end(), 0.0);
+			int heal_edges = std::accumulate(heal_edges_log.begin(), heal_edges_log.end(), 0);
+			double heal_time_per_kedge = (heal_edges > 0) ? 1000.0*heal_time/heal_edges : 0.0;
+
+			viennamesh::info(1) << "  Healed interface edges: " << heal_edges << " (" << in_mesh->get_number_dimensions() << "D), "
+								<< heal_time_per_kedge << " s per 1000 edges" << std::endl;
+
+			std::vector<double> adapt_log;
+
+			if (!operations.empty())
+			{
+				wall_tic = std::chrono::system_clock::now();
+					InputMesh.AdaptPartitions(operations, swap_quality.valid() ? swap_quality() : 0.95,
+											  smoothing_passes.valid() ? smoothing_passes() : 10, adapt_log);
+				std::chrono::duration<double> adapt_duration = std::chrono::system_clock::now() - wall_tic;
+				viennamesh::info(1) << "  Coarsening, swapping and smoothing time " << adapt_duration.count() << std::endl;
+			}
+
 			std::chrono::duration<double> overall_duration = std::chrono::system_clock::now() - overall_tic;
 			
 			int r_vertices {0};
@@ -155,6 +234,11 @@ namespace viennamesh
 
 			for (size_t i =0; i < refine_log.size(); ++i)
 				csv << refine_log[i] << ", ";
+
+			for (size_t i =0; i < adapt_log.size(); ++i)
+				csv << adapt_log[i] << ", ";
+
+			csv << heal_edges << ", " << heal_time_per_kedge << ", ";
 				
 			csv << std::endl;
 			csv.close();
@@ -468,6 +552,38 @@ namespace viennamesh
 			set_output("mesh", output_mesh);
 			set_output("colors", InputMesh.get_colors());
 
+			//output the carried quantity fields in the vertex order of the output mesh(es), for multi mesh output
+			//the fields of partition i are stored at i*carried_quantities.size()+j
+			if (!carried_quantities.empty())
+			{
+				bool single_mesh = single_mesh_output.valid() && single_mesh_output();
+				size_t output_meshes = single_mesh ? 1 : InputMesh.pragmatic_partitions.size();
+
+				std::vector< std::vector<viennagrid::quantity_field> > fields(output_meshes);
+				for (size_t i = 0; i != output_meshes; ++i)
+					fields[i] = viennamesh::make_vertex_quantities(carried_quantities);
+
+				int vertex = 0;
+				for (size_t i = 0; i != InputMesh.pragmatic_partitions.size(); ++i)
+				{
+					Mesh<double>* partition = InputMesh.pragmatic_partitions[i];
+
+					if (!single_mesh)
+						vertex = 0;
+
+					for (size_t v = 0; v < partition->get_number_nodes(); ++v, ++vertex)
+						viennamesh::scatter_vertex_quantities(fields[single_mesh ? 0 : i], vertex, partition->get_fields(v));
+				}
+
+				quantity_field_handle output_quantities = make_data<viennagrid::quantity_field>();
+				output_quantities.resize( output_meshes*carried_quantities.size() );
+				for (size_t i = 0; i != output_meshes; ++i)
+					for (size_t j = 0; j != carried_quantities.size(); ++j)
+						output_quantities.set(i*carried_quantities.size()+j, fields[i][j]);
+
+				set_output("quantities", output_quantities);
+			}
+
 			//delete in_mesh;
 
 			return true;
@@ -0,0 +1,105 @@
+#ifndef EDGE_ELEMENT_TABLE_HPP
+#define EDGE_ELEMENT_TABLE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#include "Mesh.h"
+
+//class EdgeElementTable
+//
+//Maps every edge of a pragmatic partition to the elements containing it together with the local edge number of the edge
+//in each element (same numbering as MeshPartitions::edgeNumber). The table is built once per partition and updated for the
+//elements changed by a split, so finding the elements of an interface edge does not need NEList intersections.
+class EdgeElementTable
+{
+    public:
+        struct entry
+        {
+            index_t eid;
+            int edge;
+        };
+
+        //Inserts all elements of the partition
+        void build(Mesh<double>* partition)
+        {
+            table.clear();
+            table.reserve( (partition->get_number_dimensions() == 2 ? 3 : 6) * partition->get_number_elements() );
+
+            for (size_t eid = 0; eid < partition->get_number_elements(); ++eid)
+                insert_element(partition, eid);
+        }
+
+        //Inserts all edges of element eid, has to be called after an element has been created or replaced
+        void insert_element(Mesh<double>* partition, index_t eid)
+        {
+            const index_t *n = partition->get_element(eid);
+            if (n[0] < 0)
+                return;
+
+            int nedge = (partition->get_number_dimensions() == 2) ? 3 : 6;
+            for (int e = 0; e < nedge; ++e)
+            {
+                entry value = {eid, e};
+                table.insert( std::make_pair(key(n, e, nedge), value) );
+            }
+        }
+
+        //Removes all edges of element eid, has to be called before an element is replaced
+        void erase_element(Mesh<double>* partition, index_t eid)
+        {
+            const index_t *n = partition->get_element(eid);
+            if (n[0] < 0)
+                return;
+
+            int nedge = (partition->get_number_dimensions() == 2) ? 3 : 6;
+            for (int e = 0; e < nedge; ++e)
+            {
+                auto range = table.equal_range( key(n, e, nedge) );
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (it->second.eid == eid)
+                    {
+                        table.erase(it);
+                        break;
+                    }
+                }
+            }
+        }
+
+        //Calls f(eid, edge) for every element containing the edge (v1, v2)
+        template<typename FunctorT>
+        void for_each_element(index_t v1, index_t v2, FunctorT f) const
+        {
+            auto range = table.equal_range( key(v1, v2) );
+            for (auto it = range.first; it != range.second; ++it)
+                f(it->second.eid, it->second.edge);
+        }
+
+    private:
+        static std::uint64_t key(index_t v1, index_t v2)
+        {
+            if (v1 > v2)
+                std::swap(v1, v2);
+
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(v1)) << 32) | static_cast<std::uint32_t>(v2);
+        }
+
+        //Key of local edge e of element n, in 2D edge i is opposite to node i, in 3D the edges are
+        //(n[0],n[1]), (n[0],n[2]), (n[0],n[3]), (n[1],n[2]), (n[1],n[3]), (n[2],n[3])
+        static std::uint64_t key(const index_t *n, int e, int nedge)
+        {
+            static const int edges_2d[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+            static const int edges_3d[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+
+            if (nedge == 3)
+                return key(n[edges_2d[e][0]], n[edges_2d[e][1]]);
+
+            return key(n[edges_3d[e][0]], n[edges_3d[e][1]]);
+        }
+
+        std::unordered_multimap<std::uint64_t, entry> table;
+};
+
+#endif //EDGE_ELEMENT_TABLE_HPP
@@ -157,7 +157,7 @@ public:
     }
 
     /// Add a new vertex
-    index_t append_vertex(const real_t *x, const double *m)
+    index_t append_vertex(const real_t *x, const double *m, const double *f=NULL)
     {
         for(size_t i=0; i<ndims; i++)
             _coords[ndims*NNodes+i] = x[i];
@@ -165,6 +165,10 @@ public:
         for(size_t i=0; i<msize; i++)
             metric[msize*NNodes+i] = m[i];
 
+        if(f!=NULL)
+            for(size_t i=0; i<nfields; i++)
+                fields[nfields*NNodes+i] = f[i];
+
         ++NNodes;
 
         return get_number_nodes()-1;
@@ -445,6 +449,46 @@ public:
         return;
     }
 
+    /*! Attach vertex fields which are carried through adaptation: new
+     * vertices get interpolated values, moved vertices are re-interpolated
+     * and defragment() keeps the values with their vertices.
+     *
+     * @param values array of NNodes*n values, the n values of each vertex are consecutive.
+     * @param n number of values per vertex (the sum of the components of all fields).
+     */
+    void set_fields(const double *values, size_t n)
+    {
+        nfields = n;
+        fields.resize((_coords.size()/ndims)*nfields);
+        if(NNodes*nfields>0)
+            memcpy(&fields[0], values, NNodes*nfields*sizeof(double));
+    }
+
+    /// Return the number of field values per vertex.
+    inline size_t get_number_fields() const
+    {
+        return nfields;
+    }
+
+    /// Return the field values of a vertex.
+    inline const double *get_fields(index_t nid) const
+    {
+        assert(nfields>0);
+        return &(fields[nid*nfields]);
+    }
+
+    /// Set the field values of nid to the weighted sum of the values of n nodes,
+    /// nid may be one of the nodes.
+    inline void interpolate_fields(index_t nid, size_t n, const index_t *nodes, const real_t *weights)
+    {
+        for(size_t i=0; i<nfields; i++) {
+            double value = 0.0;
+            for(size_t j=0; j<n; j++)
+                value += weights[j]*fields[nodes[j]*nfields+i];
+            fields[nid*nfields+i] = value;
+        }
+    }
+
     // Returns the list of facets and corresponding ids
     void get_boundary(int* nfacets, const int** facets, const int** ids)
     {
@@ -583,6 +627,7 @@ public:
       {
             _coords.resize(reserve*dim);
             metric.resize(reserve*msize);
+            fields.resize(reserve*nfields);
             NNList.resize(reserve);
             NEList.resize(reserve);       
       }
@@ -1212,6 +1257,7 @@ public:
         std::vector<index_t> defrag_ENList(NElements*nloc);
         std::vector<real_t> defrag_coords(NNodes*ndims);
         std::vector<double> defrag_metric(NNodes*msize);
+        std::vector<double> defrag_fields(NNodes*nfields);
         std::vector<int> defrag_boundary(NElements*nloc);
         std::vector<double> defrag_quality(NElements);
 
@@ -1254,6 +1300,8 @@ public:
                 defrag_coords[new_nid*ndims+j] = _coords[old_nid*ndims+j];
             for(size_t j=0; j<msize; j++)
                 defrag_metric[new_nid*msize+j] = metric[old_nid*msize+j];
+            for(size_t j=0; j<nfields; j++)
+                defrag_fields[new_nid*nfields+j] = fields[old_nid*nfields+j];
         }
 
         memcpy(&_ENList[0], &defrag_ENList[0], NElements*nloc*sizeof(index_t));
@@ -1261,6 +1309,8 @@ public:
         memcpy(&quality[0], &defrag_quality[0], NElements*sizeof(double));
         memcpy(&_coords[0], &defrag_coords[0], NNodes*ndims*sizeof(real_t));
         memcpy(&metric[0], &defrag_metric[0], NNodes*msize*sizeof(double));
+        if(NNodes*nfields>0)
+            memcpy(&fields[0], &defrag_fields[0], NNodes*nfields*sizeof(double));
 
         // Renumber halo, fix lnn2gnn and node_owner.
         if(num_processes>1) {
@@ -1622,6 +1672,7 @@ private:
 
         NElements = _NElements;
         NNodes = _NNodes;
+        nfields = 0;
 
 #ifdef HAVE_MPI
         MPI_Comm_size(_mpi_comm, &num_processes);
@@ -2181,6 +2232,10 @@ private:
     // Metric tensor field.
     std::vector<double> metric;
 
+    // Vertex fields carried through adaptation, nfields values per vertex.
+    size_t nfields;
+    std::vector<double> fields;
+
     // Parallel support.
     int rank, num_processes, nthreads;
     std::vector< std::vector<index_t> > send, recv;
@@ -104,6 +104,7 @@ public:
         newQualities.resize(nthreads);
         newCoords.resize(nthreads);
         newMetric.resize(nthreads);
+        newFields.resize(nthreads);
 
         // Pre-allocate the maximum size that might be required
         allNewVertices.resize(_mesh->_ENList.size());
@@ -210,6 +211,8 @@ public:
             newCoords[tid].reserve(dim*reserve_size);
             newMetric[tid].clear();
             newMetric[tid].reserve(msize*reserve_size);
+            newFields[tid].clear();
+            newFields[tid].reserve(_mesh->nfields*reserve_size);
 
             /* Loop through all edges and select them for refinement if
                its length is greater than L_max in transformed space. */
@@ -382,6 +385,7 @@ public:
                 if(_mesh->_coords.size()<reserve*dim) {
                     _mesh->_coords.resize(reserve*dim);
                     _mesh->metric.resize(reserve*msize);
+                    _mesh->fields.resize(reserve*_mesh->nfields);
                     _mesh->NNList.resize(reserve);
                     _mesh->NEList.resize(reserve);
                     _mesh->node_owner.resize(reserve);
@@ -393,6 +397,8 @@ public:
             // Append new coords and metric to the mesh.
             memcpy(&_mesh->_coords[dim*threadIdx[tid]], &newCoords[tid][0], dim*splitCnt[tid]*sizeof(real_t));
             memcpy(&_mesh->metric[msize*threadIdx[tid]], &newMetric[tid][0], msize*splitCnt[tid]*sizeof(double));
+            if(_mesh->nfields*splitCnt[tid]>0)
+                memcpy(&_mesh->fields[_mesh->nfields*threadIdx[tid]], &newFields[tid][0], _mesh->nfields*splitCnt[tid]*sizeof(double));
 
             // Fix IDs of new vertices
             assert(newVertices[tid].size()==splitCnt[tid]);
@@ -783,6 +789,13 @@ private:
                              <<"property->length(x0, x1, m1) = "<<property->template length<dim>(x0, x1, m1)<<std::endl
                                      <<"weight = "<<weight<<std::endl;
         }
+
+        // Interpolate vertex fields with the same weight
+        for(size_t i=0; i<_mesh->nfields; i++) {
+            const double f0 = _mesh->fields[n0*_mesh->nfields+i];
+            const double f1 = _mesh->fields[n1*_mesh->nfields+i];
+            newFields[tid].push_back(f0+weight*(f1 - f0));
+        }
     }
 
     //MY IMPLEMENTATION
@@ -834,6 +847,13 @@ private:
                              <<"property->length(x0, x1, m1) = "<<property->template length<dim>(x0, x1, m1)<<std::endl
                                      <<"weight = "<<weight<<std::endl;
         }
+
+        // Interpolate vertex fields with the same weight
+        for(size_t i=0; i<_mesh->nfields; i++) {
+            const double f0 = _mesh->fields[n0*_mesh->nfields+i];
+            const double f1 = _mesh->fields[n1*_mesh->nfields+i];
+            newFields[tid].push_back(f0+weight*(f1 - f0));
+        }
     } //END OF MY IMPLEMENTATION
 
     inline void refine_facet(index_t eid, const index_t *facet, int tid)
@@ -2934,6 +2954,8 @@ private:
                             ll[3] * _mesh->metric[sorted_n[3]*msize+i];
                     _mesh->metric[cid*msize+i] = nm[i];
                 }
+
+                _mesh->interpolate_fields(cid, nloc, &sorted_n[0], ll);
             }
 
             // Use the 3D laplacian smoothing kernel to find the barycentre of the wedge in metric space.
@@ -3022,6 +3044,8 @@ private:
                                              l[2]*_mesh->metric[sorted_best_e[2]*msize+i]+
                                              l[3]*_mesh->metric[sorted_best_e[3]*msize+i];
 
+            _mesh->interpolate_fields(cid, nloc, &sorted_best_e[0], l);
+
             append_element(ele1, ele1_boundary, tid);
             append_element(ele2, ele2_boundary, tid);
             append_element(ele3, ele3_boundary, tid);
@@ -3296,6 +3320,7 @@ private:
     std::vector< std::vector< DirectedEdge<index_t> > > newVertices;
     std::vector< std::vector<real_t> > newCoords;
     std::vector< std::vector<double> > newMetric;
+    std::vector< std::vector<double> > newFields;
     std::vector< std::vector<index_t> > newElements;
     std::vector< std::vector<int> > newBoundaries;
     std::vector< std::vector<double> > newQualities;
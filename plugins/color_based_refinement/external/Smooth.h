@@ -563,6 +563,7 @@ private:
         if(!valid)
             return false;
 
+        update_fields(node, p);
         for(size_t j=0; j<2; j++)
             _mesh->_coords[node*2+j] = p[j];
 
@@ -592,6 +593,7 @@ private:
         if(!valid)
             return false;
 
+        update_fields(node, p);
         for(size_t j=0; j<3; j++)
             _mesh->_coords[node*3+j] = p[j];
 
@@ -737,6 +739,7 @@ private:
         if(functional-functional_orig<epsilon_q)
             return false;
 
+        update_fields(node, p);
         for(size_t j=0; j<2; j++)
             _mesh->_coords[node*2+j] = p[j];
 
@@ -774,6 +777,7 @@ private:
         if(functional-functional_orig<epsilon_q)
             return false;
 
+        update_fields(node, p);
         for(size_t j=0; j<3; j++)
             _mesh->_coords[node*3+j] = p[j];
 
@@ -949,6 +953,7 @@ private:
             }
             assert(new_quality.empty());
 
+            update_fields(n0, new_x0);
             for(size_t i=0; i<dim; i++)
                 _mesh->_coords[n0*dim+i] = new_x0[i];
 
@@ -1185,6 +1190,7 @@ private:
             }
             assert(new_quality.empty());
 
+            update_fields(n0, new_x0);
             for(size_t i=0; i<dim; i++)
                 _mesh->_coords[n0*dim+i] = new_x0[i];
 
@@ -1316,6 +1322,52 @@ private:
         return functional;
     }
 
+    // Re-interpolates the vertex fields of node at its new position p from
+    // the cavity element containing p, has to be called before the
+    // coordinates of node are updated.
+    inline void update_fields(index_t node, const real_t *p)
+    {
+        if(_mesh->nfields==0)
+            return;
+
+        real_t l[4], best_l[4];
+        const index_t *best_n=NULL;
+        real_t tol=-std::numeric_limits<real_t>::max();
+
+        for(const auto& ie : _mesh->NEList[node]) {
+            const index_t *n=_mesh->get_element(ie);
+            assert(n[0]>=0);
+
+            const real_t *x0 = _mesh->get_coords(n[0]);
+            const real_t *x1 = _mesh->get_coords(n[1]);
+            const real_t *x2 = _mesh->get_coords(n[2]);
+
+            if(dim==2) {
+                real_t L = property->area(x0, x1, x2);
+                l[0] = property->area(p,  x1, x2)/L;
+                l[1] = property->area(x0, p,  x2)/L;
+                l[2] = property->area(x0, x1, p )/L;
+            } else {
+                const real_t *x3 = _mesh->get_coords(n[3]);
+                real_t L = property->volume(x0, x1, x2, x3);
+                l[0] = property->volume(p,  x1, x2, x3)/L;
+                l[1] = property->volume(x0, p,  x2, x3)/L;
+                l[2] = property->volume(x0, x1, p,  x3)/L;
+                l[3] = property->volume(x0, x1, x2, p )/L;
+            }
+
+            real_t min_l = *std::min_element(l, l+nloc);
+            if(min_l>tol) {
+                tol = min_l;
+                best_n = n;
+                std::copy(l, l+nloc, best_l);
+            }
+        }
+
+        if(best_n!=NULL)
+            _mesh->interpolate_fields(node, nloc, best_n, best_l);
+    }
+
     inline bool generate_location_2d(index_t node, const real_t *p, double *mp) const
     {
         // Interpolate metric at this new position.
@@ -9,6 +9,8 @@
 #include "ElementProperty.h"
 #include "Edge.h"
 #include "Swapping.h"
+#include "Coarsen.h"
+#include "Smooth.h"
 
 //TODO: DEBUG
 #include "VTKTools.h"
@@ -28,6 +30,7 @@
 #include <boost/container/flat_map.hpp>
 
 #include "outbox.hpp"
+#include "edge_element_table.hpp"
 
 #ifdef HAVE_OPENMP
     #include <omp.h>
@@ -69,13 +72,16 @@ class MeshPartitions
         bool CreatePragmaticDataStructures_par(std::string algorithm, std::vector<double>& threads_log, 
                                                std::vector<double>& heal_log, std::vector<double>& metric_log,
                                                std::vector<double>& call_refine_log, std::vector<double>& refine_log,
-                                               std::vector<double>& mesh_log);
+                                               std::vector<double>& mesh_log, std::vector<int>& heal_edges_log);
         bool CreateNeighborhoodInformation();                                                 //Create neighborhood information for vertices and partitions
         bool ColorPartitions();                                                               //Color the partitions
         bool WritePartitions();                                                               //ONLY FOR DEBUGGING!
         bool RefineInterior();                                                                //Refinement without refining boundary elements
         bool WriteMergedMesh(std::string filename);                                           //Merges partitions into a single mesh and writes it
         bool RefinementKernel(int part, double L_max);
+        bool AdaptPartitions(std::vector<std::string> const& operations, double swap_quality,
+                             int smoothing_passes, std::vector<double>& adapt_log);           //Coarsen, swap and smooth the partitions with locked interfaces
+        void SetFields(const double *values, size_t n);                                      //Sets vertex fields of the original mesh which are carried into the partitions
 
         int get_colors(){return colors;};
         int get_max(){return max;};
@@ -151,9 +157,19 @@ class MeshPartitions
 
         int edgeNumber(Mesh<double>*& partition, index_t eid, index_t v1, index_t v2);
 
+        //Coarsening, swapping and smoothing of a single partition
+        template<int dim> void AdaptationKernel(Mesh<double>* partition, std::vector<std::string> const& operations,
+                                                double swap_quality, int smoothing_passes);
+        void LockInterface(Mesh<double>* partition);                                          //Marks all partition boundary vertices as halo nodes
+        void DefragmentPartition(int part_id);                                                //Compresses a partition and updates its vertex mappings
+
         //Outboxes
         std::vector<Outbox> outboxes;
 
+        //Vertex fields of the original mesh, nfields values per vertex
+        size_t nfields;
+        std::vector<double> fields;
+
 
         //ElementProperty<double> *property;
 
@@ -291,8 +307,19 @@ MeshPartitions::MeshPartitions(Mesh<double> * orig_mesh, int nregions, std::stri
     num_regions = nregions;
     nthreads = threads;
     file = filename;
+    nfields = 0;
 } //end of Constructor
 
+//SetFields
+//
+//Tasks: Stores n field values per vertex of the original mesh, each partition gets the values of its vertices
+//and carries them through healing and adaptation (see Mesh::set_fields)
+void MeshPartitions::SetFields(const double *values, size_t n)
+{
+    nfields = n;
+    fields.assign(values, values + original_mesh->get_number_nodes()*nfields);
+} //end of SetFields
+
 //Destructor
 //
 //Tasks: TODO
@@ -897,7 +924,7 @@ bool MeshPartitions::CreatePragmaticDataStructures_ser()
 bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, std::vector<double>& threads_log, 
                                                        std::vector<double>& heal_log, std::vector<double>& metric_log,
                                                        std::vector<double>& call_refine_log, std::vector<double>& refine_log,
-                                                       std::vector<double>& mesh_log)
+                                                       std::vector<double>& mesh_log, std::vector<int>& heal_edges_log)
 {    
     viennamesh::info(1) << "Starting mesh adaptation" << std::endl;
     /*
@@ -920,6 +947,7 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
     metric_log.resize(nthreads);
     call_refine_log.resize(nthreads);
     refine_log.resize(nthreads);
+    heal_edges_log.resize(nthreads);
 
     std::fill(threads_log.begin(), threads_log.end(), 0.0);
     std::fill(mesh_log.begin(), mesh_log.end(), 0.0);
@@ -927,6 +955,7 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
     std::fill(metric_log.begin(), metric_log.end(), 0.0);
     std::fill(call_refine_log.begin(), call_refine_log.end(), 0.0);
     std::fill(refine_log.begin(), refine_log.end(), 0.0);
+    std::fill(heal_edges_log.begin(), heal_edges_log.end(), 0);
 
     outboxes.resize(num_regions, Outbox());
 /*
@@ -1261,6 +1290,18 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                 std::cout << it.first << " " << it.second << std::endl;
 */
             partition->create_boundary();
+
+            //hand the fields of the partition vertices to the partition
+            if (nfields > 0)
+            {
+                std::vector<double> fields_part(num_points_part*nfields);
+
+                for (int i = 0; i < num_points_part; ++i)
+                    for (size_t j = 0; j < nfields; ++j)
+                        fields_part[i*nfields+j] = fields[l2g_vertices_tmp[i]*nfields+j];
+
+                partition->set_fields(&(fields_part[0]), nfields);
+            }
             
             auto mesh_toc = omp_get_wtime();
 /*
@@ -1317,6 +1358,10 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                     break;
                 }
 
+                //edge to element table of the partition, built once for the first outbox and updated on every split
+                EdgeElementTable edge_elements;
+                bool edge_elements_built = false;
+
                 for (auto it : partition_adjcy[part_id])
                 {
                     //std::cout << std::endl << "   check if color of partition " << it << " is smaller than own color" << std::endl;
@@ -1351,6 +1396,16 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                         }
 //*/
                         auto verts_in_part = outboxes[it].verts_in_part(part_id);
+                        if (verts_in_part == 0)
+                            continue;
+
+                        if (!edge_elements_built)
+                        {
+                            edge_elements.build(partition);
+                            edge_elements_built = true;
+                        }
+
+                        heal_edges_log[omp_get_thread_num()] += verts_in_part;
                         //std::cout << " vertices in that outbox for this partition: " << verts_in_part << std::endl;
                         //auto verts_in_outbox_for_my_partition = std::count(outboxes[it].begin(), outboxes[it].end());
                         std::vector<int> outbox_mapping(verts_in_part, -1);
@@ -1371,6 +1426,7 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                             //std::cout << " Resizing! " << reserve << std::endl;
                             partition->_coords.resize(reserve*dim);
                             partition->metric.resize(reserve*msize); //CHANGE 3 to 6 FOR 3D-CASE!!!!
+                            partition->fields.resize(reserve*nfields);
                             partition->NNList.resize(reserve);
                             partition->NEList.resize(reserve);
                             partition->node_owner.resize(reserve);
@@ -1381,29 +1437,25 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
 
                         //std::cout << " Append new coords and new metrics to the partition" << std::endl;
 
+                        //the messages of the neighbor for this partition, new_vert is the local id of the vertex in partition it
+                        Outbox::message const* messages = outboxes[it].begin(part_id);
+
                         //Append new coords and new metrics to the partition
-                        for (size_t i = 0, j = 0; i < outboxes[it].num_verts(); ++i)
+                        for (int j = 0; j < verts_in_part; ++j)
                         {
-                            if (outboxes[it][4*i] != part_id)
-                            {
-                                //std::cout << i << " is not in this partition" << std::endl;
-                                continue;
-                            }
-                            //get 3rd element due to construction of outbox vector (3rd ele is local id of vertex in partition it)
-                            //std::cout << "outb " << i << std::endl;
                             //double p[2] {0.0, 0.0};
                             double p[dim];
-                            pragmatic_partitions[it]->get_coords(outboxes[it][4*i+3], p);
+                            pragmatic_partitions[it]->get_coords(messages[j].new_vert, p);
 
                             //double m[3] {0.0, 0.0, 0.0};
-                            double m[dim+1];
-                            pragmatic_partitions[it]->get_metric(outboxes[it][4*i+3], m);
+                            double m[msize];
+                            pragmatic_partitions[it]->get_metric(messages[j].new_vert, m);
 
-                            partition->append_vertex(p, m);
+                            //the neighbor interpolated the fields of the new vertex on the same edge
+                            partition->append_vertex(p, m, nfields > 0 ? pragmatic_partitions[it]->get_fields(messages[j].new_vert) : NULL);
 //                            std::cout << partition->get_number_nodes() << std::endl;
 
                             outbox_mapping[j] = partition->get_number_nodes()-1; 
-                            ++j;
                         }
                         //std::cout << " outbox mapping has " << outbox_mapping.size() << " entries" << std::endl;
 /*
@@ -1418,19 +1470,10 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
 
                         // Mark each element with its new vertices,
                         // update NNList for all split edges.
-                        for (size_t i = 0, j = 0; i < outboxes[it].num_verts(); ++i)
+                        for (int j = 0; j < verts_in_part; ++j)
                         {
-                            if (outboxes[it][4*i] != part_id)
-                            {
-                                //std::cout << " skip " << i << std::endl;
-                                continue;
-                            }
-
-                            //std::cout << " process entry " << i  << std::endl;
-
-                            auto vid = outboxes[it][4*i+3];
-                            auto glob_firstid = outboxes[it][4*i+1];
-                            auto glob_secondid = outboxes[it][4*i+2];
+                            auto glob_firstid = messages[j].v1;
+                            auto glob_secondid = messages[j].v2;
 
                             
                             ///std::cout << vid << " is " << local_vid << std::endl;
@@ -1454,37 +1497,11 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                             std::cout << "coords for local_vid: " << p[0] << p[1] << std::endl; 
 //*/
                             // Find which elements share this edge and mark them with their new vertices.
-                            std::set<int> NEList_firstid = partition->get_nelist(firstid);
-                            std::set<int> NEList_secondid = partition->get_nelist(secondid);
-
-                           // std::cout << "got NELists for " << firstid << " and " << secondid << std::endl;
-
-                            std::set<index_t> intersection;
-                            std::set_intersection(NEList_firstid.begin(), NEList_firstid.end(),
-                                                  NEList_secondid.begin(), NEList_secondid.end(),
-                                                  std::inserter(intersection, intersection.begin()));
-
-                            for (auto ele_iter : intersection)
+                            edge_elements.for_each_element(firstid, secondid, [&](index_t ele_iter, int edgeOffset)
                             {
-                                //std::cout << "Part_id: " << part_id << ", outboxes[it]: " << it << std::endl;
-                                //std::cout << " compute edgenumber" << std::endl;
-                                size_t edgeOffset = edgeNumber(partition, ele_iter, firstid, secondid);
-
-                                if (nedge*ele_iter+edgeOffset > new_vertices_per_element.size())
-                                {
-                                    viennamesh::error(1) << "Part_id: " << part_id << ", outboxes[it]: " << it << std::endl;
-                                    viennamesh::error(1) << " outboxes[it][4*i]: " << outboxes[it][4*i] << std::endl;
-                                    viennamesh::error(1) << " i: " << i << ", local_vid: " << local_vid << std::endl;
-                                    viennamesh::error(1) << " firstid: " << firstid << ", secondid: " << secondid << std::endl; 
-                                    viennamesh::error(1) << " got edgenumber: " << edgeOffset << std::endl;
-                                    viennamesh::error(1) << " new_vertices_per_element.size = " << new_vertices_per_element.size() << std::endl;
-                                    viennamesh::error(1) << " nedge: " << nedge << ", " << " eid: " << ele_iter << ", " << nedge*ele_iter + edgeOffset << std::endl;
-                                }
-
                                 new_vertices_per_element[nedge*ele_iter+edgeOffset] = local_vid;
-                                //std::cout << " put it also into new_vertices_per_element" << std::endl;
                                 elements_to_heal.insert(ele_iter);
-                            }
+                            });
 
                             /*std::cout << "  Update NNList for newly created vertices " << orig_NNodes << " " << j << std::endl;/*
                             std::cout << "NNList.size: " << partition->NNList.size() << std::endl;
@@ -1504,9 +1521,6 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                             //std::cout << "  NNList remove nnlist secondid" << std::endl;
                             partition->add_nnlist(secondid, local_vid);
                             //std::cout << "  NNList add nnlist secondid" << std::endl;
-
-                            ++j;
-                            //*/
                         } //end of update NNList for all split edges
 
                         /*
@@ -1566,22 +1580,20 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
 
                                 for(int j=0; j<4; ++j) 
                                 {
-                                    // Find which elements share this facet j
+                                    // Find the element with the highest ID sharing this facet j,
+                                    // these are the elements of the edge (facet[0], facet[1]) containing facet[2]
                                     const index_t *facet = facets[j];
-                                    std::set<index_t> intersection01, EE;
-                                    std::set_intersection(partition->NEList[facet[0]].begin(), partition->NEList[facet[0]].end(),
-                                                        partition->NEList[facet[1]].begin(), partition->NEList[facet[1]].end(),
-                                                        std::inserter(intersection01, intersection01.begin()));
-                                    std::set_intersection(partition->NEList[facet[2]].begin(), partition->NEList[facet[2]].end(),
-                                                        intersection01.begin(), intersection01.end(),
-                                                        std::inserter(EE, EE.begin()));
-
-                                    assert(EE.size() <= 2 );
-                                    assert(EE.count(eid) == 1);
+                                    index_t max_eid = -1;
+                                    edge_elements.for_each_element(facet[0], facet[1], [&](index_t ele_iter, int)
+                                    {
+                                        const index_t *m = partition->get_element(ele_iter);
+                                        if (m[0] == facet[2] || m[1] == facet[2] || m[2] == facet[2] || m[3] == facet[2])
+                                            max_eid = std::max(max_eid, ele_iter);
+                                    });
 
                                     // Prevent facet from being refined twice:
                                     // Only refine it if this is the element with the highest ID.
-                                    if(eid == *EE.rbegin())
+                                    if(eid == max_eid)
                                     {
                                         for(size_t k=0; k<3; ++k)
                                         {
@@ -1613,6 +1625,10 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                         // std::cout << "start element healing" << std::endl;
                         auto splitCnt = 0;
 
+                        //the healed elements are replaced, remove their edges from the edge to element table
+                        for (auto ele_id : elements_to_heal)
+                            edge_elements.erase_element(partition, ele_id);
+
                         for (auto ele_id : elements_to_heal)
                         {
                            // std::cout << "ele_id " << ele_id << ", nedge " << nedge << std::endl;
@@ -1714,6 +1730,13 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
 
                         } //end of element healing*/
 
+                        //insert the replaced and the new elements into the edge to element table
+                        for (auto ele_id : elements_to_heal)
+                            edge_elements.insert_element(partition, ele_id);
+
+                        for (size_t ele_id = origNElements; ele_id < partition->get_number_elements(); ++ele_id)
+                            edge_elements.insert_element(partition, ele_id);
+
                         /*
                         //DEBUG
                         for (size_t i = 0; i < new_vertices_per_element.size(); ++i)
@@ -1852,6 +1875,8 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                     g2l_vertex[part_id] = g2l_vertices_tmp;
                     l2g_element[part_id] = l2g_elements_tmp;
                     g2l_element[part_id] = g2l_elements_tmp;
+                    //bucket the interface messages by their target partition before the next color reads them
+                    outbox_data.build();
                     outboxes[part_id]=outbox_data;
                 }
 
@@ -1873,6 +1898,8 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
                     g2l_vertex[part_id] = g2l_vertices_tmp;
                     l2g_element[part_id] = l2g_elements_tmp;
                     g2l_element[part_id] = g2l_elements_tmp;
+                    //bucket the interface messages by their target partition before the next color reads them
+                    outbox_data.build();
                     outboxes[part_id]=outbox_data; 
                 } 
 
@@ -2018,6 +2045,162 @@ bool MeshPartitions::CreatePragmaticDataStructures_par(std::string algorithm, st
 }
 //end of CreatePragmaticDataStructures_par
 
+//AdaptPartitions
+//
+//Tasks: Coarsens, swaps and smoothes all pragmatic partitions after the refinement. The operations are applied in the given order.
+//Every vertex on the boundary of a partition (this includes the interfaces to the neighboring partitions) is locked as a halo node,
+//so the pragmatic kernels only modify the interior of a partition and the partitions stay conforming. Since no data has to be
+//exchanged over the interfaces (unlike the outboxes of the refinement), the partitions are not processed color by color.
+bool MeshPartitions::AdaptPartitions(std::vector<std::string> const& operations, double swap_quality,
+                                     int smoothing_passes, std::vector<double>& adapt_log)
+{
+    adapt_log.resize(nthreads);
+    std::fill(adapt_log.begin(), adapt_log.end(), 0.0);
+
+    int dim = original_mesh->get_number_dimensions();
+
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (size_t part_id = 0; part_id < pragmatic_partitions.size(); ++part_id)
+    {
+        auto adapt_tic = omp_get_wtime();
+
+        Mesh<double>* partition = pragmatic_partitions[part_id];
+
+        LockInterface(partition);
+
+        if (dim == 2)
+            AdaptationKernel<2>(partition, operations, swap_quality, smoothing_passes);
+
+        else
+            AdaptationKernel<3>(partition, operations, swap_quality, smoothing_passes);
+
+        //removes the collapsed vertices and elements, this also releases the interface lock
+        DefragmentPartition(part_id);
+
+        adapt_log[omp_get_thread_num()] += omp_get_wtime() - adapt_tic;
+    }
+
+    viennamesh::info(1) << "Successfully coarsened, swapped and smoothed the partitions" << std::endl;
+
+    return true;
+}
+//end of AdaptPartitions
+
+//AdaptationKernel
+//
+//Tasks: Applies the pragmatic coarsening, swapping and smoothing kernels to a single partition, using the same
+//parameters as the pragmatic_coarsen, pragmatic_swapping and pragmatic_smooth plugins
+template<int dim>
+void MeshPartitions::AdaptationKernel(Mesh<double>* partition, std::vector<std::string> const& operations,
+                                      double swap_quality, int smoothing_passes)
+{
+    for (auto const& operation : operations)
+    {
+        if (operation == "coarsen")
+        {
+            double L_up = sqrt(2.0);
+            double L_low = L_up*0.5;
+
+            Coarsen<double,dim> coarsener(*partition);
+            coarsener.coarsen(L_low, L_up);
+        }
+
+        else if (operation == "swap")
+        {
+            Swapping<double,dim> swapper(*partition);
+            swapper.swap(swap_quality);
+        }
+
+        else if (operation == "smooth")
+        {
+            Smooth<double,dim> smoother(*partition);
+            smoother.smart_laplacian(smoothing_passes);
+        }
+    }
+}
+//end of AdaptationKernel
+
+//LockInterface
+//
+//Tasks: Marks all vertices of boundary facets of a partition as owned by another process, pragmatic treats them as
+//halo nodes which are neither collapsed nor moved, and edges between two halo nodes are not swapped
+void MeshPartitions::LockInterface(Mesh<double>* partition)
+{
+    int nloc = partition->get_number_dimensions()+1;
+    int locked_owner = partition->rank+1;
+
+    if (partition->node_owner.size() < partition->get_number_nodes())
+        partition->node_owner.resize(partition->get_number_nodes(), partition->rank);
+
+    for (size_t eid = 0; eid < partition->get_number_elements(); ++eid)
+    {
+        const index_t *n = partition->get_element(eid);
+        if (n[0] < 0)
+            continue;
+
+        for (int j = 0; j < nloc; ++j)
+        {
+            //facet j is opposite to vertex j
+            if (partition->boundary[eid*nloc+j] <= 0)
+                continue;
+
+            for (int k = 0; k < nloc; ++k)
+            {
+                if (k != j)
+                    partition->node_owner[n[k]] = locked_owner;
+            }
+        }
+    }
+}
+//end of LockInterface
+
+//DefragmentPartition
+//
+//Tasks: Defragments a partition and applies the new vertex numbering to its index mappings. defragment() keeps the
+//vertices which are still used by an element and numbers them in their old order. Vertices created by the refinement
+//have no global id and are mapped to -1. The element mappings are not valid anymore and are cleared.
+void MeshPartitions::DefragmentPartition(int part_id)
+{
+    Mesh<double>* partition = pragmatic_partitions[part_id];
+    int nloc = partition->get_number_dimensions()+1;
+
+    std::vector<char> used_vertex(partition->get_number_nodes(), 0);
+
+    for (size_t eid = 0; eid < partition->get_number_elements(); ++eid)
+    {
+        const index_t *n = partition->get_element(eid);
+        if (n[0] < 0)
+            continue;
+
+        for (int k = 0; k < nloc; ++k)
+            used_vertex[n[k]] = 1;
+    }
+
+    std::vector<int> l2g_vertices_tmp;
+    std::unordered_map<index_t, index_t> g2l_vertices_tmp;
+
+    for (size_t i = 0; i < used_vertex.size(); ++i)
+    {
+        if (!used_vertex[i])
+            continue;
+
+        int global_id = (i < l2g_vertex[part_id].size()) ? l2g_vertex[part_id][i] : -1;
+
+        if (global_id >= 0)
+            g2l_vertices_tmp.insert( std::make_pair(global_id, l2g_vertices_tmp.size()) );
+
+        l2g_vertices_tmp.push_back(global_id);
+    }
+
+    partition->defragment();
+
+    l2g_vertex[part_id].swap(l2g_vertices_tmp);
+    g2l_vertex[part_id].swap(g2l_vertices_tmp);
+    l2g_element[part_id].clear();
+    g2l_element[part_id].clear();
+}
+//end of DefragmentPartition
+
 //WritePartitions
 //
 //Tasks: Writes Partitions
@@ -4055,6 +4238,8 @@ void MeshPartitions::refine_wedge(Mesh<double>*& partition, const index_t top_tr
                         ll[3] * partition->metric[sorted_n[3]*msize+i];
                 partition->metric[cid*msize+i] = nm[i];
             }
+
+            partition->interpolate_fields(cid, nloc, &sorted_n[0], ll);
         }
 
         // Use the 3D laplacian smoothing kernel to find the barycentre of the wedge in metric space.
@@ -4155,6 +4340,8 @@ void MeshPartitions::refine_wedge(Mesh<double>*& partition, const index_t top_tr
                                             l[3]*partition->metric[sorted_best_e[3]*msize+i];
         }
 
+        partition->interpolate_fields(cid, nloc, &sorted_best_e[0], l);
+
         partition->append_element(ele1);
         partition->append_element(ele2);
         partition->append_element(ele3);
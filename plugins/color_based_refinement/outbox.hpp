@@ -1,70 +1,113 @@
 #ifndef OUTBOX_HPP
 #define OUTBOX_HPP
 
+#include <vector>
+#include <algorithm>
+
 #include "counter.hpp"
 
+//class Outbox
+//
+//Collects the vertices a partition inserts on interface edges, so that the neighboring partitions of higher colors can heal
+//their side of the interface. Messages are staged during the refinement and bucketed by their target partition in build()
+//(CSR layout, targets sorted), afterwards each neighbor fetches exactly its messages without scanning the whole outbox.
 class Outbox : private Counter<Outbox>
 {
     public:
-        //Constructor
-        Outbox()
+        //A vertex inserted on the interface edge (v1, v2), v1 and v2 are global vertex ids,
+        //new_vert is the local id of the new vertex in the partition owning the outbox
+        struct message
         {
-            /*std::cout << std::endl << "========================================================================================" << std::endl;
-            std::cout << "Outbox Constructor for partition " << no_outboxes << std::endl;
-            ++no_outboxes;
-            //std::cout << "  " << no_outboxes << std::endl;
-            std::cout << "========================================================================================" << std::endl;*/
+            int v1;
+            int v2;
+            int new_vert;
+        };
 
-            //++no_outboxes;
-        }
+        //Constructor
+        Outbox() {}
 
-        Outbox(bool no_new_instance)
-        {
-            //std::cout << "Outbox Constructor for resizing" << std::endl;
-            //std::cout << "  " << no_outboxes << std::endl;
-        }
+        Outbox(bool no_new_instance) {}
 
+        //Stages a message for partition target_part_id, it is available after build()
         Outbox & operator() (int target_part_id, int v1, int v2, int new_vert)
         {
-            data.push_back(target_part_id);
-            data.push_back(v1);
-            data.push_back(v2);
-            data.push_back(new_vert);
+            staged_targets.push_back(target_part_id);
+            staged_messages.push_back( message{v1, v2, new_vert} );
+
+            return *this;
         }
 
-        int & operator[] (int v)
+        //Buckets all staged messages by their target partition, the order of the messages of a target is kept
+        void build()
         {
-            return data[v];
+            targets = staged_targets;
+            std::sort(targets.begin(), targets.end());
+            targets.erase( std::unique(targets.begin(), targets.end()), targets.end() );
+
+            offsets.assign(targets.size()+1, 0);
+            std::vector<int> bucket(staged_targets.size());
+
+            for (size_t i = 0; i < staged_targets.size(); ++i)
+            {
+                bucket[i] = find(staged_targets[i]);
+                ++offsets[bucket[i]+1];
+            }
+
+            for (size_t b = 0; b < targets.size(); ++b)
+                offsets[b+1] += offsets[b];
+
+            messages.resize(staged_messages.size());
+            std::vector<int> fill(offsets.begin(), offsets.end()-1);
+
+            for (size_t i = 0; i < staged_messages.size(); ++i)
+                messages[ fill[bucket[i]]++ ] = staged_messages[i];
+
+            staged_targets.clear();
+            staged_messages.clear();
         }
 
-        int size()
+        //Number of messages in the outbox (after build())
+        int num_verts() const
         {
-            return data.size();
+            return messages.size();
         }
 
-        int num_verts()
+        //Number of messages for partition part_id
+        int verts_in_part(int part_id) const
         {
-            return data.size()/4;
+            int b = find(part_id);
+            return (b < 0) ? 0 : offsets[b+1]-offsets[b];
         }
 
-        int verts_in_part(int part_id)
+        //Messages for partition part_id, [begin(part_id), end(part_id)) holds verts_in_part(part_id) messages
+        message const* begin(int part_id) const
         {
-            int num_verts = 0;
-            for (size_t i = 0; i < this->num_verts(); ++i)
-            {
-                if ( data[4*i] == part_id )
-                {
-                    ++num_verts;
-                }
-            }
+            int b = find(part_id);
+            return (b < 0) ? nullptr : messages.data() + offsets[b];
+        }
 
-            return num_verts;
+        message const* end(int part_id) const
+        {
+            int b = find(part_id);
+            return (b < 0) ? nullptr : messages.data() + offsets[b+1];
         }
 
         using Counter<Outbox>::howMany;
 
     private:
-        std::vector<int> data;
+        //Bucket of a target partition, -1 if there are no messages for it
+        int find(int part_id) const
+        {
+            std::vector<int>::const_iterator it = std::lower_bound(targets.begin(), targets.end(), part_id);
+            return (it == targets.end() || *it != part_id) ? -1 : it - targets.begin();
+        }
+
+        std::vector<int> staged_targets;
+        std::vector<message> staged_messages;
+
+        std::vector<int> targets;                 //Sorted ids of all target partitions
+        std::vector<int> offsets;                 //Messages of targets[b] are messages[offsets[b]] to messages[offsets[b+1]-1]
+        std::vector<message> messages;
 };
 
 #endif //OUTBOX_HPP
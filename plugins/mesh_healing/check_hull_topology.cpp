@@ -13,6 +13,7 @@
 =============================================================================== */
 
 #include "check_hull_topology.hpp"
+#include "mesh_health_report.hpp"
 
 namespace viennamesh
 {
@@ -32,8 +33,53 @@ namespace viennamesh
     typedef viennagrid::result_of::const_coboundary_range<MeshType>::type               ConstCoboundaryElementRangeType;
     typedef viennagrid::result_of::iterator<ConstCoboundaryElementRangeType>::type      ConstCoboundaryElementIteratorType;
 
+    typedef viennagrid::result_of::element<MeshType>::type                              ElementType;
+
     viennagrid::result_of::element_copy_map<>::type copy_map(output_mesh(), true);
 
+    // the facet table is only used for triangle hulls, other meshes keep
+    // the coboundary path and do not pay for it
+    if (viennagrid::cell_dimension(input_mesh()) == 2)
+    {
+      // a report of a previous healing algorithm on the same mesh is reused
+      data_handle<mesh_health_report> report_handle = get_input<mesh_health_report>("health_report");
+      if (!report_handle.valid() || !report_handle().covers(input_mesh().internal(), mesh_health_report::cell_facets))
+      {
+        report_handle = make_data<mesh_health_report>();
+        const_cast<mesh_health_report &>(report_handle()).init( input_mesh().internal(), mesh_health_report::cell_facets );
+      }
+      set_output( "health_report", report_handle );
+
+      mesh_health_report const & report = report_handle();
+      if (report.simplex())
+      {
+        // the facets of a triangle hull are its lines, every triangle of a
+        // border line is copied once in the order of the input mesh
+        std::vector<char> copy_triangle( report.cell_count(), 0 );
+        for (mesh_health_report::index_type f = 0; f != report.facet_count(); ++f)
+        {
+          if (report.kind(f) != mesh_health_report::border_facet)
+            continue;
+
+          info(5) << "Line (" << report.facet_vertex(f, 0) << "," << report.facet_vertex(f, 1) << ") has less than 2 co-boundary triangles" << std::endl;
+          for (mesh_health_report::index_type i = 0; i != report.facet_cell_count(f); ++i)
+            copy_triangle[ report.facet_cell(f, i) ] = 1;
+        }
+
+        for (mesh_health_report::index_type t = 0; t != report.cell_count(); ++t)
+        {
+          if (copy_triangle[t])
+            copy_map( ElementType(input_mesh(), report.cell_id(t)) );
+        }
+
+        info(1) << "Hull has " << report.kind_count(mesh_health_report::border_facet) << " border lines and "
+                << report.kind_count(mesh_health_report::non_manifold_facet) << " non-manifold lines" << std::endl;
+
+        set_output( "mesh", output_mesh );
+        return true;
+      }
+    }
+
 
     ConstElementRangeType lines( input_mesh(), 1 );
     for (ConstElementIteratorType lit = lines.begin(); lit != lines.end(); ++lit)
@@ -13,8 +13,7 @@
 =============================================================================== */
 
 #include "merge_close_points.hpp"
-#include "viennagrid/core/ntree.hpp"
-#include "viennagrid/algorithm/geometry.hpp"
+#include "viennameshpp/spatial_hash.hpp"
 
 namespace viennamesh
 {
@@ -29,96 +28,81 @@ namespace viennamesh
     double merge_distance = get_required_input<double>("merge_distance")();
 
     typedef viennagrid::mesh                                                MeshType;
-    typedef viennagrid::result_of::element<MeshType>::type                  ElementType;
     typedef viennagrid::result_of::point<MeshType>::type                    PointType;
 
-    typedef viennagrid::result_of::const_element_range<MeshType>::type      ConstElementRangeType;
-    typedef viennagrid::result_of::iterator<ConstElementRangeType>::type    ConstElementIteratorType;
-
-    ConstElementRangeType vertices( input_mesh(), 0 );
-    info(1) << "Old vertex count = " << vertices.size() << std::endl;
-
-
-//     OLD IMPLEMENTATION
-//
-//     std::vector<ElementType> new_vertices;
-//     for (ConstElementIteratorType vit = vertices.begin(); vit != vertices.end(); ++vit)
-//     {
-//       PointType p = viennagrid::get_point(*vit);
-//
-//       std::vector<ElementType>::iterator nvit = new_vertices.begin();
-//       for (; nvit != new_vertices.end(); ++nvit)
-//       {
-//         if (viennagrid::norm_2(p - viennagrid::get_point(*nvit)) < merge_distance )
-//         {
-//           new_vertices.push_back(*nvit);
-//           break;
-//         }
-//       }
-//
-//       if (nvit == new_vertices.end())
-//         new_vertices.push_back( viennagrid::make_vertex(output_mesh(), p) );
-//     }
-
-
-    // build up ntree
-    std::pair<PointType, PointType> bb = viennagrid::bounding_box( input_mesh() );
-    PointType center = (bb.first + bb.second)/2;
-    PointType size = bb.second - bb.first;
-
-    typedef viennagrid::vertex_with_distance_wrapper<ElementType> WrapperType;
-    typedef viennagrid::ntree_node<WrapperType> NodeType;
-    boost::shared_ptr<NodeType> root( new NodeType( center-size/2*1.1 , center+size/2*1.1 ) );
-
-    int element_per_node = 10;
-    for (ConstElementIteratorType vit = vertices.begin(); vit != vertices.end(); ++vit)
-      root->add( WrapperType(*vit, merge_distance),
-                 element_per_node,
-                 vertices.size()/element_per_node);
-
-    // create new vertices
-    viennagrid::vector<ElementType> new_vertices( vertices.size() );
-    for (ConstElementIteratorType vit = vertices.begin(); vit != vertices.end(); ++vit)
+    viennagrid_mesh mesh = input_mesh().internal();
+    int geometric_dimension = viennagrid::geometric_dimension( input_mesh() );
+    int cell_dimension = viennagrid::cell_dimension( input_mesh() );
+
+    viennagrid_int vertex_count = viennagrid::vertices( input_mesh() ).size();
+    info(1) << "Old vertex count = " << vertex_count << std::endl;
+
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
+
+
+    // cluster all vertices which are (transitively) closer than merge_distance using a hash grid
+    // with cell size merge_distance, each cluster is represented by its vertex with the smallest index
+    std::vector<viennagrid_int> representatives;
+    viennagrid_int new_vertex_count = weld_points(coords, vertex_count, geometric_dimension, merge_distance, representatives);
+
+    // create one new vertex per cluster
+    std::vector<viennagrid_element_id> new_vertices(vertex_count);
+    for (viennagrid_int i = 0; i != vertex_count; ++i)
     {
-      PointType p = viennagrid::get_point(*vit);
-
-      viennagrid::element_id new_vertex_id = (*vit).id();
-      NodeType * node = root->get(p);
-      for (std::size_t i = 0; i != node->elements().size(); ++i)
-      {
-        if (viennagrid::norm_2(p - viennagrid::get_point(node->elements()[i]())) < merge_distance )
-        {
-          if ( node->elements()[i]().id() < new_vertex_id )
-          {
-            new_vertex_id = node->elements()[i]().id();
-            break;
-          }
-        }
-      }
-
-      if ( new_vertex_id == (*vit).id() )
-        new_vertices[(*vit).id()] = viennagrid::make_vertex(output_mesh(), p);
-      else
-        new_vertices[(*vit).id()] = new_vertices[new_vertex_id];
+      if (representatives[i] == i)
+        new_vertices[i] = viennagrid::make_vertex( output_mesh(), PointType(geometric_dimension, coords + geometric_dimension*i) ).id().internal();
     }
 
-    // create cell for new mesh using merged vertices
-    ConstElementRangeType cells( input_mesh(), viennagrid::cell_dimension(input_mesh()) );
-    for (ConstElementIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
+
+    // create cells for new mesh using merged vertices in one batch
+    viennagrid_element_id * cells_begin;
+    viennagrid_element_id * cells_end;
+    viennagrid_mesh_elements_get(mesh, cell_dimension, &cells_begin, &cells_end);
+    viennagrid_int cell_count = cells_end - cells_begin;
+
+    std::vector<viennagrid_element_type> element_types(cell_count);
+    std::vector<viennagrid_int> cell_vertex_offsets(cell_count+1);
+
+    cell_vertex_offsets[0] = 0;
+
+    #pragma omp parallel for
+    for (viennagrid_int i = 0; i < cell_count; ++i)
     {
-      std::vector<ElementType> local_vertices;
+      viennagrid_element_id * vertices_begin;
+      viennagrid_element_id * vertices_end;
+      viennagrid_element_boundary_elements(mesh, cells_begin[i], 0, &vertices_begin, &vertices_end);
+
+      viennagrid_element_type_get(mesh, cells_begin[i], &element_types[i]);
+      cell_vertex_offsets[i+1] = vertices_end - vertices_begin;
+    }
+
+    for (viennagrid_int i = 0; i != cell_count; ++i)
+      cell_vertex_offsets[i+1] += cell_vertex_offsets[i];
 
-      typedef viennagrid::result_of::const_element_range<ElementType>::type ConstCoundaryRangeType;
-      typedef viennagrid::result_of::iterator<ConstCoundaryRangeType>::type ConstCoundaryIteratorType;
+    std::vector<viennagrid_element_id> cell_vertex_indices( cell_vertex_offsets[cell_count] );
 
-      ConstCoundaryRangeType boundary_vertices(*cit, 0);
-      for (ConstCoundaryIteratorType bvit = boundary_vertices.begin(); bvit != boundary_vertices.end(); ++bvit)
-        local_vertices.push_back( new_vertices[(*bvit).id()] );
+    #pragma omp parallel for
+    for (viennagrid_int i = 0; i < cell_count; ++i)
+    {
+      viennagrid_element_id * vertices_begin;
+      viennagrid_element_id * vertices_end;
+      viennagrid_element_boundary_elements(mesh, cells_begin[i], 0, &vertices_begin, &vertices_end);
+
+      viennagrid_int offset = cell_vertex_offsets[i];
+      for (viennagrid_element_id * vit = vertices_begin; vit != vertices_end; ++vit, ++offset)
+        cell_vertex_indices[offset] = new_vertices[ representatives[viennagrid_index_from_element_id(*vit)] ];
+    }
 
-      viennagrid::make_element( output_mesh(), (*cit).tag(), local_vertices.begin(), local_vertices.end() );
+    if (cell_count > 0)
+    {
+      viennagrid_mesh_element_batch_create( output_mesh().internal(),
+                                            cell_count, &element_types[0],
+                                            &cell_vertex_offsets[0], &cell_vertex_indices[0],
+                                            NULL, NULL );
     }
 
-    info(1) << "New vertex count = " << viennagrid::vertices(output_mesh()).size() << std::endl;
+    info(1) << "New vertex count = " << new_vertex_count << std::endl;
     set_output( "mesh", output_mesh );
 
     return true;
@@ -0,0 +1,483 @@
+#ifndef VIENNAMESH_ALGORITHM_MESH_HEALING_MESH_HEALTH_REPORT_HPP
+#define VIENNAMESH_ALGORITHM_MESH_HEALING_MESH_HEALTH_REPORT_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#include "viennagrid/viennagrid.hpp"
+#include "viennameshpp/plugin.hpp"
+
+namespace viennamesh
+{
+
+  // Geometric and topological checks of all cells of a mesh, computed once
+  // from flat arrays so that several healing algorithms can share them:
+  //   - the measure (length, area or volume) of every simplex cell
+  //   - degenerate cells (repeated vertices or a vanishing measure)
+  //   - the facets of all cells with their incident cells, which classifies
+  //     each facet as border (1 cell), manifold (2 cells) or non-manifold
+  // Repeated vertices are always checked, measures and facets only if they
+  // are requested and all cells are simplices. Cells are addressed by their
+  // position in the cell range of the mesh, vertices by their element index.
+  //
+  // The report is a data type of the mesh healing plugin, algorithms pass it
+  // on through their "health_report" input and output. The mesh is retained
+  // by the report, so a report computed for a mesh stays valid as long as
+  // the mesh is not modified in place.
+  class mesh_health_report
+  {
+  public:
+
+    typedef viennagrid_int index_type;
+
+    enum report_part
+    {
+      cell_measures = 1,
+      cell_facets = 2
+    };
+
+    enum cell_flag
+    {
+      repeated_vertices = 1,
+      vanishing_measure = 2
+    };
+
+    enum facet_kind
+    {
+      border_facet,
+      manifold_facet,
+      non_manifold_facet
+    };
+
+    mesh_health_report() : mesh(NULL), parts(0), measure_tolerance(0.0) {}
+    mesh_health_report(viennagrid_mesh mesh_, int parts_, double measure_tolerance_ = 0.0) :
+        mesh(NULL) { init(mesh_, parts_, measure_tolerance_); }
+
+    ~mesh_health_report()
+    {
+      if (mesh)
+        viennagrid_mesh_release(mesh);
+    }
+
+    // A simplex cell has a vanishing measure if its measure is not larger
+    // than measure_tolerance times the cell dimension-th power of its
+    // longest edge
+    void init(viennagrid_mesh mesh_, int parts_, double measure_tolerance_ = 0.0)
+    {
+      viennagrid_mesh_retain(mesh_);
+      if (mesh)
+        viennagrid_mesh_release(mesh);
+
+      mesh = mesh_;
+      parts = parts_;
+      measure_tolerance = measure_tolerance_;
+      cell_dimension_ = viennagrid::cell_dimension( viennagrid::mesh(mesh) );
+      geometric_dimension = viennagrid::geometric_dimension( viennagrid::mesh(mesh) );
+      viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
+
+      init_cells();
+      check_repeated_vertices();
+
+      measures.clear();
+      facet_offsets.assign(1, 0);
+      facet_vertices.clear();
+      facet_cells.clear();
+
+      if (simplex_ && (parts & cell_measures))
+      {
+        switch (cell_dimension_)
+        {
+          case 1: compute_measures<1>(); break;
+          case 2: compute_measures<2>(); break;
+          case 3: compute_measures<3>(); break;
+        }
+      }
+
+      if (simplex_ && (parts & cell_facets))
+        build_facets();
+
+      degenerate_count_ = 0;
+      for (index_type c = 0; c != cell_count(); ++c)
+        if (flags[c])
+          ++degenerate_count_;
+
+      kind_counts[border_facet] = kind_counts[manifold_facet] = kind_counts[non_manifold_facet] = 0;
+      for (index_type f = 0; f != facet_count(); ++f)
+        ++kind_counts[ kind(f) ];
+    }
+
+    // true if the report was computed for mesh_ with at least the parts
+    // parts_ and, if measures are requested, with the same tolerance
+    bool covers(viennagrid_mesh mesh_, int parts_, double measure_tolerance_ = 0.0) const
+    {
+      return mesh && mesh == mesh_ && (parts_ & ~parts) == 0 &&
+             (!(parts_ & cell_measures) || measure_tolerance == measure_tolerance_);
+    }
+
+    viennagrid_mesh internal() const { return mesh; }
+    int cell_dimension() const { return cell_dimension_; }
+
+    // true if all cells are simplices of the cell dimension
+    bool simplex() const { return simplex_; }
+
+    index_type cell_count() const { return cell_ids.size(); }
+    viennagrid_element_id cell_id(index_type c) const { return cell_ids[c]; }
+    index_type cell_index(viennagrid_element_id id) const
+    { return cell_positions[ viennagrid_index_from_element_id(id) ]; }
+
+    index_type cell_vertex_count(index_type c) const { return cell_vertex_offsets[c+1]-cell_vertex_offsets[c]; }
+    index_type const * cell_vertices(index_type c) const { return &cell_vertex_indices[cell_vertex_offsets[c]]; }
+
+    // length, area or volume of cell c, only available if measures were
+    // requested and the mesh is a simplex mesh
+    double measure(index_type c) const { return measures[c]; }
+
+    int cell_flags(index_type c) const { return flags[c]; }
+    bool degenerate(index_type c) const { return flags[c] != 0; }
+    index_type degenerate_count() const { return degenerate_count_; }
+
+
+    // Facets are ordered lexicographically by their sorted vertices
+    index_type facet_count() const { return facet_offsets.size()-1; }
+    index_type facet_vertex(index_type f, int i) const { return facet_vertices[cell_dimension_*f+i]; }
+
+    index_type facet_cell_count(index_type f) const { return facet_offsets[f+1]-facet_offsets[f]; }
+    index_type facet_cell(index_type f, index_type i) const { return facet_cells[facet_offsets[f]+i]; }
+
+    facet_kind kind(index_type f) const
+    {
+      index_type count = facet_cell_count(f);
+      return count < 2 ? border_facet : (count == 2 ? manifold_facet : non_manifold_facet);
+    }
+
+    index_type kind_count(facet_kind k) const { return kind_counts[k]; }
+
+  private:
+
+    mesh_health_report(mesh_health_report const &);
+    mesh_health_report & operator=(mesh_health_report const &);
+
+    void init_cells()
+    {
+      viennagrid_element_id * cells_begin;
+      viennagrid_element_id * cells_end;
+      viennagrid_mesh_elements_get(mesh, cell_dimension_, &cells_begin, &cells_end);
+      cell_ids.assign(cells_begin, cells_end);
+      index_type count = cell_count();
+
+      index_type max_index = -1;
+      for (index_type c = 0; c != count; ++c)
+        max_index = std::max(max_index, viennagrid_index_from_element_id(cell_ids[c]));
+      cell_positions.assign(max_index+1, -1);
+
+      cell_vertex_offsets.resize(count+1);
+      cell_vertex_offsets[0] = 0;
+      int not_simplex = 0;
+
+      #pragma omp parallel for reduction(+:not_simplex)
+      for (index_type c = 0; c < count; ++c)
+      {
+        cell_positions[ viennagrid_index_from_element_id(cell_ids[c]) ] = c;
+
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, cell_ids[c], 0, &vertices_begin, &vertices_end);
+        cell_vertex_offsets[c+1] = vertices_end - vertices_begin;
+
+        viennagrid_element_type type;
+        viennagrid_element_type_get(mesh, cell_ids[c], &type);
+        if (type != simplex_type() || vertices_end-vertices_begin != cell_dimension_+1)
+          ++not_simplex;
+      }
+
+      for (index_type c = 0; c != count; ++c)
+        cell_vertex_offsets[c+1] += cell_vertex_offsets[c];
+
+      cell_vertex_indices.resize( cell_vertex_offsets[count] );
+
+      #pragma omp parallel for
+      for (index_type c = 0; c < count; ++c)
+      {
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, cell_ids[c], 0, &vertices_begin, &vertices_end);
+
+        index_type offset = cell_vertex_offsets[c];
+        for (viennagrid_element_id * vit = vertices_begin; vit != vertices_end; ++vit, ++offset)
+          cell_vertex_indices[offset] = viennagrid_index_from_element_id(*vit);
+      }
+
+      simplex_ = (cell_dimension_ >= 1 && cell_dimension_ <= 3 && not_simplex == 0);
+    }
+
+    viennagrid_element_type simplex_type() const
+    {
+      switch (cell_dimension_)
+      {
+        case 1: return VIENNAGRID_ELEMENT_TYPE_LINE;
+        case 2: return VIENNAGRID_ELEMENT_TYPE_TRIANGLE;
+        case 3: return VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON;
+      }
+      return VIENNAGRID_ELEMENT_TYPE_VERTEX;
+    }
+
+    void check_repeated_vertices()
+    {
+      index_type count = cell_count();
+      flags.assign(count, 0);
+
+      #pragma omp parallel for
+      for (index_type c = 0; c < count; ++c)
+      {
+        index_type const * v = cell_vertices(c);
+        index_type n = cell_vertex_count(c);
+
+        for (index_type i = 0; i < n; ++i)
+          for (index_type j = i+1; j < n; ++j)
+            if (v[i] == v[j])
+              flags[c] |= repeated_vertices;
+      }
+    }
+
+
+    // The measure of a simplex with the edge vectors e_i = x_i - x_0 is
+    // sqrt(det G) / K! with the Gram matrix G_ij = e_i . e_j. Coordinates
+    // are padded to three dimensions so that the kernel has a fixed size
+    // and no branches, which lets the compiler vectorize it.
+    template<int K>
+    void compute_measures()
+    {
+      index_type count = cell_count();
+      measures.resize(count);
+
+      int dim = geometric_dimension;
+      double factorial = (K == 1) ? 1.0 : (K == 2 ? 2.0 : 6.0);
+
+      #pragma omp parallel for
+      for (index_type c = 0; c < count; ++c)
+      {
+        index_type const * v = &cell_vertex_indices[(K+1)*c];
+
+        double x[K+1][3];
+        for (int i = 0; i != K+1; ++i)
+          for (int d = 0; d != 3; ++d)
+            x[i][d] = d < dim ? coords[dim*v[i]+d] : 0.0;
+
+        double e[K][3];
+        for (int i = 0; i != K; ++i)
+          for (int d = 0; d != 3; ++d)
+            e[i][d] = x[i+1][d] - x[0][d];
+
+        double g[3][3] = { {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
+        for (int i = 0; i != K; ++i)
+          for (int j = 0; j != K; ++j)
+            g[i][j] = e[i][0]*e[j][0] + e[i][1]*e[j][1] + e[i][2]*e[j][2];
+
+        double det = g[0][0]*(g[1][1]*g[2][2] - g[1][2]*g[2][1])
+                   - g[0][1]*(g[1][0]*g[2][2] - g[1][2]*g[2][0])
+                   + g[0][2]*(g[1][0]*g[2][1] - g[1][1]*g[2][0]);
+
+        double measure = std::sqrt( std::max(det, 0.0) ) / factorial;
+        measures[c] = measure;
+
+        double longest = 0.0;
+        for (int i = 0; i != K+1; ++i)
+          for (int j = i+1; j != K+1; ++j)
+          {
+            double dx = x[i][0]-x[j][0];
+            double dy = x[i][1]-x[j][1];
+            double dz = x[i][2]-x[j][2];
+            longest = std::max(longest, dx*dx + dy*dy + dz*dz);
+          }
+        longest = std::sqrt(longest);
+
+        double scale = 1.0;
+        for (int i = 0; i != K; ++i)
+          scale *= longest;
+
+        if (measure <= measure_tolerance * scale)
+          flags[c] |= vanishing_measure;
+      }
+    }
+
+
+    struct facet_record
+    {
+      index_type other_vertices[2];
+      index_type cell;
+
+      bool same_facet(facet_record const & rhs) const
+      {
+        return other_vertices[0] == rhs.other_vertices[0] && other_vertices[1] == rhs.other_vertices[1];
+      }
+
+      bool operator<(facet_record const & rhs) const
+      {
+        if (other_vertices[0] != rhs.other_vertices[0])
+          return other_vertices[0] < rhs.other_vertices[0];
+        if (other_vertices[1] != rhs.other_vertices[1])
+          return other_vertices[1] < rhs.other_vertices[1];
+        return cell < rhs.cell;
+      }
+    };
+
+    // sorted vertices of the facet of cell c which is opposite to its i-th vertex
+    void facet_of_cell(index_type c, int i, index_type * facet) const
+    {
+      index_type const * v = cell_vertices(c);
+      int count = 0;
+      for (int k = 0; k != cell_dimension_+1; ++k)
+        if (k != i)
+          facet[count++] = v[k];
+      std::sort(facet, facet+count);
+    }
+
+    // Bucket every facet of every cell by its smallest vertex, within a
+    // bucket the records of the same facet become consecutive after sorting
+    void build_facets()
+    {
+      index_type count = cell_count();
+      int per_cell = cell_dimension_+1;
+      index_type record_count = per_cell*count;
+
+      index_type max_vertex = -1;
+      for (std::size_t i = 0; i != cell_vertex_indices.size(); ++i)
+        max_vertex = std::max(max_vertex, cell_vertex_indices[i]);
+      index_type bucket_count = max_vertex+1;
+
+      std::vector< std::atomic<index_type> > fill(bucket_count);
+
+      #pragma omp parallel for
+      for (index_type v = 0; v < bucket_count; ++v)
+        fill[v].store(0, std::memory_order_relaxed);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < record_count; ++i)
+      {
+        index_type facet[3];
+        facet_of_cell(i/per_cell, i%per_cell, facet);
+        fill[ facet[0] ].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      std::vector<index_type> bucket_offsets(bucket_count+1);
+      bucket_offsets[0] = 0;
+      for (index_type v = 0; v != bucket_count; ++v)
+      {
+        bucket_offsets[v+1] = bucket_offsets[v] + fill[v].load(std::memory_order_relaxed);
+        fill[v].store(bucket_offsets[v], std::memory_order_relaxed);
+      }
+
+      std::vector<facet_record> records(record_count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < record_count; ++i)
+      {
+        index_type facet[3] = {-1, -1, -1};
+        facet_of_cell(i/per_cell, i%per_cell, facet);
+
+        facet_record record;
+        record.other_vertices[0] = facet[1];
+        record.other_vertices[1] = facet[2];
+        record.cell = i/per_cell;
+        records[ fill[facet[0]].fetch_add(1, std::memory_order_relaxed) ] = record;
+      }
+
+      std::vector<index_type> bucket_facet_count(bucket_count+1, 0);
+
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type v = 0; v < bucket_count; ++v)
+      {
+        std::sort( records.begin() + bucket_offsets[v], records.begin() + bucket_offsets[v+1] );
+
+        index_type facets = 0;
+        for (index_type i = bucket_offsets[v]; i != bucket_offsets[v+1]; ++i)
+          if (i == bucket_offsets[v] || !records[i].same_facet(records[i-1]))
+            ++facets;
+        bucket_facet_count[v+1] = facets;
+      }
+
+      for (index_type v = 0; v != bucket_count; ++v)
+        bucket_facet_count[v+1] += bucket_facet_count[v];
+
+      index_type facets = bucket_facet_count[bucket_count];
+      int facet_size = cell_dimension_;
+      facet_offsets.resize(facets+1);
+      facet_vertices.resize(facet_size*facets);
+      facet_cells.resize(record_count);
+      facet_offsets[facets] = record_count;
+
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type v = 0; v < bucket_count; ++v)
+      {
+        index_type f = bucket_facet_count[v];
+        for (index_type i = bucket_offsets[v]; i != bucket_offsets[v+1]; ++i)
+        {
+          if (i == bucket_offsets[v] || !records[i].same_facet(records[i-1]))
+          {
+            facet_offsets[f] = i;
+            facet_vertices[facet_size*f] = v;
+            for (int k = 1; k != facet_size; ++k)
+              facet_vertices[facet_size*f+k] = records[i].other_vertices[k-1];
+            ++f;
+          }
+
+          facet_cells[i] = records[i].cell;
+        }
+      }
+    }
+
+
+    viennagrid_mesh mesh;
+    int parts;
+    double measure_tolerance;
+    int cell_dimension_;
+    int geometric_dimension;
+    viennagrid_numeric * coords;
+    bool simplex_;
+
+    std::vector<viennagrid_element_id> cell_ids;
+    std::vector<index_type> cell_positions;
+    std::vector<index_type> cell_vertex_offsets;
+    std::vector<index_type> cell_vertex_indices;
+
+    std::vector<double> measures;
+    std::vector<int> flags;
+    index_type degenerate_count_;
+
+    std::vector<index_type> facet_offsets;
+    std::vector<index_type> facet_vertices;
+    std::vector<index_type> facet_cells;
+    index_type kind_counts[3];
+  };
+
+
+  namespace result_of
+  {
+    template<>
+    struct data_information<mesh_health_report>
+    {
+      static std::string type_name() { return "mesh_health_report"; }
+      static viennamesh_data_make_function make_function() { return viennamesh::generic_make<mesh_health_report>; }
+      static viennamesh_data_delete_function delete_function() { return viennamesh::generic_delete<mesh_health_report>; }
+    };
+  }
+
+}
+
+#endif
@@ -13,6 +13,7 @@
 =============================================================================== */
 
 #include <numeric>
+#include <algorithm>
 #include <boost/concept_check.hpp>
 #include "multi_material_marching_cubes.hpp"
 #include "viennagrid/algorithm/geometry.hpp"
@@ -56,6 +57,66 @@ namespace viennamesh
     return access_symmetric(array, size, pos);
   }
 
+  inline int symmetric_index(std::vector<int> const & size, int x, int y, int z)
+  {
+    return ((z+size[2]/2)*size[1] + (y+size[1]/2))*size[0] + (x+size[0]/2);
+  }
+
+
+
+
+  // Output vertices of the marching cubes are identified by the element of the
+  // sample lattice they are located on: lattice edges (one per axis), lattice
+  // faces (one per normal axis) and lattice cubes, each keyed by its lower
+  // corner. Neighbouring cubes therefore produce the same key for a shared
+  // vertex, independent of the thread which processes the cube.
+  typedef long long lattice_key;
+
+  enum { lattice_edge_slot = 0, lattice_face_slot = 3, lattice_cube_slot = 6, lattice_slot_count = 7 };
+
+  inline lattice_key make_lattice_key(std::vector<int> const & size, int x, int y, int z, int slot)
+  {
+    return ((static_cast<lattice_key>(z)*size[1] + y)*size[0] + x)*lattice_slot_count + slot;
+  }
+
+  template<typename PointT>
+  PointT lattice_point(lattice_key key,
+                       std::vector<int> const & size,
+                       PointT const & center, PointT const & sample_size)
+  {
+    int slot = key % lattice_slot_count;
+    key /= lattice_slot_count;
+
+    int pos[3];
+    for (int i = 0; i != 3; ++i)
+    {
+      pos[i] = key % size[i];
+      key /= size[i];
+    }
+
+    double offset[3] = {0.0, 0.0, 0.0};
+    if (slot < lattice_face_slot)
+      offset[slot-lattice_edge_slot] = 0.5;
+    else
+    {
+      offset[0] = offset[1] = offset[2] = 0.5;
+      if (slot < lattice_cube_slot)
+        offset[slot-lattice_face_slot] = 0.0;
+    }
+
+    PointT p = center;
+    for (int i = 0; i != 3; ++i)
+      p[i] += (pos[i] - size[i]/2 + offset[i]) * sample_size[i];
+    return p;
+  }
+
+
+  struct marching_cubes_triangle
+  {
+    lattice_key vertices[3];
+    std::pair<int, int> regions;
+  };
+
 
 
 
@@ -563,6 +624,45 @@ namespace viennamesh
 
 
 
+    // lattice key of the vertex with local index "index" (see point()) of
+    // the cube with lower corner x, y, z in lattice coordinates
+    lattice_key key(int index, std::vector<int> const & size, int x, int y, int z) const
+    {
+      assert( index >= 0 );
+      assert( index <= 18 );
+
+      int corner = 0;
+      int slot = lattice_cube_slot;
+
+      if (index < 12)
+      {
+        // the two cube vertices of an edge only differ in the bit of the edge axis
+        std::pair<int,int> indices = edge_vertices(index);
+        corner = indices.first;
+        int axis_bit = indices.first ^ indices.second;
+        slot = lattice_edge_slot + (axis_bit == 1 ? 0 : (axis_bit == 2 ? 1 : 2));
+      }
+      else if (index < 18)
+      {
+        // the four cube vertices of a face share the bit of the face normal axis
+        marching_square const & face = faces[index-12];
+        int and_bits = 7;
+        int or_bits = 0;
+        for (int i = 0; i != 4; ++i)
+        {
+          and_bits &= face.vertex_indices[i];
+          or_bits |= face.vertex_indices[i];
+        }
+        corner = and_bits;
+        int normal_bit = ~(and_bits ^ or_bits) & 7;
+        slot = lattice_face_slot + (normal_bit == 1 ? 0 : (normal_bit == 2 ? 1 : 2));
+      }
+
+      return make_lattice_key(size, x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1), slot);
+    }
+
+
+
     int face_centers;
 
     marching_square faces[6];
@@ -643,7 +743,7 @@ namespace viennamesh
     for (RegionIteratorType rit = regions.begin(); rit != regions.end(); ++rit)
       max_region_id = std::max((*rit).id(), max_region_id);
 
-    std::vector<int> region_priority(max_region_id);
+    std::vector<int> region_priority(max_region_id+1);
 
     int counter = region_count;
     for (RegionIteratorType rit = regions.begin(); rit != regions.end(); ++rit)
@@ -675,60 +775,83 @@ namespace viennamesh
     int total_sample_size = sample_count[0] * sample_count[1] * sample_count[2];
     std::vector<char> sample_regions(total_sample_size, -1);
 
+
+    // bucket the cells by the z sample layers covered by their bounding box,
+    // the z layers are then sampled independently of each other
+    struct sampled_cell
+    {
+      ElementType cell;
+      int region_id;
+      int min_index[3];
+      int max_index[3];
+    };
+
+    std::vector<sampled_cell> sampled_cells;
+    std::vector< std::vector<int> > layer_cells( sample_count[2] );
+
     ElementRangeType cells(mesh, viennagrid::cell_dimension(mesh));
+    sampled_cells.reserve( cells.size() );
     for (ElementIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
     {
       std::pair<PointType, PointType> cell_bb = viennagrid::bounding_box(*cit);
 
-      std::vector<int> min_index(3);
-      std::vector<int> max_index(3);
+      sampled_cell sc;
+      sc.cell = *cit;
 
       for (int i = 0; i != 3; ++i)
       {
-        min_index[i] = (cell_bb.first[i]-center[i]) / sample_size[i];
+        sc.min_index[i] = (cell_bb.first[i]-center[i]) / sample_size[i];
         if (cell_bb.first[i] > 0)
-          ++min_index[i];
+          ++sc.min_index[i];
 
-        max_index[i] = (cell_bb.second[i]-center[i]) / sample_size[i];
+        sc.max_index[i] = (cell_bb.second[i]-center[i]) / sample_size[i];
         if (cell_bb.second[i] < 0)
-          --max_index[i];
+          --sc.max_index[i];
 
-        min_index[i] -= 3;
-        max_index[i] += 3;
+        sc.min_index[i] -= 3;
+        sc.max_index[i] += 3;
 
-        min_index[i] = std::max(min_index[i], -sample_count[i]/2);
-        max_index[i] = std::min(max_index[i],  sample_count[i]/2);
+        sc.min_index[i] = std::max(sc.min_index[i], -sample_count[i]/2);
+        sc.max_index[i] = std::min(sc.max_index[i],  sample_count[i]/2);
       }
 
-
-
       ElementRegionRangeType regions(*cit);
       if (regions.size() != 1)
         error(1) << "ERROR, one cell is on more than one region" << std::endl;
 
-      int region_id = (*regions.begin()).id();
+      sc.region_id = (*regions.begin()).id();
 
-      for (int z = min_index[2]; z <= max_index[2]; ++z)
-        for (int y = min_index[1]; y <= max_index[1]; ++y)
-          for (int x = min_index[0]; x <= max_index[0]; ++x)
-          {
-            std::vector<int> pos(3);
-            pos[0] = x;
-            pos[1] = y;
-            pos[2] = z;
+      for (int z = sc.min_index[2]; z <= sc.max_index[2]; ++z)
+        layer_cells[z + sample_count[2]/2].push_back( sampled_cells.size() );
+      sampled_cells.push_back(sc);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int layer = 0; layer < sample_count[2]; ++layer)
+    {
+      int z = layer - sample_count[2]/2;
+
+      for (std::size_t i = 0; i != layer_cells[layer].size(); ++i)
+      {
+        sampled_cell const & sc = sampled_cells[ layer_cells[layer][i] ];
 
+        for (int y = sc.min_index[1]; y <= sc.max_index[1]; ++y)
+          for (int x = sc.min_index[0]; x <= sc.max_index[0]; ++x)
+          {
             PointType sample_point = center;
-            for (int j = 0; j != 3; ++j)
-              sample_point[j] += pos[j]*sample_size[j];
+            sample_point[0] += x*sample_size[0];
+            sample_point[1] += y*sample_size[1];
+            sample_point[2] += z*sample_size[2];
 
-            if (viennagrid::is_inside(*cit, sample_point, is_inside_tolerance()))
+            if (viennagrid::is_inside(sc.cell, sample_point, is_inside_tolerance()))
             {
-              char & sample = access_symmetric(sample_regions, sample_count, pos);
+              char & sample = sample_regions[ symmetric_index(sample_count, x, y, z) ];
 
-              if ((sample == -1) || (region_priority[region_id] > region_priority[sample]))
-                sample = region_id;
+              if ((sample == -1) || (region_priority[sc.region_id] > region_priority[sample]))
+                sample = sc.region_id;
             }
           }
+      }
     }
 
     info(1) << "Finished regional sampling" << std::endl;
@@ -736,23 +859,32 @@ namespace viennamesh
 
 
 
-    typedef viennagrid::result_of::region<MeshType>::type RegionType;
-//     std::vector<RegionType> regions;
+    std::vector<char> const & used_samples = sample_regions;
 
-    std::vector<char> & used_samples = sample_regions;
+    // every z layer of cubes emits its triangles with lattice keyed vertices
+    int cube_layer_count = sample_count[2]-1;
+    std::vector< std::vector<marching_cubes_triangle> > layer_triangles(cube_layer_count);
+    std::vector< std::vector<lattice_key> > layer_vertex_keys(cube_layer_count);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int layer = 0; layer < cube_layer_count; ++layer)
+    {
+      int z = layer - sample_count[2]/2;
+
+      std::vector<marching_cubes_triangle> & triangles = layer_triangles[layer];
+      std::vector<lattice_key> & vertex_keys = layer_vertex_keys[layer];
 
-    for (int z = -sample_count[2]/2; z < sample_count[2]/2; ++z)
       for (int y = -sample_count[1]/2; y < sample_count[1]/2; ++y)
         for (int x = -sample_count[0]/2; x < sample_count[0]/2; ++x)
         {
-          int r0 = access_symmetric(used_samples, sample_count, x  , y  , z  );
-          int r1 = access_symmetric(used_samples, sample_count, x+1, y  , z  );
-          int r2 = access_symmetric(used_samples, sample_count, x  , y+1, z  );
-          int r3 = access_symmetric(used_samples, sample_count, x+1, y+1, z  );
-          int r4 = access_symmetric(used_samples, sample_count, x  , y  , z+1);
-          int r5 = access_symmetric(used_samples, sample_count, x+1, y  , z+1);
-          int r6 = access_symmetric(used_samples, sample_count, x  , y+1, z+1);
-          int r7 = access_symmetric(used_samples, sample_count, x+1, y+1, z+1);
+          int r0 = used_samples[ symmetric_index(sample_count, x  , y  , z  ) ];
+          int r1 = used_samples[ symmetric_index(sample_count, x+1, y  , z  ) ];
+          int r2 = used_samples[ symmetric_index(sample_count, x  , y+1, z  ) ];
+          int r3 = used_samples[ symmetric_index(sample_count, x+1, y+1, z  ) ];
+          int r4 = used_samples[ symmetric_index(sample_count, x  , y  , z+1) ];
+          int r5 = used_samples[ symmetric_index(sample_count, x+1, y  , z+1) ];
+          int r6 = used_samples[ symmetric_index(sample_count, x  , y+1, z+1) ];
+          int r7 = used_samples[ symmetric_index(sample_count, x+1, y+1, z+1) ];
 
           if (r0 == r1 && r0 == r2 && r0 == r3 && r0 == r4 && r0 == r5 && r0 == r6 && r0 == r7)
             continue;
@@ -762,44 +894,73 @@ namespace viennamesh
           mc.make_lines(region_priority);
           std::vector<poly_line> poly_lines = mc.make_poly_lines();
 
-          PointType p[8];
-          p[0] = viennagrid::make_point( sample_size[0] *  x,    sample_size[1] *  y,    sample_size[2] * z     );
-          p[1] = viennagrid::make_point( sample_size[0] * (x+1), sample_size[1] *  y,    sample_size[2] * z     );
-          p[2] = viennagrid::make_point( sample_size[0] *  x   , sample_size[1] * (y+1), sample_size[2] * z     );
-          p[3] = viennagrid::make_point( sample_size[0] * (x+1), sample_size[1] * (y+1), sample_size[2] * z     );
-          p[4] = viennagrid::make_point( sample_size[0] *  x   , sample_size[1] *  y   , sample_size[2] * (z+1) );
-          p[5] = viennagrid::make_point( sample_size[0] * (x+1), sample_size[1] *  y   , sample_size[2] * (z+1) );
-          p[6] = viennagrid::make_point( sample_size[0] *  x   , sample_size[1] * (y+1), sample_size[2] * (z+1) );
-          p[7] = viennagrid::make_point( sample_size[0] * (x+1), sample_size[1] * (y+1), sample_size[2] * (z+1) );
-
-          for (int i = 0; i != 8; ++i)
-            p[i] += center;
+          int lx = x + sample_count[0]/2;
+          int ly = y + sample_count[1]/2;
+          int lz = z + sample_count[2]/2;
 
           for (std::size_t i = 0; i != poly_lines.size(); ++i)
           {
             poly_line const & pl = poly_lines[i];
 
-//             ElementType v0 = viennagrid::make_unique_vertex( output_mesh(), mc.point(pl.vertex_indices[0], p), 1e-6 );
-//             ElementType v_prev = viennagrid::make_unique_vertex( output_mesh(), mc.point(pl.vertex_indices[1], p), 1e-6 );
+            lattice_key v0 = mc.key(pl.vertex_indices[0], sample_count, lx, ly, lz);
+            lattice_key v_prev = mc.key(pl.vertex_indices[1], sample_count, lx, ly, lz);
 
-            ElementType v0 = viennagrid::make_vertex( output_mesh(), mc.point(pl.vertex_indices[0], p) );
-            ElementType v_prev = viennagrid::make_vertex( output_mesh(), mc.point(pl.vertex_indices[1], p) );
+            vertex_keys.push_back(v0);
+            vertex_keys.push_back(v_prev);
 
             for (std::size_t j = 2; j != pl.vertex_indices.size(); ++j)
             {
-              ElementType v_cur = viennagrid::make_vertex( output_mesh(), mc.point(pl.vertex_indices[j], p) );
-//               ElementType v_cur = viennagrid::make_unique_vertex( output_mesh(), mc.point(pl.vertex_indices[j], p), 1e-6 );
-              ElementType triangle = viennagrid::make_triangle( output_mesh(), v0, v_prev, v_cur );
-              v_prev = v_cur;
+              lattice_key v_cur = mc.key(pl.vertex_indices[j], sample_count, lx, ly, lz);
+              vertex_keys.push_back(v_cur);
 
-//               if (pl.regions.first != -1)
-                viennagrid::add( output_mesh().get_or_create_region(pl.regions.first+1), triangle );
-//               if (pl.regions.second != -1)
-                viennagrid::add( output_mesh().get_or_create_region(pl.regions.second+1), triangle );
+              marching_cubes_triangle triangle;
+              triangle.vertices[0] = v0;
+              triangle.vertices[1] = v_prev;
+              triangle.vertices[2] = v_cur;
+              triangle.regions = pl.regions;
+              triangles.push_back(triangle);
+
+              v_prev = v_cur;
             }
           }
         }
 
+      std::sort( vertex_keys.begin(), vertex_keys.end() );
+      vertex_keys.erase( std::unique(vertex_keys.begin(), vertex_keys.end()), vertex_keys.end() );
+    }
+
+    info(1) << "Finished marching cubes" << std::endl;
+
+
+    // global vertex table, every lattice key is only created once
+    std::vector<lattice_key> vertex_keys;
+    for (int layer = 0; layer != cube_layer_count; ++layer)
+      vertex_keys.insert( vertex_keys.end(), layer_vertex_keys[layer].begin(), layer_vertex_keys[layer].end() );
+    std::sort( vertex_keys.begin(), vertex_keys.end() );
+    vertex_keys.erase( std::unique(vertex_keys.begin(), vertex_keys.end()), vertex_keys.end() );
+
+    std::vector<ElementType> vertices( vertex_keys.size() );
+    for (std::size_t i = 0; i != vertex_keys.size(); ++i)
+      vertices[i] = viennagrid::make_vertex( output_mesh(), lattice_point(vertex_keys[i], sample_count, center, sample_size) );
+
+    for (int layer = 0; layer != cube_layer_count; ++layer)
+    {
+      std::vector<marching_cubes_triangle> const & triangles = layer_triangles[layer];
+      for (std::size_t i = 0; i != triangles.size(); ++i)
+      {
+        ElementType v[3];
+        for (int j = 0; j != 3; ++j)
+          v[j] = vertices[ std::lower_bound(vertex_keys.begin(), vertex_keys.end(), triangles[i].vertices[j]) - vertex_keys.begin() ];
+
+        ElementType triangle = viennagrid::make_triangle( output_mesh(), v[0], v[1], v[2] );
+
+        viennagrid::add( output_mesh().get_or_create_region(triangles[i].regions.first+1), triangle );
+        viennagrid::add( output_mesh().get_or_create_region(triangles[i].regions.second+1), triangle );
+      }
+    }
+
+    info(1) << "Created " << vertices.size() << " vertices" << std::endl;
+
 
 
 //     point_container_handle input_mc_regions = get_required_input<point_container_handle>("mc_regions");
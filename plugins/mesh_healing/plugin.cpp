@@ -1,5 +1,6 @@
 #include "viennameshpp/plugin.hpp"
 
+#include "mesh_health_report.hpp"
 #include "remove_degenerate_cells.hpp"
 #include "volumetric_resample.hpp"
 #include "multi_material_marching_cubes.hpp"
@@ -10,6 +11,8 @@
 
 viennamesh_error viennamesh_plugin_init(viennamesh_context context)
 {
+  viennamesh::register_data_type<viennamesh::mesh_health_report>(context);
+
   viennamesh::register_algorithm<viennamesh::remove_degenerate_cells>(context);
   viennamesh::register_algorithm<viennamesh::volumetric_resample>(context);
   viennamesh::register_algorithm<viennamesh::multi_material_marching_cubes>(context);
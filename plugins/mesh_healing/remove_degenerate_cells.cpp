@@ -13,31 +13,24 @@
 =============================================================================== */
 
 #include "remove_degenerate_cells.hpp"
+#include "mesh_health_report.hpp"
 
 namespace viennamesh
 {
 
   struct remove_degenerate_cells_copy_functor
   {
+    remove_degenerate_cells_copy_functor(mesh_health_report const & report_, int removed_flags_) :
+        report(report_), removed_flags(removed_flags_) {}
+
     template<typename CellT>
     bool operator()(CellT const & cell) const
     {
-      typedef typename viennagrid::result_of::const_vertex_range<CellT>::type ConstVertexRangeType;
-      typedef typename viennagrid::result_of::iterator<ConstVertexRangeType>::type ConstVertexRangeIterator;
-
-      ConstVertexRangeType vertices(cell);
-      for (ConstVertexRangeIterator vit1 = vertices.begin(); vit1 != vertices.end(); ++vit1)
-      {
-        ConstVertexRangeIterator vit2 = vit1; ++vit2;
-        for (; vit2 != vertices.end(); ++vit2)
-        {
-          if ( (*vit1).id() == (*vit2).id() )
-            return false;
-        }
-      }
-
-      return true;
+      return (report.cell_flags( report.cell_index(cell.id().internal()) ) & removed_flags) == 0;
     }
+
+    mesh_health_report const & report;
+    int removed_flags;
   };
 
   remove_degenerate_cells::remove_degenerate_cells() {}
@@ -48,11 +41,34 @@ namespace viennamesh
     mesh_handle input_mesh = get_required_input<mesh_handle>("mesh");
     mesh_handle output_mesh = make_data<mesh_handle>();
 
-    info(1) << "Cells count before removing degenerate cells: " << viennagrid::cells(input_mesh()).size() << std::endl;
-    viennagrid::copy( input_mesh(), output_mesh(), remove_degenerate_cells_copy_functor() );
+    // without a tolerance only cells with repeated vertices are removed,
+    // with a tolerance also simplex cells with a vanishing measure
+    data_handle<double> tolerance = get_input<double>("tolerance");
+
+    int parts = 0;
+    int removed_flags = mesh_health_report::repeated_vertices;
+    double measure_tolerance = 0.0;
+    if (tolerance.valid())
+    {
+      parts |= mesh_health_report::cell_measures;
+      removed_flags |= mesh_health_report::vanishing_measure;
+      measure_tolerance = tolerance();
+    }
+
+    // a report of a previous healing algorithm on the same mesh is reused
+    data_handle<mesh_health_report> report = get_input<mesh_health_report>("health_report");
+    if (!report.valid() || !report().covers(input_mesh().internal(), parts, measure_tolerance))
+    {
+      report = make_data<mesh_health_report>();
+      const_cast<mesh_health_report &>(report()).init( input_mesh().internal(), parts, measure_tolerance );
+    }
+
+    info(1) << "Cells count before removing degenerate cells: " << report().cell_count() << std::endl;
+    viennagrid::copy( input_mesh(), output_mesh(), remove_degenerate_cells_copy_functor(report(), removed_flags) );
     info(1) << "Cells count after removing degenerate cells: " << viennagrid::cells(output_mesh()).size() << std::endl;
 
     set_output( "mesh", output_mesh );
+    set_output( "health_report", report );
 
     return true;
   }
@@ -11,6 +11,8 @@
 
 //all other includes
 #include <time.h>
+#include <map>
+#include <algorithm>
 //----------------------------------------------------------------------------------------------------------------------------------------------//
 //                                                                Declaration                                                                   //
 //----------------------------------------------------------------------------------------------------------------------------------------------//
@@ -37,9 +39,11 @@ class GroupedPartitions
     std::vector<std::set<index_t>> nodes_per_partition;
     std::vector<std::set<index_t>> initial_nodes_per_partition;
     std::vector< std::set<index_t>> elements_per_partition;
-    std::vector<std::vector<std::set<index_t>>> interface_nodes;
-    std::vector<std::vector<std::vector<index_t>>> interface_sets;
-    std::vector<std::vector<std::set<index_t>>> interface_elements_sets;  
+
+    //interfaces exist only for adjacent partitions, interface i is located between the partitions interface_neighbors[i]
+    std::vector<std::set<index_t>> interface_nodes;
+    std::vector<std::vector<index_t>> interface_sets;
+    std::vector<std::set<index_t>> interface_elements_sets;
 
     std::vector<size_t> element_counter_interfaces;
 
@@ -59,6 +63,10 @@ class GroupedPartitions
     std::vector<index_t> element_appearances;
     std::vector<index_t> vertex_appearances;
 
+    //first partition and first interface containing a global vertex (-1 if there is none)
+    std::vector<int> vertex_partition;
+    std::vector<int> vertex_interface;
+
     //vectors storing the boundaries of the whole mesh, the partitions and the interfaces
     std::vector<int> boundary_nodes_mesh;
     std::vector<std::vector<index_t>> boundary_nodes_partitions;
@@ -106,19 +114,6 @@ class GroupedPartitions
 //                                                                Helper Functions                                                              //
 //----------------------------------------------------------------------------------------------------------------------------------------------//
 
-//binomial_coefficient(int n, int k)
-//TODO: implement a more efficient dynamic version (e.g., http://www.geeksforgeeks.org/dynamic-programming-set-9-binomial-coefficient/)
-unsigned int binomial_coefficient (int n, int k)
-{ 
-  //check inputs
-  if (k == 0 || k == n)
-  {
-    return 1;
-  }
-
-  //use recursion for computation
-  return (binomial_coefficient(n-1, k-1) + binomial_coefficient(n-1, k));
-} //end of binomial_coefficient(int n, int k)
 
 //----------------------------------------------------------------------------------------------------------------------------------------------//
 //                                                                Implementation                                                                //
@@ -128,7 +123,7 @@ unsigned int binomial_coefficient (int n, int k)
 //TODO:conversion from ViennaMesh data structure into pragmatic data structure can be done here!?!?!?!?!?!?
 //TODO: REPLACE _NEList and _ENList function, since it's copying data unnecessarily!!!
 //TODO: use element initializer list!!!
-GroupedPartitions::GroupedPartitions(Mesh<double>* input_mesh, int region_count) : num_nodes(input_mesh->get_number_nodes()), num_elements(input_mesh->get_number_elements()), ncommon(input_mesh->get_number_dimensions()), nparts(region_count), epart(input_mesh->get_number_elements()), npart(input_mesh->get_number_nodes()), nodes_per_partition(region_count), elements_per_partition(region_count), interface_nodes(region_count-1), interface_sets(region_count-1), _NEList(input_mesh->get_node_element()), _ENList(input_mesh->get_element_node()), interface_elements_sets(region_count-1), element_counter_interfaces(input_mesh->get_number_elements(), 0), global_to_local_index_mappings_partitions(region_count), local_to_global_index_mappings_partitions(region_count), element_appearances(input_mesh->get_number_elements(), 0), vertex_appearances(input_mesh->get_number_nodes(), 0), global_to_local_index_mappings_interfaces(binomial_coefficient(region_count, 2)), local_to_global_index_mappings_interfaces(binomial_coefficient(region_count, 2)), boundary_nodes_mesh(input_mesh->get_number_nodes(), 0), boundary_nodes_partitions(region_count), boundary_nodes_interfaces(binomial_coefficient(region_count, 2)), num_partitions(region_count), num_interfaces(binomial_coefficient(region_count, 2)), initial_nodes_per_partition(region_count), partition_neighbors(region_count), interface_neighbors(binomial_coefficient(region_count, 2))
+GroupedPartitions::GroupedPartitions(Mesh<double>* input_mesh, int region_count) : num_nodes(input_mesh->get_number_nodes()), num_elements(input_mesh->get_number_elements()), ncommon(input_mesh->get_number_dimensions()), nparts(region_count), epart(input_mesh->get_number_elements()), npart(input_mesh->get_number_nodes()), nodes_per_partition(region_count), elements_per_partition(region_count), _NEList(input_mesh->get_node_element()), _ENList(input_mesh->get_element_node()), element_counter_interfaces(input_mesh->get_number_elements(), 0), global_to_local_index_mappings_partitions(region_count), local_to_global_index_mappings_partitions(region_count), element_appearances(input_mesh->get_number_elements(), 0), vertex_appearances(input_mesh->get_number_nodes(), 0), boundary_nodes_mesh(input_mesh->get_number_nodes(), 0), boundary_nodes_partitions(region_count), vertex_partition(input_mesh->get_number_nodes(), -1), vertex_interface(input_mesh->get_number_nodes(), -1), num_partitions(region_count), num_interfaces(0), initial_nodes_per_partition(region_count), partition_neighbors(region_count)
 {
   std::cout << "Grouped Partitions Object created" << std::endl;
   mesh = input_mesh;
@@ -269,122 +264,109 @@ void GroupedPartitions::CreatePartitionsAndInterfaces()
   //end of get nodes per partition
 
   //get the interface nodes for all partition boundaries
-  int interface_counter = 0;
-  for (size_t i = 0; i < nparts; ++i)     
-  {        
-    for (size_t j = i+1; j < nparts; ++j, ++interface_counter)
-    {   
-      std::vector<index_t> tmp;
-
-      set_intersection( initial_nodes_per_partition[i].begin(), initial_nodes_per_partition[i].end(),
-                        initial_nodes_per_partition[j].begin(), initial_nodes_per_partition[j].end(),
-                        inserter(tmp, tmp.begin()) );
-      
-      interface_sets[i].push_back(tmp);
+  //the partitions touching a node are the partitions of its adjacent elements, every pair of them shares the node,
+  //hence only interfaces of adjacent partitions are created instead of one for every possible pair of partitions
+  std::map<std::pair<int, int>, std::vector<index_t>> interface_map;
+  std::vector<std::vector<int>> node_partitions(num_nodes);
 
-      //get neighboring information
-      if (tmp.size() > 0)
-      {
-        if ( std::find(partition_neighbors[i].begin(), partition_neighbors[i].end(), j) == partition_neighbors[i].end() )
-        {
-          partition_neighbors[i].push_back(j);
-        }
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    for (auto NE_it : _NEList[i])
+    {
+      node_partitions[i].push_back(epart[NE_it]);
+    }
 
-        if ( std::find(partition_neighbors[j].begin(), partition_neighbors[j].end(), i) == partition_neighbors[j].end() )
-        {
-          partition_neighbors[j].push_back(i);
-        }
-        //partition_neighbors[i].insert(j);
-        //partition_neighbors[j].insert(i);
-        if ( std::find(interface_neighbors[interface_counter].begin(), interface_neighbors[interface_counter].end(), i) == interface_neighbors[interface_counter].end() )
-        {
-          interface_neighbors[interface_counter].push_back(i);
-        }
+    std::sort(node_partitions[i].begin(), node_partitions[i].end());
+    node_partitions[i].erase( std::unique(node_partitions[i].begin(), node_partitions[i].end()), node_partitions[i].end() );
 
-        if ( std::find(interface_neighbors[interface_counter].begin(), interface_neighbors[interface_counter].end(), j) == interface_neighbors[interface_counter].end() )
-        {
-          interface_neighbors[interface_counter].push_back(j);
-        }
-        //interface_neighbors[interface_counter].insert(i);
-        //interface_neighbors[interface_counter].insert(j);
+    for (size_t j = 0; j < node_partitions[i].size(); ++j)
+    {
+      for (size_t k = j+1; k < node_partitions[i].size(); ++k)
+      {
+        interface_map[ std::make_pair(node_partitions[i][j], node_partitions[i][k]) ].push_back(i);
       }
-    }      
-  } 
+    }
+  }
+
+  //interfaces are numbered in lexicographic order of their partition pairs
+  num_interfaces = interface_map.size();
+  interface_neighbors.reserve(num_interfaces);
+  interface_sets.reserve(num_interfaces);
+
+  for (auto & it : interface_map)
+  {
+    int i = it.first.first;
+    int j = it.first.second;
+
+    interface_sets.push_back(std::move(it.second));
+    std::vector<index_t> neighbors(2);
+    neighbors[0] = i;
+    neighbors[1] = j;
+    interface_neighbors.push_back(neighbors);
+
+    //get neighboring information
+    partition_neighbors[i].push_back(j);
+    partition_neighbors[j].push_back(i);
+  }
   //end of get the interface nodes for all partition boundaries
 
   //remove interface nodes from initial_nodes_per_partition
-  for (auto interface_nodes : interface_sets)
+  for (size_t i = 0; i < num_nodes; ++i)
   {
-    for (size_t i = 0; i < interface_nodes.size(); ++i)
+    if (node_partitions[i].size() < 2)
     {
-      for (size_t j = 0; j < initial_nodes_per_partition.size(); ++j)
-      {
-        for (auto it : interface_nodes[i])
-        {
-          initial_nodes_per_partition[j].erase(it);
-        }
-      }
+      continue;
     }
-  } 
+
+    for (auto part : node_partitions[i])
+    {
+      initial_nodes_per_partition[part].erase(i);
+    }
+  }
   //end of remove interface nodes from initial_nodes_per_partition
 
   //get partition interface elements
+  interface_elements_sets.resize(num_interfaces);
   for (size_t i = 0; i < interface_sets.size(); ++i)
   {
-    for (size_t j = 0; j < interface_sets[i].size(); ++j)
+    for (size_t k = 0; k < interface_sets[i].size(); ++k)
     {
-      std::set<index_t> tmp;
-      for (size_t k = 0; k < interface_sets[i][j].size(); ++k)
-      {            
-        for (auto NE_it : _NEList[interface_sets[i][j][k]])
-        {  
-          //element must not appear in more than one interface mesh!
-          if (element_counter_interfaces[NE_it] == 0)
-          {          
-            tmp.insert(NE_it);
-            ++element_counter_interfaces[NE_it];
-          }
+      for (auto NE_it : _NEList[interface_sets[i][k]])
+      {
+        //element must not appear in more than one interface mesh!
+        if (element_counter_interfaces[NE_it] == 0)
+        {
+          interface_elements_sets[i].insert(NE_it);
+          ++element_counter_interfaces[NE_it];
         }
       }
-      interface_elements_sets[i].push_back(tmp);
-      tmp.clear();
     }
   }
   //end of get partition interface elements
 
   //add the vertices of the partition interface elements to interface_sets
   //TODO: this seems to be overload, since a set in interface_sets storing the interface nodes is already available
+  interface_nodes.resize(num_interfaces);
   for (size_t i = 0; i < interface_elements_sets.size(); ++i)
-  { 
-    for (size_t j = 0; j < interface_elements_sets[i].size(); ++j)
+  {
+    for (auto interface_element : interface_elements_sets[i])
     {
-      std::set<index_t> tmp;
-
-      for (auto interface_element : interface_elements_sets[i][j])
-      {
-        tmp.insert(_ENList[interface_element*3]);
-        tmp.insert(_ENList[interface_element*3+1]);
-        tmp.insert(_ENList[interface_element*3+2]);
-      }
-      interface_nodes[i].push_back(tmp);
+      interface_nodes[i].insert(_ENList[interface_element*3]);
+      interface_nodes[i].insert(_ENList[interface_element*3+1]);
+      interface_nodes[i].insert(_ENList[interface_element*3+2]);
     }
   }
   //end of add the vertices of the partition interface elements to interface_sets
 
   //remove partition interface elements from the actual partitions
+  //an element is only contained in the partition assigned by metis
   for (auto interface_elements : interface_elements_sets)
   {
-    for (size_t i = 0; i < interface_elements.size(); ++i)
+    for (auto it : interface_elements)
     {
-      for (size_t j = 0; j < elements_per_partition.size(); ++j)
-      {
-        for (auto it : interface_elements[i])
-        {
-          elements_per_partition[j].erase(it);
-        }
-      }
+      elements_per_partition[ epart[it] ].erase(it);
     }
-  } 
+  }
   //end of remove partition interface elements from the actual partitions
 
   //now get vertices from global ENList
@@ -433,6 +415,11 @@ void GroupedPartitions::CreatePragmaticDataStructures()
     {
       global_to_local_index_map.insert( std::make_pair(it, new_vertex_id++) );
       ++vertex_appearances[it];
+
+      if (vertex_partition[it] < 0)
+      {
+        vertex_partition[it] = i;
+      }
     }
     
     global_to_local_index_mappings_partitions[i] = global_to_local_index_map;
@@ -489,8 +476,10 @@ void GroupedPartitions::CreatePragmaticDataStructures()
   //end of loop over all partitions
 
   //Create Interfaces
-  int num_interfaces = binomial_coefficient(nparts, 2);
-  
+  global_to_local_index_mappings_interfaces.resize(num_interfaces);
+  local_to_global_index_mappings_interfaces.resize(num_interfaces);
+  boundary_nodes_interfaces.resize(num_interfaces);
+
   //vectors storing the coordinate
   std::vector< std::vector<double>> x_coords_interfaces(num_interfaces);
   std::vector< std::vector<double>> y_coords_interfaces(num_interfaces);
@@ -500,90 +489,92 @@ void GroupedPartitions::CreatePragmaticDataStructures()
   std::vector<std::vector<index_t>> ENLists_interfaces(num_interfaces);
 
   //loop over all interfaces
-  int interface_counter = 0 ;
-  for(size_t i = 0; i < interface_elements_sets.size(); ++i)
+  for (size_t interface_counter = 0; interface_counter < num_interfaces; ++interface_counter)
   {
-    for (size_t j = 0; j < interface_elements_sets[i].size(); ++j, interface_counter++)
+    //get number of vertices and elements
+    int num_points = interface_nodes[interface_counter].size();
+    int num_cells = interface_elements_sets[interface_counter].size();
+
+    //get the vertex-to-index-mapping between old and new indices
+    std::unordered_map <index_t, index_t> interface_global_to_local_index_map;
+    std::unordered_map <index_t, index_t> interface_local_to_global_index_map;
+
+    //all elements at the nodes of this interface may already belong to previous interfaces
+    if (num_points == 0 || num_cells == 0)
     {
-      //get number of vertices and elements
-      int num_points = interface_nodes[i][j].size();
-      int num_cells = interface_elements_sets[i][j].size();
+      pragmatic_interfaces.push_back(nullptr);
 
-      //get the vertex-to-index-mapping between old and new indices
-      std::unordered_map <index_t, index_t> interface_global_to_local_index_map;
-      std::unordered_map <index_t, index_t> interface_local_to_global_index_map;
+      //if interface i does not exist, insert negative numbers into the mapping vectors to mark them as empty
+      interface_global_to_local_index_map.insert( std::make_pair(-1, -1) );
+      global_to_local_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
+      local_to_global_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
 
-      if (num_points == 0 || num_cells == 0)
-      {
-         pragmatic_interfaces.push_back(nullptr);
-      
-         //if interface i does not exist, insert negative numbers into the mapping vectors to mark them as empty
-         interface_global_to_local_index_map.insert( std::make_pair(-1, -1) );
-         global_to_local_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
-         local_to_global_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
+      continue;
+    }
 
-        continue;
-      }
+    index_t new_vertex_id = 0;
+    for (auto it : interface_nodes[interface_counter])
+    {
+      interface_global_to_local_index_map.insert( std::make_pair(it, new_vertex_id++) );
+      ++vertex_appearances[it]; //TODO: atomic increment for all appearances incrementations for parallelization???
 
-      index_t new_vertex_id = 0;  
-      for (auto it : interface_nodes[i][j])
+      if (vertex_interface[it] < 0)
       {
-        interface_global_to_local_index_map.insert( std::make_pair(it, new_vertex_id++) );
-        ++vertex_appearances[it]; //TODO: atomic increment for all appearances incrementations for parallelization???
+        vertex_interface[it] = interface_counter;
       }
+    }
 
-      global_to_local_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
+    global_to_local_index_mappings_interfaces[interface_counter] = interface_global_to_local_index_map;
 
-      //and get also the index-to-vertex mapping (opposite direction than vertex to index mapping)
-      for (auto it : interface_global_to_local_index_map)
-      {
-        interface_local_to_global_index_map[it.second] = it.first;
-      }
+    //and get also the index-to-vertex mapping (opposite direction than vertex to index mapping)
+    for (auto it : interface_global_to_local_index_map)
+    {
+      interface_local_to_global_index_map[it.second] = it.first;
+    }
 
-      local_to_global_index_mappings_interfaces[interface_counter] = interface_local_to_global_index_map;
+    local_to_global_index_mappings_interfaces[interface_counter] = interface_local_to_global_index_map;
 
-      //pre-allocate memory
-      x_coords_interfaces[interface_counter].reserve(num_points);
-      y_coords_interfaces[interface_counter].reserve(num_points);
-      ENLists_interfaces[interface_counter].resize(3*num_cells);
+    //pre-allocate memory
+    x_coords_interfaces[interface_counter].reserve(num_points);
+    y_coords_interfaces[interface_counter].reserve(num_points);
+    ENLists_interfaces[interface_counter].resize(3*num_cells);
 
-      //get coordinates of each vertex
-      //TODO: combine this loop with the next one!
-      size_t counter = 0;
-      for (auto it : interface_nodes[i][j])
-      {
-        double p[2];
-        mesh->get_coords( it, p);
-        x_coords_interfaces[interface_counter][counter] = p[0];
-        y_coords_interfaces[interface_counter][counter] = p[1];           
-        ++counter;
-      }
+    //get coordinates of each vertex
+    //TODO: combine this loop with the next one!
+    size_t counter = 0;
+    for (auto it : interface_nodes[interface_counter])
+    {
+      double p[2];
+      mesh->get_coords( it, p);
+      x_coords_interfaces[interface_counter][counter] = p[0];
+      y_coords_interfaces[interface_counter][counter] = p[1];
+      ++counter;
+    }
 
-      //create ENList with respect to the new vertex indices
-      //TODO: combine this loop with the previous one!
-      counter=0;        
-      for (auto it : interface_elements_sets[i][j])
-      {         
-        const index_t *element_ptr = nullptr;
-        element_ptr = mesh->get_element(it);
-          
-        ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];
-        ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];
-        ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];      
-
-        ++element_appearances[it];    
-      }
-          
-      //create pragmatic mesh 
-      Mesh<double> *interface_mesh = nullptr;
+    //create ENList with respect to the new vertex indices
+    //TODO: combine this loop with the previous one!
+    counter=0;
+    for (auto it : interface_elements_sets[interface_counter])
+    {
+      const index_t *element_ptr = nullptr;
+      element_ptr = mesh->get_element(it);
 
-      //TODO: change for 3D refinement
-      //mesh = new Mesh<double> ( num_points, num_cells, &(ENLists_regions[region.id()][0]) ,&(x_coords[region.id()][0]), &(y_coords[region.id()][0]), &(z_coords[region.id()][0]) );        
-      interface_mesh = new Mesh<double> ( num_points, num_cells, &(ENLists_interfaces[interface_counter][0]), &(x_coords_interfaces[interface_counter][0]), &(y_coords_interfaces[interface_counter][0]) );
-      interface_mesh->create_boundary();
+      ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];
+      ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];
+      ENLists_interfaces[interface_counter][counter++] = interface_global_to_local_index_map[*(element_ptr++)];
 
-      pragmatic_interfaces.push_back(interface_mesh);
+      ++element_appearances[it];
     }
+
+    //create pragmatic mesh
+    Mesh<double> *interface_mesh = nullptr;
+
+    //TODO: change for 3D refinement
+    //mesh = new Mesh<double> ( num_points, num_cells, &(ENLists_regions[region.id()][0]) ,&(x_coords[region.id()][0]), &(y_coords[region.id()][0]), &(z_coords[region.id()][0]) );
+    interface_mesh = new Mesh<double> ( num_points, num_cells, &(ENLists_interfaces[interface_counter][0]), &(x_coords_interfaces[interface_counter][0]), &(y_coords_interfaces[interface_counter][0]) );
+    interface_mesh->create_boundary();
+
+    pragmatic_interfaces.push_back(interface_mesh);
   }
   //end of loop over all interfaces
 }
@@ -704,43 +695,20 @@ void GroupedPartitions::GetPartitionAndInterfaceBoundaries()
 //GroupedPartitions::GetCoords()
 void GroupedPartitions::GetCoords(index_t n, double *vertex)
 {
-  bool found = false;
-
   //search partitions
- 
-  //do a lookup in the global_to_local_index_mappings_partitions and then return the corresponding coordinates!
-  for (size_t i = 0; i < global_to_local_index_mappings_partitions.size(); ++i)
+  if (vertex_partition[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_partitions[i].find(n);
-    
-    if (position == global_to_local_index_mappings_partitions[i].end())
-    {
-      continue;
-    }
-
-    //std::cout << "found vertex " << n << " in partition " << i << std::endl;
-    pragmatic_partitions[i]->get_coords(position->second, vertex);
-    found = true;
-    break;
+    int i = vertex_partition[n];
+    pragmatic_partitions[i]->get_coords(global_to_local_index_mappings_partitions[i].at(n), vertex);
+    return;
   }
   //end of seach partitions
 
   //check interface
-  if (found)
-    return; 
-
-  for (size_t i = 0; i < global_to_local_index_mappings_interfaces.size(); ++i)
+  if (vertex_interface[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_interfaces[i].find(n);
-
-    if(position == global_to_local_index_mappings_interfaces[i].end())
-    {        
-        continue;
-    }
-
-    //std::cout << "found vertex " << n << " in interface " << i << std::endl;
-    pragmatic_interfaces[i]->get_coords(position->second, vertex);
-    break;
+    int i = vertex_interface[n];
+    pragmatic_interfaces[i]->get_coords(global_to_local_index_mappings_interfaces[i].at(n), vertex);
   }
   //end of search interface
 }
@@ -853,8 +821,8 @@ std::vector<index_t>* GroupedPartitions::GetNNList(index_t n, int *partitions, i
   }  
   //end of check interfaces
   */
-  else
-    std::cout << "\033[1;31mVertex " << n << " not found\033[0m" << std::endl;
+  std::cout << "\033[1;31mVertex " << n << " not found\033[0m" << std::endl;
+  return nullptr;
 }
 //end of GroupedPartitions::GetNNList(index_t n, int *partitions, int *interfaces)
 
@@ -899,6 +867,8 @@ bool GroupedPartitions::GetNNList_adv(index_t n, std::vector<index_t> &_NNList)
   //_NNList.resize(it - _NNList.begin());
 
   //std::cout << n << " in partition: " << partition << " and interface: " << interface << std::endl;
+
+  return true;
 }
 //end of GroupedPartitions::GetNNList_adv(index_t n, int *partitions, int *interfaces)
 
@@ -1064,37 +1034,26 @@ void GroupedPartitions::WriteMergedMesh(std::string filename)
 int GroupedPartitions::GetVertexPartitionOrInterface(index_t n, bool *partition, bool *interface)
 {
   //check partitions
-  for (size_t i = 0; i < nparts; ++i)
+  if (vertex_partition[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_partitions[i].find(n);
-
-    if (position == global_to_local_index_mappings_partitions[i].end())
-    {
-      continue;
-    }
-    
     *partition = true;
     *interface = false;
-    return i;
+    return vertex_partition[n];
   }
   //end of check partitions
 
   //check interfaces
-  for (size_t i = 0; i < global_to_local_index_mappings_interfaces.size(); ++i)
+  if (vertex_interface[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_interfaces[i].find(n);
-
-    if (position == global_to_local_index_mappings_interfaces[i].end())
-    {
-      continue;
-    }
     *partition = false;
     *interface = true;
-    return i;
-  }  
+    return vertex_interface[n];
+  }
   //end of check interfaces
 
   //error
+  *partition = false;
+  *interface = false;
   return -1;
 }
 //end of GroupedPartitions::GetVertexPartitionOrInterface(index_t n, bool *partition, bool *interface)
@@ -1105,31 +1064,16 @@ int GroupedPartitions::GetVertexPartitionOrInterface(index_t n, bool *partition,
 void GroupedPartitions::GetVertexPartitionAndInterface(index_t n, int *partition, int *interface)
 {
   //check partition
-  for (size_t i = 0; i < pragmatic_partitions.size(); ++i)
+  if (vertex_partition[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_partitions[i].find(n);
-
-    if (position == global_to_local_index_mappings_partitions[i].end())
-    {
-      continue;
-    }
-    *partition = i;
-    break;
-  } //end of check partitions
+    *partition = vertex_partition[n];
+  }
 
   //check interfaces
-  for (size_t i = 0; i < pragmatic_interfaces.size(); ++i)
+  if (vertex_interface[n] >= 0)
   {
-    std::unordered_map<index_t, index_t>::iterator position = global_to_local_index_mappings_interfaces[i].find(n);
-
-    if (position == global_to_local_index_mappings_interfaces[i].end())
-    {
-      continue;
-    }
-    
-    *interface=i;
-    break;
-  } //end of check interfaces
+    *interface = vertex_interface[n];
+  }
 }
 //end of GroupedPartitions::GetVertexPartitionAndInterface(index_t n)
 
@@ -4,6 +4,8 @@
 #include "grouped_partitions.hpp"
 
 #include <time.h>
+#include <mutex>
+#include <thread>
 
 //----------------------------------------------------------------------------------------------------------------------------------------------//
 //                                                                Declaration                                                                   //
@@ -18,7 +20,6 @@ class GroupedPartitionsSmooth
 
     //member functions
     bool SimpleLaplace(int iterations);
-    bool SimpleLaplaceOnGroups_sections(int iterations);
     bool SimpleLaplaceOnGroups_tasks(int iterations);
     void Evaluate();
 
@@ -26,15 +27,9 @@ class GroupedPartitionsSmooth
     GroupedPartitions &mesh;
 
     void LaplaceKernel(int part1, int part2, int inter);
-    void AssignPartitionsAndInterface();
 
-    std::vector<std::vector<int>> work_sets;  //vector storing the work sets (value 1 and 2 denote the partitions, value 3 the corresponding interface, parameter is num_threads)
     std::vector<int> num_touches_partitions;
     std::vector<int> num_touches_interfaces;
-
-    std::vector<bool> partition_assigned; //vectors storing if partition i is already assigned to a thread
-    std::vector<bool> interface_assigned;
-    
 };
 
 //----------------------------------------------------------------------------------------------------------------------------------------------//
@@ -46,7 +41,7 @@ class GroupedPartitionsSmooth
 //----------------------------------------------------------------------------------------------------------------------------------------------//
 
 //Constructor
-GroupedPartitionsSmooth::GroupedPartitionsSmooth(GroupedPartitions &GP) : mesh(GP), num_touches_partitions(mesh.pragmatic_partitions.size(), 0), num_touches_interfaces(mesh.pragmatic_interfaces.size(), 0), work_sets(mesh.nparts/2), partition_assigned(mesh.nparts, false), interface_assigned(mesh.pragmatic_interfaces.size(), false)
+GroupedPartitionsSmooth::GroupedPartitionsSmooth(GroupedPartitions &GP) : mesh(GP), num_touches_partitions(mesh.pragmatic_partitions.size(), 0), num_touches_interfaces(mesh.pragmatic_interfaces.size(), 0)
 {
   int num_interfaces = 0;
   for (size_t i = 0; i < mesh.pragmatic_interfaces.size(); ++i)
@@ -61,12 +56,7 @@ GroupedPartitionsSmooth::GroupedPartitionsSmooth(GroupedPartitions &GP) : mesh(G
 
   std::cout << "Create GroupedPartitionsSmooth Object" << std::endl;
   std::cout << "Smooth " << mesh.num_partitions << " partitions and " << num_interfaces << " interfaces" << std::endl;
-  std::cout << "Running with " << mesh.nparts/2 << " threads" << std::endl;
-
-  for (size_t i = 0; i < work_sets.size(); ++i)
-  {
-    work_sets[i].resize(3);
-  }
+  std::cout << "Running with " << omp_get_max_threads() << " threads" << std::endl;
 }
 //end of Constructor
 
@@ -199,751 +189,106 @@ bool GroupedPartitionsSmooth::SimpleLaplace(int no_iterations)
 }
 //end of Simple Laplace Smoother
 
-//GroupedPartitionsSmooth::SimpleLaplaceOnGroups(int iterations)
+//GroupedPartitionsSmooth::SimpleLaplaceOnGroups_tasks(int iterations)
+//every interface is smoothed together with its two partitions once per iteration. The interfaces form a task queue,
+//each thread takes the next interface whose partitions are not processed by another thread at the moment, hence
+//the number of threads is independent of the number of partitions
 //TODO: adapt GetNNList, since it is omitting partition vertex neighbors in an interface!!!
-bool GroupedPartitionsSmooth::SimpleLaplaceOnGroups_sections(int iterations)
+bool GroupedPartitionsSmooth::SimpleLaplaceOnGroups_tasks(int iterations)
 {
-  int num_threads = mesh.nparts/2;
-  //int num_threads = 1;
-  omp_set_dynamic(0);     // explicitly disable dynamic teams
-  omp_set_num_threads(num_threads); // use a specified number of threads for all consecutive parallel regions 
-
-/*
-  //example work sets 
-  work_sets[0].push_back(0);
-  work_sets[0].push_back(1); 
-  work_sets[0].push_back(0);
-  
-  work_sets[1].push_back(2);
-  work_sets[1].push_back(3); 
-  work_sets[1].push_back(5);
-*/
-  //parallel sections
-
-#pragma omp parallel
-{   
-  #pragma omp master
-  {/*
-    std::cout << "Running with " << omp_get_num_threads() << " threads" << std::endl;
-    std::cout << "iteration 1/2" << std::endl;
-*/
-    clock_t tic = clock();
-    AssignPartitionsAndInterface();
-    clock_t toc = clock();
-    std::cout << "Time for assignement: " <<  static_cast<double>(toc - tic) / CLOCKS_PER_SEC << std::endl;
-    /*
-    for (size_t i = 0; i < work_sets.size(); ++i)
-    {
-      std::cout << "Thread " << i << ": " << work_sets[i][0] << " " << work_sets[i][1] << " " << work_sets[i][2] << std::endl;
-    }*/
-  }  
-
-  #pragma omp sections
+  std::vector<int> tasks;
+  for (size_t i = 0; i < mesh.pragmatic_interfaces.size(); ++i)
   {
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[0][0], work_sets[0][1], work_sets[0][2]);
-      //LaplaceKernel(work_sets[0][0], work_sets[0][1], work_sets[0][2]); #threads=2
-      //LaplaceKernel(0,1,0); //test_box_1000x1000 #threads=2
-      //LaplaceKernel(0,1,0);   //test_box_1000x1000, #threads=4
-      //LaplaceKernel(0,1,0); //test_box_2000x2000 #threads=2
-      //LaplaceKernel(0,1,0); //test_box_2000x2000 #threads=4
-    }
-    
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[1][0], work_sets[1][1], work_sets[1][2]);
-      //LaplaceKernel(work_sets[1][0], work_sets[1][1], work_sets[1][2]); #threads=2
-      //LaplaceKernel(2,3,5); //test_box_1000x1000, #threads=2
-      //LaplaceKernel(2,3,13);  //test_box_1000x1000, #threads=4
-      //LaplaceKernel(2,3,5); //test_box_2000x2000 #threads=2
-      //LaplaceKernel(2,3,13); //test_box_2000x2000 #threads=4
-    }
-/*
-    //#threads=4
-    
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[2][0], work_sets[2][1], work_sets[2][2]);
-      //LaplaceKernel(4,5,22); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[3][0], work_sets[3][1], work_sets[3][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-/*
-    //#threads=6
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[4][0], work_sets[4][1], work_sets[4][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[5][0], work_sets[5][1], work_sets[5][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    //#threads=8
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[4][0], work_sets[4][1], work_sets[4][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    #pragma omp section
+    if (mesh.pragmatic_interfaces[i] != nullptr)
     {
-      LaplaceKernel(work_sets[5][0], work_sets[5][1], work_sets[5][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
+      tasks.push_back(i);
     }
-*/  
-  } //end of sections
-
-  //now switch assignement of partitions and interfaces
-  //parallel sections
-
-  #pragma omp master 
-  {
-    //std::cout << "iteration 2/2" << std::endl;
-    std::fill(partition_assigned.begin(), partition_assigned.end(), false);
-    std::fill(interface_assigned.begin(), interface_assigned.end(), false);
-
-    clock_t tic = clock();
-    AssignPartitionsAndInterface();
-    clock_t toc = clock();
-    std::cout << "Time for assignement: " <<  static_cast<double>(toc - tic) / CLOCKS_PER_SEC << std::endl;
-/*   
-    for (size_t i = 0; i < work_sets.size(); ++i)
-    {
-      std::cout << "Thread " << i << ": " << work_sets[i][0] << " " << work_sets[i][1] << " " << work_sets[i][2] << std::endl;
-    }
-*/
-  }  
-  #pragma omp sections
-  {    
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[0][0], work_sets[0][1], work_sets[0][2]);
-      //LaplaceKernel(0, 3, 2); //test_box_300x300, 1000x1000 #threads=2
-      //LaplaceKernel(0,6,5);   //test_box_1000x1000, #threads=4
-      //LaplaceKernel(0,2,1); //test_box_2000x2000 #threads=2
-      //LaplaceKernel(0,2,1); //test_box_2000x2000 #threads=4
-    }
-    
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[1][0], work_sets[1][1], work_sets[1][2]);
-      //LaplaceKernel(1, 2, 3); //test_box_300x300, 1000x1000 #threads=2
-      //LaplaceKernel(2,5,15);   //test_box_1000x1000, #threads=4
-      //LaplaceKernel(1,3,4); //test_box_2000x2000 #threads=2
-      //LaplaceKernel(4,3,18); //test_box_2000x2000 #threads=4
-    }
-    
-    //#threads=4
-/*
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[2][0], work_sets[2][1], work_sets[2][2]);
-      //LaplaceKernel(4,7,24); //test_box_1000x1000 #threads=4
-      //LaplaceKernel(5,7,26); //test_box_2000x2000 #threads=4
-    }
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[3][0], work_sets[3][1], work_sets[3][2]);
-      //LaplaceKernel(1,3,8); //test_box_1000x1000 #threads=4
-      //LaplaceKernel(6,1,11); //test_box_2000x2000 #threads=4
-    }
-/*
-    //#threads=6
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[4][0], work_sets[4][1], work_sets[4][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[5][0], work_sets[5][1], work_sets[5][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    //#threads=8
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[4][0], work_sets[4][1], work_sets[4][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-
-    #pragma omp section
-    {
-      LaplaceKernel(work_sets[5][0], work_sets[5][1], work_sets[5][2]);
-      //LaplaceKernel(6,7,27); //test_box_2000x2000 #threads=4, test_box_1000x1000, #threads=4
-    }
-  */
-  } //end of sections
-} //end of pragma omp parallel
-
-//now process the left out interfaces
-for (size_t i = 0; i < mesh.pragmatic_interfaces.size(); ++i)
-{
-  if (mesh.pragmatic_interfaces[i] == nullptr)
-  {
-    continue;
   }
 
-  if (num_touches_interfaces[i] != 2)
-  {
-    std::cout << "interface " << i << " has to be processed for another " << iterations - num_touches_interfaces[i] << " time(s)" << std::endl;
-  }
-}
+  std::cout << iterations << " iterations of Simple Laplace Smoother on " << tasks.size() << " groups using " << omp_get_max_threads() << " threads" << std::endl;
 
-/*
-  std::cout << std::endl << "Number of Touches" << std::endl;
-  for (size_t i = 0; i < num_touches_partitions.size(); ++i)
+  for (int iteration = 1; iteration <= iterations; ++iteration)
   {
-    std::cout << "Partition " << i << ": " << num_touches_partitions[i] <<std::endl;
-  }
-  std::cout << std::endl;
-  for (size_t i = 0; i < num_touches_interfaces.size(); ++i)
-  {
-    if (mesh.pragmatic_interfaces[i] == nullptr)
-      continue;
-    std::cout << "Interface " << i << ": " << num_touches_interfaces[i] <<std::endl;
-  }
-*/
-/*
-  omp_set_dynamic(0);     // explicitly disable dynamic teams
-  omp_set_num_threads(2); // use a specified number of threads for all consecutive parallel regions 
+    std::vector<int> queue(tasks);
+    std::vector<bool> partition_busy(mesh.nparts, false);
+    size_t queue_begin = 0;   //all tasks before queue_begin are done or running
+    std::mutex queue_mutex;
 
-  clock_t tic = clock();
+    clock_t tic = clock();
 
-  #pragma omp parallel sections
-  {
-    std::cout << "Running with " << omp_get_num_threads() << " threads" << std::endl;
-    //section 1
-    #pragma omp section
+    #pragma omp parallel
     {
-      //assign partitions and corresponding interface
-      int part1 = 0;
-      int part2 = 1;
-      int inter = 0;
-
-      //std::cout << iterations << " iterations of Simple Laplace Smoother On Groups" << std::endl;
-
-      //for loop over iterations
-      for (size_t actual_iteration = 0; actual_iteration < iterations; ++actual_iteration)
+      while (true)
       {
-        std::cout << "iteration " << actual_iteration << "/" << iterations << " by thread " << omp_get_thread_num() << std::endl;
-      
-        //for loop over part1
-        //TODO: idea: iterate over the corresponding global_to_local_index_mappings and update the vertices if necessary in more than 1 pragmatic mesh!    
-        for (auto it : mesh.global_to_local_index_mappings_partitions[part1])  
-        {
-          //if vertex is on the boundary of the global mesh do not touch it!
-          if (mesh.boundary_nodes_mesh[it.first])
-          {
-            continue;
-          }
-
-          //if mesh is on the interior boundary of the partition check if it is in the assigned interface
-          //if yes, update it in both submeshes, if no, do not touch it!
-          //TODO: if it is in partition & boundary, the NNLists have to be merged to compute correct results of the Laplace smoothing!!!
-          if ( mesh.boundary_nodes_partitions[part1].at(it.second) )
-          {
-            //check interface
-            if ( mesh.global_to_local_index_mappings_interfaces[inter].find(it.first) != mesh.global_to_local_index_mappings_interfaces[inter].end() )
-            {
-              //std::cout << it.second << " is in interface with id " << mesh.global_to_local_index_mappings_interfaces[inter].at(it.first) << std::endl;
-
-              //get old vertex coordinates
-              double vertex[2] {0.0, 0.0};
-            
-              mesh.GetCoords(it.first, vertex);  
-        
-              //calculate new position
-              //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-              int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-              std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-              int num_neighbors = _NNList->size();
-
-              double q[2] {0.0, 0.0};
-
-              for (size_t j = 0; j < num_neighbors; ++j)
-              {
-                double q_tmp[2] {0.0, 0.0};
-
-                mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part1].at(_NNList->at(j)), q_tmp);
-
-                q[0] += q_tmp[0];
-                q[1] += q_tmp[1];
-              }
-
-              double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-              vertex[0] = h1 * q[0];
-              vertex[1] = h1 * q[1];  
-              // end of calculate new position
-
-              //set the new coordinates of vertex it.first
-              mesh.SetCoords(it.first, vertex);
-
-            } //end of check interface
-          } //end of if mesh.boundary_nodes_partition
-
-          //if mesh is not on any boundary of the assigned partition update its coordinates only in the partition
-          else
-          {
-            //get old vertex coordinates
-            double vertex[2] {0.0, 0.0};
-            
-            mesh.GetCoords(it.first, vertex);  
-        
-            //calculate new position
-            //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-            int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-            std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-            int num_neighbors = _NNList->size();
-
-            double q[2] {0.0, 0.0};
-
-            for (size_t j = 0; j < num_neighbors; ++j)
-            {
-              double q_tmp[2] {0.0, 0.0};
-
-              mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part1].at(_NNList->at(j)), q_tmp);
+        int inter = -1;
+        int part1 = -1;
+        int part2 = -1;
+        bool done = false;
 
-              q[0] += q_tmp[0];
-              q[1] += q_tmp[1];
-            }
-
-            double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-            vertex[0] = h1 * q[0];
-            vertex[1] = h1 * q[1];  
-            // end of calculate new position
-
-            //set the new coordinates of vertex it.first
-            mesh.SetCoords(it.first, vertex);
-          }//end of else
-        } //end of for loop over part1
-
-        //for loop over part2
-        for (auto it : mesh.global_to_local_index_mappings_partitions[part2])  
         {
-          
-          //if vertex is on the boundary of the global mesh do not touch it!
-          if (mesh.boundary_nodes_mesh[it.first])
-          {
-            continue;
-          }
+          std::lock_guard<std::mutex> lock(queue_mutex);
 
-          //if mesh is on the interior boundary of the partition check if it is in the assigned interface
-          //if yes, update it in both submeshes, if no, do not touch it!
-          //TODO: if it is in partition & boundary, the NNLists have to be merged to compute correct results of the Laplace smoothing!!!
-          if ( mesh.boundary_nodes_partitions[part2].at(it.second) )
+          if (queue_begin == queue.size())
           {
-            //check interface
-            if ( mesh.global_to_local_index_mappings_interfaces[inter].find(it.first) != mesh.global_to_local_index_mappings_interfaces[inter].end() )
-            {
-              //std::cout << it.second << " is in interface with id " << mesh.global_to_local_index_mappings_interfaces[inter].at(it.first) << std::endl;
-
-              //get old vertex coordinates
-              double vertex[2] {0.0, 0.0};
-            
-              mesh.GetCoords(it.first, vertex);  
-        
-              //calculate new position
-              //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-              int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-              std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-              int num_neighbors = _NNList->size();
-
-              double q[2] {0.0, 0.0};
-
-              for (size_t j = 0; j < num_neighbors; ++j)
-              {
-                double q_tmp[2] {0.0, 0.0};
-
-                mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part2].at(_NNList->at(j)), q_tmp);
-
-                q[0] += q_tmp[0];
-                q[1] += q_tmp[1];
-              }
-
-              double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-              vertex[0] = h1 * q[0];
-              vertex[1] = h1 * q[1];  
-              // end of calculate new position
-
-              //set the new coordinates of vertex it.first
-              mesh.SetCoords(it.first, vertex);
-
-            } //end of check interface
-          } //end of if mesh.boundary_nodes_partition
+            done = true;
+          }
 
-          //if mesh is not on any boundary of the assigned partition update its coordinates only in the partition
-          else
+          //take the first waiting interface whose partitions are free
+          for (size_t i = queue_begin; i < queue.size(); ++i)
           {
-            //get old vertex coordinates
-            double vertex[2] {0.0, 0.0};
-            
-            mesh.GetCoords(it.first, vertex);  
-        
-            //calculate new position
-            //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-            int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-            std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-            int num_neighbors = _NNList->size();
+            int candidate = queue[i];
+            int candidate_part1 = mesh.interface_neighbors[candidate][0];
+            int candidate_part2 = mesh.interface_neighbors[candidate][1];
 
-            double q[2] {0.0, 0.0};
-
-            for (size_t j = 0; j < num_neighbors; ++j)
+            if (partition_busy[candidate_part1] || partition_busy[candidate_part2])
             {
-              double q_tmp[2] {0.0, 0.0};
-
-              mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part2].at(_NNList->at(j)), q_tmp);
-
-              q[0] += q_tmp[0];
-              q[1] += q_tmp[1];
+              continue;
             }
 
-            double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-            vertex[0] = h1 * q[0];
-            vertex[1] = h1 * q[1];  
-            // end of calculate new position
-
-            //set the new coordinates of vertex it.first
-            mesh.SetCoords(it.first, vertex);
-          }//end of else
-        } //end of for loop over part2
+            inter = candidate;
+            part1 = candidate_part1;
+            part2 = candidate_part2;
+            partition_busy[part1] = true;
+            partition_busy[part2] = true;
 
-        //for loop over interface
-        //adapt only interior vertices, since the boundary vertices have already been updated in the loops over both partitions!!!  
-        for (auto it : mesh.global_to_local_index_mappings_interfaces[inter])  
-        {    
-          //check if vertex is on any interface boundary (includes already the global mesh boundary)
-          //TODO: boundary_nodes_interfaces contains to many elements ==> adapt the algorithm in grouped_partitions.hpp!!!
-          if ( mesh.boundary_nodes_interfaces[inter].at(it.second) )
-          {
-            continue;
+            std::swap(queue[i], queue[queue_begin]);
+            ++queue_begin;
+            break;
           }
+        }
 
-          //get old vertex coordinates
-          double vertex[2] {0.0, 0.0};
-            
-          mesh.GetCoords(it.first, vertex);  
-        
-          //calculate new position
-          //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-          int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-          std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-          int num_neighbors = _NNList->size();
-
-          double q[2] {0.0, 0.0};
-
-          for (size_t j = 0; j < num_neighbors; ++j)
-          {
-            double q_tmp[2] {0.0, 0.0};
-
-            mesh.GetCoords(mesh.local_to_global_index_mappings_interfaces[inter].at(_NNList->at(j)), q_tmp);
-
-            q[0] += q_tmp[0];
-            q[1] += q_tmp[1];
-          }
-
-          double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-          vertex[0] = h1 * q[0];
-          vertex[1] = h1 * q[1];  
-          // end of calculate new position
-
-          //set the new coordinates of vertex i
-          mesh.SetCoords(it.first, vertex);
-        } //end of for loop over interface
-      } //end of loop over iterations
-    } //end of pragma omp section (section 1)
-
-    //section 2
-    #pragma omp section
-    {
-      //assign partitions and corresponding interface
-      int part1 = 2;
-      int part2 = 3;
-      int inter = 5;
-
-      //std::cout << iterations << " iterations of Simple Laplace Smoother On Groups" << std::endl;
-
-      //for loop over iterations
-      for (size_t actual_iteration = 0; actual_iteration < iterations; ++actual_iteration)
-      {
-        std::cout << "iteration " << actual_iteration << "/" << iterations << " by thread " << omp_get_thread_num() << std::endl;
-      
-        //for loop over part1
-        //TODO: idea: iterate over the corresponding global_to_local_index_mappings and update the vertices if necessary in more than 1 pragmatic mesh!    
-        for (auto it : mesh.global_to_local_index_mappings_partitions[part1])  
+        if (done)
         {
-          //if vertex is on the boundary of the global mesh do not touch it!
-          if (mesh.boundary_nodes_mesh[it.first])
-          {
-            continue;
-          }
-
-          //if mesh is on the interior boundary of the partition check if it is in the assigned interface
-          //if yes, update it in both submeshes, if no, do not touch it!
-          //TODO: if it is in partition & boundary, the NNLists have to be merged to compute correct results of the Laplace smoothing!!!
-          if ( mesh.boundary_nodes_partitions[part1].at(it.second) )
-          {
-            //check interface
-            if ( mesh.global_to_local_index_mappings_interfaces[inter].find(it.first) != mesh.global_to_local_index_mappings_interfaces[inter].end() )
-            {
-              //std::cout << it.second << " is in interface with id " << mesh.global_to_local_index_mappings_interfaces[inter].at(it.first) << std::endl;
-
-              //get old vertex coordinates
-              double vertex[2] {0.0, 0.0};
-            
-              mesh.GetCoords(it.first, vertex);  
-        
-              //calculate new position
-              //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-              int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-              std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-              int num_neighbors = _NNList->size();
-
-              double q[2] {0.0, 0.0};
-
-              for (size_t j = 0; j < num_neighbors; ++j)
-              {
-                double q_tmp[2] {0.0, 0.0};
-
-                mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part1].at(_NNList->at(j)), q_tmp);
-
-                q[0] += q_tmp[0];
-                q[1] += q_tmp[1];
-              }
-
-              double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-              vertex[0] = h1 * q[0];
-              vertex[1] = h1 * q[1];  
-              // end of calculate new position
-
-              //set the new coordinates of vertex it.first
-              mesh.SetCoords(it.first, vertex);
-
-            } //end of check interface
-          } //end of if mesh.boundary_nodes_partition
-
-          //if mesh is not on any boundary of the assigned partition update its coordinates only in the partition
-          else
-          {
-            //get old vertex coordinates
-            double vertex[2] {0.0, 0.0};
-            
-            mesh.GetCoords(it.first, vertex);  
-        
-            //calculate new position
-            //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-            int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-            std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-            int num_neighbors = _NNList->size();
-
-            double q[2] {0.0, 0.0};
-
-            for (size_t j = 0; j < num_neighbors; ++j)
-            {
-              double q_tmp[2] {0.0, 0.0};
-
-              mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part1].at(_NNList->at(j)), q_tmp);
-
-              q[0] += q_tmp[0];
-              q[1] += q_tmp[1];
-            }
-
-            double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-            vertex[0] = h1 * q[0];
-            vertex[1] = h1 * q[1];  
-            // end of calculate new position
-
-            //set the new coordinates of vertex it.first
-            mesh.SetCoords(it.first, vertex);
-          }//end of else
-        } //end of for loop over part1
+          break;
+        }
 
-        //for loop over part2
-        for (auto it : mesh.global_to_local_index_mappings_partitions[part2])  
+        //all remaining interfaces are blocked by running tasks
+        if (inter < 0)
         {
-          
-          //if vertex is on the boundary of the global mesh do not touch it!
-          if (mesh.boundary_nodes_mesh[it.first])
-          {
-            continue;
-          }
-
-          //if mesh is on the interior boundary of the partition check if it is in the assigned interface
-          //if yes, update it in both submeshes, if no, do not touch it!
-          //TODO: if it is in partition & boundary, the NNLists have to be merged to compute correct results of the Laplace smoothing!!!
-          if ( mesh.boundary_nodes_partitions[part2].at(it.second) )
-          {
-            //check interface
-            if ( mesh.global_to_local_index_mappings_interfaces[inter].find(it.first) != mesh.global_to_local_index_mappings_interfaces[inter].end() )
-            {
-              //std::cout << it.second << " is in interface with id " << mesh.global_to_local_index_mappings_interfaces[inter].at(it.first) << std::endl;
-
-              //get old vertex coordinates
-              double vertex[2] {0.0, 0.0};
-            
-              mesh.GetCoords(it.first, vertex);  
-        
-              //calculate new position
-              //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-              int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-              std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-              int num_neighbors = _NNList->size();
-
-              double q[2] {0.0, 0.0};
-
-              for (size_t j = 0; j < num_neighbors; ++j)
-              {
-                double q_tmp[2] {0.0, 0.0};
-
-                mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part2].at(_NNList->at(j)), q_tmp);
-
-                q[0] += q_tmp[0];
-                q[1] += q_tmp[1];
-              }
-
-              double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-              vertex[0] = h1 * q[0];
-              vertex[1] = h1 * q[1];  
-              // end of calculate new position
-
-              //set the new coordinates of vertex it.first
-              mesh.SetCoords(it.first, vertex);
-
-            } //end of check interface
-          } //end of if mesh.boundary_nodes_partition
-
-          //if mesh is not on any boundary of the assigned partition update its coordinates only in the partition
-          else
-          {
-            //get old vertex coordinates
-            double vertex[2] {0.0, 0.0};
-            
-            mesh.GetCoords(it.first, vertex);  
-        
-            //calculate new position
-            //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-            int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-            std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-            int num_neighbors = _NNList->size();
-
-            double q[2] {0.0, 0.0};
-
-            for (size_t j = 0; j < num_neighbors; ++j)
-            {
-              double q_tmp[2] {0.0, 0.0};
-
-              mesh.GetCoords(mesh.local_to_global_index_mappings_partitions[part2].at(_NNList->at(j)), q_tmp);
-
-              q[0] += q_tmp[0];
-              q[1] += q_tmp[1];
-            }
-
-            double h1 = (1.0 / static_cast<double>(num_neighbors) );
-
-            vertex[0] = h1 * q[0];
-            vertex[1] = h1 * q[1];  
-            // end of calculate new position
-
-            //set the new coordinates of vertex it.first
-            mesh.SetCoords(it.first, vertex);
-          }//end of else
-        } //end of for loop over part2
-
-        //for loop over interface
-        //adapt only interior vertices, since the boundary vertices have already been updated in the loops over both partitions!!!  
-        for (auto it : mesh.global_to_local_index_mappings_interfaces[inter])  
-        {    
-          //check if vertex is on any interface boundary (includes already the global mesh boundary)
-          //TODO: boundary_nodes_interfaces contains to many elements ==> adapt the algorithm in grouped_partitions.hpp!!!
-          if ( mesh.boundary_nodes_interfaces[inter].at(it.second) )
-          {
-            continue;
-          }
-
-          //get old vertex coordinates
-          double vertex[2] {0.0, 0.0};
-            
-          mesh.GetCoords(it.first, vertex);  
-        
-          //calculate new position
-          //equation from MSc-Thesis "Glättung von Polygonnetzen in medizinischen Visualisierungen - J. Haase, 2005, eq. 2.2"
-
-          int partition, interface; //TODO: this is unnecessary with this algorithm!!!
-          std::vector<index_t>* _NNList = mesh.GetNNList(it.first, &partition, &interface);
-          int num_neighbors = _NNList->size();
-
-          double q[2] {0.0, 0.0};
-
-          for (size_t j = 0; j < num_neighbors; ++j)
-          {
-            double q_tmp[2] {0.0, 0.0};
-
-            mesh.GetCoords(mesh.local_to_global_index_mappings_interfaces[inter].at(_NNList->at(j)), q_tmp);
-
-            q[0] += q_tmp[0];
-            q[1] += q_tmp[1];
-          }
+          std::this_thread::yield();
+          continue;
+        }
 
-          double h1 = (1.0 / static_cast<double>(num_neighbors) );
+        LaplaceKernel(part1, part2, inter);
 
-          vertex[0] = h1 * q[0];
-          vertex[1] = h1 * q[1];  
-          // end of calculate new position
+        {
+          std::lock_guard<std::mutex> lock(queue_mutex);
 
-          //set the new coordinates of vertex i
-          mesh.SetCoords(it.first, vertex);
-        } //end of for loop over interface
-      } //end of loop over iterations
-    } //end of pragma omp section (section 2)
+          partition_busy[part1] = false;
+          partition_busy[part2] = false;
 
-  }//end of pragma omp sections  
+          ++num_touches_partitions[part1];
+          ++num_touches_partitions[part2];
+          ++num_touches_interfaces[inter];
+        }
+      }
+    } //end of pragma omp parallel
 
-  clock_t toc = clock();
+    clock_t toc = clock();
+    std::cout << "iteration " << iteration << "/" << iterations << ": " << static_cast<double>(toc - tic) / CLOCKS_PER_SEC << std::endl;
+  }
 
-  std::cout << "Took " << static_cast<double>( toc - tic ) / CLOCKS_PER_SEC << " seconds " << std::endl;
   return true;
-*/
-}
-//end of GroupedPartitionsSmooth::SimpleLaplaceOnGroups(int iterations)
-
-//GroupedPartitionsSmooth::SimpleLaplaceOnGroups_tasks(int iterations)
-bool GroupedPartitionsSmooth::SimpleLaplaceOnGroups_tasks(int iterations)
-{
-  int num_threads = mesh.nparts/2;
-  omp_set_dynamic(0);               // explicitly disable dynamic teams
-  omp_set_num_threads(num_threads); // use a specified number of threads for all consecutive parallel regions 
 }
 //end of GroupedPartitionsSmooth::SimpleLaplaceOnGroups_tasks(int iterations)
 
@@ -1213,169 +558,6 @@ void GroupedPartitionsSmooth::LaplaceKernel(int part1, int part2, int inter)
 }
 //end of GroupedPartitionsSmooth::LaplaceKernel(int part1, int part2, int inter)
 
-//GroupedPartitionsSmooth::AssignPartitionsAndInterface()
-void GroupedPartitionsSmooth::AssignPartitionsAndInterface()
-{
-  //std::cout << "Assign Partitions And Interfaces! " << std::endl;
-/*
-  for (size_t i = 0; i < mesh.partition_neighbors.size(); ++i)
-  {
-    std::cout << "Neighbors of Partition " << i << std::endl;
-    for (auto it : mesh.partition_neighbors[i])
-    {
-      std::cout << "  " << it << std::endl;
-    }
-  }
-*/
-/*
-  for (size_t i = 0; i < mesh.interface_neighbors.size(); ++i)
-  {
-    if (mesh.interface_neighbors[i].size() == 0)
-      continue; 
-
-    //std::cout << "Neighbors of Interface " << i << std::endl;
-    for (auto it : mesh.interface_neighbors[i])
-    {
-      //std::cout << "  " << it << std::endl;
-    }
-  }
-*/
-  //create work sets
-  //IDEA: iterate over num_touches_interfaces to make sure, that every interface and every partition is touched exactly 
-  // the number of total iterations (parameter int iterations)
-
-  //assign a unique combination of paritions and interface to each thread  
-  //for (size_t thread = 0; thread < work_sets.size(); ++thread)
-  //{ 
-    int thread = 0;
-    int iteration = 1;
-
-    for (size_t i = 0; i < num_touches_interfaces.size(); ++i)
-    {
-      //std::cout << i << ": " << num_touches_interfaces[i] << std::endl;
-      //skip if empty interface
-      if (mesh.interface_neighbors[i].size() == 0 || interface_assigned[i])
-      {
-       // std::cout << "continuing after " << i << std::endl;
-        continue;
-      }
-
-      else if (num_touches_interfaces[i] == iteration)
-      {
-        //std::cout << "skip " << i << std::endl;
-        continue;
-      } 
-
-      //else assign interface and partitions
-      else
-      {
-        //std::set<int>::iterator set_iterator = mesh.interface_neighbors[i].begin();
-        //std::cout << interface_assigned[i] << " " << partition_assigned[*(set_iterator++)] << " " << partition_assigned[*(set_iterator)] << std::endl;
-
-        //set_iterator = mesh.interface_neighbors[i].begin();
-
-        //check if interface or its corresponding partitions are already assigned
-        //if ( interface_assigned[i] || partition_assigned[*(set_iterator++)] || partition_assigned[*(set_iterator)] ) //this is for interface_assigned and partition_assigned being sets
-        if( interface_assigned[i] || partition_assigned[ mesh.interface_neighbors[i][0] ] || partition_assigned[ mesh.interface_neighbors[i][1] ]  )
-        {
-          //set_iterator = mesh.interface_neighbors[i].begin();
-         // std::cout << "interface " << i << " can not be assigned!" << std::endl;
-         // std::cout << i << ": " << interface_assigned[i] << ", " << mesh.interface_neighbors[i][0] << ": " << partition_assigned[ mesh.interface_neighbors[i][0] ] << ", " << mesh.interface_neighbors[i][1] << ": " << partition_assigned[ mesh.interface_neighbors[i][1] ] << std::endl;
-          continue;
-        }
-
-        //std::cout << "assign " << i << std::endl;
-/*
-        set_iterator = mesh.interface_neighbors[i].begin();
-        std::cout << interface_assigned[i] << " " << partition_assigned[*(set_iterator++)] << " " << partition_assigned[*(set_iterator)] << std::endl;
-        
-        set_iterator = mesh.interface_neighbors[i].begin();
-
-        work_sets[thread][0] = *(set_iterator);  //partition 1
-        ++num_touches_partitions[*(set_iterator)];
-        std::cout << "part1: " << *(set_iterator) << std::endl;
-        partition_assigned[*(set_iterator++)] = true;
-
-        work_sets[thread][1] = *(set_iterator);  //partition 2
-        ++num_touches_partitions[*(set_iterator)];
-        std::cout << "part2: " << *(set_iterator) << std::endl;
-        partition_assigned[*(set_iterator++)] = true;
-
-        work_sets[thread][2] = i;  //interface
-        ++num_touches_interfaces[i];
-        interface_assigned[i] = true;
-*/
-
-        //std::cout << interface_assigned[i] << " " << partition_assigned[ mesh.interface_neighbors[i][0] ] << " " << partition_assigned[ mesh.interface_neighbors[i][1] ] << std::endl;
-        
-        work_sets[thread][0] = mesh.interface_neighbors[i][0];  //partition 1
-        ++num_touches_partitions[ mesh.interface_neighbors[i][0] ];
-        //std::cout << "part1: " << mesh.interface_neighbors[i][0] << std::endl;
-        partition_assigned[ mesh.interface_neighbors[i][0] ] = true;
-
-        work_sets[thread][1] = mesh.interface_neighbors[i][1];  //partition 2
-        ++num_touches_partitions[ mesh.interface_neighbors[i][1] ];
-        //std::cout << "part2: " << mesh.interface_neighbors[i][1] << std::endl;
-        partition_assigned[ mesh.interface_neighbors[i][1] ] = true;
-
-        work_sets[thread][2] = i;  //interface
-        ++num_touches_interfaces[i];
-        interface_assigned[i] = true;
-
-        ++thread;
-      }
-
-      if (thread == mesh.nparts/2)
-        break;
-    } //end of create work sets
-
-    if (thread < mesh.nparts/2)
-    {
-      //std::cout << "Did not assign work to " << mesh.nparts/2 - thread << " threads" << std::endl;
-      //assign the 2 partitions left, together with any available interface
-      std::vector<bool>::iterator part;
-      
-      part = std::find( partition_assigned.begin(), partition_assigned.end(), false );  //find partition
-      int index = std::distance(partition_assigned.begin(), part);
-      partition_assigned[ index ] = true;
-      work_sets[thread][0] = index;
-      ++num_touches_partitions[ index ];
-      
-      part = std::find( partition_assigned.begin(), partition_assigned.end(), false );  //find partition
-      index = std::distance(partition_assigned.begin(), part);      
-      partition_assigned[ index ]=true;
-      work_sets[thread][1] = index;
-      ++num_touches_partitions[ index ];
-
-      part = std::find( interface_assigned.begin(), interface_assigned.end(), false );  //find interface
-      index = std::distance(interface_assigned.begin(), part); 
-      if (num_touches_interfaces[index] == 1)
-      {
-        int counter=1;    //counter set to 1, otherwise the first try in the do-while loop would be the same interface as found in the first place
-        bool interface_found = false;
-        do
-        {
-          part = std::find(part+counter, interface_assigned.end(), false );
-          index = std::distance(interface_assigned.begin(), part);
-          ++counter;
-          if (mesh.pragmatic_interfaces[index] != nullptr && num_touches_interfaces[index] != 1)
-          {
-            interface_found = true;
-          }
-        } while (!interface_found);
-          
-        //std::cout << index << " " << interface_assigned.size() << std::endl;
-      }
-      interface_assigned[ index ] = true;
-      work_sets[thread][2] = index;
-      ++num_touches_interfaces[ index ];
-      
-      ++thread;
-      //std::cout << "Assigned leftover partitions together with any available interface" << std::endl;
-    }
-  //}
-} //end of GroupedPartitionsSmooth::AssignPartitionsAndInterface()
-
 //GroupedPartitionsSmooth::Evaluate()
 void GroupedPartitionsSmooth::Evaluate()
 {
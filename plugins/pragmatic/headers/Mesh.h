@@ -148,6 +148,24 @@ public:
     }
 #endif
 
+    /*! Mesh constructor for interleaved coordinates (x0 y0 [z0] x1 y1 [z1] ...).
+     * This is for use when there is no MPI.
+     *
+     * @param NNodes number of nodes in the local mesh.
+     * @param NElements number of nodes in the local mesh.
+     * @param ENList array storing the global node number for each element.
+     * @param coords array storing the interleaved coordinates of each node.
+     * @param ndims is the geometric dimension, 2 for triangles and 3 for tetrahedra.
+     */
+    Mesh(int NNodes, int NElements, const index_t *ENList,
+         const real_t *coords, int ndims)
+    {
+#ifdef HAVE_MPI
+        _mpi_comm = MPI_COMM_WORLD;
+#endif
+        _init(NNodes, NElements, ENList, NULL, NULL, NULL, NULL, NULL, coords, ndims);
+    }
+
     /// Default destructor.
     ~Mesh()
     {
@@ -470,6 +488,46 @@ public:
         return;
     }
     
+    /*! Attach vertex fields which are carried through adaptation: new
+     * vertices get interpolated values, moved vertices are re-interpolated
+     * and defragment() keeps the values with their vertices.
+     *
+     * @param values array of NNodes*n values, the n values of each vertex are consecutive.
+     * @param n number of values per vertex (the sum of the components of all fields).
+     */
+    void set_fields(const double *values, size_t n)
+    {
+        nfields = n;
+        fields.resize((_coords.size()/ndims)*nfields);
+        if(NNodes*nfields>0)
+            memcpy(&fields[0], values, NNodes*nfields*sizeof(double));
+    }
+
+    /// Return the number of field values per vertex.
+    inline size_t get_number_fields() const
+    {
+        return nfields;
+    }
+
+    /// Return the field values of a vertex.
+    inline const double *get_fields(index_t nid) const
+    {
+        assert(nfields>0);
+        return &(fields[nid*nfields]);
+    }
+
+    /// Set the field values of nid to the weighted sum of the values of n nodes,
+    /// nid may be one of the nodes.
+    inline void interpolate_fields(index_t nid, size_t n, const index_t *nodes, const real_t *weights)
+    {
+        for(size_t i=0; i<nfields; i++) {
+            double value = 0.0;
+            for(size_t j=0; j<n; j++)
+                value += weights[j]*fields[nodes[j]*nfields+i];
+            fields[nid*nfields+i] = value;
+        }
+    }
+
     /// Return the array of boundary facets and associated tags
     inline  int * get_boundaryTags() 
     {
@@ -1057,6 +1115,7 @@ public:
         std::vector<index_t> defrag_ENList(NElements*nloc);
         std::vector<real_t> defrag_coords(NNodes*ndims);
         std::vector<double> defrag_metric(NNodes*msize);
+        std::vector<double> defrag_fields(NNodes*nfields);
         std::vector<int> defrag_boundary(NElements*nloc);
         std::vector<double> defrag_quality(NElements);
 
@@ -1099,6 +1158,8 @@ public:
                 defrag_coords[new_nid*ndims+j] = _coords[old_nid*ndims+j];
             for(size_t j=0; j<msize; j++)
                 defrag_metric[new_nid*msize+j] = metric[old_nid*msize+j];
+            for(size_t j=0; j<nfields; j++)
+                defrag_fields[new_nid*nfields+j] = fields[old_nid*nfields+j];
         }
 
         memcpy(&_ENList[0], &defrag_ENList[0], NElements*nloc*sizeof(index_t));
@@ -1106,6 +1167,8 @@ public:
         memcpy(&quality[0], &defrag_quality[0], NElements*sizeof(double));
         memcpy(&_coords[0], &defrag_coords[0], NNodes*ndims*sizeof(real_t));
         memcpy(&metric[0], &defrag_metric[0], NNodes*msize*sizeof(double));
+        if(NNodes*nfields>0)
+            memcpy(&fields[0], &defrag_fields[0], NNodes*nfields*sizeof(double));
 
         // Renumber halo, fix lnn2gnn and node_owner.
         if(num_processes>1) {
@@ -1461,13 +1524,15 @@ private:
 
     void _init(int _NNodes, int _NElements, const index_t *globalENList,
                const real_t *x, const real_t *y, const real_t *z,
-               const index_t *lnn2gnn, const index_t *owner_range)
+               const index_t *lnn2gnn, const index_t *owner_range,
+               const real_t *coords=NULL, int coords_ndims=0)
     {
         num_processes = 1;
         rank=0;
 
         NElements = _NElements;
         NNodes = _NNodes;
+        nfields = 0;
 
 #ifdef HAVE_MPI
         MPI_Comm_size(_mpi_comm, &num_processes);
@@ -1482,7 +1547,7 @@ private:
 
         nthreads = pragmatic_nthreads();
 
-        if(z==NULL) {
+        if((coords==NULL && z==NULL) || (coords!=NULL && coords_ndims==2)) {
             nloc = 3;
             ndims = 2;
             msize = 3;
@@ -1599,7 +1664,12 @@ private:
                     _ENList[i*nloc+j] = ENList[i*nloc+j];
                 }
             }
-            if(ndims==2) {
+            if(coords!=NULL) {
+                #pragma omp for schedule(static)
+                for(int i=0; i<(int)(NNodes*ndims); i++) {
+                    _coords[i] = coords[i];
+                }
+            } else if(ndims==2) {
                 #pragma omp for schedule(static)
                 for(int i=0; i<(int)NNodes; i++) {
                     _coords[i*2  ] = x[i];
@@ -2028,6 +2098,10 @@ private:
     // Metric tensor field.
     std::vector<double> metric;
 
+    // Vertex fields carried through adaptation, nfields values per vertex.
+    size_t nfields;
+    std::vector<double> fields;
+
     // Parallel support.
     int rank, num_processes, nthreads;
     std::vector< std::vector<index_t> > send, recv;
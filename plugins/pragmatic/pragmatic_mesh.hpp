@@ -14,6 +14,13 @@
 
 //viennamesh includes
 #include "viennameshpp/core.hpp"
+#include "viennameshpp/sizing_function.hpp"
+#include "viennameshpp/vertex_quantities.hpp"
+
+//standard includes
+#include <cmath>
+#include <vector>
+#include <string>
 
 typedef viennagrid::mesh                                          MeshType;
 
@@ -60,86 +67,274 @@ inline void make_metric(Mesh<double> *mesh, size_t geometric_dimension)
 			}
 		}//end make_metric
 
+//make metric from vertex data psi (one value per pragmatic node, i.e. per viennagrid vertex id)
+//the Hessian of psi is recovered in parallel inside MetricField::add_field, eta is the target interpolation error
+template<int dim>
+inline void make_metric_from_field(Mesh<double> *mesh, std::vector<double> const & psi, double eta)
+		{
+			MetricField<double,dim> metric_field(*mesh);
+
+			metric_field.add_field(&(psi[0]), eta, 1);
+			metric_field.update_mesh();
+		}//end make_metric_from_field
+
+inline void make_metric_from_field(Mesh<double> *mesh, size_t geometric_dimension, std::vector<double> const & psi, double eta)
+		{
+			if (geometric_dimension == 2)
+				make_metric_from_field<2>(mesh, psi, eta);
+
+			else
+				make_metric_from_field<3>(mesh, psi, eta);
+		}//end make_metric_from_field
+
+//make isotropic metric M = 1/h^2 * I from a sizing function h
+//vertices where the sizing function is undefined keep their current mean edge length
+template<int dim>
+inline void make_metric_from_sizing_function(Mesh<double> *mesh,
+                                             viennamesh::sizing_function::base_functor::function_type const & sizing_function)
+		{
+			MetricField<double,dim> metric_field(*mesh);
+
+			int NNodes = mesh->get_number_nodes();
+			std::vector<double> metric(NNodes*(dim==2?3:6), 0.0);
+
+			#pragma omp parallel for schedule(static)
+			for (int i=0; i<NNodes; ++i)
+			{
+				const double *coords = mesh->get_coords(i);
+				viennagrid::point pt(dim);
+				for (int d=0; d<dim; ++d)
+					pt[d] = coords[d];
+
+				viennamesh::sizing_function::base_functor::result_type size = sizing_function(pt);
+
+				double h;
+				if (size && *size > 0)
+					h = *size;
+
+				else
+				{
+					std::vector<index_t> const & neighbors = *(mesh->get_nnlist(i));
+
+					h = 0.0;
+					for (size_t j=0; j<neighbors.size(); ++j)
+					{
+						const double *other = mesh->get_coords(neighbors[j]);
+
+						double length_2 = 0.0;
+						for (int d=0; d<dim; ++d)
+							length_2 += (other[d]-coords[d])*(other[d]-coords[d]);
+
+						h += sqrt(length_2);
+					}
+
+					if (!neighbors.empty())
+						h /= neighbors.size();
+				}
+
+				if (h <= 0)
+					h = 1.0;
+
+				double *m = &(metric[i*(dim==2?3:6)]);
+				if (dim == 2)
+				{
+					m[0] = m[2] = 1.0/(h*h);
+				}
+
+				else
+				{
+					m[0] = m[3] = m[5] = 1.0/(h*h);
+				}
+			}
+
+			metric_field.set_metric(&(metric[0]));
+			metric_field.update_mesh();
+		}//end make_metric_from_sizing_function
+
+inline void make_metric_from_sizing_function(Mesh<double> *mesh, size_t geometric_dimension,
+                                             viennamesh::sizing_function::base_functor::function_type const & sizing_function)
+		{
+			if (geometric_dimension == 2)
+				make_metric_from_sizing_function<2>(mesh, sizing_function);
+
+			else
+				make_metric_from_sizing_function<3>(mesh, sizing_function);
+		}//end make_metric_from_sizing_function
+
+//copies a scalar vertex quantity field into a vector indexed by vertex id (= pragmatic node id)
+inline std::vector<double> vertex_quantity(MeshType const & input_mesh, viennagrid::quantity_field const & field)
+		{
+			typedef viennagrid::result_of::const_vertex_range<MeshType>::type ConstVertexRangeType;
+			typedef viennagrid::result_of::iterator<ConstVertexRangeType>::type ConstVertexIteratorType;
+
+			std::vector<double> psi( viennagrid::vertex_count(input_mesh), 0.0 );
+
+			ConstVertexRangeType vertices(input_mesh);
+			for (ConstVertexIteratorType vit = vertices.begin(); vit != vertices.end(); ++vit)
+				psi[(*vit).id().index()] = field.get(*vit);
+
+			return psi;
+		}//end vertex_quantity
+
+//sets up the metric for the pragmatic plugins: a user-defined sizing function (XML string) takes precedence over
+//a scalar vertex quantity field, without either one the analytic test metric of make_metric is used
+//metric_quantity selects the quantity field by name, otherwise the first scalar vertex field is taken
+inline void make_metric(Mesh<double> *mesh,
+                        MeshType const & input_mesh,
+                        viennamesh::data_handle<viennagrid_quantity_field> const & quantities,
+                        viennamesh::data_handle<viennamesh_string> const & metric_quantity,
+                        viennamesh::data_handle<double> const & metric_eta,
+                        viennamesh::data_handle<viennamesh_string> const & sizing_function,
+                        std::string const & base_path)
+		{
+			size_t geometric_dimension = viennagrid::geometric_dimension(input_mesh);
+
+			if (sizing_function.valid())
+			{
+				viennamesh::info(5) << "Using user-defined XML string sizing function as metric" << std::endl;
+				make_metric_from_sizing_function(mesh, geometric_dimension,
+				                                 viennamesh::sizing_function::from_xml(sizing_function(), input_mesh, base_path));
+				return;
+			}
+
+			if (quantities.valid())
+			{
+				for (int i = 0; i != quantities.size(); ++i)
+				{
+					viennagrid::quantity_field field = quantities(i);
+
+					if (metric_quantity.valid() ? field.get_name() != metric_quantity() :
+					    (field.topologic_dimension() != 0 || field.values_per_quantity() != 1))
+						continue;
+
+					if (field.topologic_dimension() != 0 || field.values_per_quantity() != 1)
+					{
+						viennamesh::error(1) << "Quantity field \"" << field.get_name() << "\" is not a scalar vertex field and cannot be used as metric" << std::endl;
+						break;
+					}
+
+					double eta = metric_eta.valid() ? metric_eta() : 0.0001;
+
+					viennamesh::info(1) << "Using quantity field \"" << field.get_name() << "\" as metric (eta = " << eta << ")" << std::endl;
+					make_metric_from_field(mesh, geometric_dimension, vertex_quantity(input_mesh, field), eta);
+					return;
+				}
+
+				viennamesh::warning(1) << "No suitable quantity field for the metric found, using default metric" << std::endl;
+			}
+
+			make_metric(mesh, geometric_dimension);
+		}//end make_metric
+
+//attaches the vertex quantity fields of the input mesh to the pragmatic mesh, they are carried through adaptation
+//in the vertex field buffer of the mesh (new vertices are interpolated, moved vertices re-interpolated)
+//returns the carried fields, cell fields cannot be carried and are skipped
+inline std::vector<viennagrid::quantity_field> attach_quantities(Mesh<double> *mesh,
+                                                                 MeshType const &,
+                                                                 viennamesh::data_handle<viennagrid_quantity_field> const & quantities)
+		{
+			std::vector<viennagrid::quantity_field> carried = viennamesh::vertex_quantities(quantities);
+			if (carried.empty())
+				return carried;
+
+			std::vector<double> values;
+			viennamesh::gather_vertex_quantities(carried, mesh->get_number_nodes(), values);
+
+			mesh->set_fields(&(values[0]), viennamesh::vertex_quantity_values(carried));
+			return carried;
+		}//end attach_quantities
+
+//writes the carried vertex fields of the adapted pragmatic mesh into new quantity fields, one per carried field
+//in pragmatic node order (= vertex order of the converted output mesh)
+inline void extract_quantities(Mesh<double> *mesh,
+                               std::vector<viennagrid::quantity_field> const & carried,
+                               viennamesh::data_handle<viennagrid_quantity_field> & output)
+		{
+			std::vector<viennagrid::quantity_field> fields = viennamesh::make_vertex_quantities(carried);
+
+			int NNodes = mesh->get_number_nodes();
+			for (int i = 0; i < NNodes; ++i)
+				viennamesh::scatter_vertex_quantities(fields, i, mesh->get_fields(i));
+
+			output.set(fields);
+		}//end extract_quantities
+
 //convert vienangrid to pragmatic data structure
-inline Mesh<double>* convert(MeshType input_mesh, Mesh<double>* mesh)
+//the coordinates are handed to pragmatic directly from viennagrid's interleaved coordinate array
+//and the ENList is filled in parallel into a pre-sized array, vertex indices are the pragmatic node ids
+inline Mesh<double>* convert(MeshType const & input_mesh, Mesh<double>* mesh)
+		{
+			size_t geometric_dimension = viennagrid::geometric_dimension( input_mesh );
+			int NNodes = viennagrid::vertex_count( input_mesh );
+
+			//get pointer to coordinates array from the mesh
+			//(coordinates are stored in a big array in the following scheme [x0 y0 z0 x1 y1 z1 ... xn yn zn])
+			viennagrid_numeric *ptr_coords = nullptr;
+			viennagrid_mesh_vertex_coords_pointer(input_mesh.internal(), &ptr_coords);
+
+			//get elements from mesh, the topological dimension equals the geometric dimension (triangles in 2d, tetrahedrons in 3d)
+			viennagrid_element_id * cells_begin;
+			viennagrid_element_id * cells_end;
+			viennagrid_mesh_elements_get(input_mesh.internal(), geometric_dimension, &cells_begin, &cells_end);
+
+			int NElements = cells_end - cells_begin;
+			int nloc = geometric_dimension + 1;
+
+			std::vector<index_t> ENList(NElements*nloc);
+
+			#pragma omp parallel for schedule(static)
+			for (int i = 0; i < NElements; ++i)
+			{
+				viennagrid_element_id * vertices_begin;
+				viennagrid_element_id * vertices_end;
+				viennagrid_element_boundary_elements(input_mesh.internal(), cells_begin[i], 0, &vertices_begin, &vertices_end);
+
+				for (int j = 0; j < nloc; ++j)
+					ENList[i*nloc+j] = viennagrid_index_from_element_id(vertices_begin[j]);
+			}
+
+			mesh = new Mesh<double> (NNodes, NElements, &(ENList[0]), ptr_coords, geometric_dimension);
+			return mesh;
+		}//end of convert(MeshType const & input_mesh, Mesh<double> *mesh)
+
+//convert pragmatic data structure back into viennagrid data structure
+//vertices are created in pragmatic node order, the cells are created with a single batch call
+inline void convert(Mesh<double>* mesh, size_t geometric_dimension, MeshType & output_mesh)
 		{
-			  size_t cell_dimension = viennagrid::cell_dimension( input_mesh );
-		  	size_t geometric_dimension = viennagrid::geometric_dimension( input_mesh );
-		  	size_t NNodes = viennagrid::vertex_count( input_mesh );
-		  	size_t NElements = viennagrid::cells( input_mesh ).size();
-
-			  //set up vectors for ENList and x-, y- and z-coordinates
-		  	std::vector<index_t> ENList;
-		  	std::vector<double> x, y, z;
-
-			  //Initialize x-, y- and z-coordinates
-		  	//
-		  	//create pointer to iterate over viennagrid_array
-		  	viennagrid_numeric *ptr_coords = nullptr;
-						
-		  	//get pointer to coordinates array from the mesh
-		  	viennagrid_mesh_vertex_coords_pointer(input_mesh.internal(), &ptr_coords);			
-			
-		  	//iterate over all nodes in the mesh and store the coordinates in the vectors needed by pragmatic
-		  	//(coordinates are stored in a big array in the following scheme [x0 y0 z0 x1 y1 z1 ... xn yn zn])
-		  	for (size_t i=0; i<NNodes; ++i)
-		  	{			  
-		   	  x.push_back(*(ptr_coords++));
-		    	y.push_back(*(ptr_coords++));
-		  
-		    	  //depending on the dimension push_back data from the array or push_back 0 into the pragmatic data
-		    	  if (geometric_dimension == 3)
-		      	    z.push_back(*(ptr_coords++));
-		    
-		    	  else
-		      	    z.push_back(0);
-		  	}
-		  
-		  	//Iterate over all triangles in the mesh
-		  	viennagrid_element_id * vertex_ids_begin;
-		  	viennagrid_element_id * vertex_ids_end;
-		  	viennagrid_dimension topological_dimension = geometric_dimension;		//produces segmentation fault if not set to 2 for 2d and to 3 for 3d case
-												//TODO:THE SOLUTION IN THE ROW ABOVE IS OPTIMIZABLE!!!
-		  	//get elements from mesh
-		  	viennagrid_mesh_elements_get(input_mesh.internal(), topological_dimension, &vertex_ids_begin, &vertex_ids_end);
-			
-		 	  viennagrid_element_id * boundary_vertex_ids_begin;
-		  	viennagrid_element_id * boundary_vertex_ids_end;
-		  	viennagrid_dimension boundary_topological_dimension = 0;
-		  	viennagrid_element_id triangle_id;
-						
-		  	int counter = 0;
-		  			
-		  	//outer for loop iterates over all elements with dimension = topological_dimension (2 for triangles, 3 for tetrahedrons)
-		  	//inner for loop iterates over all elements with dimension = boundary_topological_dimension (0 for vertices)
-		  	//this info is needed to build the NEList which is used to build the pragmatic data structure
-		  	for (viennagrid_element_id * vit = vertex_ids_begin; vit != vertex_ids_end; ++vit)
-		  	{
-		    		//get vertices of triangle
-		    		triangle_id = *vit;
-		    		viennagrid_element_boundary_elements(input_mesh.internal(), triangle_id, boundary_topological_dimension, &boundary_vertex_ids_begin, &boundary_vertex_ids_end);
-			  			  
-		    		for (viennagrid_element_id * bit = boundary_vertex_ids_begin; bit != boundary_vertex_ids_end; ++bit)
-		    		{
-		      			viennagrid_element_id vertex_id = *bit;
-		      			ENList.push_back(vertex_id);
-		    		}
-			  		  
-		    		++counter;
-		  	}
-		  
-		  	if (geometric_dimension == 2)	
-		  	{
-          mesh = new Mesh<double> (NNodes, NElements, &(ENList[0]), &(x[0]), &(y[0]));
-				  return mesh;
-		  	}
-		
-		 	  else
-		  	{		
-				  mesh = new Mesh<double> (NNodes, NElements, &(ENList[0]), &(x[0]), &(y[0]), &(z[0]));
-				  return mesh;
-		  	}
-		}//end of convert(MeshType input_mesh, Mesh<double> *mesh)
+			typedef viennagrid::result_of::point<MeshType>::type PointType;
+
+			int NNodes = mesh->get_number_nodes();
+			int NElements = mesh->get_number_elements();
+			int nloc = geometric_dimension + 1;
+
+			std::vector<viennagrid_element_id> vertex_ids(NNodes);
+			for (int i = 0; i < NNodes; ++i)
+				vertex_ids[i] = viennagrid::make_vertex( output_mesh, PointType(geometric_dimension, mesh->get_coords(i)) ).id().internal();
+
+			if (NElements == 0)
+				return;
+
+			std::vector<viennagrid_element_type> element_types(NElements,
+				geometric_dimension == 2 ? VIENNAGRID_ELEMENT_TYPE_TRIANGLE : VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON);
+			std::vector<viennagrid_int> cell_vertex_offsets(NElements+1);
+			std::vector<viennagrid_element_id> cell_vertex_ids(NElements*nloc);
+
+			#pragma omp parallel for schedule(static)
+			for (int i = 0; i < NElements; ++i)
+			{
+				const index_t *n = mesh->get_element(i);
+
+				cell_vertex_offsets[i] = i*nloc;
+				for (int j = 0; j < nloc; ++j)
+					cell_vertex_ids[i*nloc+j] = vertex_ids[n[j]];
+			}
+			cell_vertex_offsets[NElements] = NElements*nloc;
+
+			viennagrid_mesh_element_batch_create( output_mesh.internal(),
+			                                      NElements, &element_types[0],
+			                                      &cell_vertex_offsets[0], &cell_vertex_ids[0],
+			                                      NULL, NULL );
+		}//end of convert(Mesh<double> *mesh, size_t geometric_dimension, MeshType & output_mesh)
 
 //export_to_viennagrid_vtu: converts the pragmatic data structure into viennagrid data structure 
 inline bool export_to_viennagrid_vtu(std::vector<Mesh<double>*> meshes)
@@ -94,7 +94,7 @@ namespace viennamesh
       serial_mesh->create_boundary();
 
       //make_metric(mesh, 2); //it is not necessary to create a metric!
-      //output << "SimpleLaplaceOnGroups_sections" << std::endl << "==================================================" << std::endl;
+      //output << "SimpleLaplaceOnGroups_tasks" << std::endl << "==================================================" << std::endl;
       GroupedPartitions Mesh1(mesh, region_count());  
       clock_t tic = clock();
       GroupedPartitionsSmooth Smoother1(Mesh1);
@@ -103,7 +103,7 @@ namespace viennamesh
 
       //ProfilerStart("profile_simplelaplaceongroups.log");
       tic = clock();
-      Smoother1.SimpleLaplaceOnGroups_sections(2);
+      Smoother1.SimpleLaplaceOnGroups_tasks(2);
       toc = clock();
       //ProfilerStop();
       //output << "SimpleLaplaceOnGroups: " << static_cast<double>(toc - tic) / CLOCKS_PER_SEC << std::endl;
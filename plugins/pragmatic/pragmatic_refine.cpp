@@ -39,7 +39,7 @@ namespace viennamesh
 			
 				for(int i=1; i<=no_of_passes; i++)
 		  		{	
-					std::cout << "Pass " << i << " of " << no_of_passes << std::endl;	//DEFAULT VALUE IS i<3; only 3 passes for refinement!
+					VIENNAMESH_LOG(info, 5) << "Pass " << i << " of " << no_of_passes << std::endl;	//DEFAULT VALUE IS i<3; only 3 passes for refinement!
         				adapt.refine(sqrt(2.0));						//DEFAULT VALUE IS SQRT(2.0)
     		 		}				
 			}
@@ -50,7 +50,7 @@ namespace viennamesh
 			
 				for(int i=1; i<=no_of_passes; i++)
 		  		{	
-					std::cout << "Pass " << i << " of " << no_of_passes << std::endl;	//DEFAULT VALUE IS i<3; only 3 passes for refinement!
+					VIENNAMESH_LOG(info, 5) << "Pass " << i << " of " << no_of_passes << std::endl;	//DEFAULT VALUE IS i<3; only 3 passes for refinement!
         				adapt.refine(sqrt(2.0));						//DEFAULT VALUE IS SQRT(2.0)
     		 		}
 			}
@@ -77,6 +77,15 @@ namespace viennamesh
 		  //create string_handle to get input filename, used for benchmark purposes to store the output in a file (see at the end of this file!!!)
 		  string_handle input_file = get_input<string_handle>("input_file");
 
+		  //optional metric inputs: a scalar vertex quantity field (Hessian-based metric) or a sizing function
+		  quantity_field_handle quantities = get_input<viennagrid::quantity_field>("quantities");
+		  string_handle metric_quantity = get_input<string_handle>("metric_quantity");
+		  data_handle<double> metric_eta = get_input<double>("metric_eta");
+		  string_handle sizing_function = get_input<string_handle>("sizing_function");
+
+		  //optional: carry the vertex quantity fields through adaptation and output them with the adapted mesh
+		  data_handle<bool> carry_quantities = get_input<bool>("carry_quantities");
+
 		  int no_of_passes;
 		
 		  //check if a value for refinement_passes has been provided, otherwise set it to a default value
@@ -98,7 +107,12 @@ namespace viennamesh
 		  size_t geometric_dimension = viennagrid::geometric_dimension( input_mesh() );
 
 		  //set up the metric
-		  make_metric(mesh, geometric_dimension);
+		  make_metric(mesh, input_mesh(), quantities, metric_quantity, metric_eta, sizing_function, base_path());
+
+		  //attach the carried quantity fields, they are interpolated on new vertices during adaptation
+		  std::vector<viennagrid::quantity_field> carried_quantities;
+		  if (carry_quantities.valid() && carry_quantities())
+		    carried_quantities = attach_quantities(mesh, input_mesh(), quantities);
 
    		  // Refine<double,2> adapt(*mesh);
 		  
@@ -120,54 +134,20 @@ namespace viennamesh
 		  //VTKTools<double>::export_vtu("examples/data/myfirsttask/pragmatic_refine", mesh);
 
 		  //convert pragmatic mesh datastructure back into viennamesh data structure
-		  //this is a first simple 2d example!!!
-		  MeshType output_mesh;	
-		  std::vector<VertexType> vertex_handles(mesh->get_number_nodes());	  
-		  double *x_out;
-		  x_out = new double [3];
-		  const index_t *ptr_ENList=nullptr;
-		 
-		  size_t NNodes = mesh->get_number_nodes();
-		  size_t NElements = mesh->get_number_elements();
-	
-		 /* float tmp_nn = (NNodes / 100) * 1;
-		  float tmp_ne = (NElements / 100) * 1;
-		  */
-		 // std::cout << "Creating Vertices" << std::endl;
-
-		  for (size_t i = 0; i < NNodes; ++i)
-		  {	
-		        mesh->get_coords(i, x_out);
-			if (geometric_dimension==2)
-			  vertex_handles[i]=viennagrid::make_vertex(output_mesh, viennagrid::make_point(x_out[0], x_out[1]));
-			
-			else
-			  vertex_handles[i]=viennagrid::make_vertex(output_mesh, viennagrid::make_point(x_out[0], x_out[1], x_out[2]));
+		  MeshType output_mesh;
+		  convert(mesh, geometric_dimension, output_mesh);
 
-			/*if(i%(int)tmp_nn==0)
-			  std::cout << (i/tmp_nn) << " %" << std::endl;*/
-		  } 
-	
-		 // std::cout << std::endl << "Creating Elements" << std::endl;
+		  //set output mesh
+		  set_output("mesh", output_mesh);	  
 
-		  for (size_t i = 0; i < NElements; ++i)
+		  //output the carried quantity fields, in the vertex order of the output mesh
+		  if (!carried_quantities.empty())
 		  {
-			//std::cout << "Element " << i << " of " << NElements << std::endl;
-			ptr_ENList = mesh->get_element(i);
-			
-			if (geometric_dimension==2)
-			  CellType cell = viennagrid::make_triangle(output_mesh, vertex_handles[ptr_ENList[0]], vertex_handles[ptr_ENList[1]], vertex_handles[ptr_ENList[2]]);
-			
-			else
-			  CellType cell = viennagrid::make_tetrahedron(output_mesh, vertex_handles[ptr_ENList[0]], vertex_handles[ptr_ENList[1]], vertex_handles[ptr_ENList[2]], vertex_handles[ptr_ENList[3]]);
-
-			/*if(i%(int)tmp_ne==0)
-			  std::cout << (i/tmp_ne) << " %" << std::endl;*/
+		    quantity_field_handle output_quantities = make_data<viennagrid::quantity_field>();
+		    extract_quantities(mesh, carried_quantities, output_quantities);
+		    set_output("quantities", output_quantities);
 		  }
 
-		  //set output mesh
-		  set_output("mesh", output_mesh);	  
-
 		  double toc_w_reconversion = omp_get_wtime();
 
 		  //output results
@@ -210,7 +190,6 @@ namespace viennamesh
 		  output.close();
 
 		  delete mesh;
-		  delete x_out;
 
 		  return true;
 		} //end run()
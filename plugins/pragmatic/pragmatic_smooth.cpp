@@ -19,23 +19,38 @@ namespace viennamesh
 		pragmatic_smooth::pragmatic_smooth()	{}
 		std::string pragmatic_smooth::name() {return "pragmatic_smooth";}
 
-		void make_smoothing(Mesh<double> *mesh, size_t geometric_dimension, std::string type)
+		template<int dim>
+		void make_smoothing(Mesh<double> *mesh, std::string type, int no_of_passes)
 		{
-			if ( type.compare("laplacian") )
+			Smooth<double,dim> adapt(*mesh);
+
+			if ( type == "laplacian" )
 			{
 				std::cout << "LAPLACIAN SMOOTHING" << std::endl;
+				adapt.laplacian(no_of_passes);
 			}
 
-			else if ( type.compare("smart_laplacian") )
+			else if ( type == "optimisation_linf" )
 			{
-				std::cout << "SMART LAPLACIAN SMOOTHING" << std::endl;
+				std::cout << "OPTIMISATION LINF SMOOTHING" << std::endl;
+				adapt.optimisation_linf(no_of_passes);
 			}
 
-			else if ( type.compare("optimisation_linf") )
+			else
 			{
-				std::cout << "OPTIMISATION LINF SMOOTHING" << std::endl;
+				std::cout << "SMART LAPLACIAN SMOOTHING" << std::endl;
+				adapt.smart_laplacian(no_of_passes);
 			}
 		}
+
+		void make_smoothing(Mesh<double> *mesh, size_t geometric_dimension, std::string type, int no_of_passes)
+		{
+			if (geometric_dimension == 2)
+				make_smoothing<2>(mesh, type, no_of_passes);
+
+			else
+				make_smoothing<3>(mesh, type, no_of_passes);
+		}
 		
 		bool pragmatic_smooth::run(viennamesh::algorithm_handle &)
 		{
@@ -68,11 +83,59 @@ namespace viennamesh
 
 		  //create string_handle to get input filename, used for benchmark purposes to store the output in a file (see at the end of this file!!!)
 		  string_handle input_file = get_input<string_handle>("input_file");
-  
-      //TODO
+
+		  //optional metric inputs: a scalar vertex quantity field (Hessian-based metric) or a sizing function
+		  quantity_field_handle quantities = get_input<viennagrid::quantity_field>("quantities");
+		  string_handle metric_quantity = get_input<string_handle>("metric_quantity");
+		  data_handle<double> metric_eta = get_input<double>("metric_eta");
+		  string_handle sizing_function = get_input<string_handle>("sizing_function");
+
+		  //optional: carry the vertex quantity fields through adaptation and output them with the adapted mesh
+		  data_handle<bool> carry_quantities = get_input<bool>("carry_quantities");
+
+		  std::string type = smoothing_algorithm.valid() ? std::string(smoothing_algorithm()) : std::string("smart_laplacian");
+		  int no_of_passes = smoothing_passes.valid() ? smoothing_passes() : 10;
+
+		  Mesh<double> *mesh = nullptr;
+		  mesh = convert(input_mesh(), mesh);
+		  mesh->create_boundary();
+
+		  size_t geometric_dimension = viennagrid::geometric_dimension( input_mesh() );
+
+		  //set up the metric
+		  make_metric(mesh, input_mesh(), quantities, metric_quantity, metric_eta, sizing_function, base_path());
+
+		  //attach the carried quantity fields, they are interpolated on new vertices during adaptation
+		  std::vector<viennagrid::quantity_field> carried_quantities;
+		  if (carry_quantities.valid() && carry_quantities())
+		    carried_quantities = attach_quantities(mesh, input_mesh(), quantities);
+
+		  double tic_smooth = omp_get_wtime();
+
+		  //smooth the mesh
+		  make_smoothing(mesh, geometric_dimension, type, no_of_passes);
+
+		  double toc_smooth = omp_get_wtime();
+
+		  //convert pragmatic mesh datastructure back into viennamesh data structure
+		  MeshType output_mesh;
+		  convert(mesh, geometric_dimension, output_mesh);
+
+		  std::cout << "Time for smoothing: " << toc_smooth - tic_smooth << " seconds." << std::endl;
+		  std::cout << "Overall time: " << omp_get_wtime() - tic << " seconds." << std::endl;
 
 		  //Create output
-		  set_output("mesh", input_mesh());
+		  set_output("mesh", output_mesh);
+
+		  //output the carried quantity fields, in the vertex order of the output mesh
+		  if (!carried_quantities.empty())
+		  {
+		    quantity_field_handle output_quantities = make_data<viennagrid::quantity_field>();
+		    extract_quantities(mesh, carried_quantities, output_quantities);
+		    set_output("quantities", output_quantities);
+		  }
+
+		  delete mesh;
 	
 		  return true;
 		} //end run()
@@ -128,6 +128,11 @@ namespace viennamesh
     gradient_field_real.set_name("gradient_real");
 
     ConstVertexRangeType vertices(sphere);
+
+    std::vector<double> thetas;
+    std::vector<double> phis;
+    thetas.reserve( vertices.size() );
+    phis.reserve( vertices.size() );
     for (ConstVertexRangeIterator vit = vertices.begin(); vit != vertices.end(); ++vit)
     {
       PointType const & pt = viennagrid::get_point(*vit);
@@ -137,10 +142,17 @@ namespace viennamesh
       double r;
       to_spherical(pt, theta, phi, r);
 
-      double grad_real = m_real.grad(theta, phi, 1e-2);
-      gradient_field_real.set(*vit, grad_real);
+      thetas.push_back(theta);
+      phis.push_back(phi);
     }
 
+    std::vector<double> grads_real;
+    m_real.grad(thetas, phis, 1e-2, grads_real);
+
+    int i = 0;
+    for (ConstVertexRangeIterator vit = vertices.begin(); vit != vertices.end(); ++vit, ++i)
+      gradient_field_real.set(*vit, grads_real[i]);
+
 //     {
 //       int bench_count = 100000;
 //       std::vector<double> v(bench_count);
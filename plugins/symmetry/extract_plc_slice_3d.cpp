@@ -296,8 +296,9 @@ namespace viennamesh
           // adding point on axis only if point on axis is not in a facet hole region
           if ( ! (((tmp > 0) && (line_hole_flag[lid] == 1)) || ((tmp < 0) && (line_hole_flag[lid] == -1))) )
           {
-            std::map<viennagrid_numeric, viennagrid_int>::iterator it = vertices_on_axis.find(d);
-            if (it == vertices_on_axis.end())
+            // facets sharing a point on the axis compute d independently, match it within the tolerance
+            std::map<viennagrid_numeric, viennagrid_int>::iterator it = vertices_on_axis.lower_bound(d - tol);
+            if (it == vertices_on_axis.end() || it->first > d + tol)
             {
 //               std::cout << "Found vertex on axis: " << p << std::endl;
 
@@ -19,6 +19,8 @@
 #include "extract_slice_3d.hpp"
 #include "geometry.hpp"
 
+#include "viennameshpp/spatial_hash.hpp"
+
 #include "viennagrid/algorithm/distance.hpp"
 #include "viennagrid/algorithm/centroid.hpp"
 
@@ -160,28 +162,56 @@ namespace viennamesh
         }
       }
 
-      std::vector<viennagrid_int> line_ids;
       std::map<ElementType, viennagrid_int> vertices_on_hyperplane;
-
       for (LinesOnHyperplaneType::iterator it = lines_on_hyperplane.begin(); it != lines_on_hyperplane.end(); ++it)
       {
         vertices_on_hyperplane.insert( std::make_pair((*it).first, -1) );
         vertices_on_hyperplane.insert( std::make_pair((*it).second, -1) );
       }
 
+      // cut points and vertices which were already on the plane may coincide
+      // within the tolerance, weld them before building the PLC
+      std::vector<viennagrid_numeric> hyperplane_coords;
+      hyperplane_coords.reserve( 3*vertices_on_hyperplane.size() );
       for (std::map<ElementType, viennagrid_int>::iterator vit = vertices_on_hyperplane.begin(); vit != vertices_on_hyperplane.end(); ++vit)
       {
         PointType p = viennagrid::get_point( (*vit).first );
-        viennagrid_plc_vertex_create(plc_output_mesh, &p[0], &vit->second);
+        for (int i = 0; i != 3; ++i)
+          hyperplane_coords.push_back(p[i]);
+      }
+
+      std::vector<viennagrid_int> representatives;
+      weld_points( hyperplane_coords.empty() ? 0 : &hyperplane_coords[0], vertices_on_hyperplane.size(), 3, tol, representatives );
+
+      std::vector<viennagrid_int> plc_vertices( representatives.size() );
+      viennagrid_int index = 0;
+      for (std::map<ElementType, viennagrid_int>::iterator vit = vertices_on_hyperplane.begin(); vit != vertices_on_hyperplane.end(); ++vit, ++index)
+      {
+        if (representatives[index] == index)
+          viennagrid_plc_vertex_create(plc_output_mesh, &hyperplane_coords[3*index], &plc_vertices[index]);
+        vit->second = index;
       }
 
+      std::set< std::pair<viennagrid_int, viennagrid_int> > plc_lines;
       for (LinesOnHyperplaneType::iterator it = lines_on_hyperplane.begin(); it != lines_on_hyperplane.end(); ++it)
+      {
+        viennagrid_int v0 = plc_vertices[ representatives[vertices_on_hyperplane[(*it).first]] ];
+        viennagrid_int v1 = plc_vertices[ representatives[vertices_on_hyperplane[(*it).second]] ];
+
+        // lines collapsed by welding are dropped
+        if (v0 == v1)
+          continue;
+        if (v1 < v0)
+          std::swap(v0, v1);
+
+        plc_lines.insert( std::make_pair(v0, v1) );
+      }
+
+      std::vector<viennagrid_int> line_ids;
+      for (std::set< std::pair<viennagrid_int, viennagrid_int> >::iterator it = plc_lines.begin(); it != plc_lines.end(); ++it)
       {
         viennagrid_int line_id;
-        viennagrid_plc_line_create(plc_output_mesh,
-                                   vertices_on_hyperplane[(*it).first],
-                                   vertices_on_hyperplane[(*it).second],
-                                   &line_id);
+        viennagrid_plc_line_create(plc_output_mesh, (*it).first, (*it).second, &line_id);
         line_ids.push_back(line_id);
       }
 
@@ -1,6 +1,13 @@
 #ifndef VIENNAMESH_ALGORITHM_SYMMETRY_GENERALIZED_MOMENT_HPP
 #define VIENNAMESH_ALGORITHM_SYMMETRY_GENERALIZED_MOMENT_HPP
 
+#include <map>
+#include <mutex>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include "common.hpp"
 #include "integrate.hpp"
 
@@ -478,6 +485,113 @@ namespace viennamesh
 
 
 
+  // Integrands of all coefficients C(2l, m, 2p), 0 <= l <= p, -2l <= m <= 2l,
+  // for one degree p. The Jacobi polynomials and factors are the ones of
+  // C_cached, but they are computed once per degree and the radial and
+  // trigonometric terms are shared by all coefficients of one point.
+  class C_table
+  {
+  public:
+
+    typedef double NumericType;
+    typedef polynom<double> PolynomType;
+
+    explicit C_table(int two_p_in) : two_p(two_p_in)
+    {
+      for (int l = 0; l <= two_p/2; ++l)
+        for (int m_in = -2*l; m_in <= 2*l; ++m_in)
+        {
+          entry e;
+          e.sign_m = m_in > 0;
+          e.m = std::abs(m_in);
+
+          e.J = jacobi_polynom<double>(2*l-e.m, e.m, e.m);
+          for (std::size_t i = 0; i <= e.J.grad(); ++i)
+            e.J[i] = (power_mone(e.m) + power_mone(i)) * e.J[i];
+
+          if (e.m == 0)
+            e.factor = 0.5;
+          else
+            e.factor = std::sqrt( (factorial(2*l+e.m)*factorial(2*l-e.m)) / (factorial(2*l)*factorial(2*l)) ) *
+                       std::pow(1.0/2.0, e.m) * (1.0 / std::sqrt(2));
+
+          entries.push_back(e);
+        }
+    }
+
+    // tables are created on first use and shared afterwards
+    static C_table const & get(int two_p)
+    {
+      static std::map< int, shared_ptr<C_table> > tables;
+      static std::mutex tables_mutex;
+
+      std::lock_guard<std::mutex> lock(tables_mutex);
+      shared_ptr<C_table> & table = tables[two_p];
+      if (!table)
+        table.reset( new C_table(two_p) );
+      return *table;
+    }
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t workspace_size() const { return 3*(two_p+1); }
+
+    static std::size_t index(int two_l, int m)
+    {
+      int l = two_l/2;
+      return 2*l*l - l + m + two_l;
+    }
+
+    // values has to hold size() entries and workspace workspace_size() entries
+    void operator()(NumericType x, NumericType y, NumericType z,
+                    NumericType * values, NumericType * workspace) const
+    {
+      NumericType r = std::sqrt(x*x+y*y+z*z);
+      NumericType cos_theta = z/r;
+      NumericType sin_theta = std::sqrt(1-cos_theta*cos_theta);
+      NumericType phi = atan2(y,x);
+      NumericType r_p = std::pow(r, two_p);
+
+      NumericType * cos_mphi = workspace;
+      NumericType * sin_mphi = workspace + (two_p+1);
+      NumericType * sin_theta_m = workspace + 2*(two_p+1);
+
+      sin_theta_m[0] = 1.0;
+      for (int m = 0; m <= two_p; ++m)
+      {
+        cos_mphi[m] = std::cos(m*phi);
+        sin_mphi[m] = std::sin(m*phi);
+        if (m > 0)
+          sin_theta_m[m] = sin_theta_m[m-1] * sin_theta;
+      }
+
+      for (std::size_t i = 0; i != entries.size(); ++i)
+      {
+        entry const & e = entries[i];
+
+        NumericType result = e.J(cos_theta) * e.factor;
+        if (e.m != 0)
+          result *= (e.sign_m ? cos_mphi[e.m] : sin_mphi[e.m]) * sin_theta_m[e.m];
+
+        values[i] = r_p * result;
+      }
+    }
+
+  private:
+
+    struct entry
+    {
+      bool sign_m;
+      int m;
+      NumericType factor;
+      PolynomType J;
+    };
+
+    int two_p;
+    std::vector<entry> entries;
+  };
+
+
+
   template<typename T>
   class C_to_integrate
   {
@@ -540,7 +654,7 @@ namespace viennamesh
 //   }
 
 
-  double S(int p, int l)
+  inline double S(int p, int l)
   {
     double sum = 0.0;
     for (int k = l; k <= 2*l; ++k)
@@ -553,6 +667,107 @@ namespace viennamesh
   }
 
 
+  // Integrates all coefficients of C_table::get(two_p) over the cells of mesh,
+  // result[C_table::index(two_l, m)] is equal to C(two_l, m, two_p, mesh).
+  // The cells are distributed over the threads, each thread accumulates into
+  // its own coefficient vector and the vectors are reduced in thread order.
+  template<bool mesh_is_const>
+  void C_all(int two_p,
+             viennagrid::base_mesh<mesh_is_const> const & mesh,
+             std::vector<double> & result)
+  {
+    typedef viennagrid::base_mesh<mesh_is_const> MeshType;
+    typedef typename viennagrid::result_of::const_cell_range<MeshType>::type ConstCellRange;
+    typedef typename viennagrid::result_of::iterator<ConstCellRange>::type ConstCellIterator;
+    typedef typename viennagrid::result_of::point<MeshType>::type PointType;
+
+    typedef triangle_quadrature< triangle_gauss_weights_generator<double, 20> > QuadratureType;
+    typedef QuadratureType::weight_container_type WeightContainerType;
+
+    if (two_p%2 != 0)
+      abort();
+
+    C_table const & table = C_table::get(two_p);
+    WeightContainerType const & weights = QuadratureType::weights();
+
+    // flat copy of the triangle corners
+    ConstCellRange cells( mesh );
+    std::vector<double> corners;
+    corners.reserve( 9*cells.size() );
+    for (ConstCellIterator cit = cells.begin(); cit != cells.end(); ++cit)
+    {
+      for (int i = 0; i != 3; ++i)
+      {
+        PointType pt = viennagrid::get_point(*cit, i);
+        corners.insert( corners.end(), pt.begin(), pt.begin()+3 );
+      }
+    }
+    long cell_count = corners.size()/9;
+
+    int thread_count = 1;
+#ifdef HAVE_OPENMP
+    thread_count = omp_get_max_threads();
+#endif
+    std::vector< std::vector<double> > thread_results( thread_count, std::vector<double>(table.size(), 0.0) );
+
+    #pragma omp parallel num_threads(thread_count)
+    {
+      int thread = 0;
+#ifdef HAVE_OPENMP
+      thread = omp_get_thread_num();
+#endif
+
+      std::vector<double> & local_result = thread_results[thread];
+      std::vector<double> values( table.size() );
+      std::vector<double> workspace( table.workspace_size() );
+
+      #pragma omp for schedule(static)
+      for (long c = 0; c < cell_count; ++c)
+      {
+        double const * p0 = &corners[9*c];
+
+        double d0[3];
+        double d1[3];
+        for (int i = 0; i != 3; ++i)
+        {
+          d0[i] = p0[3+i]-p0[i];
+          d1[i] = p0[6+i]-p0[i];
+        }
+
+        double n0 = d0[1]*d1[2] - d0[2]*d1[1];
+        double n1 = d0[2]*d1[0] - d0[0]*d1[2];
+        double n2 = d0[0]*d1[1] - d0[1]*d1[0];
+        double area = std::sqrt(n0*n0 + n1*n1 + n2*n2) / 2.0;
+
+        for (typename WeightContainerType::size_type w = 0; w != weights.size(); ++w)
+        {
+          double pt[3];
+          for (int i = 0; i != 3; ++i)
+            pt[i] = p0[i] + weights[w].p[0]*d0[i] + weights[w].p[1]*d1[i];
+
+          table(pt[0], pt[1], pt[2], &values[0], &workspace[0]);
+
+          double weight = weights[w].w * area;
+          for (std::size_t i = 0; i != values.size(); ++i)
+            local_result[i] += weight * values[i];
+        }
+      }
+    }
+
+    result.assign( table.size(), 0.0 );
+    for (int thread = 0; thread != thread_count; ++thread)
+      for (std::size_t i = 0; i != result.size(); ++i)
+        result[i] += thread_results[thread][i];
+
+    for (int l = 0; l <= two_p/2; ++l)
+    {
+      double s = S(two_p/2, l);
+      for (int m = -2*l; m <= 2*l; ++m)
+        result[C_table::index(2*l, m)] *= s;
+    }
+  }
+
+
   template<typename T, bool mesh_is_const>
   T C(int two_l, int m, int two_p,
       viennagrid::base_mesh<mesh_is_const> const & mesh)
@@ -632,15 +847,13 @@ namespace viennamesh
       assert(two_p_ % 2 == 0);
       set_p(two_p_/2);
 
+      std::vector<double> coefficients;
+      viennamesh::C_all(2*p(), mesh, coefficients);
+
       for (int l = 0; l <= p(); ++l)
         for (int m = -2*l; m <= 2*l; ++m)
         {
-          values[l][m+2*l] = viennamesh::C<CT>(2*l, m, 2*p(), mesh);
-//                                                 ,
-//                                                relative_integrate_tolerance,
-//                                                absolute_integrate_tolerance,
-//                                                max_integrate_iterations);
-
+          values[l][m+2*l] = coefficients[ C_table::index(2*l, m) ];
 //           std::cout << "C(" << 2*l << "," << m << ") = " << values[l][m+2*l] << std::endl;
         }
 
@@ -693,6 +906,39 @@ namespace viennamesh
       return grad(theta, phi, eps);
     }
 
+    // Same as grad(theta[i], phi[i], eps) for all i, the real spherical
+    // harmonics are evaluated with one SphericalHarmonicTable per thread and
+    // the directions are processed in parallel.
+    void grad(std::vector<double> const & theta, std::vector<double> const & phi, double eps,
+              std::vector<double> & result) const
+    {
+      assert(theta.size() == phi.size());
+      result.resize( theta.size() );
+
+      SphericalHarmonicTable harmonics( 2*p() );
+
+      #pragma omp parallel
+      {
+        std::vector<double> Y( harmonics.size() );
+
+        #pragma omp for schedule(static)
+        for (long i = 0; i < static_cast<long>(theta.size()); ++i)
+        {
+          double theta_m_eps = evaluate(harmonics, theta[i]-eps, phi[i], &Y[0]);
+          double theta_p_eps = evaluate(harmonics, theta[i]+eps, phi[i], &Y[0]);
+
+          double d_theta = (theta_p_eps-theta_m_eps) / (2.0*eps);
+
+          double phi_m_eps = evaluate(harmonics, theta[i], phi[i]-eps, &Y[0]);
+          double phi_p_eps = evaluate(harmonics, theta[i], phi[i]+eps, &Y[0]);
+
+          double d_phi = (phi_p_eps-phi_m_eps) / (2.0*eps);
+
+          result[i] = std::sqrt(d_theta*d_theta + d_phi*d_phi);
+        }
+      }
+    }
+
 
     void print() const
     {
@@ -803,6 +1049,18 @@ namespace viennamesh
 
   private:
 
+    double evaluate(SphericalHarmonicTable const & harmonics, double theta, double phi, double * Y) const
+    {
+      harmonics(theta, phi, Y);
+
+      CType sum = 0.0;
+      for (int l = 0; l <= p(); ++l)
+        for (int m = -2*l; m <= 2*l; ++m)
+          sum += this->C(2*l, m) * Y[ SphericalHarmonicTable::index(2*l, m) ];
+
+      return real(sum);
+    }
+
     void set_p(int p_in)
     {
       values.clear();
@@ -19,6 +19,8 @@
 #include "merge_slice_interface_3d.hpp"
 #include "geometry.hpp"
 
+#include "viennameshpp/spatial_hash.hpp"
+
 #include "viennagrid/algorithm/distance.hpp"
 #include "viennagrid/algorithm/centroid.hpp"
 
@@ -88,6 +90,8 @@ namespace viennamesh
       return false;
 
     double tol = 1e-6;
+    if (get_input<double>("tolerance").valid())
+      tol = get_input<double>("tolerance")();
 
     typedef viennagrid::mesh                                                MeshType;
     typedef viennagrid::result_of::coord<MeshType>::type                    CoordType;
@@ -144,6 +148,22 @@ namespace viennamesh
       }
     }
 
+    // index the copied vertices once, rotated vertices of plane N[0] are
+    // matched against them within the tolerance
+    std::vector<ElementType> copied_vertices;
+    std::vector<viennagrid_numeric> copied_coords;
+    ConstElementRangeType output_vertices( output_mesh(), 0 );
+    for (ConstElementRangeIterator vit = output_vertices.begin(); vit != output_vertices.end(); ++vit)
+    {
+      PointType point = viennagrid::get_point(*vit);
+      copied_vertices.push_back(*vit);
+      for (int i = 0; i != geometric_dimension; ++i)
+        copied_coords.push_back(point[i]);
+    }
+
+    spatial_hash copied_vertices_hash( copied_coords.empty() ? 0 : &copied_coords[0],
+                                       copied_vertices.size(), geometric_dimension, tol );
+
     // rotate elements on plane N[0] to plane N[1]
     std::map<ElementType, ElementType> vertex_map;
     ConstElementRangeType vertices( input_mesh(), 0 );
@@ -172,8 +192,14 @@ namespace viennamesh
           vertex_map[*vit] = viennagrid::make_vertex( output_mesh(), rotated_point );
         else
         {
-          std::pair<ElementType, CoordType> nearst_vertex = get_nearest_vertex( output_mesh(), rotated_point );
-          vertex_map[*vit] = nearst_vertex.first;
+          spatial_hash::index_type index = copied_vertices_hash.find( &rotated_point[0] );
+          if (index >= 0)
+            vertex_map[*vit] = copied_vertices[index];
+          else
+          {
+            std::pair<ElementType, CoordType> nearst_vertex = get_nearest_vertex( output_mesh(), rotated_point );
+            vertex_map[*vit] = nearst_vertex.first;
+          }
         }
       }
     }
@@ -21,9 +21,9 @@
 
 #include "viennagrid/algorithm/distance.hpp"
 #include "viennagrid/algorithm/centroid.hpp"
-#include "viennagrid/core/ntree.hpp"
 
 #include "viennameshpp/progress_tracker.hpp"
+#include "viennameshpp/spatial_hash.hpp"
 
 
 namespace viennamesh
@@ -224,40 +224,36 @@ namespace viennamesh
 
 
 
+      // the rotated copies are independent of each other and are computed in
+      // parallel, vertex creation itself has to be serial
+      std::vector<PointType> new_points( shared_vertex_count + non_shared_vertex_count * (rotational_frequency/2) );
+
       for (std::size_t i = 0; i != vertices_on_both_planes.size(); ++i)
-        new_vertices.push_back( viennagrid::make_vertex(output_mesh(), points[vertices_on_both_planes[i]]).id() );
+        new_points[i] = points[vertices_on_both_planes[i]];
 
-      for (int hrf = 0; hrf != rotational_frequency/2; ++hrf)
+      #pragma omp parallel for
+      for (int hrf = 0; hrf < rotational_frequency/2; ++hrf)
       {
+        std::size_t index = shared_vertex_count + hrf*non_shared_vertex_count;
         double current_angle = angle * hrf * 2;
 
         for (std::size_t i = 0; i != vertices_on_plane0.size(); ++i)
-        {
-          PointType rotated = rotate( points[ vertices_on_plane0[i] ], axis, current_angle );
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotated).id() );
-        }
+          new_points[index++] = rotate( points[ vertices_on_plane0[i] ], axis, current_angle );
 
         for (std::size_t i = 0; i != vertices_on_no_plane.size(); ++i)
-        {
-          PointType rotated = rotate( points[ vertices_on_no_plane[i] ], axis, current_angle );
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotated).id() );
-        }
+          new_points[index++] = rotate( points[ vertices_on_no_plane[i] ], axis, current_angle );
 
         for (std::size_t i = 0; i != vertices_on_plane1.size(); ++i)
-        {
-          PointType rotated = rotate( points[ vertices_on_plane1[i] ], axis, current_angle );
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotated).id() );
-        }
+          new_points[index++] = rotate( points[ vertices_on_plane1[i] ], axis, current_angle );
 
         current_angle = angle * (hrf+1) * 2;
         for (std::size_t i = 0; i != vertices_on_no_plane.size(); ++i)
-        {
-          PointType rotated = rotate( reflect(points[vertices_on_no_plane[i]], N[0]),
-                                      axis, current_angle );
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotated).id() );
-        }
+          new_points[index++] = rotate( reflect(points[vertices_on_no_plane[i]], N[0]), axis, current_angle );
       }
 
+      for (std::size_t i = 0; i != new_points.size(); ++i)
+        new_vertices.push_back( viennagrid::make_vertex(output_mesh(), new_points[i]).id() );
+
       info(1) << "New mesh has " << new_vertices.size() << " vertices (old had " << vertices.size() << ")" << std::endl;
       info(1) << "    shared vertex count = " << vertices_on_both_planes.size() << std::endl;
       info(1) << "    on plane count = " << vertices_on_plane0.size() << std::endl;
@@ -408,56 +404,37 @@ namespace viennamesh
       cs[1].normalize();
       cs[0] = viennagrid::cross_prod(cs[1], N[1]);
 
-      std::vector<PointType> pp1( vertices_on_plane1.size() );
-      for (std::size_t i = 0; i != vertices_on_plane1.size(); ++i)
-      {
-        pp1[i].resize(2);
-        pp1[i][0] = viennagrid::inner_prod( cs[0], points[vertices_on_plane1[i]] );
-        pp1[i][1] = viennagrid::inner_prod( cs[1], points[vertices_on_plane1[i]] );
-      }
-
-      PointType min = pp1[0];
-      PointType max = pp1[1];
+      // match the rotated vertices of plane 0 with the vertices of plane 1
+      // using their 2D coordinates within plane 1
+      std::vector<viennagrid_numeric> pp1( 2*vertices_on_plane1.size() );
 
-      for (std::size_t i1 = 1; i1 != vertices_on_plane1.size(); ++i1)
+      #pragma omp parallel for
+      for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(vertices_on_plane1.size()); ++i)
       {
-        min = viennagrid::min(min, pp1[i1]);
-        max = viennagrid::max(max, pp1[i1]);
+        pp1[2*i+0] = viennagrid::inner_prod( cs[0], points[vertices_on_plane1[i]] );
+        pp1[2*i+1] = viennagrid::inner_prod( cs[1], points[vertices_on_plane1[i]] );
       }
 
-      PointType center = (min+max)/2;
-      PointType size = max-min;
-
-      typedef viennagrid::point_id_wrapper WrapperType;
-      typedef viennagrid::ntree_node<WrapperType> NodeType;
-      boost::shared_ptr<NodeType> root( new NodeType( center-size/2*1.3 , center+size/2*1.3 ) );
-
+      spatial_hash plane1_hash;
       {
-        viennamesh::LoggingStack stack("build tree");
-        for (std::size_t i1 = 0; i1 != vertices_on_plane1.size(); ++i1)
-          root->add( WrapperType(pp1[i1], i1), 10, vertices_on_plane1.size()/10 );
+        viennamesh::LoggingStack stack("build hash");
+        plane1_hash.init( pp1.empty() ? 0 : &pp1[0], vertices_on_plane1.size(), 2, tol );
       }
 
       std::vector<viennagrid::element_id> reordered_vertices_on_plane1( vertices_on_plane0.size() );
-      for (std::size_t i0 = 0; i0 != vertices_on_plane0.size(); ++i0)
+
+      #pragma omp parallel for
+      for (std::ptrdiff_t i0 = 0; i0 < static_cast<std::ptrdiff_t>(vertices_on_plane0.size()); ++i0)
       {
-        PointType const & p0 = points[vertices_on_plane0[i0]];
-        PointType rotated_p0 = rotate(p0, axis, angle);
+        PointType rotated_p0 = rotate(points[vertices_on_plane0[i0]], axis, angle);
 
-        PointType tmp0(2);
+        viennagrid_numeric tmp0[2];
         tmp0[0] = viennagrid::inner_prod( cs[0], rotated_p0 );
         tmp0[1] = viennagrid::inner_prod( cs[1], rotated_p0 );
 
-        NodeType * node = root->get(tmp0);
-        for (std::size_t j = 0; j != node->elements().size(); ++j)
-        {
-          PointType tmp1 = node->elements()[j].point();
-          if ( viennagrid::detail::is_equal(tol, tmp0, tmp1) )
-          {
-            reordered_vertices_on_plane1[i0] = vertices_on_plane1[ node->elements()[j].id() ];
-            break;
-          }
-        }
+        spatial_hash::index_type i1 = plane1_hash.find(tmp0);
+        if (i1 >= 0)
+          reordered_vertices_on_plane1[i0] = vertices_on_plane1[i1];
       }
 
       vertices_on_plane1 = reordered_vertices_on_plane1;
@@ -507,20 +484,27 @@ namespace viennamesh
       }
 
 
+      std::vector<PointType> new_points( shared_vertex_count + non_shared_vertex_count * rotational_frequency );
+
       for (std::size_t i = 0; i != vertices_on_both_planes.size(); ++i)
-        new_vertices.push_back( viennagrid::make_vertex(output_mesh(), points[vertices_on_both_planes[i]]) );
+        new_points[i] = points[vertices_on_both_planes[i]];
 
-      for (int rf = 0; rf != rotational_frequency; ++rf)
+      #pragma omp parallel for
+      for (int rf = 0; rf < rotational_frequency; ++rf)
       {
+        std::size_t index = shared_vertex_count + rf*non_shared_vertex_count;
         double current_angle = angle * rf;
 
         for (std::size_t i = 0; i != vertices_on_plane0.size(); ++i)
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotate(points[vertices_on_plane0[i]], axis, current_angle)) );
+          new_points[index++] = rotate(points[vertices_on_plane0[i]], axis, current_angle);
 
         for (std::size_t i = 0; i != vertices_on_no_plane.size(); ++i)
-          new_vertices.push_back( viennagrid::make_vertex(output_mesh(), rotate(points[vertices_on_no_plane[i]], axis, current_angle)) );
+          new_points[index++] = rotate(points[vertices_on_no_plane[i]], axis, current_angle);
       }
 
+      for (std::size_t i = 0; i != new_points.size(); ++i)
+        new_vertices.push_back( viennagrid::make_vertex(output_mesh(), new_points[i]) );
+
       info(1) << "New mesh has " << new_vertices.size() << " vertices (old had " << vertices.size() << ")" << std::endl;
       info(1) << "    shared vertex count = " << shared_vertex_count << std::endl;
       info(1) << "    on plane count = " << vertices_on_plane0.size() << std::endl;
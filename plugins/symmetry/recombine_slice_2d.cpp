@@ -15,8 +15,10 @@
 #include <set>
 #include <map>
 #include <iterator>
+#include <algorithm>
 
 #include "recombine_slice_2d.hpp"
+#include "viennameshpp/spatial_hash.hpp"
 #include "viennagrid/algorithm/distance.hpp"
 #include "viennagrid/algorithm/centroid.hpp"
 
@@ -50,6 +52,8 @@ namespace viennamesh
     typedef viennagrid::result_of::iterator<ConstElementRangeType>::type    ConstElementIteratorType;
 
     double tol = 1e-6;
+    if (get_input<double>("tolerance").valid())
+      tol = get_input<double>("tolerance")();
 
     mesh_handle input_mesh = get_required_input<mesh_handle>("mesh");
 
@@ -79,45 +83,74 @@ namespace viennamesh
       info(1) << "mirror_axis " << mirror_axis << std::endl;
     info(1) << "centroid " << centroid << std::endl;
 
-    mesh_handle output_mesh = make_data<mesh_handle>();
-    viennagrid::result_of::element_copy_map<>::type copy_map( output_mesh(), tol );
-
+    // all copies of the slice (the slice itself, the mirrored slice and the
+    // rotated slices) are written to one flat coordinate array, coinciding
+    // vertices are welded afterwards using a spatial hash
+    std::vector<viennagrid_numeric> slice_coords;
     ConstElementRangeType triangles(input_mesh(), 2);
     for (ConstElementIteratorType tit = triangles.begin(); tit != triangles.end(); ++tit)
     {
-      copy_map(*tit);
-
-      if (mirror_axis_used)
+      for (int pi = 0; pi != 3; ++pi)
       {
-        PointType mirror_vector = viennagrid::make_point( std::cos(mirror_axis), std::sin(mirror_axis) );
-
-        ElementType v0 = viennagrid::make_unique_vertex( output_mesh(), reflect(viennagrid::get_point(*tit, 0), centroid, mirror_vector), tol );
-        ElementType v1 = viennagrid::make_unique_vertex( output_mesh(), reflect(viennagrid::get_point(*tit, 1), centroid, mirror_vector), tol );
-        ElementType v2 = viennagrid::make_unique_vertex( output_mesh(), reflect(viennagrid::get_point(*tit, 2), centroid, mirror_vector), tol );
-
-        viennagrid::make_triangle( output_mesh(), v0, v1, v2 );
+        PointType p = viennagrid::get_point(*tit, pi);
+        slice_coords.push_back(p[0]);
+        slice_coords.push_back(p[1]);
       }
     }
 
-    std::vector<ElementType> slice_triangles;
-    ConstElementRangeType output_triangles(input_mesh(), 2);
-    for (ConstElementIteratorType tit = output_triangles.begin(); tit != output_triangles.end(); ++tit)
-      slice_triangles.push_back(*tit);
+    int triangle_count = slice_coords.size() / 6;
+    int copy_count = 1 + (mirror_axis_used ? 1 : 0) + std::max(rotational_frequency-1, 0);
 
-    for (std::vector<ElementType>::iterator tit = slice_triangles.begin(); tit != slice_triangles.end(); ++tit)
+    PointType mirror_vector;
+    if (mirror_axis_used)
+      mirror_vector = viennagrid::make_point( std::cos(mirror_axis), std::sin(mirror_axis) );
+
+    std::vector<viennagrid_numeric> coords( slice_coords.size() * copy_count );
+
+    #pragma omp parallel for
+    for (int ci = 0; ci < copy_count; ++ci)
     {
-      for (int i = 1; i != rotational_frequency; ++i)
+      // copy 0 is the slice, copy 1 the mirrored slice (if used), the remaining copies are rotated
+      int rotation = mirror_axis_used ? ci-1 : ci;
+      double angle = 2*M_PI*static_cast<double>(rotation)/static_cast<double>(rotational_frequency);
+
+      viennagrid_numeric * dst = &coords[0] + ci*slice_coords.size();
+      for (std::size_t i = 0; i != slice_coords.size(); i += 2)
       {
-        double angle = 2*M_PI*static_cast<double>(i)/static_cast<double>(rotational_frequency);
+        PointType p = viennagrid::make_point( slice_coords[i], slice_coords[i+1] );
 
-        ElementType v0 = viennagrid::make_unique_vertex( output_mesh(), rotate(viennagrid::get_point(*tit, 0), centroid, angle), tol );
-        ElementType v1 = viennagrid::make_unique_vertex( output_mesh(), rotate(viennagrid::get_point(*tit, 1), centroid, angle), tol );
-        ElementType v2 = viennagrid::make_unique_vertex( output_mesh(), rotate(viennagrid::get_point(*tit, 2), centroid, angle), tol );
+        if (mirror_axis_used && ci == 1)
+          p = reflect(p, centroid, mirror_vector);
+        else if (ci != 0)
+          p = rotate(p, centroid, angle);
 
-        viennagrid::make_triangle( output_mesh(), v0, v1, v2 );
+        dst[i+0] = p[0];
+        dst[i+1] = p[1];
       }
     }
 
+    std::vector<viennagrid_int> representatives;
+    viennagrid_int vertex_count = weld_points( coords.empty() ? 0 : &coords[0], coords.size()/2, 2, tol, representatives );
+
+    info(1) << "Welded " << coords.size()/2 << " slice vertices to " << vertex_count << " vertices" << std::endl;
+
+    mesh_handle output_mesh = make_data<mesh_handle>();
+
+    std::vector<ElementType> new_vertices( representatives.size() );
+    for (std::size_t i = 0; i != representatives.size(); ++i)
+    {
+      if (representatives[i] == static_cast<viennagrid_int>(i))
+        new_vertices[i] = viennagrid::make_vertex( output_mesh(), viennagrid::make_point(coords[2*i], coords[2*i+1]) );
+    }
+
+    for (int i = 0; i != triangle_count*copy_count; ++i)
+    {
+      viennagrid::make_triangle( output_mesh(),
+                                 new_vertices[ representatives[3*i+0] ],
+                                 new_vertices[ representatives[3*i+1] ],
+                                 new_vertices[ representatives[3*i+2] ] );
+    }
+
     set_output( "mesh", output_mesh );
 
     return true;
@@ -124,6 +124,74 @@ namespace viennamesh
   };
 
 
+  /** @brief Evaluates all real spherical harmonics Y(l,m), 0 <= l <= max_l, at once.
+    *
+    * Same convention as SphericalHarmonic<double>, but the associated Legendre
+    * functions are evaluated with one upward recursion and the normalization
+    * factors are precomputed. Y(l,m) is stored at index l*l+l+m.
+    */
+  class SphericalHarmonicTable
+  {
+  public:
+
+    SphericalHarmonicTable(int max_l) : max_l_(max_l), normalizations_((max_l+1)*(max_l+1))
+    {
+      for (int l = 0; l <= max_l_; ++l)
+        for (int m = 0; m <= l; ++m)
+          normalizations_[index(l,m)] = sqrt( (2.0*l + 1.0) * factorial(l - m) / (2.0 * M_PI * factorial(l + m)) );
+    }
+
+    int max_l() const { return max_l_; }
+    std::size_t size() const { return normalizations_.size(); }
+    static std::size_t index(int l, int m) { return l*l+l+m; }
+
+    // values has to hold size() entries
+    void operator()(double theta, double phi, double * values) const
+    {
+      double x = std::cos(theta);
+      double s = std::sqrt(1.0 - x*x);
+
+      // associated Legendre functions P(l,m), m >= 0, stored at the slot of Y(l,m)
+      double pmm = 1.0;
+      for (int m = 0; m <= max_l_; ++m)
+      {
+        if (m > 0)
+          pmm *= -(2.0*m - 1.0) * s;
+        values[index(m,m)] = pmm;
+
+        if (m+1 <= max_l_)
+          values[index(m+1,m)] = x * (2.0*m + 1.0) * pmm;
+
+        for (int l = m+2; l <= max_l_; ++l)
+          values[index(l,m)] = ( (2.0*l - 1.0) * x * values[index(l-1,m)]
+                               - (l + m - 1.0)     * values[index(l-2,m)] ) / static_cast<double>(l - m);
+      }
+
+      for (int m = 0; m <= max_l_; ++m)
+      {
+        double cos_mphi = std::cos(m * phi);
+        double sin_mphi = std::sin(m * phi);
+
+        for (int l = m; l <= max_l_; ++l)
+        {
+          double tmp = normalizations_[index(l,m)] * values[index(l,m)];
+          if (m == 0)
+            values[index(l,0)] = tmp / sqrt(2.0);
+          else
+          {
+            values[index(l,m)] = tmp * cos_mphi;
+            values[index(l,-m)] = tmp * sin_mphi;
+          }
+        }
+      }
+    }
+
+  private:
+    int max_l_;
+    std::vector<double> normalizations_;
+  };
+
+
   template<>
   class SphericalHarmonic< std::complex<double> >
   {
@@ -22,6 +22,7 @@
 #include <vector>
 #include <typeinfo>
 #include <cstdlib>
+#include <algorithm>
 
 using std::string;
 
@@ -84,15 +85,55 @@ namespace viennamesh
     std::vector<int> vertex_indices;
   };
 
+  // The elements of a region are stored in compressed row storage, the vertex
+  // indices of element i are vertex_indices[element_offsets[i]] up to
+  // vertex_indices[element_offsets[i+1]-1]
   struct region_t
   {
+    region_t() : regnr(-1), nelements(0), npointidx(0) {}
+
     int regnr;
     string name,material;
     int nelements,npointidx;
-    std::vector<element_t> elements;
+    std::vector<int> raw_elements;
+    std::vector<viennagrid_element_type> element_tags;
+    std::vector<int> element_offsets;
+    std::vector<int> vertex_indices;
     std::map<string,dataset_t> dataset;
+
+    std::size_t element_count() const { return element_tags.size(); }
+
+    element_t element(std::size_t i) const
+    {
+      element_t result;
+      result.element_tag = element_tags[i];
+      result.vertex_indices.assign( vertex_indices.begin() + element_offsets[i],
+                                    vertex_indices.begin() + element_offsets[i+1] );
+      return result;
+    }
   };
 
+
+  // Reads count entries of a one dimensional dataset directly into buffer
+  // using hyperslabs of at most slab_size entries, each entry occupies
+  // stride values of T in the buffer
+  template<typename T>
+  void read_hyperslabs(const DataSet &ds, const DataType &mem_type, hsize_t count, std::size_t stride, T * buffer)
+  {
+    hsize_t const slab_size = 1 << 20;
+
+    for (hsize_t offset = 0; offset < count; offset += slab_size)
+    {
+      hsize_t n = std::min(slab_size, count-offset);
+
+      DataSpace file_space = ds.getSpace();
+      file_space.selectHyperslab(H5S_SELECT_SET, &n, &offset);
+      DataSpace mem_space(1, &n);
+
+      ds.read( buffer + offset*stride, mem_type, mem_space, file_space );
+    }
+  }
+
   struct attributeinfo_c
   {
     const dataset_t *firstattribute;
@@ -125,11 +166,6 @@ namespace viennamesh
       b.read( trans_move, PredType::NATIVE_DOUBLE);
     }
 
-    typedef struct coord2_t {
-            double x[3];
-        } coord2_t;
-
-
     void read_vertex(const DataSet &vert)
     {
       const DataSpace &dataspace = vert.getSpace();
@@ -138,35 +174,25 @@ namespace viennamesh
       if (nvertices!=dims[0])
         mythrow("nvertices not equal vertices.dim");
 
-      CompType mtype2( sizeof(coord2_t) );
-      const H5std_string MEMBER1( "x" );
-      const H5std_string MEMBER2( "y" );
-      const H5std_string MEMBER3( "z" );
-      mtype2.insertMember( "x", HOFFSET(coord2_t, x[0]), PredType::NATIVE_DOUBLE);
+      // the memory type maps the compound members directly onto the flat vertex buffer
+      CompType mtype( dim*sizeof(double) );
+      mtype.insertMember( "x", 0, PredType::NATIVE_DOUBLE);
 
       if (dim>1)
-        mtype2.insertMember( "y", HOFFSET(coord2_t, x[1]), PredType::NATIVE_DOUBLE);
+        mtype.insertMember( "y", sizeof(double), PredType::NATIVE_DOUBLE);
 
       if (dim>2)
-        mtype2.insertMember( "z", HOFFSET(coord2_t, x[2]), PredType::NATIVE_DOUBLE);
+        mtype.insertMember( "z", 2*sizeof(double), PredType::NATIVE_DOUBLE);
 
-      /*
-      * Read two fields x and y from s2 dataset. Fields in the file
-      * are found by their names "x_name" and "y_name".
-      */
-      coord2_t * s2 = new coord2_t[dims[0]];
-      vert.read( s2, mtype2 );
+      vertex.resize( dim*dims[0] );
+      if (vertex.empty())
+        return;
 
-      for (unsigned int i=0; i<dims[0]; i++)
-      {
-        vertex.push_back(s2[i].x[0]*10000.);
-        if (dim>1)
-        vertex.push_back(s2[i].x[1]*10000.);
-        if (dim>2)
-        vertex.push_back(s2[i].x[2]*10000.);
-      }
+      read_hyperslabs( vert, mtype, dims[0], dim, &vertex[0] );
 
-      delete[] s2;
+      #pragma omp parallel for
+      for (long i = 0; i < static_cast<long>(vertex.size()); ++i)
+        vertex[i] *= 10000.;
     }
 
     void read_elements(region_t &region, const DataSet &elem)
@@ -181,42 +207,75 @@ namespace viennamesh
       if (ndims!=1)
         mythrow("ndims of elements in region " << region.name << " is not one");
 
-      int * el = new int[dims[0]];
-      elem.read( el, PredType::NATIVE_INT);
+      // the element stream is decoded after all regions are read, see decode_elements
+      std::size_t offset = region.raw_elements.size();
+      region.raw_elements.resize( offset + dims[0] );
+      if (dims[0] != 0)
+        read_hyperslabs( elem, PredType::NATIVE_INT, dims[0], 1, &region.raw_elements[offset] );
+    }
+
+    // Decodes the element stream of a region into compressed row storage,
+    // returns the unknown element type if there is one and 0 otherwise
+    static int decode_region_elements(region_t &region)
+    {
+      std::vector<int> const & el = region.raw_elements;
+
+      region.element_tags.clear();
+      region.element_offsets.assign(1, 0);
+      region.vertex_indices.clear();
+      region.vertex_indices.reserve( el.size() );
 
-      unsigned int elct=0;
-      while (elct<dims[0])
+      std::size_t elct=0;
+      while (elct<el.size())
       {
-        element_t element;
+        int vertex_count;
         switch (el[elct++])
         {
           case 1:
-            element.element_tag = VIENNAGRID_ELEMENT_TYPE_LINE;
-            for (int i=0; i<2; i++)
-              element.vertex_indices.push_back(el[elct++]);
+            region.element_tags.push_back(VIENNAGRID_ELEMENT_TYPE_LINE);
+            vertex_count = 2;
             break;
           case 2:
-            element.element_tag = VIENNAGRID_ELEMENT_TYPE_TRIANGLE;
-            for (int i=0; i<3; i++)
-              element.vertex_indices.push_back(el[elct++]);
+            region.element_tags.push_back(VIENNAGRID_ELEMENT_TYPE_TRIANGLE);
+            vertex_count = 3;
             break;
           case 3:
-            element.element_tag = VIENNAGRID_ELEMENT_TYPE_QUADRILATERAL;
-            for (int i=0; i<4; i++)
-              element.vertex_indices.push_back(el[elct++]);
+            region.element_tags.push_back(VIENNAGRID_ELEMENT_TYPE_QUADRILATERAL);
+            vertex_count = 4;
             break;
           case 5:
-            element.element_tag = VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON;
-            for (int i=0; i<4; i++)
-              element.vertex_indices.push_back(el[elct++]);
+            region.element_tags.push_back(VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON);
+            vertex_count = 4;
             break;
-          default:mythrow("Element type " << el[elct-1] << " in region " << region.name << " not known");
+          default:
+            return el[elct-1];
         }
 
-        region.elements.push_back(element);
+        region.vertex_indices.insert( region.vertex_indices.end(), el.begin()+elct, el.begin()+elct+vertex_count );
+        region.element_offsets.push_back( region.vertex_indices.size() );
+        elct += vertex_count;
       }
 
-      delete[] el;
+      std::vector<int>().swap(region.raw_elements);
+      return 0;
+    }
+
+    void decode_elements()
+    {
+      // HDF5 serializes all calls, but decoding the element streams can run concurrently
+      std::vector<region_t*> regions;
+      for (std::map<string,region_t>::iterator R=region.begin(); R!=region.end(); R++)
+        regions.push_back(&R->second);
+
+      std::vector<int> unknown_types( regions.size(), 0 );
+
+      #pragma omp parallel for schedule(dynamic)
+      for (int i = 0; i < static_cast<int>(regions.size()); ++i)
+        unknown_types[i] = decode_region_elements( *regions[i] );
+
+      for (std::size_t i = 0; i != regions.size(); ++i)
+        if (unknown_types[i] != 0)
+          mythrow("Element type " << unknown_types[i] << " in region " << regions[i]->name << " not known");
     }
 
     void read_region(const int regnr, const Group &reg)
@@ -301,10 +360,10 @@ namespace viennamesh
       if (dataset.nvalues!=dims[0] || ndims!=1)
         mythrow("Dataset " << dataset.name << " should have " << dataset.nvalues << " values, but has " << dims[0] << " with dimension " << ndims);
 
-      double * v = new double[dims[0]];
-      values.read( v, PredType::NATIVE_DOUBLE);
-      dataset.values.insert(dataset.values.end(),&v[0],&v[dims[0]]);
-      delete[] v;
+      std::size_t offset = dataset.values.size();
+      dataset.values.resize( offset + dims[0] );
+      if (dims[0] != 0)
+        read_hyperslabs( values, PredType::NATIVE_DOUBLE, dims[0], 1, &dataset.values[offset] );
     }
 
     void read_dataset(const Group &dataset)
@@ -409,6 +468,7 @@ namespace viennamesh
         const Group &reg=geometry.openGroup(name);
         read_region(i,reg);
       }
+      decode_elements();
 
       const Group &trans=geometry.openGroup("transformation");
       read_transformation(trans);
@@ -471,44 +531,61 @@ namespace viennamesh
       viennagrid_element_type cell_type = VIENNAGRID_ELEMENT_TYPE_VERTEX;
       for (std::map<string,region_t>::iterator S=region.begin(); S!=region.end(); S++)
       {
-        std::vector<element_t> &elements=S->second.elements;
-        for (std::vector<element_t>::iterator E=elements.begin(); E!=elements.end(); E++)
-        {
-          element_t const & e = *E;
-          cell_type = viennagrid_topological_max( cell_type, e.element_tag );
-        }
+        std::vector<viennagrid_element_type> const & tags = S->second.element_tags;
+        for (std::size_t i = 0; i != tags.size(); ++i)
+          cell_type = viennagrid_topological_max( cell_type, tags[i] );
       }
 
 
+      // all cells are created with one batch call, lower dimensional elements are contacts
+      std::vector<viennagrid_element_type> cell_types;
+      std::vector<viennagrid_int> cell_vertex_offsets(1, 0);
+      std::vector<viennagrid_element_id> cell_vertex_ids;
+      std::vector<viennagrid_region_id> cell_region_ids;
+
       std::map<string, region_contacts<VertexType> > contact_elements;
 
       for (std::map<string,region_t>::iterator S=region.begin(); S!=region.end(); S++)
       {
-        string region_name = S->second.name;
+        region_t const & r = S->second;
+        string region_name = r.name;
+
+        bool region_created = false;
+        viennagrid_region_id region_id = 0;
 
-        std::vector<element_t> &elements=S->second.elements;
-        for (std::vector<element_t>::iterator E=elements.begin(); E!=elements.end(); E++)
+        for (std::size_t i = 0; i != r.element_count(); ++i)
         {
-          element_t const & e = *E;
+          if (r.element_tags[i] == cell_type)
+          {
+            if (!region_created)
+            {
+              region_id = mesh.get_or_create_region(region_name).id();
+              region_created = true;
+            }
 
-          std::vector<VertexType> cell_vertices(e.vertex_indices.size());
-          for (std::size_t i = 0; i < e.vertex_indices.size(); ++i)
-            cell_vertices[i] = vertices[e.vertex_indices[i]];
+            for (int j = r.element_offsets[i]; j != r.element_offsets[i+1]; ++j)
+              cell_vertex_ids.push_back( vertices[r.vertex_indices[j]].id().internal() );
 
-          if (e.element_tag == cell_type)
-          {
-            viennagrid::make_element( mesh.get_or_create_region(region_name),
-                                      viennagrid::element_tag::from_internal(e.element_tag),
-                                      cell_vertices.begin(), cell_vertices.end() );
+            cell_types.push_back( cell_type );
+            cell_vertex_offsets.push_back( cell_vertex_ids.size() );
+            cell_region_ids.push_back( region_id );
           }
           else
           {
             contact_elements[region_name].region_name = region_name + "_contact";
-            contact_elements[region_name].elements.push_back(e);
+            contact_elements[region_name].elements.push_back( r.element(i) );
           }
         }
       }
 
+      if (!cell_types.empty())
+      {
+        viennagrid_mesh_element_batch_create( mesh.internal(),
+                                              cell_types.size(), &cell_types[0],
+                                              &cell_vertex_offsets[0], &cell_vertex_ids[0],
+                                              &cell_region_ids[0], NULL );
+      }
+
       if (extrude_contacts)
       {
         for (typename std::map<string, region_contacts<VertexType> >::iterator rc = contact_elements.begin(); rc != contact_elements.end(); ++rc)
@@ -679,41 +756,40 @@ namespace viennamesh
 
     void correct_vertices()
     {
-      std::map<int,int> hakerl;
-      std::vector<double> vertexsave;
+      // renumber the vertices used by any element consecutively and drop the others
+      std::vector<int> new_index( nvertices, -1 );
       for (std::map<string,region_t>::iterator R=region.begin(); R!=region.end(); R++)
       {
-        for (unsigned int j=0; j<R->second.elements.size(); j++)
-        {
-          for (unsigned int i=0; i<R->second.elements[j].vertex_indices.size(); i++)
-            hakerl[R->second.elements[j].vertex_indices[i]];
-        }
+        std::vector<int> const & indices = R->second.vertex_indices;
+        for (std::size_t i = 0; i != indices.size(); ++i)
+          new_index[indices[i]] = 0;
       }
+
       int ct=0;
-      if (hakerl.size()*dim==vertex.size())
+      for (unsigned int i = 0; i != nvertices; ++i)
+        if (new_index[i] == 0)
+          new_index[i] = ct++;
+
+      if (static_cast<unsigned int>(ct) == nvertices)
         return;
-      vertexsave=vertex;
-      vertex.clear();
-      for (std::map<int,int>::iterator I=hakerl.begin(); I!=hakerl.end(); I++)
+
+      std::vector<double> vertexsave( ct*dim );
+      for (unsigned int i = 0; i != nvertices; ++i)
       {
-        vertex.push_back(vertexsave[I->first*dim]);
-        if (dim==2)
-          vertex.push_back(vertexsave[I->first*dim+1]);
-        if (dim==3)
-          vertex.push_back(vertexsave[I->first*dim+2]);
-        I->second=ct++;
+        if (new_index[i] >= 0)
+          std::copy( vertex.begin() + i*dim, vertex.begin() + (i+1)*dim, vertexsave.begin() + new_index[i]*dim );
       }
+      vertex.swap(vertexsave);
+
       for (std::map<string,region_t>::iterator R=region.begin(); R!=region.end(); R++)
       {
-        for (unsigned int j=0; j<R->second.elements.size(); j++)
-        {
-          for (unsigned int i=0; i<R->second.elements[j].vertex_indices.size(); i++)
-          {
-            int idx=hakerl[R->second.elements[j].vertex_indices[i]];
-            R->second.elements[j].vertex_indices[i]=idx;
-          }
-        }
+        std::vector<int> & indices = R->second.vertex_indices;
+
+        #pragma omp parallel for
+        for (long i = 0; i < static_cast<long>(indices.size()); ++i)
+          indices[i] = new_index[indices[i]];
       }
+
       nvertices=vertex.size()/dim;
     }
 
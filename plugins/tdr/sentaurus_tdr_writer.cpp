@@ -15,6 +15,7 @@
 #include "sentaurus_tdr_writer.hpp"
 
 #include <fstream>
+#include <algorithm>
 
 #include <boost/container/flat_map.hpp>
 #include <boost/lexical_cast.hpp>
@@ -68,18 +69,36 @@ void write_attribute(H5::H5Object & obj, std::string const & name, double value)
   attr.write(H5::PredType::NATIVE_DOUBLE, &value);
 }
 
+hsize_t const dataset_chunk_size = 1 << 16;
+
+//large or compressed datasets are chunked, small ones stay contiguous
 template <typename T>
-H5::DataSet write_dataset(H5::Group & group, std::string const & name, H5::DataType const & type, hsize_t length, std::vector<T> const & data)
+H5::DataSet write_dataset(H5::Group & group, std::string const & name, H5::DataType const & type, hsize_t length, std::vector<T> const & data, int compression_level = 0)
 {
   H5::DataSpace dataspace(1, &length);
-  H5::DataSet dataset = group.createDataSet(name, type, dataspace);
-  dataset.write(&data[0], type);
+
+  H5::DSetCreatPropList properties;
+  if (length > 0 && (compression_level > 0 || length > dataset_chunk_size))
+  {
+    hsize_t chunk_length = std::min(length, dataset_chunk_size);
+    properties.setChunk(1, &chunk_length);
+    if (compression_level > 0)
+    {
+      properties.setDeflate(compression_level);
+    }
+  }
+
+  H5::DataSet dataset = group.createDataSet(name, type, dataspace, properties);
+  if (length > 0)
+  {
+    dataset.write(&data[0], type);
+  }
   return dataset;
 }
 
 } //end of anonymous namespace
 
-void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & mesh, std::vector<viennagrid::quantity_field> const & quantities)
+void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & mesh, std::vector<viennagrid::quantity_field> const & quantities, int compression_level)
 {
   unsigned int dimension = viennagrid::geometric_dimension(mesh);
   if (dimension != 2)
@@ -87,6 +106,11 @@ void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & m
     throw viennautils::make_exception<tdr_writer_error>("TDR writer currently supports only two dimensional meshes");
   }
 
+  if (compression_level < 0 || compression_level > 9)
+  {
+    throw viennautils::make_exception<tdr_writer_error>("Compression level has to be between 0 and 9");
+  }
+
   try
   {
     H5::H5File file(filename, H5F_ACC_TRUNC);
@@ -149,7 +173,7 @@ void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & m
         vertex_type.insertMember( "z", 2*sizeof(double), H5::PredType::NATIVE_DOUBLE);
       }
 
-      write_dataset(geometry, "vertex", vertex_type, vertex_coordinates.size()/dimension, vertex_coordinates);
+      write_dataset(geometry, "vertex", vertex_type, vertex_coordinates.size()/dimension, vertex_coordinates, compression_level);
     }
 
     RegionRange regions(mesh);
@@ -186,7 +210,7 @@ void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & m
           }
         }
 
-        H5::DataSet elements = write_dataset(region_group, "elements_0", H5::PredType::NATIVE_INT32, region_element_data.size(), region_element_data);
+        H5::DataSet elements = write_dataset(region_group, "elements_0", H5::PredType::NATIVE_INT32, region_element_data.size(), region_element_data, compression_level);
         write_attribute(elements, "number of elements", static_cast<int>(num_elements));
       }
     }
@@ -244,7 +268,7 @@ void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & m
             write_attribute(dataset_group, "conversion factor", 1.0);
             write_attribute(dataset_group, "region", region_num);
             write_attribute(dataset_group, "unit:name", "unknown"); //TODO
-            write_dataset(dataset_group, "values", H5::PredType::NATIVE_DOUBLE, values.size(), values);
+            write_dataset(dataset_group, "values", H5::PredType::NATIVE_DOUBLE, values.size(), values, compression_level);
           }
         }
       }
@@ -28,7 +28,8 @@ namespace viennamesh
 
 struct tdr_writer_error : virtual viennautils::exception {};
 
-void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & mesh, std::vector<viennagrid::quantity_field> const & quantities);
+//compression_level is the deflate level (0 - 9) of the vertex, element and value datasets, 0 disables compression
+void write_to_tdr(std::string const & filename, viennagrid::const_mesh const & mesh, std::vector<viennagrid::quantity_field> const & quantities, int compression_level = 0);
 
 } //end of namespace viennamesh
 
@@ -33,6 +33,12 @@ bool tdr_writer::run(viennamesh::algorithm_handle &)
   string_handle filename = get_required_input<string_handle>("filename");
   mesh_handle input_mesh = get_required_input<mesh_handle>("mesh");
   quantity_field_handle quantities = get_input<viennagrid::quantity_field>("quantities");
+
+  int compression_level = 0;
+  if (get_input<int>("compression_level").valid())
+  {
+    compression_level = get_input<int>("compression_level")();
+  }
   
   info(1) << "About to write mesh to TDR file: " << filename() << std::endl;
   
@@ -43,7 +49,7 @@ bool tdr_writer::run(viennamesh::algorithm_handle &)
   
   try
   {
-    write_to_tdr(filename(), input_mesh(), (quantities.valid() ? quantities.get_vector() : std::vector<viennagrid::quantity_field>()));
+    write_to_tdr(filename(), input_mesh(), (quantities.valid() ? quantities.get_vector() : std::vector<viennagrid::quantity_field>()), compression_level);
   }
   catch (tdr_writer_error const & e)
   {
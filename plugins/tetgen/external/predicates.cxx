@@ -372,26 +372,30 @@
   Square(a1, _j, _1); \
   Two_Two_Sum(_j, _1, _l, _2, x5, x4, x3, x2)
 
+// All values below depend on the bounding box of the mesh being generated
+// and are set by exactinit(). They are thread local so that several meshes
+// can be generated concurrently.
+
 /* splitter = 2^ceiling(p / 2) + 1.  Used to split floats in half.           */
-static REAL splitter;
-static REAL epsilon;         /* = 2^(-p).  Used to estimate roundoff errors. */
+static thread_local REAL splitter;
+static thread_local REAL epsilon;         /* = 2^(-p).  Used to estimate roundoff errors. */
 /* A set of coefficients used to calculate maximum roundoff errors.          */
-static REAL resulterrbound;
-static REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
-static REAL o3derrboundA, o3derrboundB, o3derrboundC;
-static REAL iccerrboundA, iccerrboundB, iccerrboundC;
-static REAL isperrboundA, isperrboundB, isperrboundC;
+static thread_local REAL resulterrbound;
+static thread_local REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
+static thread_local REAL o3derrboundA, o3derrboundB, o3derrboundC;
+static thread_local REAL iccerrboundA, iccerrboundB, iccerrboundC;
+static thread_local REAL isperrboundA, isperrboundB, isperrboundC;
 
 // Options to choose types of geometric computtaions.
 // Added by H. Si, 2012-08-23.
-static int  _use_inexact_arith; // -X option.
-static int  _use_static_filter; // Default option, disable it by -X1
+static thread_local int  _use_inexact_arith; // -X option.
+static thread_local int  _use_static_filter; // Default option, disable it by -X1
 
 // Static filters for orient3d() and insphere().
 // They are pre-calcualted and set in exactinit().
 // Added by H. Si, 2012-08-23.
-static REAL o3dstaticfilter;
-static REAL ispstaticfilter;
+static thread_local REAL o3dstaticfilter;
+static thread_local REAL ispstaticfilter;
 
 
 
@@ -14,6 +14,12 @@
    License:         MIT (X11), see file LICENSE in the base directory
 =============================================================================== */
 
+#include <cmath>
+#include <algorithm>
+#include <exception>
+#include <sstream>
+#include <unordered_map>
+
 #include "tetgen_mesh.hpp"
 #include "tetgen_make_mesh.hpp"
 
@@ -21,25 +27,58 @@
 #include "viennagrid/algorithm/spanned_volume.hpp"
 // #include "viennagrid/algorithm/extract_seed_points.hpp"
 #include "viennameshpp/sizing_function.hpp"
+#include "viennameshpp/union_find.hpp"
 
 
 namespace viennamesh
 {
   namespace tetgen
   {
-    sizing_function::base_functor::function_type tetgen_sizing_function;
-    bool using_sizing_function;
+    // Refinement criteria of one tetgen_make_mesh invocation
+    struct refinement_context
+    {
+      refinement_context() : using_sizing_function(false),
+                             max_edge_ratio(0), using_max_edge_ratio(false),
+                             max_inscribed_radius_edge_ratio(0), using_max_inscribed_radius_edge_ratio(false) {}
+
+      sizing_function::base_functor::function_type tetgen_sizing_function;
+      bool using_sizing_function;
 
-    double max_edge_ratio;
-    bool using_max_edge_ratio;
+      double max_edge_ratio;
+      bool using_max_edge_ratio;
 
-    double max_inscribed_radius_edge_ratio;
-    bool using_max_inscribed_radius_edge_ratio;
+      double max_inscribed_radius_edge_ratio;
+      bool using_max_inscribed_radius_edge_ratio;
+    };
+
+    // tetgen's refinement callback has no user data argument, the context of
+    // the tetrahedralize() call running on this thread is set by make_mesh_impl
+    thread_local refinement_context const * current_refinement_context = NULL;
+
+    // Sets the refinement context of the current thread while in scope, the
+    // previous context is restored afterwards so that scopes can be nested
+    class refinement_context_scope
+    {
+    public:
+      refinement_context_scope(refinement_context const * context) : old_context(current_refinement_context)
+      { current_refinement_context = context; }
+      ~refinement_context_scope() { current_refinement_context = old_context; }
+
+    private:
+      refinement_context_scope(refinement_context_scope const &);
+      refinement_context_scope & operator=(refinement_context_scope const &);
+
+      refinement_context const * old_context;
+    };
 
     bool should_tetrahedron_be_refined_function(double * tet_p0, double * tet_p1, double * tet_p2, double * tet_p3, double * , double)
     {
       typedef viennagrid::point PointType;
 
+      refinement_context const * context = current_refinement_context;
+      if (!context)
+        return false;
+
       PointType p0 = viennagrid::make_point( tet_p0[0], tet_p0[1], tet_p0[2]);
       PointType p1 = viennagrid::make_point( tet_p1[0], tet_p1[1], tet_p1[2]);
       PointType p2 = viennagrid::make_point( tet_p2[0], tet_p2[1], tet_p2[2]);
@@ -54,29 +93,29 @@ namespace viennamesh
 
       double maxlen = std::max(std::max(std::max(d01, d02), std::max(d03, d12)), std::max(d13, d23));
 
-      if (using_max_edge_ratio)
+      if (context->using_max_edge_ratio)
       {
         double min_len = std::min(std::min(std::min(d01, d02), std::min(d03, d12)), std::min(d13, d23));
 
-        if (min_len / maxlen < max_edge_ratio)
+        if (min_len / maxlen < context->max_edge_ratio)
           return true;
       }
 
 
-      if (using_max_inscribed_radius_edge_ratio)
+      if (context->using_max_inscribed_radius_edge_ratio)
       {
         // http://saketsaurabh.in/blog/2009/11/radius-of-a-sphere-inscribed-in-a-general-tetrahedron/
         double volume = viennagrid::spanned_volume( p0, p1, p2, p3 );
         double surface = viennagrid::spanned_volume( p0, p1, p2 ) + viennagrid::spanned_volume( p0, p1, p3 ) + viennagrid::spanned_volume( p0, p2, p3 ) + viennagrid::spanned_volume( p1, p2, p3 );
         double inscribed_sphere_radius = volume / (3.0 * surface);
 
-        if (inscribed_sphere_radius / maxlen < max_inscribed_radius_edge_ratio)
+        if (inscribed_sphere_radius / maxlen < context->max_inscribed_radius_edge_ratio)
           return true;
       }
 
 
 
-      if (using_sizing_function)
+      if (context->using_sizing_function)
       {
         PointType center = (p0+p1+p2+p3)/4.0;
 
@@ -90,7 +129,7 @@ namespace viennamesh
         sizing_function::base_functor::result_type local_size = sizing_function::base_functor::result_type();
         for (int i = 0; i != 4; ++i)
         {
-          sizing_function::base_functor::result_type current_size = tetgen_sizing_function( sample_points[i] );
+          sizing_function::base_functor::result_type current_size = context->tetgen_sizing_function( sample_points[i] );
           if (current_size)
           {
             if (!local_size)
@@ -104,7 +143,7 @@ namespace viennamesh
         }
 
         if (local_size)
-          info(10) << "Requested size = " << local_size.get() << "   current triangle size = " << std::sqrt(maxlen) << std::endl;
+          VIENNAMESH_LOG(info, 10) << "Requested size = " << local_size.get() << "   current triangle size = " << std::sqrt(maxlen) << std::endl;
 
         if (local_size && maxlen > local_size.get()*local_size.get())
           return 1;
@@ -144,13 +183,20 @@ namespace viennamesh
 
 
 
+    // If log is given, the messages are written to it instead of the info
+    // log, meshing jobs running in a parallel loop log them after the loop
     void make_mesh_impl(tetgen::mesh const & input,
                         tetgen::mesh & output,
                         point_container const & hole_points,
                         seed_point_container const & seed_points,
-                        tetgenbehavior options)
+                        tetgenbehavior options,
+                        refinement_context const * context = NULL,
+                        std::ostream * log = NULL)
     {
-      tetgenio & tmp = (tetgenio&)(input);
+      std::ostringstream messages;
+
+      // shallow copy, the input may be shared with other algorithms running concurrently
+      tetgenio tmp(input);
 
       int old_numberofregions = tmp.numberofregions;
       REAL * old_regionlist = tmp.regionlist;
@@ -195,18 +241,24 @@ namespace viennamesh
           tmp.regionlist[5*(old_numberofregions+i)+4] = 0;
         }
 
-        info(1) << "Using additional seed points" << std::endl;
+        messages << "Using additional seed points" << std::endl;
       }
 
       if (tmp.numberofregions != 0)
       {
-        info(1) << "Using seed points" << std::endl;
+        messages << "Using seed points" << std::endl;
+        options.regionattrib = 1;
+      }
+
+      if (log)
+        *log << messages.str();
+      else
+      {
+        info(1) << messages.str();
         for (int i = 0; i != tmp.numberofregions; ++i)
         {
-          info(10) << "  (" << tmp.regionlist[5*i+0] << "," << tmp.regionlist[5*i+1] << "," << tmp.regionlist[5*i+2] << ") - " << tmp.regionlist[5*i+3] << std::endl;
+          VIENNAMESH_LOG(info, 10) << "  (" << tmp.regionlist[5*i+0] << "," << tmp.regionlist[5*i+1] << "," << tmp.regionlist[5*i+2] << ") - " << tmp.regionlist[5*i+3] << std::endl;
         }
-
-        options.regionattrib = 1;
       }
 
       {
@@ -215,7 +267,23 @@ namespace viennamesh
 
         std::cout << "Region attrib: " << options.regionattrib << std::endl;
 
-        tetrahedralize(&options, &tmp, &output);
+        if (context)
+        {
+          options.use_refinement_callback = 1;
+          tmp.tetunsuitable = should_tetrahedron_be_refined_function;
+        }
+
+        refinement_context_scope refinement_scope(context);
+
+        try
+        {
+          tetrahedralize(&options, &tmp, &output);
+        }
+        catch (...)
+        {
+          tmp.initialize();
+          throw;
+        }
       }
 
       if (!hole_points.empty())
@@ -224,11 +292,538 @@ namespace viennamesh
       if (!seed_points.empty())
         delete[] tmp.regionlist;
 
-      tmp.numberofregions = old_numberofregions;
-      tmp.regionlist = old_regionlist;
+      // all remaining arrays are owned by the input
+      tmp.initialize();
+    }
+
+
+
+
+
+    // Refines a triangulated surface by red-green-blue bisection until
+    // split_edge(p0, p1) is false for every edge. An edge marked in one face
+    // forces the bisection of the longest edge of this face, hence faces
+    // sharing an edge are always split consistently and the refined surface
+    // stays conforming. face_source keeps the index of the original face.
+    template<typename SplitEdgeFunctorT>
+    void refine_surface(std::vector<REAL> & points,
+                        std::vector<int> & faces,
+                        std::vector<int> & face_source,
+                        SplitEdgeFunctorT split_edge,
+                        int max_pass_count = 64)
+    {
+      typedef unsigned long long EdgeKeyType;
+
+      for (int pass = 0; pass != max_pass_count; ++pass)
+      {
+        std::size_t face_count = faces.size()/3;
+
+        // edge -> midpoint index, -1 if the midpoint is not yet created
+        std::unordered_map<EdgeKeyType, int> marked_edges;
+
+        auto edge_key = [](int v0, int v1) -> EdgeKeyType
+        {
+          if (v0 > v1)
+            std::swap(v0, v1);
+          return (static_cast<EdgeKeyType>(v0) << 32) | static_cast<EdgeKeyType>(v1);
+        };
+
+        auto squared_length = [&points](int v0, int v1) -> REAL
+        {
+          REAL result = 0;
+          for (int d = 0; d != 3; ++d)
+            result += (points[3*v0+d]-points[3*v1+d]) * (points[3*v0+d]-points[3*v1+d]);
+          return result;
+        };
+
+        // local index of the first vertex of the longest edge, ties are
+        // broken by the vertex ids so both sides of an edge agree
+        std::vector<unsigned char> longest_edge(face_count);
+        for (std::size_t f = 0; f != face_count; ++f)
+        {
+          int const * face = &faces[3*f];
+          int best = 0;
+          for (int k = 1; k != 3; ++k)
+          {
+            REAL lk = squared_length(face[k], face[(k+1)%3]);
+            REAL lb = squared_length(face[best], face[(best+1)%3]);
+            if (lk > lb || (lk == lb && edge_key(face[k], face[(k+1)%3]) < edge_key(face[best], face[(best+1)%3])))
+              best = k;
+          }
+          longest_edge[f] = best;
+
+          for (int k = 0; k != 3; ++k)
+          {
+            int v0 = face[k];
+            int v1 = face[(k+1)%3];
+            if (split_edge(&points[3*v0], &points[3*v1]))
+              marked_edges[edge_key(v0, v1)] = -1;
+          }
+        }
+
+        if (marked_edges.empty())
+          return;
+
+        // closure: a face with a marked edge has to split its longest edge
+        bool changed = true;
+        while (changed)
+        {
+          changed = false;
+          for (std::size_t f = 0; f != face_count; ++f)
+          {
+            int const * face = &faces[3*f];
+            EdgeKeyType longest = edge_key(face[longest_edge[f]], face[(longest_edge[f]+1)%3]);
+            if (marked_edges.count(longest))
+              continue;
+
+            for (int k = 0; k != 3; ++k)
+            {
+              if (marked_edges.count( edge_key(face[k], face[(k+1)%3]) ))
+              {
+                marked_edges[longest] = -1;
+                changed = true;
+                break;
+              }
+            }
+          }
+        }
+
+        auto midpoint = [&](int v0, int v1) -> int
+        {
+          std::unordered_map<EdgeKeyType, int>::iterator it = marked_edges.find( edge_key(v0, v1) );
+          if (it == marked_edges.end())
+            return -1;
+
+          if (it->second < 0)
+          {
+            it->second = points.size()/3;
+            for (int d = 0; d != 3; ++d)
+              points.push_back( (points[3*v0+d] + points[3*v1+d]) / 2.0 );
+          }
+          return it->second;
+        };
+
+        std::vector<int> new_faces;
+        std::vector<int> new_face_source;
+        new_faces.reserve( 2*faces.size() );
+        new_face_source.reserve( 2*face_source.size() );
+
+        auto add_face = [&](int v0, int v1, int v2, int source)
+        {
+          new_faces.push_back(v0);
+          new_faces.push_back(v1);
+          new_faces.push_back(v2);
+          new_face_source.push_back(source);
+        };
+
+        for (std::size_t f = 0; f != face_count; ++f)
+        {
+          // rotate the face so that (a,b) is the longest edge
+          int a = faces[3*f + longest_edge[f]];
+          int b = faces[3*f + (longest_edge[f]+1)%3];
+          int c = faces[3*f + (longest_edge[f]+2)%3];
+          int source = face_source[f];
+
+          int mab = midpoint(a, b);
+          if (mab < 0)
+          {
+            add_face(a, b, c, source);
+            continue;
+          }
+
+          int mbc = midpoint(b, c);
+          int mca = midpoint(c, a);
+
+          if (mca < 0)
+            add_face(a, mab, c, source);
+          else
+          {
+            add_face(a, mab, mca, source);
+            add_face(mab, c, mca, source);
+          }
+
+          if (mbc < 0)
+            add_face(mab, b, c, source);
+          else
+          {
+            add_face(mab, b, mbc, source);
+            add_face(mab, mbc, c, source);
+          }
+        }
+
+        faces.swap(new_faces);
+        face_source.swap(new_face_source);
+      }
+
+      warning(1) << "Surface refinement stopped after " << max_pass_count << " passes" << std::endl;
+    }
+
+
+
+
+
+    // Meshes every region of a multi-region PLC with its own tetgen run. The
+    // PLC is first tetrahedralized without any quality constraints, which
+    // recovers all facets and yields the triangulation of the region
+    // interfaces. Each connected region is then meshed concurrently from its
+    // closed boundary with the interface triangulation kept fixed (-Y), and
+    // the region meshes are stitched through the shared interface vertices.
+    void make_region_meshes_impl(tetgen::mesh const & input,
+                                 tetgen::mesh & output,
+                                 point_container const & hole_points,
+                                 seed_point_container const & seed_points,
+                                 tetgenbehavior options,
+                                 refinement_context const * context = NULL)
+    {
+      tetgen::mesh interfaces;
+
+      {
+        tetgenbehavior interface_options;
+        interface_options.plc = 1;
+        interface_options.zeroindex = 1;
+        interface_options.quiet = 1;
+        interface_options.nojettison = 1;
+        interface_options.regionattrib = 1;
+        interface_options.neighout = 2;
+        interface_options.epsilon = options.epsilon;
+        interface_options.facet_ang_tol = options.facet_ang_tol;
+        interface_options.vertexperblock = options.vertexperblock;
+        interface_options.tetrahedraperblock = options.tetrahedraperblock;
+        interface_options.shellfaceperblock = options.shellfaceperblock;
+
+        make_mesh_impl(input, interfaces, hole_points, seed_points, interface_options);
+      }
+
+      int point_count = interfaces.numberofpoints;
+      int tet_count = interfaces.numberoftetrahedra;
+      int face_count = interfaces.numberoftrifaces;
+      int attribute_count = interfaces.numberoftetrahedronattributes;
+
+      info(1) << "Interface mesh has " << face_count << " faces and " << tet_count << " tetrahedra" << std::endl;
+
+      if (tet_count == 0)
+        return;
+
+      // the region attribute is the last tetrahedron attribute
+      std::vector<REAL> tet_region(tet_count);
+      for (int i = 0; i < tet_count; ++i)
+        tet_region[i] = interfaces.tetrahedronattributelist[attribute_count*i + attribute_count-1];
+
+      // a region is a set of face connected tetrahedra with the same attribute,
+      // disconnected parts of a region are meshed independently
+      concurrent_union_find components(tet_count);
+
+      #pragma omp parallel for
+      for (int i = 0; i < tet_count; ++i)
+      {
+        for (int k = 0; k != 4; ++k)
+        {
+          int j = interfaces.neighborlist[4*i+k];
+          if (j > i && tet_region[j] == tet_region[i])
+            components.unite(i, j);
+        }
+      }
+
+      std::vector<int> tet_component;
+      int component_count = components.labels(tet_component);
+
+      // the first tetrahedron of each component is used to place its seed point
+      std::vector<int> component_tet(component_count, -1);
+      for (int i = 0; i < tet_count; ++i)
+        if (component_tet[ tet_component[i] ] < 0)
+          component_tet[ tet_component[i] ] = i;
+
+      // The interface triangulation of the boundary recovery is as coarse as
+      // the input. With -Y tetgen is not allowed to split it, so it is refined
+      // to the requested cell size beforehand.
+      std::vector<REAL> points(interfaces.pointlist, interfaces.pointlist + 3*point_count);
+      std::vector<int> faces(interfaces.trifacelist, interfaces.trifacelist + 3*face_count);
+      std::vector<int> face_source(face_count);
+      for (int i = 0; i < face_count; ++i)
+        face_source[i] = i;
+
+      // edge length of a regular tetrahedron with the maximum cell volume
+      REAL max_edge_length = 0;
+      if (options.fixedvolume && options.maxvolume > 0)
+        max_edge_length = std::pow(6.0*std::sqrt(2.0)*options.maxvolume, 1.0/3.0);
+      bool using_sizing_function = context && context->using_sizing_function;
+
+      if (max_edge_length > 0 || using_sizing_function)
+      {
+        refine_surface(points, faces, face_source, [&](REAL const * p0, REAL const * p1) -> bool
+        {
+          REAL length = std::sqrt( (p0[0]-p1[0])*(p0[0]-p1[0]) + (p0[1]-p1[1])*(p0[1]-p1[1]) + (p0[2]-p1[2])*(p0[2]-p1[2]) );
+          if (max_edge_length > 0 && length > max_edge_length)
+            return true;
+
+          if (using_sizing_function)
+          {
+            sizing_function::base_functor::result_type size = context->tetgen_sizing_function(
+                viennagrid::make_point( (p0[0]+p1[0])/2.0, (p0[1]+p1[1])/2.0, (p0[2]+p1[2])/2.0 ) );
+            if (size && length > size.get())
+              return true;
+          }
+
+          return false;
+        });
+
+        info(1) << "Refined interface triangulation from " << face_count << " to " << faces.size()/3 << " faces" << std::endl;
+
+        point_count = points.size()/3;
+        face_count = faces.size()/3;
+      }
+
+      // interface faces per component (CSR), a face between two different
+      // components belongs to both of them
+      std::vector<int> face_offsets(component_count+1, 0);
+      for (int i = 0; i < face_count; ++i)
+      {
+        int c0 = interfaces.adjtetlist[2*face_source[i]+0] < 0 ? -1 : tet_component[ interfaces.adjtetlist[2*face_source[i]+0] ];
+        int c1 = interfaces.adjtetlist[2*face_source[i]+1] < 0 ? -1 : tet_component[ interfaces.adjtetlist[2*face_source[i]+1] ];
+
+        if (c0 >= 0)
+          ++face_offsets[c0+1];
+        if (c1 >= 0 && c1 != c0)
+          ++face_offsets[c1+1];
+      }
+      for (int c = 0; c != component_count; ++c)
+        face_offsets[c+1] += face_offsets[c];
+
+      std::vector<int> component_faces(face_offsets.back());
+      {
+        std::vector<int> fill(face_offsets.begin(), face_offsets.end()-1);
+        for (int i = 0; i < face_count; ++i)
+        {
+          int c0 = interfaces.adjtetlist[2*face_source[i]+0] < 0 ? -1 : tet_component[ interfaces.adjtetlist[2*face_source[i]+0] ];
+          int c1 = interfaces.adjtetlist[2*face_source[i]+1] < 0 ? -1 : tet_component[ interfaces.adjtetlist[2*face_source[i]+1] ];
+
+          if (c0 >= 0)
+            component_faces[ fill[c0]++ ] = i;
+          if (c1 >= 0 && c1 != c0)
+            component_faces[ fill[c1]++ ] = i;
+        }
+      }
+
+      // Points of the interface mesh which are kept: all points on interface
+      // faces and isolated input points, the latter are assigned to the
+      // component of a tetrahedron using them. Steiner points inside the
+      // volume are dropped, the region meshing creates its own.
+      std::vector<int> point_component(point_count, -1);
+      std::vector<bool> is_interface_point(point_count, false);
+      for (int i = 0; i < 3*face_count; ++i)
+        is_interface_point[ faces[i] ] = true;
+
+      for (int i = 0; i < tet_count; ++i)
+      {
+        for (int k = 0; k != 4; ++k)
+        {
+          int p = interfaces.tetrahedronlist[4*i+k];
+          if (p < input.numberofpoints && !is_interface_point[p])
+            point_component[p] = tet_component[i];
+        }
+      }
+
+      std::vector<int> global_point_index(point_count, -1);
+      int global_point_count = 0;
+      for (int p = 0; p < point_count; ++p)
+        if (is_interface_point[p] || point_component[p] >= 0)
+          global_point_index[p] = global_point_count++;
+
+      std::vector< std::vector<int> > component_isolated_points(component_count);
+      for (int p = 0; p < point_count; ++p)
+        if (point_component[p] >= 0)
+          component_isolated_points[ point_component[p] ].push_back(p);
+
+
+      options.plc = 1;
+      options.refine = 0;
+      options.convex = 0;
+      options.nobisect = 1;
+      options.zeroindex = 1;
+      options.nojettison = 1;
+      options.regionattrib = 1;
+      options.neighout = 0;
+      options.facesout = 0;
+      options.edgesout = 0;
+      options.quiet = 1;
+      options.verbose = 0;
+
+      std::vector<tetgen::mesh> region_meshes(component_count);
+      std::vector< std::vector<int> > region_points(component_count);
+      std::vector<int> region_tet_count(component_count, 0);
+      std::vector<std::string> region_log(component_count);
+
+      std::exception_ptr region_error;
+
+      info(1) << "Meshing " << component_count << " regions in parallel" << std::endl;
+
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (int c = 0; c < component_count; ++c)
+      {
+        try
+        {
+          // local numbering of the region boundary points
+          std::vector<int> & local_to_global = region_points[c];
+          for (int f = face_offsets[c]; f != face_offsets[c+1]; ++f)
+            for (int k = 0; k != 3; ++k)
+              local_to_global.push_back( faces[3*component_faces[f]+k] );
+          local_to_global.insert( local_to_global.end(),
+                                  component_isolated_points[c].begin(), component_isolated_points[c].end() );
+
+          std::sort( local_to_global.begin(), local_to_global.end() );
+          local_to_global.erase( std::unique(local_to_global.begin(), local_to_global.end()), local_to_global.end() );
+
+          tetgen::mesh region_input;
+          region_input.firstnumber = 0;
+
+          region_input.numberofpoints = local_to_global.size();
+          region_input.pointlist = new REAL[3*local_to_global.size()];
+          for (std::size_t i = 0; i != local_to_global.size(); ++i)
+            std::copy( points.begin() + 3*local_to_global[i], points.begin() + 3*local_to_global[i] + 3,
+                       region_input.pointlist + 3*i );
+
+          int region_face_count = face_offsets[c+1] - face_offsets[c];
+          region_input.numberoffacets = region_face_count;
+          region_input.facetlist = new tetgenio::facet[region_face_count];
+          region_input.facetmarkerlist = new int[region_face_count];
+          for (int f = 0; f != region_face_count; ++f)
+          {
+            int face = component_faces[face_offsets[c] + f];
+
+            tetgenio::facet & facet = region_input.facetlist[f];
+            tetgenio::init(&facet);
+            facet.numberofpolygons = 1;
+            facet.polygonlist = new tetgenio::polygon[1];
+            tetgenio::init(facet.polygonlist);
+            facet.polygonlist[0].numberofvertices = 3;
+            facet.polygonlist[0].vertexlist = new int[3];
+            for (int k = 0; k != 3; ++k)
+              facet.polygonlist[0].vertexlist[k] = std::lower_bound( local_to_global.begin(), local_to_global.end(),
+                                                                     faces[3*face+k] ) - local_to_global.begin();
+
+            region_input.facetmarkerlist[f] = interfaces.trifacemarkerlist ? interfaces.trifacemarkerlist[ face_source[face] ] : 0;
+          }
+
+          // the centroid of a tetrahedron of the interface mesh is inside the region
+          int seed_tet = component_tet[c];
+          region_input.numberofregions = 1;
+          region_input.regionlist = new REAL[5];
+          std::fill( region_input.regionlist, region_input.regionlist+5, 0 );
+          for (int k = 0; k != 4; ++k)
+            for (int d = 0; d != 3; ++d)
+              region_input.regionlist[d] += interfaces.pointlist[3*interfaces.tetrahedronlist[4*seed_tet+k]+d] / 4.0;
+          region_input.regionlist[3] = 1;
+
+          // keep the volume constraint of the user defined region
+          for (int i = 0; i < input.numberofregions; ++i)
+            if (input.regionlist[5*i+3] == tet_region[seed_tet])
+              region_input.regionlist[4] = input.regionlist[5*i+4];
+
+          // the log is not thread safe, the messages are logged after the loop
+          std::ostringstream log;
+          make_mesh_impl(region_input, region_meshes[c], point_container(), seed_point_container(), options, context, &log);
+          region_log[c] = log.str();
+
+          // cavities enclosed by the region boundary get a different attribute
+          tetgen::mesh const & region_mesh = region_meshes[c];
+          int region_attribute_count = region_mesh.numberoftetrahedronattributes;
+          for (int i = 0; i < region_mesh.numberoftetrahedra; ++i)
+            if (region_mesh.tetrahedronattributelist[region_attribute_count*i + region_attribute_count-1] == 1)
+              ++region_tet_count[c];
+        }
+        catch (...)
+        {
+          #pragma omp critical (tetgen_region_error)
+          {
+            if (!region_error)
+              region_error = std::current_exception();
+          }
+        }
+      }
+
+      for (int c = 0; c != component_count; ++c)
+      {
+        if (!region_log[c].empty())
+          info(1) << "Region " << c << ": " << region_log[c];
+        VIENNAMESH_LOG(info, 5) << "Region " << c << " has " << region_tet_count[c] << " tetrahedra" << std::endl;
+      }
+
+      if (region_error)
+        std::rethrow_exception(region_error);
 
-      tmp.numberofholes = old_numberofholes;
-      tmp.holelist = old_holelist;
+
+      // stitch the regions: interface points first, followed by the interior
+      // points of each region, all boundary points of a region are its first
+      // input points because of -Y and -J
+      std::vector<int> point_offsets(component_count+1);
+      std::vector<int> tet_offsets(component_count+1);
+      point_offsets[0] = global_point_count;
+      tet_offsets[0] = 0;
+      for (int c = 0; c != component_count; ++c)
+      {
+        point_offsets[c+1] = point_offsets[c] + region_meshes[c].numberofpoints - region_points[c].size();
+        tet_offsets[c+1] = tet_offsets[c] + region_tet_count[c];
+      }
+
+      output.firstnumber = 0;
+      output.numberofpoints = point_offsets.back();
+      output.pointlist = new REAL[3*output.numberofpoints];
+      output.numberofcorners = 4;
+      output.numberoftetrahedra = tet_offsets.back();
+      output.tetrahedronlist = new int[4*output.numberoftetrahedra];
+      output.numberoftetrahedronattributes = 1;
+      output.tetrahedronattributelist = new REAL[output.numberoftetrahedra];
+
+      #pragma omp parallel for
+      for (int p = 0; p < point_count; ++p)
+        if (global_point_index[p] >= 0)
+          std::copy( points.begin() + 3*p, points.begin() + 3*p + 3,
+                     output.pointlist + 3*global_point_index[p] );
+
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (int c = 0; c < component_count; ++c)
+      {
+        tetgen::mesh const & region_mesh = region_meshes[c];
+        std::vector<int> const & local_to_global = region_points[c];
+        int local_count = local_to_global.size();
+
+        std::copy( region_mesh.pointlist + 3*local_count, region_mesh.pointlist + 3*region_mesh.numberofpoints,
+                   output.pointlist + 3*point_offsets[c] );
+
+        REAL attribute = tet_region[ component_tet[c] ];
+        int region_attribute_count = region_mesh.numberoftetrahedronattributes;
+        int tet_index = tet_offsets[c];
+        for (int i = 0; i < region_mesh.numberoftetrahedra; ++i)
+        {
+          if (region_mesh.tetrahedronattributelist[region_attribute_count*i + region_attribute_count-1] != 1)
+            continue;
+
+          for (int k = 0; k != 4; ++k)
+          {
+            int local = region_mesh.tetrahedronlist[4*i+k];
+            output.tetrahedronlist[4*tet_index+k] = local < local_count ?
+                global_point_index[ local_to_global[local] ] :
+                point_offsets[c] + local - local_count;
+          }
+          output.tetrahedronattributelist[tet_index] = attribute;
+          ++tet_index;
+        }
+      }
+
+      // the (refined) interface triangulation is unchanged by the region meshing
+      output.numberoftrifaces = face_count;
+      output.trifacelist = new int[3*face_count];
+      for (int i = 0; i < 3*face_count; ++i)
+        output.trifacelist[i] = global_point_index[ faces[i] ];
+      if (interfaces.trifacemarkerlist)
+      {
+        output.trifacemarkerlist = new int[face_count];
+        for (int i = 0; i < face_count; ++i)
+          output.trifacemarkerlist[i] = interfaces.trifacemarkerlist[ face_source[i] ];
+      }
+
+      info(1) << "Stitched " << component_count << " regions into " << output.numberofpoints << " points and "
+              << output.numberoftetrahedra << " tetrahedra" << std::endl;
     }
 
 
@@ -317,6 +912,7 @@ namespace viennamesh
       data_handle<bool> extract_region_seed_points = get_input<bool>("extract_region_seed_points");
       data_handle<double> cell_size = get_input<double>("cell_size");
       data_handle<bool> forbid_steiner_points_on_faces = get_input<bool>("forbid_steiner_points_on_faces");
+      data_handle<bool> parallel_regions = get_input<bool>("parallel_regions");
 
 
 
@@ -327,7 +923,6 @@ namespace viennamesh
       data_handle<tetgen::mesh> output_mesh = make_data<tetgen::mesh>();
 
 
-      tetgen::mesh & im = const_cast<tetgen::mesh &>(input_mesh());
       tetgen::mesh & om = const_cast<tetgen::mesh &>(output_mesh());
 
 
@@ -357,9 +952,7 @@ namespace viennamesh
 //         options.addsteiner_algo = 2;
       }
 
-      using_sizing_function = false;
-      using_max_edge_ratio = false;
-      using_max_inscribed_radius_edge_ratio = false;
+      refinement_context context;
 
 
 //       tetgenio tmp = input_mesh();
@@ -385,19 +978,15 @@ namespace viennamesh
 
       if (max_edge_ratio.valid())
       {
-        viennamesh::tetgen::max_edge_ratio = max_edge_ratio();
-        using_max_edge_ratio = true;
-        options.use_refinement_callback = 1;
-        im.tetunsuitable = should_tetrahedron_be_refined_function;
+        context.max_edge_ratio = max_edge_ratio();
+        context.using_max_edge_ratio = true;
         info(1) << "Using global max edge ratio: " << max_edge_ratio() << std::endl;
       }
 
       if (max_inscribed_radius_edge_ratio.valid())
       {
-        viennamesh::tetgen::max_inscribed_radius_edge_ratio = max_inscribed_radius_edge_ratio();
-        using_max_inscribed_radius_edge_ratio = true;
-        options.use_refinement_callback = 1;
-        im.tetunsuitable = should_tetrahedron_be_refined_function;
+        context.max_inscribed_radius_edge_ratio = max_inscribed_radius_edge_ratio();
+        context.using_max_inscribed_radius_edge_ratio = true;
         info(1) << "Using global max inscribed radius edge ratio: " << max_inscribed_radius_edge_ratio() << std::endl;
       }
 
@@ -446,12 +1035,10 @@ namespace viennamesh
       {
         info(5) << "Using user-defined XML string sizing function" << std::endl;
         info(5) << sizing_function() << std::endl;
-        tetgen_sizing_function = make_sizing_function(
+        context.tetgen_sizing_function = make_sizing_function(
                                     input_mesh(), hole_points, seed_points,
                                     sizing_function(), base_path());
-        using_sizing_function = true;
-        options.use_refinement_callback = 1;
-        im.tetunsuitable = should_tetrahedron_be_refined_function;
+        context.using_sizing_function = true;
 
 //         options << "u";
 //         should_triangle_be_refined = should_triangle_be_refined_function;
@@ -501,7 +1088,17 @@ namespace viennamesh
 
 
 //       tetgen::output_mesh output_mesh;
-      make_mesh_impl( im, om, hole_points, seed_points, options );
+      bool use_refinement_callback = context.using_sizing_function ||
+                                     context.using_max_edge_ratio ||
+                                     context.using_max_inscribed_radius_edge_ratio;
+
+      if (parallel_regions.valid() && parallel_regions())
+      {
+        info(1) << "Meshing regions separately using a fixed interface triangulation" << std::endl;
+        make_region_meshes_impl( input_mesh(), om, hole_points, seed_points, options, use_refinement_callback ? &context : NULL );
+      }
+      else
+        make_mesh_impl( input_mesh(), om, hole_points, seed_points, options, use_refinement_callback ? &context : NULL );
       set_output("mesh", output_mesh);
 
 //       if (sizing_function.valid())
@@ -1,6 +1,10 @@
 #include "tetgen_mesh.hpp"
 #include "viennagrid/viennagrid.hpp"
 
+#include <map>
+#include <vector>
+#include <algorithm>
+
 namespace viennamesh
 {
   viennamesh_error convert(viennagrid_plc plc, tetgen::mesh & output)
@@ -122,66 +126,96 @@ namespace viennamesh
 
   viennamesh_error convert(viennagrid::mesh const & input, tetgen::mesh & output)
   {
-    typedef viennagrid::mesh ViennaGridMeshType;
+    viennagrid_mesh mesh = input.internal();
+    int geometric_dimension = viennagrid::geometric_dimension(input);
 
-    typedef viennagrid::result_of::const_element<ViennaGridMeshType>::type ConstVertexType;
-    typedef viennagrid::result_of::const_element<ViennaGridMeshType>::type ConstCellType;
+    if (geometric_dimension != 3)
+      return VIENNAMESH_ERROR_CONVERSION_FAILED;
 
-    typedef viennagrid::result_of::const_element_range<ViennaGridMeshType, 2>::type ConstCellRangeType;
-    typedef viennagrid::result_of::iterator<ConstCellRangeType>::type ConstCellIteratorType;
+    viennagrid_element_id * cells_begin;
+    viennagrid_element_id * cells_end;
+    viennagrid_mesh_elements_get(mesh, 2, &cells_begin, &cells_end);
+    viennagrid_int cell_count = cells_end - cells_begin;
 
-    std::map<ConstVertexType, int> vertex_handle_to_tetgen_index_map;
+    viennagrid_element_id * vertices_begin;
+    viennagrid_element_id * vertices_end;
+    viennagrid_mesh_elements_get(mesh, 0, &vertices_begin, &vertices_end);
 
-    output.firstnumber = 0;
-    output.numberofpoints = 0;
-    output.pointlist = new REAL[ viennagrid::vertices(input).size() * 3 ];
+    viennagrid_int max_vertex_index = -1;
+    for (viennagrid_element_id * vit = vertices_begin; vit != vertices_end; ++vit)
+      max_vertex_index = std::max(max_vertex_index, viennagrid_index_from_element_id(*vit));
+
+    // only vertices used by a facet become tetgen points, they are numbered in
+    // the order of their first use, vertex_indices is indexed by vertex index
+    std::vector<int> vertex_indices(max_vertex_index+1, -1);
+    std::vector<viennagrid_int> point_vertex_indices;
+    point_vertex_indices.reserve(vertices_end - vertices_begin);
+
+    for (viennagrid_int i = 0; i != cell_count; ++i)
+    {
+      viennagrid_element_id * lines_begin;
+      viennagrid_element_id * lines_end;
+      viennagrid_element_boundary_elements(mesh, cells_begin[i], 1, &lines_begin, &lines_end);
+
+      for (viennagrid_element_id * lit = lines_begin; lit != lines_end; ++lit)
+      {
+        viennagrid_element_id * line_vertices_begin;
+        viennagrid_element_id * line_vertices_end;
+        viennagrid_element_boundary_elements(mesh, *lit, 0, &line_vertices_begin, &line_vertices_end);
 
-    int index = 0;
+        for (viennagrid_element_id * vit = line_vertices_begin; vit != line_vertices_end; ++vit)
+        {
+          viennagrid_int vertex_index = viennagrid_index_from_element_id(*vit);
+          if (vertex_indices[vertex_index] < 0)
+          {
+            vertex_indices[vertex_index] = point_vertex_indices.size();
+            point_vertex_indices.push_back(vertex_index);
+          }
+        }
+      }
+    }
+
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
 
-    ConstCellRangeType cells(input);
+    output.firstnumber = 0;
+    output.numberofpoints = point_vertex_indices.size();
+    output.pointlist = new REAL[ output.numberofpoints * 3 ];
 
-    output.numberoffacets = cells.size();
+    #pragma omp parallel for
+    for (int i = 0; i < output.numberofpoints; ++i)
+      std::copy( coords + 3*point_vertex_indices[i], coords + 3*point_vertex_indices[i] + 3, output.pointlist + 3*i );
+
+    output.numberoffacets = cell_count;
     output.facetlist = new tetgenio::facet[output.numberoffacets];
 
-    index = 0;
-    for (ConstCellIteratorType cit = cells.begin(); cit != cells.end(); ++cit, ++index)
+    #pragma omp parallel for
+    for (viennagrid_int i = 0; i < cell_count; ++i)
     {
-      typedef viennagrid::result_of::const_element_range<ConstCellType, 1>::type ConstLineOnCellRange;
-      typedef viennagrid::result_of::iterator<ConstLineOnCellRange>::type ConstLineOnCellIterator;
-
-      tetgenio::facet & facet = output.facetlist[index];
+      tetgenio::facet & facet = output.facetlist[i];
       facet.holelist = 0;
+      facet.numberofholes = 0;
+
+      viennagrid_element_id * lines_begin;
+      viennagrid_element_id * lines_end;
+      viennagrid_element_boundary_elements(mesh, cells_begin[i], 1, &lines_begin, &lines_end);
 
-      ConstLineOnCellRange lines(*cit);
-      facet.numberofpolygons = lines.size();
-      facet.polygonlist = new tetgenio::polygon[ lines.size() ];
+      facet.numberofpolygons = lines_end - lines_begin;
+      facet.polygonlist = new tetgenio::polygon[ facet.numberofpolygons ];
 
       std::size_t polygon_index = 0;
-      for (ConstLineOnCellIterator lcit = lines.begin(); lcit != lines.end(); ++lcit, ++polygon_index)
+      for (viennagrid_element_id * lit = lines_begin; lit != lines_end; ++lit, ++polygon_index)
       {
         tetgenio::polygon & polygon = facet.polygonlist[polygon_index];
         polygon.numberofvertices = 2;
         polygon.vertexlist = new int[ 2 ];
 
-        for (int i = 0; i < 2; ++i)
-        {
-          std::map<ConstVertexType, int>::iterator vit = vertex_handle_to_tetgen_index_map.find( viennagrid::vertices(*lcit)[i] );
-          if (vit != vertex_handle_to_tetgen_index_map.end())
-          {
-            polygon.vertexlist[i] = vit->second;
-          }
-          else
-          {
-            output.pointlist[output.numberofpoints*3+0] = viennagrid::get_point(viennagrid::vertices(*lcit)[i])[0];
-            output.pointlist[output.numberofpoints*3+1] = viennagrid::get_point(viennagrid::vertices(*lcit)[i])[1];
-            output.pointlist[output.numberofpoints*3+2] = viennagrid::get_point(viennagrid::vertices(*lcit)[i])[2];
+        viennagrid_element_id * line_vertices_begin;
+        viennagrid_element_id * line_vertices_end;
+        viennagrid_element_boundary_elements(mesh, *lit, 0, &line_vertices_begin, &line_vertices_end);
 
-            polygon.vertexlist[i] = output.numberofpoints;
-            vertex_handle_to_tetgen_index_map[viennagrid::vertices(*lcit)[i]] = output.numberofpoints;
-
-            ++output.numberofpoints;
-          }
-        }
+        polygon.vertexlist[0] = vertex_indices[ viennagrid_index_from_element_id(line_vertices_begin[0]) ];
+        polygon.vertexlist[1] = vertex_indices[ viennagrid_index_from_element_id(line_vertices_begin[1]) ];
       }
     }
 
@@ -194,35 +228,49 @@ namespace viennamesh
   viennamesh_error convert(tetgen::mesh const & input, viennagrid::mesh & output)
   {
     typedef viennagrid::mesh                                    MeshType;
-    typedef viennagrid::result_of::element<MeshType>::type      VertexType;
-    typedef viennagrid::result_of::element<MeshType>::type      CellType;
-
-    std::vector<VertexType> vertices(input.numberofpoints);
+    typedef viennagrid::result_of::point<MeshType>::type        PointType;
 
+    std::vector<viennagrid_element_id> vertex_ids(input.numberofpoints);
     for (int i = 0; i < input.numberofpoints; ++i)
+      vertex_ids[i] = viennagrid::make_vertex( output, PointType(3, input.pointlist + 3*i) ).id().internal();
+
+    if (input.numberoftetrahedra == 0)
+      return VIENNAMESH_SUCCESS;
+
+    std::vector<viennagrid_element_type> element_types(input.numberoftetrahedra, VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON);
+    std::vector<viennagrid_int> cell_vertex_offsets(input.numberoftetrahedra+1);
+    std::vector<viennagrid_element_id> cell_vertex_ids(4*input.numberoftetrahedra);
+    std::vector<viennagrid_region_id> cell_region_ids;
+
+    #pragma omp parallel for
+    for (int i = 0; i < input.numberoftetrahedra; ++i)
     {
-      vertices[i] = viennagrid::make_vertex( output,
-        viennagrid::make_point(input.pointlist[3*i+0], input.pointlist[3*i+1], input.pointlist[3*i+2])
-      );
+      cell_vertex_offsets[i] = 4*i;
+      for (int j = 0; j != 4; ++j)
+        cell_vertex_ids[4*i+j] = vertex_ids[ input.tetrahedronlist[input.numberofcorners*i+j] ];
     }
+    cell_vertex_offsets[input.numberoftetrahedra] = 4*input.numberoftetrahedra;
 
-    for (int i = 0; i < input.numberoftetrahedra; ++i)
+    if (input.numberoftetrahedronattributes != 0)
     {
-      CellType cell = viennagrid::make_tetrahedron(
-        output,
-        vertices[ input.tetrahedronlist[4*i+0] ],
-        vertices[ input.tetrahedronlist[4*i+1] ],
-        vertices[ input.tetrahedronlist[4*i+2] ],
-        vertices[ input.tetrahedronlist[4*i+3] ]
-      );
-
-      if (input.numberoftetrahedronattributes != 0)
+      // regions have to exist before they are referenced in the batch
+      cell_region_ids.resize(input.numberoftetrahedra);
+      std::map<int, viennagrid_region_id> region_ids;
+      for (int i = 0; i < input.numberoftetrahedra; ++i)
       {
-        int region_id = input.tetrahedronattributelist[i] + 0.5;
-        viennagrid::add(output.get_or_create_region(region_id), cell);
+        int region_id = input.tetrahedronattributelist[i*input.numberoftetrahedronattributes] + 0.5;
+        std::map<int, viennagrid_region_id>::iterator it = region_ids.find(region_id);
+        if (it == region_ids.end())
+          it = region_ids.insert( std::make_pair(region_id, output.get_or_create_region(region_id).id()) ).first;
+        cell_region_ids[i] = it->second;
       }
     }
 
+    viennagrid_mesh_element_batch_create( output.internal(),
+                                          input.numberoftetrahedra, &element_types[0],
+                                          &cell_vertex_offsets[0], &cell_vertex_ids[0],
+                                          cell_region_ids.empty() ? NULL : &cell_region_ids[0], NULL );
+
     return VIENNAMESH_SUCCESS;
   }
 
@@ -1,12 +1,31 @@
 #include "triangle_interface.h"
 #include <stdlib.h>
 
-int (*should_triangle_be_refined)(REAL * triorg, REAL * tridest, REAL * triapex, REAL area) = 0;
+#if defined(_MSC_VER)
+  #define TRIANGLE_THREAD_LOCAL __declspec(thread)
+#else
+  #define TRIANGLE_THREAD_LOCAL __thread
+#endif
+
+static TRIANGLE_THREAD_LOCAL triangle_refinement_function refinement_function = 0;
+static TRIANGLE_THREAD_LOCAL void * refinement_user_data = 0;
+
+void triangle_set_refinement_function(triangle_refinement_function function, void * user_data)
+{
+  refinement_function = function;
+  refinement_user_data = user_data;
+}
+
+void triangle_get_refinement_function(triangle_refinement_function * function, void ** user_data)
+{
+  *function = refinement_function;
+  *user_data = refinement_user_data;
+}
 
 int triunsuitable(REAL * triorg, REAL * tridest, REAL * triapex, REAL area)
 {
-  if (should_triangle_be_refined)
-    return should_triangle_be_refined(triorg, tridest, triapex, area);
+  if (refinement_function)
+    return refinement_function(refinement_user_data, triorg, tridest, triapex, area);
   else
     return 0;
 }
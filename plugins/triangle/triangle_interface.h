@@ -12,7 +12,14 @@
 #include "external/triangle.h"
 #include "viennamesh/viennamesh.h"
 
-extern int (*should_triangle_be_refined)(REAL * triorg, REAL * tridest, REAL * triapex, REAL area);
+/* refinement callback used by triangulate() with the -u switch, user_data is passed through */
+typedef int (*triangle_refinement_function)(void * user_data, REAL * triorg, REAL * tridest, REAL * triapex, REAL area);
+
+/* sets the refinement callback for the triangulate() calls of the calling thread only,
+   meshing jobs on different threads do not interfere */
+void triangle_set_refinement_function(triangle_refinement_function function, void * user_data);
+/* returns the refinement callback of the calling thread */
+void triangle_get_refinement_function(triangle_refinement_function * function, void ** user_data);
 
 typedef struct triangulateio * triangle_mesh;
 viennamesh_error triangle_make_mesh(triangle_mesh * mesh);
@@ -22,9 +22,11 @@ namespace viennamesh
   namespace triangle
   {
 
-    double max_length = 0.0;
-    int should_hull_triangle_be_refined_function(double * triorg, double * tridest, double * triapex, double)
+    // user_data is the maximum edge length of the running make_hull invocation
+    int should_hull_triangle_be_refined_function(void * user_data, double * triorg, double * tridest, double * triapex, double)
     {
+      double max_length = *static_cast<double const *>(user_data);
+
       REAL dxoa, dxda, dxod;
       REAL dyoa, dyda, dyod;
       REAL oalen, dalen, odlen;
@@ -289,6 +291,7 @@ namespace viennamesh
 
 
       triangle::mesh_3d triangle_3d_input_mesh;
+      double max_length = 0.0;
 
       if (cell_size.valid())
       {
@@ -307,7 +310,6 @@ namespace viennamesh
         info(1) << "using cell size " << cell_size() << std::endl;
 
         options << "u";
-        should_triangle_be_refined = should_hull_triangle_be_refined_function;
       }
       else
         convert( input_plc() , triangle_3d_input_mesh );
@@ -378,6 +380,7 @@ namespace viennamesh
 
         {
           StdCaptureHandle capture_handle;
+          refinement_function_scope refinement_scope( cell_size.valid() ? should_hull_triangle_be_refined_function : NULL, &max_length );
           triangulate( buffer, &cur_tmp, &triangle_3d_output_mesh.cells[i].plc, NULL);
         }
 
@@ -22,10 +22,12 @@ namespace viennamesh
 {
   namespace triangle
   {
-    sizing_function::base_functor::function_type triangle_sizing_function;
-
-    int should_triangle_be_refined_function(double * triorg, double * tridest, double * triapex, double)
+    // user_data is the sizing function of the running make_mesh invocation
+    int should_triangle_be_refined_function(void * user_data, double * triorg, double * tridest, double * triapex, double)
     {
+      sizing_function::base_functor::function_type const & triangle_sizing_function =
+          *static_cast<sizing_function::base_functor::function_type const *>(user_data);
+
       REAL dxoa, dxda, dxod;
       REAL dyoa, dyda, dyod;
       REAL oalen, dalen, odlen;
@@ -92,7 +94,8 @@ namespace viennamesh
                         triangle_mesh & output,
                         point_container const & hole_points,
                         seed_point_container const & seed_points,
-                        std::string options)
+                        std::string options,
+                        sizing_function::base_functor::function_type const * triangle_sizing_function = NULL)
     {
       triangulateio tmp = *input;
 
@@ -141,6 +144,8 @@ namespace viennamesh
 
       {
         StdCaptureHandle capture_handle;
+        refinement_function_scope refinement_scope( triangle_sizing_function ? should_triangle_be_refined_function : NULL,
+                                                    const_cast<sizing_function::base_functor::function_type *>(triangle_sizing_function) );
         triangulate( options_buffer, &tmp, output, NULL);
       }
 
@@ -321,6 +326,8 @@ namespace viennamesh
 
 
 
+      sizing_function::base_functor::function_type triangle_sizing_function;
+
       data_handle<viennamesh_string> sizing_function = get_input<viennamesh_string>("sizing_function");
       if (sizing_function.valid())
       {
@@ -330,7 +337,6 @@ namespace viennamesh
                                     input_mesh(), hole_points, seed_points,
                                     sizing_function(), base_path());
         options << "u";
-        should_triangle_be_refined = should_triangle_be_refined_function;
       }
 
 
@@ -338,7 +344,8 @@ namespace viennamesh
 
 
       data_handle<triangle_mesh> output_mesh = make_data<triangle_mesh>();
-      make_mesh_impl( input_mesh(), const_cast<triangle_mesh&>(output_mesh()), hole_points, seed_points, options.str() );
+      make_mesh_impl( input_mesh(), const_cast<triangle_mesh&>(output_mesh()), hole_points, seed_points, options.str(),
+                      sizing_function.valid() ? &triangle_sizing_function : NULL );
       set_output("mesh", output_mesh);
 
       return true;
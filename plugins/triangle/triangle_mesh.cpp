@@ -1,6 +1,10 @@
 #include "triangle_mesh.hpp"
 #include "viennagrid/viennagrid.hpp"
 
+#include <map>
+#include <vector>
+#include <algorithm>
+
 
 
 namespace viennamesh
@@ -36,59 +40,95 @@ namespace viennamesh
 
 
 
-  viennamesh_error convert(viennagrid::mesh const & input, triangulateio & output)
+  namespace triangle
   {
-    typedef viennagrid::mesh                                              MeshType;
-    typedef viennagrid::result_of::const_element<MeshType>::type          ConstVertexType;
+    // Maps the vertex ids of a mesh to consecutive indices. vertex_indices is
+    // indexed by the element index of a vertex id, the coordinate array of the
+    // mesh uses the same index. Returns the number of vertices.
+    viennagrid_int make_vertex_indices(viennagrid_mesh mesh, std::vector<viennagrid_int> & vertex_indices,
+                                       std::vector<viennagrid_int> & vertex_element_indices)
+    {
+      viennagrid_element_id * vertices_begin;
+      viennagrid_element_id * vertices_end;
+      viennagrid_mesh_elements_get(mesh, 0, &vertices_begin, &vertices_end);
+      viennagrid_int vertex_count = vertices_end - vertices_begin;
 
-    typedef viennagrid::result_of::const_vertex_range<MeshType>::type     ConstVertexRangeType;
-    typedef viennagrid::result_of::iterator<ConstVertexRangeType>::type   ConstVertexIteratorType;
+      viennagrid_int max_index = -1;
+      for (viennagrid_element_id * vit = vertices_begin; vit != vertices_end; ++vit)
+        max_index = std::max(max_index, viennagrid_index_from_element_id(*vit));
 
-    typedef viennagrid::result_of::const_element_range<MeshType,1>::type  ConstLineRangeType;
-    typedef viennagrid::result_of::iterator<ConstLineRangeType>::type     ConstCellIteratorType;
+      vertex_indices.assign(max_index+1, -1);
+      vertex_element_indices.resize(vertex_count);
 
-    //MY IMPL
-    typedef viennagrid::result_of::const_element_range<MeshType,2>::type  ConstTriangleRangeType;
-    typedef viennagrid::result_of::iterator<ConstTriangleRangeType>::type ConstTriangleIteratorType;
-    //END OF MY IMPL
+      for (viennagrid_int i = 0; i != vertex_count; ++i)
+      {
+        vertex_element_indices[i] = viennagrid_index_from_element_id(vertices_begin[i]);
+        vertex_indices[ vertex_element_indices[i] ] = i;
+      }
 
-    std::map<ConstVertexType, int> vertex_handle_to_tetgen_index_map;
+      return vertex_count;
+    }
 
-    ConstVertexRangeType vertices(input);
-    viennamesh::triangle::init_points( output, vertices.size() );
+    viennagrid_int element_count(viennagrid_mesh mesh, viennagrid_dimension dimension)
+    {
+      viennagrid_element_id * elements_begin;
+      viennagrid_element_id * elements_end;
+      viennagrid_mesh_elements_get(mesh, dimension, &elements_begin, &elements_end);
+      return elements_end - elements_begin;
+    }
 
-    int index = 0;
-    for (ConstVertexIteratorType vit = vertices.begin(); vit != vertices.end(); ++vit, ++index)
+    // Fills list with the vertex indices of all elements of the given dimension
+    // (vertices_per_element per element), list has to be allocated for all
+    // elements, e.g. by init_segments or init_triangles
+    void make_element_list(viennagrid_mesh mesh, viennagrid_dimension dimension, int vertices_per_element,
+                           std::vector<viennagrid_int> const & vertex_indices, int * list)
     {
-      output.pointlist[index*2+0] = viennagrid::get_point(input, *vit)[0];
-      output.pointlist[index*2+1] = viennagrid::get_point(input, *vit)[1];
+      viennagrid_element_id * elements_begin;
+      viennagrid_element_id * elements_end;
+      viennagrid_mesh_elements_get(mesh, dimension, &elements_begin, &elements_end);
+      viennagrid_int element_count = elements_end - elements_begin;
+
+      #pragma omp parallel for
+      for (viennagrid_int i = 0; i < element_count; ++i)
+      {
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, elements_begin[i], 0, &vertices_begin, &vertices_end);
 
-      vertex_handle_to_tetgen_index_map[ *vit ] = index;
+        for (int j = 0; j != vertices_per_element; ++j)
+          list[vertices_per_element*i+j] = vertex_indices[ viennagrid_index_from_element_id(vertices_begin[j]) ];
+      }
     }
+  }
 
 
-    ConstLineRangeType lines(input);
-    viennamesh::triangle::init_segments( output, lines.size() );
+  viennamesh_error convert(viennagrid::mesh const & input, triangulateio & output)
+  {
+    viennagrid_mesh mesh = input.internal();
+    int geometric_dimension = viennagrid::geometric_dimension(input);
 
-    index = 0;
-    for (ConstCellIteratorType lit = lines.begin(); lit != lines.end(); ++lit, ++index)
-    {
-      output.segmentlist[2*index+0] = vertex_handle_to_tetgen_index_map[ viennagrid::vertices(*lit)[0] ];
-      output.segmentlist[2*index+1] = vertex_handle_to_tetgen_index_map[ viennagrid::vertices(*lit)[1] ];
-    }
+    std::vector<viennagrid_int> vertex_indices;
+    std::vector<viennagrid_int> vertex_element_indices;
+    viennagrid_int vertex_count = viennamesh::triangle::make_vertex_indices(mesh, vertex_indices, vertex_element_indices);
 
-    //MY IMPL
-    ConstTriangleRangeType triangles(input);
-    viennamesh::triangle::init_triangles( output, triangles.size() );
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
 
-    index = 0;
-    for (ConstTriangleIteratorType tit = triangles.begin(); tit != triangles.end(); ++tit, ++index)
+    viennamesh::triangle::init_points( output, vertex_count );
+
+    #pragma omp parallel for
+    for (viennagrid_int i = 0; i < vertex_count; ++i)
     {
-      output.trianglelist[3*index+0] = vertex_handle_to_tetgen_index_map[ viennagrid::vertices(*tit)[0] ];
-      output.trianglelist[3*index+1] = vertex_handle_to_tetgen_index_map[ viennagrid::vertices(*tit)[1] ];
-      output.trianglelist[3*index+2] = vertex_handle_to_tetgen_index_map[ viennagrid::vertices(*tit)[2] ];
+      viennagrid_numeric const * point = coords + geometric_dimension*vertex_element_indices[i];
+      output.pointlist[i*2+0] = point[0];
+      output.pointlist[i*2+1] = point[1];
     }
-    //END OF MYIMPL
+
+    viennamesh::triangle::init_segments( output, viennamesh::triangle::element_count(mesh, 1) );
+    viennamesh::triangle::make_element_list(mesh, 1, 2, vertex_indices, output.segmentlist);
+
+    viennamesh::triangle::init_triangles( output, viennamesh::triangle::element_count(mesh, 2) );
+    viennamesh::triangle::make_element_list(mesh, 2, 3, vertex_indices, output.trianglelist);
 
     return VIENNAMESH_SUCCESS;
   }
@@ -97,35 +137,49 @@ namespace viennamesh
   viennamesh_error convert(triangulateio const & input, viennagrid::mesh & output)
   {
     typedef viennagrid::mesh                                    MeshType;
+    typedef viennagrid::result_of::point<MeshType>::type        PointType;
+
+    std::vector<viennagrid_element_id> vertex_ids(input.numberofpoints);
+    for (int i = 0; i < input.numberofpoints; ++i)
+      vertex_ids[i] = viennagrid::make_vertex( output, PointType(2, input.pointlist + 2*i) ).id().internal();
 
-    typedef viennagrid::result_of::element<MeshType>::type      VertexType;
-    typedef viennagrid::result_of::element<MeshType>::type      CellType;
+    if (input.numberoftriangles == 0)
+      return VIENNAMESH_SUCCESS;
 
-    std::vector<VertexType> vertex_handles(input.numberofpoints);
+    std::vector<viennagrid_element_type> element_types(input.numberoftriangles, VIENNAGRID_ELEMENT_TYPE_TRIANGLE);
+    std::vector<viennagrid_int> cell_vertex_offsets(input.numberoftriangles+1);
+    std::vector<viennagrid_element_id> cell_vertex_ids(3*input.numberoftriangles);
+    std::vector<viennagrid_region_id> cell_region_ids;
 
-    for (int i = 0; i < input.numberofpoints; ++i)
+    #pragma omp parallel for
+    for (int i = 0; i < input.numberoftriangles; ++i)
     {
-      vertex_handles[i] = viennagrid::make_vertex( output,
-        viennagrid::make_point(input.pointlist[2*i+0], input.pointlist[2*i+1])
-      );
+      cell_vertex_offsets[i] = 3*i;
+      for (int j = 0; j != 3; ++j)
+        cell_vertex_ids[3*i+j] = vertex_ids[ input.trianglelist[3*i+j] ];
     }
+    cell_vertex_offsets[input.numberoftriangles] = 3*input.numberoftriangles;
 
-    for (int i = 0; i < input.numberoftriangles; ++i)
+    if (input.numberoftriangleattributes != 0)
     {
-      CellType cell = viennagrid::make_triangle(
-        output,
-        vertex_handles[ input.trianglelist[3*i+0] ],
-        vertex_handles[ input.trianglelist[3*i+1] ],
-        vertex_handles[ input.trianglelist[3*i+2] ]
-      );
-
-      if (input.numberoftriangleattributes != 0)
+      // regions have to exist before they are referenced in the batch
+      cell_region_ids.resize(input.numberoftriangles);
+      std::map<int, viennagrid_region_id> region_ids;
+      for (int i = 0; i < input.numberoftriangles; ++i)
       {
         int segment_id = input.triangleattributelist[i];
-        viennagrid::add(output.get_or_create_region(segment_id), cell);
+        std::map<int, viennagrid_region_id>::iterator it = region_ids.find(segment_id);
+        if (it == region_ids.end())
+          it = region_ids.insert( std::make_pair(segment_id, output.get_or_create_region(segment_id).id()) ).first;
+        cell_region_ids[i] = it->second;
       }
     }
 
+    viennagrid_mesh_element_batch_create( output.internal(),
+                                          input.numberoftriangles, &element_types[0],
+                                          &cell_vertex_offsets[0], &cell_vertex_ids[0],
+                                          cell_region_ids.empty() ? NULL : &cell_region_ids[0], NULL );
+
     return VIENNAMESH_SUCCESS;
   }
 
@@ -33,6 +33,27 @@ namespace viennamesh
     void init_points(triangulateio & mesh, int num_points);
     void init_segments(triangulateio & mesh, int num_segments);
     void init_triangles(triangulateio & mesh, int num_triangles);
+
+    // Installs a refinement callback for the triangulate() calls of the
+    // current thread while in scope, the previous callback is restored
+    // afterwards so that scopes can be nested
+    class refinement_function_scope
+    {
+    public:
+      refinement_function_scope(triangle_refinement_function function, void * user_data)
+      {
+        triangle_get_refinement_function(&old_function, &old_user_data);
+        triangle_set_refinement_function(function, user_data);
+      }
+      ~refinement_function_scope() { triangle_set_refinement_function(old_function, old_user_data); }
+
+    private:
+      refinement_function_scope(refinement_function_scope const &);
+      refinement_function_scope & operator=(refinement_function_scope const &);
+
+      triangle_refinement_function old_function;
+      void * old_user_data;
+    };
   }
 
 
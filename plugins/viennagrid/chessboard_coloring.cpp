@@ -13,6 +13,7 @@
 =============================================================================== */
 
 #include "chessboard_coloring.hpp"
+#include "triangle_adjacency.hpp"
 
 namespace viennamesh
 {
@@ -66,11 +67,6 @@ namespace viennamesh
         viennagrid_element_id * triangle_ids_end;
         viennagrid_dimension topological_dimension = viennagrid::cell_dimension( input_mesh() );	
 
-        viennagrid_element_id * neighbor_begin;
-        viennagrid_element_id * neighbor_end;
-
-        viennagrid_dimension connector = 1;
-
         viennagrid_mesh_elements_get(input_mesh().internal(), topological_dimension, &triangle_ids_begin, &triangle_ids_end);	
 
         viennagrid::quantity_field color_field(2,1);
@@ -79,6 +75,14 @@ namespace viennamesh
 
         //viennagrid_quantity_field_init(color_field, 2, VIENNAGRID_QUANTITY_FIELD_TYPE_NUMERIC, 1 , VIENNAGRID_QUANTITY_FIELD_STORAGE_DENSE);
 
+        //vertex neighbors of all triangles are taken from an adjacency built once instead of
+        //querying the mesh for the neighbors of neighbors of every triangle
+        triangle_adjacency adjacency( input_mesh().internal() );
+        adjacency.build_vertex_triangles();
+
+        std::vector<triangle_adjacency::index_type> neighbors;
+        std::vector<triangle_adjacency::index_type> n_neighbors;
+
         //get triangles from mesh
 
         for (viennagrid_element_id *tri = triangle_ids_begin; tri != triangle_ids_end; ++tri)
@@ -97,22 +101,16 @@ namespace viennamesh
 
                 color_field.set(*tri, clr);
 
-                viennagrid_element_neighbor_elements(input_mesh().internal(), *tri, 0, 2, &neighbor_begin, &neighbor_end);
+                adjacency.vertex_neighbors( adjacency.triangle_index(*tri), neighbors );
 
-                for (viennagrid_element_id *n_tri = neighbor_begin; n_tri != neighbor_end; ++n_tri)
+                for (std::size_t n = 0; n != neighbors.size(); ++n)
                 {
-                    int n_tri_index = viennagrid_index_from_element_id( *n_tri );
-
-                    //std::cout << "  " << n_tri_index << std::endl;
-
-                    viennagrid_element_id * n_neighbor_begin;
-                    viennagrid_element_id * n_neighbor_end;
-
-                    viennagrid_element_neighbor_elements(input_mesh().internal(), *n_tri, 0, 2, &n_neighbor_begin, &n_neighbor_end);
+                    adjacency.vertex_neighbors( neighbors[n], n_neighbors );
 
-                    for (viennagrid_element_id *n_n_tri = n_neighbor_begin; n_n_tri != n_neighbor_end; ++n_n_tri)
+                    for (std::size_t nn = 0; nn != n_neighbors.size(); ++nn)
                     {
-                        int n_n_tri_index = viennagrid_index_from_element_id( *n_n_tri );
+                        viennagrid_element_id n_n_tri = adjacency.triangle_id( n_neighbors[nn] );
+                        int n_n_tri_index = viennagrid_index_from_element_id( n_n_tri );
 
                         if ( !touched[n_n_tri_index])
                         { 
@@ -120,7 +118,7 @@ namespace viennamesh
                             touched[n_n_tri_index] = true;
 
                             clr = 0;
-                            color_field.set(*n_n_tri, clr);
+                            color_field.set(n_n_tri, clr);
                         }
                     }
                 }
@@ -13,8 +13,10 @@
 =============================================================================== */
 
 #include "extract_plc_geometry.hpp"
+#include "triangle_adjacency.hpp"
 
 #include <set>
+#include <cmath>
 #include "viennagrid/algorithm/extract_hole_points.hpp"
 #include "viennagrid/algorithm/plane_to_2d_projector.hpp"
 #include "viennagrid/algorithm/geometry.hpp"
@@ -22,276 +24,231 @@
 namespace viennamesh
 {
 
-  class same_segments_functor
-  {
-  public:
-    same_segments_functor() {}
-
-    template<typename CellT1, typename CellT2>
-    bool operator()(CellT1 const & lhs, CellT2 const & rhs) const
-    {
-      return viennagrid::equal_regions( viennagrid::regions(lhs), viennagrid::regions(rhs) );
-    }
-  };
-
-  template<typename NumericConfigT>
-  class same_orientation_functor
+  // Groups the triangles of a hull into PLC facets and creates the facets
+  // in a PLC. Triangles sharing an edge are in the same facet if they belong
+  // to the same regions and are coplanar within the tolerance; facets are
+  // labelled with the shared triangle adjacency and a union-find. Boundary
+  // lines and hole points of the facets are independent of each other and
+  // are extracted in parallel.
+  template<bool mesh_is_const>
+  void extract_plcs(viennagrid::base_mesh<mesh_is_const> const & mesh,
+                    viennagrid_plc plc,
+                    double coplanar_tolerance)
   {
-  public:
-    same_orientation_functor(NumericConfigT nc_) : nc(nc_) {}
-
-    template<typename CellT1, typename CellT2>
-    bool operator()(CellT1 const & lhs, CellT2 const & rhs) const
-    {
-      typedef typename viennagrid::result_of::point<CellT1>::type PointType;
-
-      PointType lhs_normal = viennagrid::normal_vector(lhs);
-      lhs_normal /= viennagrid::norm_2(lhs_normal);
+    typedef triangle_adjacency::index_type index_type;
 
-      PointType rhs_normal = viennagrid::normal_vector(rhs);
-      rhs_normal /= viennagrid::norm_2(rhs_normal);
+    typedef viennagrid::base_mesh<mesh_is_const>                                MeshType;
+    typedef typename viennagrid::result_of::element<MeshType>::type             ElementType;
+    typedef typename viennagrid::result_of::point<MeshType>::type               PointType;
+    typedef typename viennagrid::result_of::region_range<ElementType>::type     RegionRangeType;
+    typedef typename viennagrid::result_of::iterator<RegionRangeType>::type     RegionRangeIterator;
 
-      return std::abs(viennagrid::inner_prod(lhs_normal, rhs_normal)) >=
-             1.0-viennagrid::detail::absolute_tolerance<double>(nc);
-    }
+    viennagrid_plc_geometric_dimension_set(plc, 3);
 
-  private:
-    NumericConfigT nc;
-  };
+    triangle_adjacency adjacency( mesh.internal() );
+    index_type triangle_count = adjacency.triangle_count();
 
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh.internal(), &coords);
 
-  template<typename Functor1T, typename Functor2T>
-  class same_cell_combine_functor
-  {
-  public:
-    same_cell_combine_functor(Functor1T const & f1_, Functor2T const & f2_) : f1(f1_), f2(f2_) {}
 
-    template<typename CellT1, typename CellT2>
-    bool operator()(CellT1 const & lhs, CellT2 const & rhs) const
+    // regions of all triangles, sorted for comparison
+    std::vector<index_type> region_offsets(triangle_count+1, 0);
+    std::vector<viennagrid_region_id> regions;
+    for (index_type t = 0; t != triangle_count; ++t)
     {
-      return f1(lhs, rhs) && f2(lhs, rhs);
+      RegionRangeType triangle_regions( ElementType(mesh, adjacency.triangle_id(t)) );
+      for (RegionRangeIterator rit = triangle_regions.begin(); rit != triangle_regions.end(); ++rit)
+        regions.push_back( (*rit).id() );
+      std::sort( regions.begin() + region_offsets[t], regions.end() );
+      region_offsets[t+1] = regions.size();
     }
 
-  private:
-    Functor1T f1;
-    Functor2T f2;
-  };
-
-
+    std::vector<viennagrid_numeric> normals(3*triangle_count);
 
+    #pragma omp parallel for
+    for (index_type t = 0; t < triangle_count; ++t)
+    {
+      index_type const * v = adjacency.triangle_vertices(t);
+      viennagrid_numeric a[3], b[3];
+      for (int k = 0; k != 3; ++k)
+      {
+        a[k] = coords[3*v[1]+k] - coords[3*v[0]+k];
+        b[k] = coords[3*v[2]+k] - coords[3*v[0]+k];
+      }
 
+      viennagrid_numeric * n = &normals[3*t];
+      n[0] = a[1]*b[2]-a[2]*b[1];
+      n[1] = a[2]*b[0]-a[0]*b[2];
+      n[2] = a[0]*b[1]-a[1]*b[0];
 
-  template<typename MeshT, typename CellT, typename SamePLCCellFunctorT,
-           typename VisitedAccessorT, typename PLCIDAccessorT>
-  void recursively_add_neighbours( MeshT const & mesh,
-                                   CellT const & cell,
-                                   SamePLCCellFunctorT same_cell_functor,
-                                   VisitedAccessorT & visited_accessor,
-                                   PLCIDAccessorT & plc_id_accessor,
-                                   int plc_id)
-  {
-    typedef typename viennagrid::result_of::point<MeshT>::type PointType;
-
-    if ( visited_accessor.get(cell) )
-      return;
-
-    visited_accessor.set(cell, true);
-    plc_id_accessor.set(cell, plc_id);
+      viennagrid_numeric length = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      for (int k = 0; k != 3; ++k)
+        n[k] /= length;
+    }
 
-    PointType normal_vector = viennagrid::normal_vector( cell );
-    normal_vector /= viennagrid::norm_2(normal_vector);
 
-    typedef typename viennagrid::result_of::const_neighbor_range<MeshT>::type NeighbourRangeType;
-    typedef typename viennagrid::result_of::iterator<NeighbourRangeType>::type NeighbourRangeIterator;
+    // label the facets, facets are numbered in the order of their first
+    // triangle
+    concurrent_union_find facet_sets(triangle_count);
 
-    NeighbourRangeType neighbors(mesh, cell, 1, viennagrid::topologic_dimension(mesh));
-    for (NeighbourRangeIterator it = neighbors.begin(); it != neighbors.end(); ++it)
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (index_type e = 0; e < adjacency.edge_count(); ++e)
     {
-      if ( visited_accessor.get(*it) )
-        continue;
-
-      if ( same_cell_functor(cell, *it) )
-        recursively_add_neighbours( mesh, *it, same_cell_functor, visited_accessor, plc_id_accessor, plc_id );
+      index_type count = adjacency.edge_triangle_count(e);
+      for (index_type i = 0; i != count; ++i)
+        for (index_type j = i+1; j != count; ++j)
+        {
+          index_type t0 = adjacency.edge_triangle(e, i);
+          index_type t1 = adjacency.edge_triangle(e, j);
+
+          if ( region_offsets[t0+1]-region_offsets[t0] != region_offsets[t1+1]-region_offsets[t1] ||
+               !std::equal(regions.begin()+region_offsets[t0], regions.begin()+region_offsets[t0+1],
+                           regions.begin()+region_offsets[t1]) )
+            continue;
+
+          viennagrid_numeric const * n0 = &normals[3*t0];
+          viennagrid_numeric const * n1 = &normals[3*t1];
+          if ( std::abs(n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2]) >= 1.0-coplanar_tolerance )
+            facet_sets.unite(t0, t1);
+        }
     }
-  }
-
-
-
 
-  template<bool mesh_is_const, typename SamePLCFunctorT>
-  void extract_plcs(viennagrid::base_mesh<mesh_is_const> const & mesh,
-                    viennagrid_plc plc,
-                    SamePLCFunctorT same_plc_functor)
-  {
-    viennagrid_plc_geometric_dimension_set(plc, 3);
-
-    typedef viennagrid::base_mesh<mesh_is_const> MeshType;
+    std::vector<index_type> facets;
+    index_type facet_count = facet_sets.labels(facets);
 
-    typedef typename viennagrid::result_of::element<MeshType>::type ElementType;
 
-    typedef typename viennagrid::result_of::const_cell_range<MeshType>::type ConstCellRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstCellRangeType>::type ConstCellIteratorType;
-    typedef typename viennagrid::result_of::point<MeshType>::type PointType;
+    // triangles of each facet in CSR layout
+    std::vector<index_type> facet_triangle_offsets(facet_count+1, 0);
+    for (index_type t = 0; t != triangle_count; ++t)
+      ++facet_triangle_offsets[facets[t]+1];
+    for (index_type f = 0; f != facet_count; ++f)
+      facet_triangle_offsets[f+1] += facet_triangle_offsets[f];
 
-    typedef typename viennagrid::result_of::const_element_range<MeshType, 1>::type ConstLineRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstLineRangeType>::type ConstLineIteratorType;
-
-    ConstCellRangeType cells(mesh);
-
-    std::vector<bool> cell_visited_container( cells.size(), false );
-    typename viennagrid::result_of::accessor< std::vector<bool>, ElementType >::type cell_visited(cell_visited_container);
-
-    std::vector<int> plc_id_container( cells.size(), -1 );
-    typename viennagrid::result_of::accessor< std::vector<int>, ElementType >::type plc_ids(plc_id_container);
-    int lowest_plc_id = 0;
-
-    for (ConstCellIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
+    std::vector<index_type> facet_triangles(triangle_count);
     {
-      if ( cell_visited.get(*cit) )
-        continue;
-
-      recursively_add_neighbours( mesh, *cit, same_plc_functor, cell_visited, plc_ids, lowest_plc_id++ );
+      std::vector<index_type> fill( facet_triangle_offsets.begin(), facet_triangle_offsets.end()-1 );
+      for (index_type t = 0; t != triangle_count; ++t)
+        facet_triangles[ fill[facets[t]]++ ] = t;
     }
 
-    std::map<ElementType, viennagrid_int> vertex_map;
-
-    for (int i = 0; i < lowest_plc_id; ++i)
+    // PLC lines of each facet: all edges of the facet except the inner
+    // edges with exactly two triangles, both in the facet. Edges are ordered
+    // by their vertices, so are the lines of each facet.
+    std::vector< std::vector<index_type> > facet_lines(facet_count);
+    for (index_type e = 0; e != adjacency.edge_count(); ++e)
     {
-      std::vector<point> hole_points_3d;
+      index_type count = adjacency.edge_triangle_count(e);
+      for (index_type i = 0; i != count; ++i)
       {
-        // extract PLC hole points
-        typedef typename viennagrid::result_of::element_id<MeshType>::type VertexIDType;
-        std::map<VertexIDType, int> vertex_to_point_index;
-        std::vector<point> plc_points_3d;
-
-        for (ConstCellIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
-        {
-          if (plc_ids.get(*cit) == i)
-          {
-            typedef typename viennagrid::result_of::const_vertex_range<ElementType>::type VertexOnCellRangeType;
-            typedef typename viennagrid::result_of::iterator<VertexOnCellRangeType>::type VertexOnCellIteratorType;
-            VertexOnCellRangeType vertices_on_cells(*cit);
-            for (VertexOnCellIteratorType vcit = vertices_on_cells.begin(); vcit != vertices_on_cells.end(); ++vcit)
-            {
-              typename std::map<VertexIDType, int>::iterator it = vertex_to_point_index.find( (*vcit).id() );
-              if (it == vertex_to_point_index.end())
-              {
-                plc_points_3d.push_back( viennagrid::get_point(*vcit) );
-                vertex_to_point_index[(*vcit).id()] = plc_points_3d.size()-1;
-              }
-            }
-          }
-        }
-
-        std::vector<point> plc_points_2d( plc_points_3d.size() );
-        viennagrid::plane_to_2d_projector<PointType> projection_functor;
-        projection_functor.init( plc_points_3d.begin(), plc_points_3d.end(), 1e-6 );
-        projection_functor.project( plc_points_3d.begin(), plc_points_3d.end(), plc_points_2d.begin() );
-
+        index_type facet = facets[ adjacency.edge_triangle(e, i) ];
+
+        // every facet is handled once, at its first triangle on the edge
+        bool first = true;
+        for (index_type j = 0; j != i; ++j)
+          if (facets[adjacency.edge_triangle(e, j)] == facet)
+            first = false;
+        if (!first)
+          continue;
 
+        if (count == 2 && facets[adjacency.edge_triangle(e, 1-i)] == facet)
+          continue;
 
-        typedef viennagrid::mesh Triangular2DMeshType;
-        typedef viennagrid::result_of::element<Triangular2DMeshType>::type Vertex2DType;
+        facet_lines[facet].push_back(e);
+      }
+    }
 
-        Triangular2DMeshType mesh2d;
-        std::vector<Vertex2DType> vertex_handles_2d(plc_points_2d.size());
-        for (std::size_t j = 0; j < plc_points_2d.size(); ++j)
-          vertex_handles_2d[j] = viennagrid::make_vertex(mesh2d, plc_points_2d[j]);
 
-        for (ConstCellIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
-        {
-          if (plc_ids.get(*cit) == i)
-          {
-            viennagrid::make_triangle(
-              mesh2d,
-              vertex_handles_2d[ vertex_to_point_index[viennagrid::vertices(*cit)[0].id()] ],
-              vertex_handles_2d[ vertex_to_point_index[viennagrid::vertices(*cit)[1].id()] ],
-              vertex_handles_2d[ vertex_to_point_index[viennagrid::vertices(*cit)[2].id()] ]
-            );
-          }
-        }
+    // hole points of each facet, the facet is projected to 2D and the
+    // holes of its triangulation are extracted
+    std::vector< std::vector<point> > facet_hole_points(facet_count);
 
-        std::vector<point> hole_points_2d;
-        viennagrid::extract_hole_points( mesh2d, hole_points_2d );
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (index_type f = 0; f < facet_count; ++f)
+    {
+      std::vector<index_type> facet_vertices;
+      for (index_type i = facet_triangle_offsets[f]; i != facet_triangle_offsets[f+1]; ++i)
+      {
+        index_type const * v = adjacency.triangle_vertices( facet_triangles[i] );
+        facet_vertices.insert( facet_vertices.end(), v, v+3 );
+      }
+      std::sort( facet_vertices.begin(), facet_vertices.end() );
+      facet_vertices.erase( std::unique(facet_vertices.begin(), facet_vertices.end()), facet_vertices.end() );
 
+      std::vector<point> plc_points_3d( facet_vertices.size() );
+      for (std::size_t j = 0; j != facet_vertices.size(); ++j)
+        plc_points_3d[j] = PointType(3, coords + 3*facet_vertices[j]);
 
+      std::vector<point> plc_points_2d( plc_points_3d.size() );
+      viennagrid::plane_to_2d_projector<PointType> projection_functor;
+      projection_functor.init( plc_points_3d.begin(), plc_points_3d.end(), 1e-6 );
+      projection_functor.project( plc_points_3d.begin(), plc_points_3d.end(), plc_points_2d.begin() );
 
-        projection_functor.unproject( hole_points_2d.begin(), hole_points_2d.end(), std::back_inserter(hole_points_3d) );
-      }
 
+      typedef viennagrid::mesh Triangular2DMeshType;
+      typedef viennagrid::result_of::element<Triangular2DMeshType>::type Vertex2DType;
 
-      // extract PLC lines
-      std::map<ElementType, viennagrid_int> plc_vertices;
-      std::set< std::pair<ElementType, ElementType> > plc_lines;
+      Triangular2DMeshType mesh2d;
+      std::vector<Vertex2DType> vertex_handles_2d(plc_points_2d.size());
+      for (std::size_t j = 0; j < plc_points_2d.size(); ++j)
+        vertex_handles_2d[j] = viennagrid::make_vertex(mesh2d, plc_points_2d[j]);
 
-      ConstLineRangeType lines(mesh);
-      for (ConstLineIteratorType lit = lines.begin(); lit != lines.end(); ++lit)
+      for (index_type i = facet_triangle_offsets[f]; i != facet_triangle_offsets[f+1]; ++i)
       {
-        typedef typename viennagrid::result_of::const_coboundary_range<MeshType>::type ConstCoboundaryRangeType;
-        typedef typename viennagrid::result_of::iterator<ConstCoboundaryRangeType>::type                                                 ConstCoboundaryRangeIterator;
+        index_type const * v = adjacency.triangle_vertices( facet_triangles[i] );
+        index_type local[3];
+        for (int k = 0; k != 3; ++k)
+          local[k] = std::lower_bound( facet_vertices.begin(), facet_vertices.end(), v[k] ) - facet_vertices.begin();
 
-        ConstCoboundaryRangeType triangles(mesh, *lit, 2);
-        int triangle_in_plc_count = 0;
-        for (ConstCoboundaryRangeIterator ctit = triangles.begin(); ctit != triangles.end(); ++ctit)
-        {
-          if (plc_ids.get(*ctit) == i)
-            ++triangle_in_plc_count;
-        }
+        viennagrid::make_triangle( mesh2d, vertex_handles_2d[local[0]], vertex_handles_2d[local[1]], vertex_handles_2d[local[2]] );
+      }
 
-        if (triangle_in_plc_count == 2 && triangles.size() == 2)
-          continue;
+      std::vector<point> hole_points_2d;
+      viennagrid::extract_hole_points( mesh2d, hole_points_2d );
 
-        if (triangle_in_plc_count > 0)
-        {
-          ElementType v0 = viennagrid::vertices(*lit)[0];
-          ElementType v1 = viennagrid::vertices(*lit)[1];
+      projection_functor.unproject( hole_points_2d.begin(), hole_points_2d.end(), std::back_inserter(facet_hole_points[f]) );
+    }
 
-          plc_vertices.insert( std::make_pair(v0, -1) );
-          plc_vertices.insert( std::make_pair(v1, -1) );
 
+    // the PLC is created serially in the order of the facets
+    std::vector<viennagrid_int> plc_vertices( adjacency.vertex_count(), -1 );
 
-          if (v1 < v0)
-            std::swap(v0, v1);
+    for (index_type f = 0; f != facet_count; ++f)
+    {
+      std::vector<index_type> const & lines = facet_lines[f];
 
-          plc_lines.insert( std::make_pair(v0, v1) );
-        }
+      std::vector<index_type> line_vertices;
+      for (std::size_t j = 0; j != lines.size(); ++j)
+      {
+        line_vertices.push_back( adjacency.edge_vertex(lines[j], 0) );
+        line_vertices.push_back( adjacency.edge_vertex(lines[j], 1) );
       }
+      std::sort( line_vertices.begin(), line_vertices.end() );
+      line_vertices.erase( std::unique(line_vertices.begin(), line_vertices.end()), line_vertices.end() );
 
-      for (typename std::map<ElementType, viennagrid_int>::iterator vit = plc_vertices.begin(); vit != plc_vertices.end(); ++vit)
+      for (std::size_t j = 0; j != line_vertices.size(); ++j)
       {
-        typename std::map<ElementType, viennagrid_int>::iterator gvit = vertex_map.find( (*vit).first );
-        if (gvit == vertex_map.end())
-        {
-          PointType p = viennagrid::get_point( vit->first );
-          viennagrid_plc_vertex_create(plc, &p[0], &vit->second);
-          vertex_map.insert( *vit );
-        }
-        else
-          vit->second = gvit->second;
+        if (plc_vertices[line_vertices[j]] < 0)
+          viennagrid_plc_vertex_create(plc, coords + 3*line_vertices[j], &plc_vertices[line_vertices[j]]);
       }
 
       std::vector<viennagrid_int> line_ids;
-      for (typename std::set< std::pair<ElementType, ElementType> >::iterator it = plc_lines.begin(); it != plc_lines.end(); ++it)
+      for (std::size_t j = 0; j != lines.size(); ++j)
       {
         viennagrid_int line_id;
-
-
-
         viennagrid_plc_line_create(plc,
-                                   plc_vertices[(*it).first],
-                                   plc_vertices[(*it).second],
+                                   plc_vertices[ adjacency.edge_vertex(lines[j], 0) ],
+                                   plc_vertices[ adjacency.edge_vertex(lines[j], 1) ],
                                    &line_id);
         line_ids.push_back(line_id);
       }
 
-
       viennagrid_int facet_id;
       viennagrid_plc_facet_create(plc, line_ids.size(), &line_ids[0], &facet_id);
 
+      std::vector<point> const & hole_points_3d = facet_hole_points[f];
       for (std::vector<point>::const_iterator hpit = hole_points_3d.begin(); hpit != hole_points_3d.end(); ++hpit)
-      {
         viennagrid_plc_facet_hole_point_add(plc, facet_id, &(*hpit)[0]);
-      }
     }
   }
 
@@ -515,18 +472,11 @@ namespace viennamesh
     std::cerr << "Extract PLC of " << input_mesh.size() << " Partitions" << std::endl;
     //END OF MY IMPLEMENTATION
 
-    typedef same_segments_functor Functor1Type;
-    typedef same_orientation_functor<double> Functor2Type;
-
-    Functor1Type f1;
-    Functor2Type f2(coplanar_tolerance);
-    same_cell_combine_functor< Functor1Type, Functor2Type > functor(f1, f2);
-
     //MY IMPLEMENTATION
     for (size_t i = 0; i < input_mesh.size(); ++i)
     {
 
-      extract_plcs(input_mesh(i), tmp(i), functor);
+      extract_plcs(input_mesh(i), tmp(i), coplanar_tolerance);
       coarsen_plc_mesh(tmp(i), output_plc(i), colinear_tolerance);
 
       viennagrid_dimension geo_dim;
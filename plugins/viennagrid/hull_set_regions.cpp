@@ -13,6 +13,7 @@
 =============================================================================== */
 
 #include "hull_set_regions.hpp"
+#include "triangle_adjacency.hpp"
 #include "viennagrid/algorithm/distance.hpp"
 #include <memory>
 #include <set>
@@ -22,49 +23,6 @@ namespace viennamesh
 {
 
 
-  template<typename MeshT, typename ElementT, typename AccessorT, typename ToSetT>
-  void set_neighbors(MeshT const & mesh,
-                     ElementT const & element,
-                     AccessorT & accessor,
-                     ToSetT to_set,
-                     ToSetT invalid,
-                     viennagrid_int connector_topologic_dimension)
-  {
-    if (accessor.get(element) != invalid)
-      return;
-
-    accessor.set(element, to_set);
-
-    typedef typename viennagrid::result_of::const_element_range<ElementT, 1>::type ConstBoundaryLineRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstBoundaryLineRangeType>::type ConstBoundaryLineRangeIterator;
-
-    ConstBoundaryLineRangeType boundary_lines(element);
-    for (ConstBoundaryLineRangeIterator blit = boundary_lines.begin(); blit != boundary_lines.end(); ++blit)
-    {
-      typedef typename viennagrid::result_of::const_coboundary_range<MeshT, 2>::type ConstCoboundaryTriangleRangeType;
-      typedef typename viennagrid::result_of::iterator<ConstCoboundaryTriangleRangeType>::type ConstCoboundaryTriangleRangeIterator;
-
-      ConstCoboundaryTriangleRangeType neigbor_triangles(mesh, *blit);
-
-//       if (neigbor_triangles.size() == 1)
-//         std::cout << "ERROR!!!" << std::endl;
-
-      // skip lines which have not exactly 2 coboundary triangles
-      if (neigbor_triangles.size() != 2)
-        continue;
-
-      for (ConstCoboundaryTriangleRangeIterator ntit = neigbor_triangles.begin(); ntit != neigbor_triangles.end(); ++ntit)
-      {
-        // skip this
-        if (*ntit == element)
-          continue;
-
-        set_neighbors(mesh, *ntit, accessor, to_set, invalid, connector_topologic_dimension);
-      }
-    }
-  }
-
-
   struct poly_line;
 
   struct patch
@@ -108,16 +66,10 @@ namespace viennamesh
 
     ConstCellRangeType cells(input_mesh());
 
-    std::vector<int> cell_region_container( cells.size(), -1 );
-    typedef viennagrid::result_of::accessor< std::vector<int>, ElementType >::type RegionAccessorType;
-    RegionAccessorType cell_region( cell_region_container );
-
-    int region_count = 0;
-    for (ConstCellRangeIterator cit = cells.begin(); cit != cells.end(); ++cit)
-    {
-      if (cell_region.get(*cit) == -1)
-        set_neighbors( input_mesh(), *cit, cell_region, region_count++, -1, 2 );
-    }
+    // each patch of triangles connected over manifold edges becomes a region
+    triangle_adjacency adjacency( input_mesh().internal() );
+    std::vector<triangle_adjacency::index_type> cell_region;
+    int region_count = label_manifold_patches(adjacency, cell_region);
 
     info(1) << "Number of regions: " << region_count << std::endl;
 
@@ -125,7 +77,7 @@ namespace viennamesh
     for (ConstCellRangeIterator cit = cells.begin(); cit != cells.end(); ++cit)
     {
       ElementType new_element = copy_map(*cit);
-      viennagrid::add( output_mesh().get_or_create_region( cell_region.get(*cit) ), new_element);
+      viennagrid::add( output_mesh().get_or_create_region( cell_region[adjacency.triangle_index((*cit).id().internal())] ), new_element);
     }
 
 
@@ -13,7 +13,9 @@
 =============================================================================== */
 
 #include "hyperplane_clip.hpp"
+#include "simplex_refinement.hpp"
 #include "viennagrid/algorithm/refine.hpp"
+#include <cmath>
 
 namespace viennamesh
 {
@@ -55,6 +57,233 @@ namespace viennamesh
   };
 
 
+  namespace
+  {
+    typedef simplex_refinement::index_type index_type;
+
+    // Clips simplex cells at a hyperplane and keeps the part on the negative
+    // side of the normal. Points are numbered globally: input vertices
+    // first, followed by the intersection points of the cut edges.
+    class simplex_clip
+    {
+    public:
+
+      simplex_clip(simplex_cells const & cells_, point const & normal_, std::vector<viennagrid_numeric> const & distances_,
+                   edge_point_table const & cuts_, std::vector<index_type> const & slots_,
+                   simplex_refinement const & refinement_) :
+          cells(cells_), distances(distances_), cuts(cuts_), slots(slots_), refinement(refinement_)
+      {
+        for (int k = 0; k != 3; ++k)
+          normal[k] = k < static_cast<int>(normal_.size()) ? normal_[k] : 0;
+      }
+
+      // writes the children of a cut cell (with global point numbers) and
+      // returns their count, children may be NULL for counting
+      int clip(index_type c, index_type * children) const
+      {
+        index_type const * v = cells.cell_vertices(c);
+        int count = 0;
+
+        if (cells.cell_dimension == 1)
+        {
+          index_type cut = cut_point(c, 0, 1);
+          if (children)
+          {
+            children[0] = distances[v[0]] < 0 ? v[0] : cut;
+            children[1] = distances[v[0]] < 0 ? cut : v[1];
+          }
+          return 1;
+        }
+
+        if (cells.cell_dimension == 2)
+        {
+          int local[] = {0, 1, 2};
+          index_type polygon[4];
+          int size = clip_polygon(c, local, 3, polygon);
+          return fan(polygon, size, children);
+        }
+
+        // The kept part of a tetrahedron is a convex polytope, it is split
+        // into tetrahedra by connecting its smallest point with all faces
+        // not containing it. Faces are split by the same rule, so shared
+        // faces of neighboring cells are split consistently.
+        static const int faces[4][3] = { {1,2,3}, {0,3,2}, {0,1,3}, {0,2,1} };
+
+        index_type polygons[5][6];
+        int sizes[5];
+        for (int f = 0; f != 4; ++f)
+          sizes[f] = clip_polygon(c, faces[f], 3, polygons[f]);
+        sizes[4] = cap(c, polygons[4]);
+
+        index_type apex = std::numeric_limits<index_type>::max();
+        for (int f = 0; f != 5; ++f)
+          for (int i = 0; i != sizes[f]; ++i)
+            apex = std::min(apex, polygons[f][i]);
+
+        viennagrid_numeric parent_orientation = orientation(v);
+
+        for (int f = 0; f != 5; ++f)
+        {
+          if (sizes[f] < 3 || std::find(polygons[f], polygons[f]+sizes[f], apex) != polygons[f]+sizes[f])
+            continue;
+
+          index_type triangles[12];
+          int triangle_count = fan(polygons[f], sizes[f], triangles);
+
+          for (int t = 0; t != triangle_count; ++t, ++count)
+          {
+            if (!children)
+              continue;
+
+            index_type * child = children + 4*count;
+            child[0] = apex;
+            std::copy(triangles+3*t, triangles+3*t+3, child+1);
+            if ( (orientation(child) > 0) != (parent_orientation > 0) )
+              std::swap(child[2], child[3]);
+          }
+        }
+
+        return count;
+      }
+
+    private:
+
+      index_type cut_point(index_type c, int i, int j) const
+      {
+        int edges = simplex_edge_count(cells.cell_dimension);
+        return cuts.point( slots[edges*c + simplex_local_edge(cells.cell_dimension, i, j)] );
+      }
+
+      void coords(index_type p, viennagrid_numeric * result) const
+      {
+        if (p < cells.vertex_count)
+          std::copy( cells.vertex_coords(p), cells.vertex_coords(p)+cells.geometric_dimension, result );
+        else
+          refined_point(cells, refinement, p-cells.vertex_count, result );
+      }
+
+      // clips the polygon of the given local vertices, the cyclic order is
+      // kept; returns the size of the clipped polygon
+      int clip_polygon(index_type c, int const * local, int size, index_type * polygon) const
+      {
+        index_type const * v = cells.cell_vertices(c);
+        int count = 0;
+
+        for (int i = 0; i != size; ++i)
+        {
+          int j = (i+1)%size;
+          viennagrid_numeric di = distances[ v[local[i]] ];
+          viennagrid_numeric dj = distances[ v[local[j]] ];
+
+          if (di <= 0)
+            polygon[count++] = v[local[i]];
+          if ((di < 0 && dj > 0) || (di > 0 && dj < 0))
+            polygon[count++] = cut_point(c, local[i], local[j]);
+        }
+
+        return count;
+      }
+
+      // the face of the kept part which lies on the hyperplane, its points
+      // are ordered by their angle around the centroid
+      int cap(index_type c, index_type * polygon) const
+      {
+        index_type const * v = cells.cell_vertices(c);
+        int count = 0;
+
+        for (int i = 0; i != 4; ++i)
+        {
+          if (distances[v[i]] == 0)
+            polygon[count++] = v[i];
+          for (int j = i+1; j != 4; ++j)
+            if ((distances[v[i]] < 0 && distances[v[j]] > 0) || (distances[v[i]] > 0 && distances[v[j]] < 0))
+              polygon[count++] = cut_point(c, i, j);
+        }
+
+        if (count < 4)
+          return count;
+
+        // a quadrilateral is reordered so that its first and third point
+        // form a diagonal, i.e. the remaining points lie on different sides
+        viennagrid_numeric p[4][3];
+        for (int i = 0; i != 4; ++i)
+          coords(polygon[i], p[i]);
+
+        for (int i = 1; i != 4; ++i)
+        {
+          int o0 = (i == 1) ? 2 : 1;
+          int o1 = 6-i-o0;
+          if ( (side(p[0], p[i], p[o0]) > 0) != (side(p[0], p[i], p[o1]) > 0) )
+          {
+            index_type tmp[4] = { polygon[0], polygon[o0], polygon[i], polygon[o1] };
+            std::copy(tmp, tmp+4, polygon);
+            break;
+          }
+        }
+
+        return count;
+      }
+
+      // side of q with respect to the line from a to b within the hyperplane
+      viennagrid_numeric side(viennagrid_numeric const * a, viennagrid_numeric const * b, viennagrid_numeric const * q) const
+      {
+        viennagrid_numeric u[3], w[3];
+        for (int k = 0; k != 3; ++k)
+        {
+          u[k] = b[k]-a[k];
+          w[k] = q[k]-a[k];
+        }
+
+        return normal[0]*(u[1]*w[2]-u[2]*w[1]) + normal[1]*(u[2]*w[0]-u[0]*w[2]) + normal[2]*(u[0]*w[1]-u[1]*w[0]);
+      }
+
+      // splits a convex polygon into triangles from its smallest point
+      static int fan(index_type const * polygon, int size, index_type * triangles)
+      {
+        if (size < 3)
+          return 0;
+
+        int first = std::min_element(polygon, polygon+size) - polygon;
+        if (triangles)
+        {
+          for (int i = 1; i+1 < size; ++i)
+          {
+            triangles[3*(i-1)+0] = polygon[first];
+            triangles[3*(i-1)+1] = polygon[(first+i)%size];
+            triangles[3*(i-1)+2] = polygon[(first+i+1)%size];
+          }
+        }
+
+        return size-2;
+      }
+
+      viennagrid_numeric orientation(index_type const * tet) const
+      {
+        viennagrid_numeric c[4][3];
+        for (int i = 0; i != 4; ++i)
+          coords(tet[i], c[i]);
+
+        viennagrid_numeric a[3], b[3], d[3];
+        for (int k = 0; k != 3; ++k)
+        {
+          a[k] = c[1][k]-c[0][k];
+          b[k] = c[2][k]-c[0][k];
+          d[k] = c[3][k]-c[0][k];
+        }
+
+        return a[0]*(b[1]*d[2]-b[2]*d[1]) - a[1]*(b[0]*d[2]-b[2]*d[0]) + a[2]*(b[0]*d[1]-b[1]*d[0]);
+      }
+
+      simplex_cells const & cells;
+      std::vector<viennagrid_numeric> const & distances;
+      edge_point_table const & cuts;
+      std::vector<index_type> const & slots;
+      simplex_refinement const & refinement;
+      viennagrid_numeric normal[3];
+    };
+  }
+
+
   hyperplane_clip::hyperplane_clip() {}
   std::string hyperplane_clip::name() { return "hyperplane_clip"; }
 
@@ -86,12 +315,167 @@ namespace viennamesh
     info(1) << "Hyperplane point: " << hyperplane_point << std::endl;
     info(1) << "Hyperplane normal: " << hyperplane_normal << std::endl;
 
-    mesh_handle tmp = make_data<mesh_handle>();
     mesh_handle output_mesh = make_data<mesh_handle>();
+    double tolerance = 1e-8;
+
+    simplex_cells cells;
+    if (!cells.init( input_mesh().internal() ) || (cells.cell_dimension == 3 && cells.geometric_dimension != 3))
+    {
+      info(1) << "Mesh has non-simplex cells, using generic refinement" << std::endl;
+
+      mesh_handle tmp = make_data<mesh_handle>();
+      viennagrid::hyperplane_refine(input_mesh(), hyperplane_point, hyperplane_normal, tolerance, tmp() );
+      viennagrid::copy( tmp(), output_mesh(),
+                        on_positive_hyperplane_side_functor<point, double>(hyperplane_point, -hyperplane_normal, tolerance) );
+
+      set_output( "mesh", output_mesh );
+      return true;
+    }
+
+    index_type cell_count = cells.cell_count();
+    int per_cell = cells.vertices_per_cell();
+    int edges_per_cell = simplex_edge_count(cells.cell_dimension);
+
+
+    // signed distances of all vertices, vertices within the tolerance are
+    // on the hyperplane
+    std::vector<viennagrid_numeric> distances(cells.vertex_count);
+
+    #pragma omp parallel for
+    for (index_type v = 0; v < cells.vertex_count; ++v)
+    {
+      viennagrid_numeric const * c = cells.vertex_coords(v);
+      viennagrid_numeric distance = 0;
+      viennagrid_numeric length = 0;
+      for (int d = 0; d != point_dimension; ++d)
+      {
+        distance += hyperplane_normal[d] * (c[d]-hyperplane_point[d]);
+        length += (c[d]-hyperplane_point[d]) * (c[d]-hyperplane_point[d]);
+      }
+
+      distances[v] = std::abs(distance) > tolerance*std::sqrt(length) ? distance : 0;
+    }
+
+
+    // classify the cells and register the cut edges of the cells which
+    // have vertices on both sides
+    enum { removed, kept, cut };
+    std::vector<char> status(cell_count);
+    index_type cut_count = 0;
+
+    #pragma omp parallel for reduction(+:cut_count)
+    for (index_type c = 0; c < cell_count; ++c)
+    {
+      index_type const * v = cells.cell_vertices(c);
+      int negative = 0;
+      int positive = 0;
+      for (int i = 0; i != per_cell; ++i)
+      {
+        if (distances[v[i]] < 0) ++negative;
+        if (distances[v[i]] > 0) ++positive;
+      }
+
+      status[c] = negative == 0 ? removed : (positive == 0 ? kept : cut);
+      if (status[c] == cut)
+        ++cut_count;
+    }
+
+    std::vector<index_type> slots(edges_per_cell*cell_count, -1);
+    edge_point_table cuts(edges_per_cell*cut_count);
+
+    #pragma omp parallel for
+    for (index_type c = 0; c < cell_count; ++c)
+    {
+      if (status[c] != cut)
+        continue;
+
+      index_type const * v = cells.cell_vertices(c);
+      for (int e = 0; e != edges_per_cell; ++e)
+      {
+        index_type v0 = v[simplex_edge_vertex(cells.cell_dimension, e, 0)];
+        index_type v1 = v[simplex_edge_vertex(cells.cell_dimension, e, 1)];
+        if ((distances[v0] < 0 && distances[v1] > 0) || (distances[v0] > 0 && distances[v1] < 0))
+          slots[edges_per_cell*c+e] = cuts.insert(v0, v1, edges_per_cell*c+e);
+      }
+    }
+
+    simplex_refinement refinement;
+    index_type point_count = cuts.assign_points(slots, cells.vertex_count, refinement.point_edges);
+    refinement.point_weights.resize(point_count);
+
+    #pragma omp parallel for
+    for (index_type p = 0; p < point_count; ++p)
+    {
+      viennagrid_numeric d0 = distances[ refinement.point_edges[2*p+0] ];
+      viennagrid_numeric d1 = distances[ refinement.point_edges[2*p+1] ];
+      refinement.point_weights[p] = d0 / (d0-d1);
+    }
+
+
+    // count the children of every cell and emit them at prefix-summed
+    // offsets, children use global point numbers at first
+    simplex_clip clip(cells, hyperplane_normal, distances, cuts, slots, refinement);
+    std::vector<index_type> child_offsets(cell_count+1);
+    child_offsets[0] = 0;
+
+    #pragma omp parallel for
+    for (index_type c = 0; c < cell_count; ++c)
+      child_offsets[c+1] = status[c] == removed ? 0 : (status[c] == kept ? 1 : clip.clip(c, NULL));
+
+    for (index_type c = 0; c != cell_count; ++c)
+      child_offsets[c+1] += child_offsets[c];
+
+    index_type child_count = child_offsets[cell_count];
+    refinement.child_vertices.resize(per_cell*child_count);
+    refinement.child_parents.resize(child_count);
+
+    #pragma omp parallel for
+    for (index_type c = 0; c < cell_count; ++c)
+    {
+      index_type * children = &refinement.child_vertices[0] + per_cell*child_offsets[c];
+      if (status[c] == kept)
+        std::copy( cells.cell_vertices(c), cells.cell_vertices(c)+per_cell, children );
+      else if (status[c] == cut)
+        clip.clip(c, children);
+
+      for (index_type i = child_offsets[c]; i != child_offsets[c+1]; ++i)
+        refinement.child_parents[i] = c;
+    }
+
+
+    // only input vertices used by a child are kept
+    std::vector<index_type> vertex_map(cells.vertex_count, 0);
+
+    #pragma omp parallel for
+    for (index_type i = 0; i < per_cell*child_count; ++i)
+    {
+      if (refinement.child_vertices[i] < cells.vertex_count)
+        vertex_map[ refinement.child_vertices[i] ] = 1;
+    }
+
+    for (index_type v = 0; v != cells.vertex_count; ++v)
+    {
+      if (vertex_map[v])
+      {
+        vertex_map[v] = refinement.kept_vertices.size();
+        refinement.kept_vertices.push_back(v);
+      }
+    }
+
+    index_type kept_count = refinement.kept_vertices.size();
+
+    #pragma omp parallel for
+    for (index_type i = 0; i < per_cell*child_count; ++i)
+    {
+      index_type p = refinement.child_vertices[i];
+      refinement.child_vertices[i] = p < cells.vertex_count ? vertex_map[p] : kept_count + (p-cells.vertex_count);
+    }
+
+    info(1) << "Clipped " << cell_count << " cells into " << child_count << " cells, created "
+            << point_count << " new vertices" << std::endl;
 
-    viennagrid::hyperplane_refine(input_mesh(), hyperplane_point, hyperplane_normal, 1e-8, tmp() );
-    viennagrid::copy( tmp(), output_mesh(),
-                      on_positive_hyperplane_side_functor<point, double>(hyperplane_point, -hyperplane_normal, 1e-8) );
+    write_refined_mesh(cells, refinement, output_mesh().internal());
+    transfer_refined_quantities(*this, cells, refinement);
 
     set_output( "mesh", output_mesh );
 
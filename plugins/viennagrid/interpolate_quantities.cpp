@@ -14,6 +14,7 @@
 
 #include "interpolate_quantities.hpp"
 #include "viennagrid/algorithm/quantity_interpolate.hpp"
+#include "quantity_transfer.hpp"
 
 namespace viennamesh
 {
@@ -32,6 +33,50 @@ namespace viennamesh
     dst_quantity_fields.resize( src_quantity_fields.size() );
 
 
+    // locate all destination vertices and cells once, the cached weights
+    // are shared by all fields
+    quantity_transfer transfer;
+    if (transfer.init( src_mesh().internal(), dst_mesh().internal() ))
+    {
+      if (transfer.outside_count() > 0)
+        info(1) << transfer.outside_count() << " destination vertices are outside of the source mesh, using the nearest source cell" << std::endl;
+
+      std::vector<viennagrid::quantity_field> src_fields;
+      std::vector<viennagrid::quantity_field> dst_fields;
+      std::vector<int> field_indices;
+
+      for (int i = 0; i != src_quantity_fields.size(); ++i)
+      {
+        viennagrid::quantity_field src_qf = src_quantity_fields(i);
+        viennagrid::quantity_field dst_qf;
+
+        if (!transfer.prepare(src_qf, dst_qf))
+        {
+          info(1) << "Quantity field \"" << src_qf.get_name() << "\" has unsupported topologic dimension = " << (int)src_qf.topologic_dimension() << " -> skipping" << std::endl;
+          continue;
+        }
+
+        info(1) << "Found quantity field \"" << src_qf.get_name() << "\" with topologic dimension " << (int)src_qf.topologic_dimension() <<
+        " and values dimension " << (int)src_qf.values_per_quantity() << std::endl;
+
+        src_fields.push_back(src_qf);
+        dst_fields.push_back(dst_qf);
+        field_indices.push_back(i);
+      }
+
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (int i = 0; i < static_cast<int>(src_fields.size()); ++i)
+        transfer.apply(src_fields[i], dst_fields[i]);
+
+      for (std::size_t i = 0; i != dst_fields.size(); ++i)
+        dst_quantity_fields.set(field_indices[i], dst_fields[i]);
+
+      set_output( "quantities", dst_quantity_fields );
+      return true;
+    }
+
+
+    // source meshes with non-simplex cells use the viennagrid interpolation
     for (int i = 0; i != src_quantity_fields.size(); ++i)
     {
       viennagrid::quantity_field src_qf = src_quantity_fields(i);
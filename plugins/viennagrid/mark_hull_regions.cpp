@@ -1,4 +1,5 @@
 #include "mark_hull_regions.hpp"
+#include "triangle_adjacency.hpp"
 
 #include "viennagrid/algorithm/geometry.hpp"
 #include "viennagrid/algorithm/centroid.hpp"
@@ -119,108 +120,70 @@ namespace viennamesh
 
 
 
-  template<typename MeshT, typename NeighborsT, typename RegionAccessorT, typename ElementT>
-  void mark_neighbors(MeshT const & mesh,
-                      std::vector<NeighborsT> const & pos_neighbors,
-                      std::vector<NeighborsT> const & neg_neighbors,
-                      RegionAccessorT & pos_orient,
-                      RegionAccessorT & neg_orient,
-                      ElementT triangle,
-                      bool positive,
-                      int region_id)
+  // Every triangle has two sides, side(t, true) is the side the normal
+  // vector of t points to. Two sides are connected if the space in front of
+  // the first side continues over a common edge to the second side; the
+  // connected components of sides are the hull regions.
+  inline triangle_adjacency::index_type side(triangle_adjacency::index_type t, bool positive)
   {
-    if (positive)
-    {
-      int rid = pos_orient.get(triangle);
-      assert(neg_orient.get(triangle) != region_id);
-      if (rid == -1)
-      {
-        pos_orient.set(triangle, region_id);
-      }
-      else
-      {
-        assert(rid == region_id);
-        return;
-      }
-    }
-    else
-    {
-      int rid = neg_orient.get(triangle);
-      assert(pos_orient.get(triangle) != region_id);
-      if (rid == -1)
-      {
-        neg_orient.set(triangle, region_id);
-      }
-      else
-      {
-        assert(rid == region_id);
-        return;
-      }
-    }
-
-
-    NeighborsT const & neighbors = positive ? pos_neighbors[triangle.id().index()] : neg_neighbors[triangle.id().index()];
-    for (typename NeighborsT::const_iterator ntit = neighbors.begin(); ntit != neighbors.end(); ++ntit)
-    {
-      mark_neighbors(mesh,
-                     pos_neighbors, neg_neighbors,
-                     pos_orient, neg_orient,
-                     *ntit,
-                     same_orientation(triangle, *ntit) == positive,
-                     region_id);
-    }
+    return 2*t + (positive ? 0 : 1);
   }
 
 
-
-
-  template<typename MeshT, typename RegionAccessorT, typename NumericConfigT>
+  template<typename MeshT, typename NumericConfigT>
   int mark_hulls(MeshT const & mesh,
-                 RegionAccessorT & pos_orient,
-                 RegionAccessorT & neg_orient,
+                 triangle_adjacency const & adjacency,
+                 std::vector<int> & pos_orient,
+                 std::vector<int> & neg_orient,
                  NumericConfigT numeric_config)
   {
     typedef typename viennagrid::result_of::coord<MeshT>::type CoordType;
     typedef typename viennagrid::result_of::point<MeshT>::type PointType;
-    typedef typename viennagrid::result_of::element<MeshT>::type ElementType;
-
-    std::vector< std::vector<ElementType> > positive_neighbor_triangles( viennagrid::elements(mesh,2).size() );
-    std::vector< std::vector<ElementType> > negative_neighbor_triangles( viennagrid::elements(mesh,2).size() );
+    typedef triangle_adjacency::index_type index_type;
 
-    typedef typename viennagrid::result_of::const_element_range<MeshT>::type ConstElementRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstElementRangeType>::type ConstElementIteratorType;
+    index_type triangle_count = adjacency.triangle_count();
+    index_type edge_count = adjacency.edge_count();
 
-    typedef typename viennagrid::result_of::const_coboundary_range<MeshT>::type ConstCoboundaryRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstCoboundaryRangeType>::type ConstCoboundaryIteratorType;
-
-
-    ConstElementRangeType lines(mesh, 1);
-    for (ConstElementIteratorType lit = lines.begin(); lit != lines.end(); ++lit)
+    for (index_type e = 0; e != edge_count; ++e)
     {
-      ConstCoboundaryRangeType triangles(mesh, *lit, 2);
-
-      if (triangles.size() < 2)
+      if (adjacency.edge_triangle_count(e) < 2)
       {
-        error(1) << "Line " << *lit << " has less than 2 co-boundary triangles" << std::endl;
-        for (ConstCoboundaryIteratorType tit = triangles.begin(); tit != triangles.end(); ++tit)
-          error(1) << "    " << *tit << std::endl;
+        error(1) << "Line (" << adjacency.edge_vertex(e,0) << "," << adjacency.edge_vertex(e,1) << ") has less than 2 co-boundary triangles" << std::endl;
+        for (index_type i = 0; i != adjacency.edge_triangle_count(e); ++i)
+        {
+          index_type const * tv = adjacency.triangle_vertices( adjacency.edge_triangle(e,i) );
+          error(1) << "    Triangle (" << tv[0] << "," << tv[1] << "," << tv[2] << ")" << std::endl;
+        }
 
         VIENNAMESH_ERROR(VIENNAMESH_ERROR_SIZING_FUNCTION, "Topological error: one line has less than 2 co-boundary triangles");
       }
+    }
 
-      if (triangles.size() == 2)
-      {
-        positive_neighbor_triangles[ triangles[0].id().index() ].push_back( triangles[1] );
-        negative_neighbor_triangles[ triangles[0].id().index() ].push_back( triangles[1] );
+    int geometric_dimension = viennagrid::geometric_dimension(mesh);
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh.internal(), &coords);
+
+    concurrent_union_find sides(2*triangle_count);
 
-        positive_neighbor_triangles[ triangles[1].id().index() ].push_back( triangles[0] );
-        negative_neighbor_triangles[ triangles[1].id().index() ].push_back( triangles[0] );
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (index_type e = 0; e < edge_count; ++e)
+    {
+      index_type count = adjacency.edge_triangle_count(e);
+
+      if (count == 2)
+      {
+        bool same = adjacency.edge_triangle_forward(e,0) != adjacency.edge_triangle_forward(e,1);
+        sides.unite( side(adjacency.edge_triangle(e,0), true), side(adjacency.edge_triangle(e,1), same) );
+        sides.unite( side(adjacency.edge_triangle(e,0), false), side(adjacency.edge_triangle(e,1), !same) );
         continue;
       }
 
 
-      ElementType v[2] = { viennagrid::vertices(*lit)[0], viennagrid::vertices(*lit)[1] };
-      PointType p[2] = { viennagrid::get_point(v[0]), viennagrid::get_point(v[1]) };
+      // non-manifold line: sort the co-boundary triangles by their angle
+      // around the line, the space between two consecutive triangles
+      // connects the facing sides of these triangles
+      PointType p[2] = { PointType(geometric_dimension, coords + geometric_dimension*adjacency.edge_vertex(e,0)),
+                         PointType(geometric_dimension, coords + geometric_dimension*adjacency.edge_vertex(e,1)) };
 
       PointType lp = (p[0]+p[1])/2;
       PointType lv = p[1]-p[0];
@@ -235,76 +198,56 @@ namespace viennamesh
       xv = viennagrid::cross_prod(yv,lv);
       xv.normalize();
 
+      struct fan_triangle
+      {
+        CoordType angle;
+        index_type triangle;
+        bool positive;
+        bool forward;
 
+        bool operator<(fan_triangle const & rhs) const { return angle < rhs.angle; }
+      };
 
-
-
-      typedef std::map<CoordType, std::pair<ElementType, bool> > SortedNeighborsType;
-      SortedNeighborsType sorted_neighbors;
-
-      for (ConstCoboundaryIteratorType tit = triangles.begin(); tit != triangles.end(); ++tit)
+      std::vector<fan_triangle> fan(count);
+      for (index_type i = 0; i != count; ++i)
       {
-        PointType tp = viennagrid::centroid(*tit);
-        PointType tn = viennagrid::normal_vector(*tit);
+        index_type const * tv = adjacency.triangle_vertices( adjacency.edge_triangle(e,i) );
+        PointType a(geometric_dimension, coords + geometric_dimension*tv[0]);
+        PointType b(geometric_dimension, coords + geometric_dimension*tv[1]);
+        PointType c(geometric_dimension, coords + geometric_dimension*tv[2]);
 
+        PointType tp = (a+b+c)/3;
+        PointType tn = viennagrid::cross_prod(b-a, c-a);
         PointType to_triangle_vector = tp-lp;
 
-        CoordType x = viennagrid::inner_prod(to_triangle_vector, xv);
-        CoordType y = viennagrid::inner_prod(to_triangle_vector, yv);
-
-        CoordType angle = std::atan2(y, x);
-        bool positive = viennagrid::inner_prod( viennagrid::cross_prod( to_triangle_vector, tn ), lv ) > 0;
-
-        sorted_neighbors[angle] = std::make_pair(*tit, positive);
+        fan[i].angle = std::atan2( viennagrid::inner_prod(to_triangle_vector, yv), viennagrid::inner_prod(to_triangle_vector, xv) );
+        fan[i].triangle = adjacency.edge_triangle(e,i);
+        fan[i].positive = viennagrid::inner_prod( viennagrid::cross_prod( to_triangle_vector, tn ), lv ) > 0;
+        fan[i].forward = adjacency.edge_triangle_forward(e,i);
       }
 
-      assert( sorted_neighbors.size() ==  triangles.size() );
+      std::sort(fan.begin(), fan.end());
 
-      typename SortedNeighborsType::iterator it0 = sorted_neighbors.begin();
-      typename SortedNeighborsType::iterator it1 = it0; ++it1;
-
-      for (; it1 != sorted_neighbors.end(); ++it0, ++it1)
+      for (index_type i = 0; i != count; ++i)
       {
-        if ( (*it0).second.second )
-        {
-          positive_neighbor_triangles[ (*it0).second.first.id().index() ].push_back( (*it1).second.first );
-        }
-        else
-        {
-          negative_neighbor_triangles[ (*it0).second.first.id().index() ].push_back( (*it1).second.first );
-        }
+        fan_triangle const & t0 = fan[i];
+        fan_triangle const & t1 = fan[(i+1) % count];
+        bool same = t0.forward != t1.forward;
 
-        if ( (*it1).second.second )
-        {
-          negative_neighbor_triangles[ (*it1).second.first.id().index() ].push_back( (*it0).second.first );
-        }
-        else
-        {
-          positive_neighbor_triangles[ (*it1).second.first.id().index() ].push_back( (*it0).second.first );
-        }
+        sides.unite( side(t0.triangle, t0.positive), side(t1.triangle, same == t0.positive) );
+        sides.unite( side(t1.triangle, !t1.positive), side(t0.triangle, same == !t1.positive) );
       }
+    }
 
-      it1 = sorted_neighbors.begin();
-      if ( (*it0).second.second )
-      {
-        positive_neighbor_triangles[ (*it0).second.first.id().index() ].push_back( (*it1).second.first );
-      }
-      else
-      {
-        negative_neighbor_triangles[ (*it0).second.first.id().index() ].push_back( (*it1).second.first );
-      }
+    std::vector<index_type> roots;
+    sides.representatives(roots);
 
-      if ( (*it1).second.second )
-      {
-        negative_neighbor_triangles[ (*it1).second.first.id().index() ].push_back( (*it0).second.first );
-      }
-      else
-      {
-        positive_neighbor_triangles[ (*it1).second.first.id().index() ].push_back( (*it0).second.first );
-      }
-    }
+    // region of each component of sides, indexed by its root
+    std::vector<int> side_regions(2*triangle_count, -1);
 
 
+    typedef typename viennagrid::result_of::const_element_range<MeshT>::type ConstElementRangeType;
+    typedef typename viennagrid::result_of::iterator<ConstElementRangeType>::type ConstElementIteratorType;
 
     std::pair<PointType, PointType> bb = viennagrid::bounding_box(mesh);
     PointType outside_point = bb.first - viennagrid::make_point(1,1,1) * viennagrid::norm_2(bb.first-bb.second) * 0.1;
@@ -343,11 +286,10 @@ namespace viennamesh
           break;
       }
 
-      // if there was no intersection -> mark this triangle and all neighbor triangles recursively
+      // if there was no intersection -> the side facing the outside point belongs to the outer region
       if (tit2 == triangles.end())
       {
-        mark_neighbors(mesh, positive_neighbor_triangles, negative_neighbor_triangles, pos_orient, neg_orient, *tit, p > 0, 0);
-
+        side_regions[ roots[side(adjacency.triangle_index((*tit).id().internal()), p > 0)] ] = 0;
         break;
       }
     }
@@ -359,29 +301,28 @@ namespace viennamesh
     {
       done = true;
 
-      ConstElementRangeType triangles(mesh, 2);
-      for (ConstElementIteratorType tit = triangles.begin(); tit != triangles.end(); ++tit)
+      for (index_type t = 0; t != triangle_count; ++t)
       {
         // triangle already is in two regions
-        if ( (pos_orient.get(*tit) != -1) && (neg_orient.get(*tit) != -1) )
+        if ( (side_regions[roots[side(t, true)]] != -1) && (side_regions[roots[side(t, false)]] != -1) )
           continue;
 
-        bool positive = pos_orient.get(*tit) == -1;
-
-        mark_neighbors(mesh,
-                       positive_neighbor_triangles,
-                       negative_neighbor_triangles,
-                       pos_orient,
-                       neg_orient,
-                       *tit,
-                       positive,
-                       region_id);
+        bool positive = side_regions[roots[side(t, true)]] == -1;
+        side_regions[roots[side(t, positive)]] = region_id;
 
         done = false;
         ++region_id;
       }
+    }
 
+    pos_orient.resize(triangle_count);
+    neg_orient.resize(triangle_count);
 
+    #pragma omp parallel for
+    for (index_type t = 0; t < triangle_count; ++t)
+    {
+      pos_orient[t] = side_regions[roots[side(t, true)]];
+      neg_orient[t] = side_regions[roots[side(t, false)]];
     }
 
     return region_id-1;
@@ -403,14 +344,12 @@ namespace viennamesh
     typedef viennagrid::result_of::element<MeshType>::type    ElementType;
 
 
-    std::vector<int> positive_orientation_regions( viennagrid::cells(input_mesh()).size(), -1 );
-    viennagrid::result_of::accessor< std::vector<int>, ElementType >::type pos_orient(positive_orientation_regions);
-
-    std::vector<int> negative_orientation_regions( viennagrid::cells(input_mesh()).size(), -1 );
-    viennagrid::result_of::accessor< std::vector<int>, ElementType >::type neg_orient(negative_orientation_regions);
+    triangle_adjacency adjacency( input_mesh().internal() );
 
+    std::vector<int> pos_orient;
+    std::vector<int> neg_orient;
 
-    int region_count = mark_hulls(input_mesh(), pos_orient, neg_orient, 1e-6 );
+    int region_count = mark_hulls(input_mesh(), adjacency, pos_orient, neg_orient, 1e-6 );
     info(1) << "Found " << region_count << " regions " << std::endl;
 
     mesh_handle output_mesh = make_data<mesh_handle>();
@@ -438,8 +377,9 @@ namespace viennamesh
     ConstCellRangeType cells( input_mesh() );
     for (ConstCellRangeIterator cit = cells.begin(); cit != cells.end(); ++cit)
     {
-      int por = pos_orient.get(*cit);
-      int nor = neg_orient.get(*cit);
+      triangle_adjacency::index_type t = adjacency.triangle_index( (*cit).id().internal() );
+      int por = pos_orient[t];
+      int nor = neg_orient[t];
 
       if (por == 0 && nor == 0)
       {
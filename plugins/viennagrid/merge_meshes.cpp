@@ -13,46 +13,213 @@
 =============================================================================== */
 
 #include "merge_meshes.hpp"
+#include "viennameshpp/spatial_hash.hpp"
+#include <set>
 
 namespace viennamesh
 {
-  template<bool mesh_is_const>
-  void merge_meshes_impl(viennagrid::base_mesh<mesh_is_const> const & src_mesh,
-                         viennagrid::mesh const & dst_mesh,
-                         double tolerance, bool region_offset)
+  // Merges meshes into one output mesh. Vertices of all but the first mesh
+  // are merged with an earlier vertex (of any mesh) closer than the
+  // tolerance; coincident vertices are found with one spatial hash over the
+  // vertices of all meshes, queried in parallel.
+  class mesh_merger
   {
-    viennagrid::result_of::element_copy_map<>::type copy_map(dst_mesh, tolerance, false);
+  public:
 
-    typedef viennagrid::base_mesh<mesh_is_const>                                    SrcMeshType;
+    typedef viennagrid_int index_type;
 
-    typedef typename viennagrid::result_of::element<SrcMeshType>::type              CellType;
+    mesh_merger(double tolerance_, bool region_offset_) : tolerance(tolerance_), region_offset(region_offset_) {}
 
-    typedef typename viennagrid::result_of::const_cell_range<SrcMeshType>::type     ConstCellRangeType;
-    typedef typename viennagrid::result_of::iterator<ConstCellRangeType>::type      ConstCellIteratorType;
+    void add(viennagrid_mesh mesh) { meshes.push_back( viennagrid::mesh(mesh) ); }
+    std::size_t size() const { return meshes.size(); }
 
-    typedef typename viennagrid::result_of::region_range<SrcMeshType>::type         SrcRegionRangeType;
-    typedef typename viennagrid::result_of::iterator<SrcRegionRangeType>::type      SrcRegionRangeIterator;
+    bool merge(viennagrid::mesh const & output)
+    {
+      if (meshes.empty())
+        return true;
 
-    int region_id_offset = dst_mesh.region_count();
-    int source_region_count = src_mesh.region_count();
+      int geometric_dimension = viennagrid::geometric_dimension( meshes[0] );
+      std::vector<index_type> vertex_offsets( meshes.size()+1, 0 );
+      for (std::size_t m = 0; m != meshes.size(); ++m)
+      {
+        if (viennagrid::geometric_dimension(meshes[m]) != geometric_dimension && viennagrid::vertices(meshes[m]).size() != 0)
+        {
+          error(1) << "Mesh " << m << " has geometric dimension " << viennagrid::geometric_dimension(meshes[m])
+                   << ", expected " << geometric_dimension << std::endl;
+          return false;
+        }
 
-    ConstCellRangeType cells(src_mesh);
-    for (ConstCellIteratorType cit = cells.begin(); cit != cells.end(); ++cit)
-    {
-      CellType cell = copy_map(*cit);
+        vertex_offsets[m+1] = vertex_offsets[m] + viennagrid::vertices(meshes[m]).size();
+      }
 
-      if (source_region_count <= 1)
-        viennagrid::add( dst_mesh.get_or_create_region(region_offset ? region_id_offset : 0), cell );
+      index_type vertex_count = vertex_offsets.back();
+      std::vector<viennagrid_numeric> coords( geometric_dimension*vertex_count );
+      for (std::size_t m = 0; m != meshes.size(); ++m)
+      {
+        viennagrid_numeric * mesh_coords;
+        viennagrid_mesh_vertex_coords_pointer(meshes[m].internal(), &mesh_coords);
+        std::copy( mesh_coords, mesh_coords + geometric_dimension*(vertex_offsets[m+1]-vertex_offsets[m]),
+                   coords.begin() + geometric_dimension*vertex_offsets[m] );
+      }
+
+
+      // every vertex after the first mesh is matched with the smallest
+      // vertex within the tolerance, which is never a later one
+      std::vector<index_type> matches(vertex_count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < vertex_offsets[1]; ++i)
+        matches[i] = i;
+
+      if (tolerance > 0)
+      {
+        spatial_hash hash(&coords[0], vertex_count, geometric_dimension, tolerance);
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (index_type i = vertex_offsets[1]; i < vertex_count; ++i)
+        {
+          index_type match = hash.find( &coords[geometric_dimension*i] );
+          matches[i] = match < 0 ? i : match;
+        }
+      }
       else
       {
-        SrcRegionRangeType region_range(*cit);
-        for (SrcRegionRangeIterator rit = region_range.begin(); rit != region_range.end(); ++rit)
+        #pragma omp parallel for
+        for (index_type i = vertex_offsets[1]; i < vertex_count; ++i)
+          matches[i] = i;
+      }
+
+      // a matched vertex may have been matched itself, chains point to
+      // smaller indices so a single pass in index order resolves them
+      typedef viennagrid::result_of::point<viennagrid::mesh>::type PointType;
+
+      std::vector<viennagrid_element_id> vertex_ids(vertex_count);
+      index_type merged_vertex_count = 0;
+      for (index_type i = 0; i != vertex_count; ++i)
+      {
+        if (matches[i] == i)
+          vertex_ids[i] = viennagrid::make_vertex( output, PointType(geometric_dimension, &coords[geometric_dimension*i]) ).id().internal();
+        else
         {
-          viennagrid::add( dst_mesh.get_or_create_region((*rit).id() + (region_offset ? region_id_offset : 0)), cell );
+          vertex_ids[i] = vertex_ids[ matches[i] ];
+          ++merged_vertex_count;
         }
       }
+
+      info(1) << "Merged " << merged_vertex_count << " of " << vertex_count << " vertices" << std::endl;
+
+
+      for (std::size_t m = 0; m != meshes.size(); ++m)
+        merge_cells(meshes[m], output, &vertex_ids[vertex_offsets[m]]);
+
+      return true;
     }
-  }
+
+  private:
+
+    void merge_cells(viennagrid::mesh const & src_mesh, viennagrid::mesh const & dst_mesh,
+                     viennagrid_element_id const * vertex_ids)
+    {
+      typedef viennagrid::mesh                                                MeshType;
+      typedef viennagrid::result_of::element<MeshType>::type                  CellType;
+      typedef viennagrid::result_of::region_range<CellType>::type             SrcRegionRangeType;
+      typedef viennagrid::result_of::iterator<SrcRegionRangeType>::type       SrcRegionRangeIterator;
+
+      viennagrid_mesh mesh = src_mesh.internal();
+      int cell_dimension = viennagrid::cell_dimension(src_mesh);
+
+      viennagrid_element_id * cells_begin;
+      viennagrid_element_id * cells_end;
+      viennagrid_mesh_elements_get(mesh, cell_dimension, &cells_begin, &cells_end);
+      index_type cell_count = cells_end - cells_begin;
+
+      if (cell_count == 0)
+        return;
+
+      // regions as in the serial merge: the regions of the source are
+      // shifted by the number of regions already in the output
+      int region_id_offset = region_offset ? dst_region_ids.size() : 0;
+      int source_region_count = src_mesh.region_count();
+
+      std::vector<viennagrid_region_id> cell_region_ids(cell_count);
+      std::vector< std::pair<index_type, viennagrid_region_id> > additional_regions;
+      for (index_type c = 0; c != cell_count; ++c)
+      {
+        if (source_region_count <= 1)
+          cell_region_ids[c] = region_id_offset;
+        else
+        {
+          SrcRegionRangeType region_range( CellType(src_mesh, cells_begin[c]) );
+          cell_region_ids[c] = region_range.empty() ? region_id_offset : (*region_range.begin()).id() + region_id_offset;
+
+          SrcRegionRangeIterator rit = region_range.begin();
+          for (++rit; rit != region_range.end(); ++rit)
+            additional_regions.push_back( std::make_pair(c, (*rit).id() + region_id_offset) );
+        }
+      }
+
+      // regions have to exist before they are referenced in the batch
+      for (index_type c = 0; c != cell_count; ++c)
+        if (dst_region_ids.insert(cell_region_ids[c]).second)
+          dst_mesh.get_or_create_region(cell_region_ids[c]);
+
+
+      std::vector<viennagrid_element_type> element_types(cell_count);
+      std::vector<viennagrid_int> cell_vertex_offsets(cell_count+1);
+      cell_vertex_offsets[0] = 0;
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < cell_count; ++i)
+      {
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, cells_begin[i], 0, &vertices_begin, &vertices_end);
+
+        viennagrid_element_type_get(mesh, cells_begin[i], &element_types[i]);
+        cell_vertex_offsets[i+1] = vertices_end - vertices_begin;
+      }
+
+      for (index_type i = 0; i != cell_count; ++i)
+        cell_vertex_offsets[i+1] += cell_vertex_offsets[i];
+
+      std::vector<viennagrid_element_id> cell_vertex_indices( cell_vertex_offsets[cell_count] );
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < cell_count; ++i)
+      {
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, cells_begin[i], 0, &vertices_begin, &vertices_end);
+
+        viennagrid_int offset = cell_vertex_offsets[i];
+        for (viennagrid_element_id * vit = vertices_begin; vit != vertices_end; ++vit, ++offset)
+          cell_vertex_indices[offset] = vertex_ids[ viennagrid_index_from_element_id(*vit) ];
+      }
+
+      // the batch returns the existing cell if an equal cell is already in
+      // the output (e.g. a cell of two regions after split_mesh), so the
+      // additional regions are attached through the returned ids
+      std::vector<viennagrid_element_id> created(cell_count);
+      viennagrid_mesh_element_batch_create( dst_mesh.internal(),
+                                            cell_count, &element_types[0],
+                                            &cell_vertex_offsets[0], &cell_vertex_indices[0],
+                                            &cell_region_ids[0], &created[0] );
+
+      // cells in more than one region are the rare case
+      for (std::size_t i = 0; i != additional_regions.size(); ++i)
+      {
+        dst_region_ids.insert(additional_regions[i].second);
+        viennagrid::add( dst_mesh.get_or_create_region(additional_regions[i].second),
+                         CellType(dst_mesh, created[additional_regions[i].first]) );
+      }
+    }
+
+    double tolerance;
+    bool region_offset;
+
+    std::vector<viennagrid::mesh> meshes;
+    std::set<viennagrid_region_id> dst_region_ids;
+  };
 
 
 
@@ -74,15 +241,12 @@ namespace viennamesh
 
     info(1) << "Using region offset: " << std::boolalpha << region_offset << std::endl;
 
-    int merged_count = 0;
+    mesh_merger merger(tolerance, region_offset);
     if (input_mesh.valid())
     {
       int mesh_count = input_mesh.size();
       for (int i = 0; i != mesh_count; ++i)
-      {
-        merge_meshes_impl( input_mesh(i), output_mesh(), (merged_count == 0 ? -1 : tolerance), region_offset );
-        ++merged_count;
-      }
+        merger.add( input_mesh(i).internal() );
     }
 
     int mesh_index = 0;
@@ -96,10 +260,7 @@ namespace viennamesh
 
       int mesh_count = another_input_mesh.size();
       for (int i = 0; i != mesh_count; ++i)
-      {
-        merge_meshes_impl( another_input_mesh(i), output_mesh(), (merged_count == 0 ? -1 : tolerance), region_offset );
-        ++merged_count;
-      }
+        merger.add( another_input_mesh(i).internal() );
 
       ++mesh_index;
     }
@@ -119,7 +280,10 @@ namespace viennamesh
 //       input_mesh = get_input<mesh_handle>("mesh[" + lexical_cast<std::string>(index++) + "]");
 //     }
 
-    info(1) << "Merged " << merged_count << " meshes" << std::endl;
+    if (!merger.merge( output_mesh() ))
+      return false;
+
+    info(1) << "Merged " << merger.size() << " meshes" << std::endl;
 
     set_output( "mesh", output_mesh );
 
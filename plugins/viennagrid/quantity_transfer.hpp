@@ -0,0 +1,555 @@
+#ifndef VIENNAMESH_ALGORITHM_VIENNAGRID_QUANTITY_TRANSFER_HPP
+#define VIENNAMESH_ALGORITHM_VIENNAGRID_QUANTITY_TRANSFER_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "simplex_refinement.hpp"
+
+namespace viennamesh
+{
+
+  // Uniform grid over the bounding box of a simplex mesh, every grid cell
+  // lists the mesh cells whose bounding box overlaps it (CSR layout). The
+  // grid is read-only after init() so that queries can run concurrently.
+  class simplex_cell_grid
+  {
+  public:
+
+    typedef simplex_cells::index_type index_type;
+
+    void init(simplex_cells const & cells_)
+    {
+      cells = &cells_;
+      dimension = cells->geometric_dimension;
+      index_type count = cells->cell_count();
+      int per_cell = cells->vertices_per_cell();
+
+      std::vector<double> boxes(2*dimension*count);
+      double extent_sum = 0.0;
+
+      #pragma omp parallel for reduction(+:extent_sum)
+      for (index_type c = 0; c < count; ++c)
+      {
+        double * box = &boxes[2*dimension*c];
+        for (int d = 0; d != dimension; ++d)
+        {
+          box[d] = std::numeric_limits<double>::max();
+          box[dimension+d] = -std::numeric_limits<double>::max();
+        }
+
+        for (int k = 0; k != per_cell; ++k)
+        {
+          viennagrid_numeric const * p = cells->vertex_coords( cells->cell_vertices(c)[k] );
+          for (int d = 0; d != dimension; ++d)
+          {
+            box[d] = std::min(box[d], p[d]);
+            box[dimension+d] = std::max(box[dimension+d], p[d]);
+          }
+        }
+
+        double extent = 0.0;
+        for (int d = 0; d != dimension; ++d)
+          extent = std::max(extent, box[dimension+d]-box[d]);
+        extent_sum += extent;
+      }
+
+      for (int d = 0; d != 3; ++d)
+      {
+        lower[d] = 0.0;
+        size[d] = 1;
+      }
+
+      for (int d = 0; d != dimension; ++d)
+      {
+        lower[d] = std::numeric_limits<double>::max();
+        double upper = -std::numeric_limits<double>::max();
+        for (index_type c = 0; c < count; ++c)
+        {
+          lower[d] = std::min(lower[d], boxes[2*dimension*c+d]);
+          upper = std::max(upper, boxes[2*dimension*c+dimension+d]);
+        }
+        extent[d] = count > 0 ? upper-lower[d] : 0.0;
+      }
+
+      // grid cells have about the size of an average mesh cell, the number
+      // of grid cells is bounded by a multiple of the number of mesh cells
+      spacing = count > 0 ? extent_sum / count : 1.0;
+      if (spacing <= 0.0)
+        spacing = 1.0;
+
+      while (true)
+      {
+        double total = 1.0;
+        for (int d = 0; d != dimension; ++d)
+        {
+          size[d] = std::max( static_cast<index_type>(1), static_cast<index_type>(std::ceil(extent[d] / spacing)) );
+          total *= size[d];
+        }
+
+        if (total <= 4.0*count + 64.0)
+          break;
+        spacing *= 2.0;
+      }
+
+      index_type grid_cell_count = size[0]*size[1]*size[2];
+      std::vector< std::atomic<index_type> > fill(grid_cell_count);
+
+      #pragma omp parallel for
+      for (index_type g = 0; g < grid_cell_count; ++g)
+        fill[g].store(0, std::memory_order_relaxed);
+
+      #pragma omp parallel for
+      for (index_type c = 0; c < count; ++c)
+      {
+        index_type first[3];
+        index_type last[3];
+        box_range(&boxes[2*dimension*c], first, last);
+
+        for (index_type z = first[2]; z <= last[2]; ++z)
+          for (index_type y = first[1]; y <= last[1]; ++y)
+            for (index_type x = first[0]; x <= last[0]; ++x)
+              fill[ (z*size[1] + y)*size[0] + x ].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      offsets.resize(grid_cell_count+1);
+      offsets[0] = 0;
+      for (index_type g = 0; g != grid_cell_count; ++g)
+      {
+        offsets[g+1] = offsets[g] + fill[g].load(std::memory_order_relaxed);
+        fill[g].store(offsets[g], std::memory_order_relaxed);
+      }
+
+      grid_cells.resize( offsets[grid_cell_count] );
+
+      #pragma omp parallel for
+      for (index_type c = 0; c < count; ++c)
+      {
+        index_type first[3];
+        index_type last[3];
+        box_range(&boxes[2*dimension*c], first, last);
+
+        for (index_type z = first[2]; z <= last[2]; ++z)
+          for (index_type y = first[1]; y <= last[1]; ++y)
+            for (index_type x = first[0]; x <= last[0]; ++x)
+              grid_cells[ fill[(z*size[1] + y)*size[0] + x].fetch_add(1, std::memory_order_relaxed) ] = c;
+      }
+
+      // keep the cell lists sorted so that queries are deterministic
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type g = 0; g < grid_cell_count; ++g)
+        std::sort( grid_cells.begin() + offsets[g], grid_cells.begin() + offsets[g+1] );
+    }
+
+
+    // Locates point p: returns the mesh cell containing p and its barycentric
+    // coordinates. If no cell contains p, the cell closest to p is used and
+    // the barycentric coordinates are clamped to it; returns -1 for an empty
+    // mesh. outside is set to true if the fallback was used.
+    index_type locate(viennagrid_numeric const * p, viennagrid_numeric * weights, bool & outside) const
+    {
+      static const double inside_tolerance = 1e-10;
+
+      index_type cell[3];
+      grid_position(p, cell);
+
+      // cells of the grid cell of p, the containing cell is the one where p
+      // is deepest inside
+      index_type best = -1;
+      double best_min_weight = -std::numeric_limits<double>::max();
+      viennagrid_numeric w[4];
+
+      index_type g = (cell[2]*size[1] + cell[1])*size[0] + cell[0];
+      for (index_type i = offsets[g]; i != offsets[g+1]; ++i)
+      {
+        double min_weight = barycentric(grid_cells[i], p, w);
+        if (min_weight > best_min_weight)
+        {
+          best_min_weight = min_weight;
+          best = grid_cells[i];
+        }
+      }
+
+      outside = !(best_min_weight >= -inside_tolerance);
+      if (!outside)
+      {
+        barycentric(best, p, weights);
+        return best;
+      }
+
+      // nearest-cell fallback: search growing shells of grid cells until
+      // candidates are found, then one more shell because a closer cell
+      // can be registered in a neighbouring grid cell
+      best = -1;
+      double best_distance = std::numeric_limits<double>::max();
+      index_type max_radius = std::max(size[0], std::max(size[1], size[2]));
+      index_type found_radius = -1;
+
+      for (index_type radius = 0; radius <= max_radius; ++radius)
+      {
+        if (found_radius >= 0 && radius > found_radius+1)
+          break;
+
+        for (index_type z = cell[2]-radius; z <= cell[2]+radius; ++z)
+          for (index_type y = cell[1]-radius; y <= cell[1]+radius; ++y)
+            for (index_type x = cell[0]-radius; x <= cell[0]+radius; ++x)
+            {
+              if (x < 0 || y < 0 || z < 0 || x >= size[0] || y >= size[1] || z >= size[2])
+                continue;
+              if (std::max(std::abs(x-cell[0]), std::max(std::abs(y-cell[1]), std::abs(z-cell[2]))) != radius)
+                continue;
+
+              g = (z*size[1] + y)*size[0] + x;
+              for (index_type i = offsets[g]; i != offsets[g+1]; ++i)
+              {
+                double distance = clamped_distance(grid_cells[i], p, w);
+                if (distance < best_distance || (distance == best_distance && grid_cells[i] < best))
+                {
+                  best_distance = distance;
+                  best = grid_cells[i];
+                }
+              }
+
+              if (best >= 0 && found_radius < 0)
+                found_radius = radius;
+            }
+      }
+
+      if (best >= 0)
+        clamped_distance(best, p, weights);
+      return best;
+    }
+
+  private:
+
+    void grid_position(double const * p, index_type * cell) const
+    {
+      for (int d = 0; d != 3; ++d)
+      {
+        cell[d] = 0;
+        if (d < dimension)
+        {
+          double x = std::floor( (p[d]-lower[d]) / spacing );
+          x = std::max(0.0, std::min(x, static_cast<double>(size[d]-1)));
+          cell[d] = static_cast<index_type>(x);
+        }
+      }
+    }
+
+    void box_range(double const * box, index_type * first, index_type * last) const
+    {
+      grid_position(box, first);
+      grid_position(box+dimension, last);
+    }
+
+    // Barycentric coordinates of p with respect to cell c, points off the
+    // affine hull of lower dimensional cells are projected onto it. Returns
+    // the smallest coordinate.
+    double barycentric(index_type c, viennagrid_numeric const * p, viennagrid_numeric * weights) const
+    {
+      int k = cells->cell_dimension;
+      index_type const * v = cells->cell_vertices(c);
+      viennagrid_numeric const * x0 = cells->vertex_coords(v[0]);
+
+      double e[3][3];
+      double r[3];
+      for (int i = 0; i != k; ++i)
+      {
+        viennagrid_numeric const * xi = cells->vertex_coords(v[i+1]);
+        for (int d = 0; d != dimension; ++d)
+          e[i][d] = xi[d] - x0[d];
+      }
+
+      // normal equations G l = E^T (p - x0) with the Gram matrix G = E^T E
+      double g[3][3];
+      for (int i = 0; i != k; ++i)
+      {
+        r[i] = 0.0;
+        for (int d = 0; d != dimension; ++d)
+          r[i] += e[i][d] * (p[d]-x0[d]);
+        for (int j = 0; j != k; ++j)
+        {
+          g[i][j] = 0.0;
+          for (int d = 0; d != dimension; ++d)
+            g[i][j] += e[i][d]*e[j][d];
+        }
+      }
+
+      double l[3] = {0.0, 0.0, 0.0};
+      if (k == 1)
+      {
+        if (g[0][0] != 0.0)
+          l[0] = r[0] / g[0][0];
+      }
+      else if (k == 2)
+      {
+        double det = g[0][0]*g[1][1] - g[0][1]*g[1][0];
+        if (det != 0.0)
+        {
+          l[0] = (r[0]*g[1][1] - g[0][1]*r[1]) / det;
+          l[1] = (g[0][0]*r[1] - r[0]*g[1][0]) / det;
+        }
+      }
+      else
+      {
+        double det = g[0][0]*(g[1][1]*g[2][2] - g[1][2]*g[2][1])
+                   - g[0][1]*(g[1][0]*g[2][2] - g[1][2]*g[2][0])
+                   + g[0][2]*(g[1][0]*g[2][1] - g[1][1]*g[2][0]);
+        if (det != 0.0)
+        {
+          // Cramer's rule
+          for (int i = 0; i != 3; ++i)
+          {
+            double m[3][3];
+            for (int a = 0; a != 3; ++a)
+              for (int b = 0; b != 3; ++b)
+                m[a][b] = (b == i) ? r[a] : g[a][b];
+            l[i] = ( m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+                   - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+                   + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]) ) / det;
+          }
+        }
+      }
+
+      weights[0] = 1.0;
+      for (int i = 0; i != k; ++i)
+      {
+        weights[i+1] = l[i];
+        weights[0] -= l[i];
+      }
+
+      double min_weight = weights[0];
+      for (int i = 1; i <= k; ++i)
+        min_weight = std::min(min_weight, weights[i]);
+      return min_weight;
+    }
+
+    // Clamps the barycentric coordinates of p to cell c and returns the
+    // squared distance between p and the clamped point
+    double clamped_distance(index_type c, viennagrid_numeric const * p, viennagrid_numeric * weights) const
+    {
+      int k = cells->cell_dimension;
+      barycentric(c, p, weights);
+
+      double sum = 0.0;
+      for (int i = 0; i <= k; ++i)
+      {
+        weights[i] = std::max(weights[i], 0.0);
+        sum += weights[i];
+      }
+      for (int i = 0; i <= k; ++i)
+        weights[i] = sum > 0.0 ? weights[i]/sum : 1.0/(k+1);
+
+      index_type const * v = cells->cell_vertices(c);
+      double distance = 0.0;
+      for (int d = 0; d != dimension; ++d)
+      {
+        double x = 0.0;
+        for (int i = 0; i <= k; ++i)
+          x += weights[i] * cells->vertex_coords(v[i])[d];
+        distance += (x-p[d])*(x-p[d]);
+      }
+      return distance;
+    }
+
+    simplex_cells const * cells;
+    int dimension;
+
+    double lower[3];
+    double extent[3];
+    double spacing;
+    index_type size[3];
+
+    std::vector<index_type> offsets;
+    std::vector<index_type> grid_cells;
+  };
+
+
+
+  // Transfers quantity fields from a simplex source mesh to an arbitrary
+  // destination mesh. All destination vertices (and cell centroids) are
+  // located once in init(), the source cells and barycentric weights are
+  // cached and applied to any number of fields afterwards. Vertex fields are
+  // interpolated linearly, cell fields take the value of the source cell
+  // containing the centroid of the destination cell.
+  class quantity_transfer
+  {
+  public:
+
+    typedef simplex_cells::index_type index_type;
+
+    // returns false if the source mesh has non-simplex cells or if the
+    // meshes have different geometric dimensions
+    bool init(viennagrid_mesh src_mesh, viennagrid_mesh dst_mesh)
+    {
+      if (!src.init(src_mesh))
+        return false;
+
+      // the destination coordinates are read with the source dimension
+      int dimension = src.geometric_dimension;
+      if (viennagrid::geometric_dimension( viennagrid::mesh(dst_mesh) ) != dimension)
+        return false;
+
+      grid.init(src);
+      int per_cell = src.vertices_per_cell();
+
+      viennagrid_element_id * vertices_begin;
+      viennagrid_element_id * vertices_end;
+      viennagrid_mesh_elements_get(dst_mesh, 0, &vertices_begin, &vertices_end);
+      dst_vertex_indices.resize(vertices_end - vertices_begin);
+
+      viennagrid_numeric * dst_coords;
+      viennagrid_mesh_vertex_coords_pointer(dst_mesh, &dst_coords);
+
+      index_type vertex_count = dst_vertex_indices.size();
+      vertex_cells.resize(vertex_count);
+      vertex_weights.resize(per_cell*vertex_count);
+      index_type outside = 0;
+
+      #pragma omp parallel for reduction(+:outside)
+      for (index_type i = 0; i < vertex_count; ++i)
+      {
+        dst_vertex_indices[i] = viennagrid_index_from_element_id(vertices_begin[i]);
+
+        bool is_outside;
+        vertex_cells[i] = grid.locate(dst_coords + dimension*dst_vertex_indices[i], &vertex_weights[per_cell*i], is_outside);
+        if (is_outside)
+          ++outside;
+      }
+      outside_vertex_count = outside;
+
+
+      dst_cell_dimension = viennagrid::cell_dimension( viennagrid::mesh(dst_mesh) );
+
+      viennagrid_element_id * cells_begin;
+      viennagrid_element_id * cells_end;
+      viennagrid_mesh_elements_get(dst_mesh, dst_cell_dimension, &cells_begin, &cells_end);
+      dst_cell_indices.resize(cells_end - cells_begin);
+
+      index_type cell_count = dst_cell_indices.size();
+      cell_cells.resize(cell_count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < cell_count; ++i)
+      {
+        dst_cell_indices[i] = viennagrid_index_from_element_id(cells_begin[i]);
+
+        viennagrid_element_id * cell_vertices_begin;
+        viennagrid_element_id * cell_vertices_end;
+        viennagrid_element_boundary_elements(dst_mesh, cells_begin[i], 0, &cell_vertices_begin, &cell_vertices_end);
+
+        viennagrid_numeric centroid[3] = {0.0, 0.0, 0.0};
+        for (viennagrid_element_id * vit = cell_vertices_begin; vit != cell_vertices_end; ++vit)
+          for (int d = 0; d != dimension; ++d)
+            centroid[d] += dst_coords[dimension*viennagrid_index_from_element_id(*vit)+d];
+        for (int d = 0; d != dimension; ++d)
+          centroid[d] /= (cell_vertices_end - cell_vertices_begin);
+
+        viennagrid_numeric weights[4];
+        bool is_outside;
+        index_type c = grid.locate(centroid, weights, is_outside);
+        cell_cells[i] = c < 0 ? -1 : viennagrid_index_from_element_id(src.cell_ids[c]);
+      }
+
+      return true;
+    }
+
+    // number of destination vertices which are not inside any source cell
+    // and use the nearest-cell fallback
+    index_type outside_count() const { return outside_vertex_count; }
+
+    // Initializes dst for src, returns false for fields which are neither
+    // vertex nor cell fields
+    bool prepare(viennagrid::quantity_field const & src_qf, viennagrid::quantity_field & dst_qf) const
+    {
+      int topologic_dimension = src_qf.topologic_dimension();
+      if (topologic_dimension != 0 && topologic_dimension != src.cell_dimension)
+        return false;
+
+      dst_qf.init( topologic_dimension == 0 ? 0 : dst_cell_dimension, src_qf.values_per_quantity(), src_qf.storage_layout() );
+      dst_qf.set_name( src_qf.get_name() );
+      return true;
+    }
+
+    // Applies the cached weights to a field prepared with prepare(), fields
+    // are independent so that several of them can be applied concurrently
+    void apply(viennagrid::quantity_field const & src_qf, viennagrid::quantity_field & dst_qf) const
+    {
+      int values = src_qf.values_per_quantity();
+      int per_cell = src.vertices_per_cell();
+      std::vector<viennagrid_numeric> value(values);
+
+      if (src_qf.topologic_dimension() == 0)
+      {
+        for (index_type i = 0; i != static_cast<index_type>(vertex_cells.size()); ++i)
+        {
+          if (vertex_cells[i] < 0)
+            continue;
+
+          std::fill(value.begin(), value.end(), 0.0);
+          index_type const * v = src.cell_vertices(vertex_cells[i]);
+          viennagrid_numeric const * w = &vertex_weights[per_cell*i];
+
+          bool complete = true;
+          for (int k = 0; k != per_cell && complete; ++k)
+          {
+            void * src_value;
+            if (viennagrid_quantity_field_value_get(src_qf.internal(), v[k], &src_value) != VIENNAGRID_SUCCESS || !src_value)
+              complete = false;
+            else
+              for (int j = 0; j != values; ++j)
+                value[j] += w[k] * static_cast<viennagrid_numeric*>(src_value)[j];
+          }
+
+          if (complete)
+            viennagrid_quantity_field_value_set(dst_qf.internal(), dst_vertex_indices[i], &value[0]);
+        }
+      }
+      else
+      {
+        for (index_type i = 0; i != static_cast<index_type>(cell_cells.size()); ++i)
+        {
+          void * src_value;
+          if (cell_cells[i] >= 0 &&
+              viennagrid_quantity_field_value_get(src_qf.internal(), cell_cells[i], &src_value) == VIENNAGRID_SUCCESS && src_value)
+            viennagrid_quantity_field_value_set(dst_qf.internal(), dst_cell_indices[i], src_value);
+        }
+      }
+    }
+
+  private:
+
+    simplex_cells src;
+    simplex_cell_grid grid;
+
+    std::vector<index_type> dst_vertex_indices;
+    std::vector<index_type> vertex_cells;
+    std::vector<viennagrid_numeric> vertex_weights;
+    index_type outside_vertex_count;
+
+    int dst_cell_dimension;
+    std::vector<index_type> dst_cell_indices;
+    std::vector<index_type> cell_cells;
+  };
+
+}
+
+#endif
@@ -0,0 +1,481 @@
+#ifndef VIENNAMESH_ALGORITHM_VIENNAGRID_SIMPLEX_REFINEMENT_HPP
+#define VIENNAMESH_ALGORITHM_VIENNAGRID_SIMPLEX_REFINEMENT_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+
+#include "viennagrid/viennagrid.hpp"
+#include "viennameshpp/plugin.hpp"
+
+namespace viennamesh
+{
+
+  // Flat connectivity of a mesh whose cells are all simplices (lines,
+  // triangles or tetrahedra). Vertices are addressed by their element index.
+  class simplex_cells
+  {
+  public:
+
+    typedef viennagrid_int index_type;
+
+    // returns false if the mesh has cells which are not simplices of the
+    // cell dimension
+    bool init(viennagrid_mesh mesh_)
+    {
+      mesh = mesh_;
+      cell_dimension = viennagrid::cell_dimension( viennagrid::mesh(mesh) );
+      geometric_dimension = viennagrid::geometric_dimension( viennagrid::mesh(mesh) );
+
+      if (cell_dimension < 1 || cell_dimension > 3)
+        return false;
+
+      switch (cell_dimension)
+      {
+        case 1: cell_type = VIENNAGRID_ELEMENT_TYPE_LINE; break;
+        case 2: cell_type = VIENNAGRID_ELEMENT_TYPE_TRIANGLE; break;
+        default: cell_type = VIENNAGRID_ELEMENT_TYPE_TETRAHEDRON; break;
+      }
+
+      viennagrid_element_id * cells_begin;
+      viennagrid_element_id * cells_end;
+      viennagrid_mesh_elements_get(mesh, cell_dimension, &cells_begin, &cells_end);
+      cell_ids.assign(cells_begin, cells_end);
+
+      viennagrid_element_id * vertices_begin;
+      viennagrid_element_id * vertices_end;
+      viennagrid_mesh_elements_get(mesh, 0, &vertices_begin, &vertices_end);
+      vertex_count = vertices_end - vertices_begin;
+
+      viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
+
+      index_type count = cell_count();
+      int per_cell = vertices_per_cell();
+      vertices.resize(per_cell*count);
+      int not_simplex = 0;
+
+      #pragma omp parallel for reduction(+:not_simplex)
+      for (index_type c = 0; c < count; ++c)
+      {
+        viennagrid_element_type type;
+        viennagrid_element_type_get(mesh, cell_ids[c], &type);
+
+        viennagrid_element_id * cell_vertices_begin;
+        viennagrid_element_id * cell_vertices_end;
+        viennagrid_element_boundary_elements(mesh, cell_ids[c], 0, &cell_vertices_begin, &cell_vertices_end);
+
+        if (type != cell_type || cell_vertices_end-cell_vertices_begin != per_cell)
+        {
+          ++not_simplex;
+          continue;
+        }
+
+        for (int k = 0; k != per_cell; ++k)
+          vertices[per_cell*c+k] = viennagrid_index_from_element_id(cell_vertices_begin[k]);
+      }
+
+      return not_simplex == 0;
+    }
+
+    index_type cell_count() const { return cell_ids.size(); }
+    int vertices_per_cell() const { return cell_dimension+1; }
+
+    index_type const * cell_vertices(index_type c) const { return &vertices[vertices_per_cell()*c]; }
+    viennagrid_numeric const * vertex_coords(index_type v) const { return coords + geometric_dimension*v; }
+
+    viennagrid_mesh mesh;
+    int cell_dimension;
+    int geometric_dimension;
+    viennagrid_element_type cell_type;
+
+    index_type vertex_count;
+    viennagrid_numeric * coords;
+
+    std::vector<viennagrid_element_id> cell_ids;
+    std::vector<index_type> vertices;
+  };
+
+
+  // the edges of a simplex as pairs of local vertex indices
+  inline int simplex_edge_count(int cell_dimension)
+  { return (cell_dimension+1)*cell_dimension/2; }
+
+  inline int simplex_edge_vertex(int e, int i)
+  {
+    static const int edges[6][2] = { {0,1}, {0,2}, {0,3}, {1,2}, {1,3}, {2,3} };
+    return edges[e][i];
+  }
+
+  // the local edge index of a tetrahedron/triangle/line edge between the
+  // local vertices i and j, edges of lower dimensional simplices are
+  // renumbered so that all of them are consecutive
+  inline int simplex_local_edge(int cell_dimension, int i, int j)
+  {
+    static const int tetrahedron_edges[4][4] = { {-1,0,1,2}, {0,-1,3,4}, {1,3,-1,5}, {2,4,5,-1} };
+    static const int triangle_edges[3][3] = { {-1,0,1}, {0,-1,2}, {1,2,-1} };
+
+    if (cell_dimension == 3)
+      return tetrahedron_edges[i][j];
+    if (cell_dimension == 2)
+      return triangle_edges[i][j];
+    return 0;
+  }
+
+  inline int simplex_edge_vertex(int cell_dimension, int e, int i)
+  {
+    static const int triangle_edges[3][2] = { {0,1}, {0,2}, {1,2} };
+    if (cell_dimension == 2)
+      return triangle_edges[e][i];
+    return simplex_edge_vertex(e, i);
+  }
+
+
+
+  // Concurrent hash table which gives every edge of a mesh a unique new
+  // point, e.g. its midpoint or its intersection with a hyperplane. Edges
+  // are keyed by their (sorted) vertex indices and inserted with open
+  // addressing and compare-and-swap, so all cells can register their edges
+  // in parallel. Each insert carries a request number (e.g. cell*edges+edge),
+  // the smallest request of an edge owns it. Numbering the points in the
+  // order of their owners makes the result independent of the thread
+  // interleaving.
+  class edge_point_table
+  {
+  public:
+
+    typedef viennagrid_int index_type;
+    typedef unsigned long long key_type;
+
+    explicit edge_point_table(std::size_t expected_edges)
+    {
+      std::size_t capacity = 16;
+      while (capacity < 2*expected_edges)
+        capacity *= 2;
+
+      mask = capacity-1;
+      shift = 64;
+      for (std::size_t c = capacity; c > 1; c /= 2)
+        --shift;
+
+      std::vector< std::atomic<key_type> > tmp_keys(capacity);
+      std::vector< std::atomic<index_type> > tmp_owners(capacity);
+      keys.swap(tmp_keys);
+      owners.swap(tmp_owners);
+      points.resize(capacity);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < static_cast<index_type>(capacity); ++i)
+      {
+        keys[i].store(empty_key(), std::memory_order_relaxed);
+        owners[i].store(std::numeric_limits<index_type>::max(), std::memory_order_relaxed);
+      }
+    }
+
+    // registers the edge between the vertices v0 and v1 for a request and
+    // returns its slot, safe to call concurrently
+    index_type insert(index_type v0, index_type v1, index_type request)
+    {
+      key_type key = make_key(v0, v1);
+      std::size_t slot = static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift);
+
+      while (true)
+      {
+        key_type current = keys[slot].load(std::memory_order_relaxed);
+        if (current == empty_key() &&
+            keys[slot].compare_exchange_strong(current, key, std::memory_order_relaxed))
+          break;
+
+        if (current == key)
+          break;
+
+        slot = (slot+1) & mask;
+      }
+
+      index_type owner = owners[slot].load(std::memory_order_relaxed);
+      while (request < owner &&
+             !owners[slot].compare_exchange_weak(owner, request, std::memory_order_relaxed)) {}
+
+      return slot;
+    }
+
+    // Numbers the points of all registered edges in the order of their
+    // owning requests, starting at first_point. slots holds the slot of
+    // every request (or -1 for requests without an edge). The two vertices
+    // of each new point are appended to point_edges; returns the number of
+    // new points.
+    index_type assign_points(std::vector<index_type> const & slots, index_type first_point,
+                             std::vector<index_type> & point_edges)
+    {
+      index_type next = first_point;
+      for (index_type r = 0; r != static_cast<index_type>(slots.size()); ++r)
+      {
+        index_type slot = slots[r];
+        if (slot < 0 || owners[slot].load(std::memory_order_relaxed) != r)
+          continue;
+
+        points[slot] = next++;
+        point_edges.push_back( edge_vertex(slot, 0) );
+        point_edges.push_back( edge_vertex(slot, 1) );
+      }
+
+      return next-first_point;
+    }
+
+    index_type point(index_type slot) const { return points[slot]; }
+
+    // the smaller (i=0) or larger (i=1) vertex of the edge in a slot
+    index_type edge_vertex(index_type slot, int i) const
+    {
+      key_type key = keys[slot].load(std::memory_order_relaxed);
+      return static_cast<index_type>( i == 0 ? (key >> 32) : (key & 0xFFFFFFFFULL) );
+    }
+
+  private:
+
+    static key_type empty_key() { return ~key_type(0); }
+
+    static key_type make_key(index_type v0, index_type v1)
+    {
+      if (v1 < v0)
+        std::swap(v0, v1);
+      return (static_cast<key_type>(v0) << 32) | static_cast<key_type>(v1);
+    }
+
+    std::size_t mask;
+    int shift;
+
+    std::vector< std::atomic<key_type> > keys;
+    std::vector< std::atomic<index_type> > owners;
+    std::vector<index_type> points;
+  };
+
+
+
+  // The result of a refinement kernel. Output vertices are the kept input
+  // vertices followed by the new points, each new point lies on an input
+  // edge. Every child cell references its parent cell, which provides its
+  // region and its cell quantities.
+  struct simplex_refinement
+  {
+    typedef viennagrid_int index_type;
+
+    index_type output_vertex_count() const { return kept_vertices.size() + point_weights.size(); }
+    index_type child_count() const { return child_parents.size(); }
+
+    // input vertex index of each kept output vertex
+    std::vector<index_type> kept_vertices;
+
+    // the two input vertices of each new point (smaller index first) and the
+    // weight of the second one
+    std::vector<index_type> point_edges;
+    std::vector<viennagrid_numeric> point_weights;
+
+    // output vertex indices of the children, vertices_per_cell() per child
+    std::vector<index_type> child_vertices;
+    std::vector<index_type> child_parents;
+  };
+
+
+  inline void refined_point(simplex_cells const & cells, simplex_refinement const & refinement,
+                            simplex_refinement::index_type p, viennagrid_numeric * result)
+  {
+    viennagrid_numeric const * c0 = cells.vertex_coords( refinement.point_edges[2*p+0] );
+    viennagrid_numeric const * c1 = cells.vertex_coords( refinement.point_edges[2*p+1] );
+    viennagrid_numeric w = refinement.point_weights[p];
+
+    for (int d = 0; d != cells.geometric_dimension; ++d)
+      result[d] = (1.0-w)*c0[d] + w*c1[d];
+  }
+
+
+  // Creates the vertices, regions and cells of a refinement in an empty
+  // output mesh, children are created in one batch and belong to the first
+  // region of their parent.
+  inline void write_refined_mesh(simplex_cells const & cells, simplex_refinement const & refinement,
+                                 viennagrid_mesh output_mesh)
+  {
+    typedef simplex_refinement::index_type index_type;
+
+    typedef viennagrid::mesh                                        MeshType;
+    typedef viennagrid::result_of::point<MeshType>::type            PointType;
+    typedef viennagrid::result_of::element<MeshType>::type          ElementType;
+    typedef viennagrid::result_of::region<MeshType>::type           RegionType;
+    typedef viennagrid::result_of::region_range<MeshType>::type     RegionRangeType;
+    typedef viennagrid::result_of::region_range<ElementType>::type  ElementRegionRangeType;
+    typedef viennagrid::result_of::iterator<RegionRangeType>::type  RegionRangeIterator;
+
+    MeshType input(cells.mesh);
+    MeshType output(output_mesh);
+
+    int dim = cells.geometric_dimension;
+    index_type kept_count = refinement.kept_vertices.size();
+    index_type point_count = refinement.point_weights.size();
+
+    std::vector<viennagrid_element_id> vertex_ids( kept_count+point_count );
+    for (index_type i = 0; i != kept_count; ++i)
+      vertex_ids[i] = viennagrid::make_vertex( output, PointType(dim, cells.vertex_coords(refinement.kept_vertices[i])) ).id().internal();
+
+    std::vector<viennagrid_numeric> coords(dim);
+    for (index_type p = 0; p != point_count; ++p)
+    {
+      refined_point(cells, refinement, p, &coords[0]);
+      vertex_ids[kept_count+p] = viennagrid::make_vertex( output, PointType(dim, &coords[0]) ).id().internal();
+    }
+
+
+    // regions have to exist before they are referenced in the batch
+    std::vector<viennagrid_region_id> parent_regions;
+    RegionRangeType regions(input);
+    if (!regions.empty())
+    {
+      for (RegionRangeIterator rit = regions.begin(); rit != regions.end(); ++rit)
+      {
+        RegionType region = output.get_or_create_region( (*rit).id() );
+        region.set_name( (*rit).get_name() );
+      }
+
+      parent_regions.resize( cells.cell_count() );
+      for (index_type c = 0; c != cells.cell_count(); ++c)
+      {
+        ElementRegionRangeType cell_regions( ElementType(input, cells.cell_ids[c]) );
+        parent_regions[c] = cell_regions.empty() ? (*regions.begin()).id() : (*cell_regions.begin()).id();
+      }
+    }
+
+
+    index_type child_count = refinement.child_count();
+    if (child_count == 0)
+      return;
+
+    int per_cell = cells.vertices_per_cell();
+    std::vector<viennagrid_element_type> element_types(child_count, cells.cell_type);
+    std::vector<viennagrid_int> cell_vertex_offsets(child_count+1);
+    std::vector<viennagrid_element_id> cell_vertex_ids(per_cell*child_count);
+    std::vector<viennagrid_region_id> cell_region_ids;
+    if (!parent_regions.empty())
+      cell_region_ids.resize(child_count);
+
+    #pragma omp parallel for
+    for (index_type i = 0; i < child_count; ++i)
+    {
+      cell_vertex_offsets[i] = per_cell*i;
+      for (int k = 0; k != per_cell; ++k)
+        cell_vertex_ids[per_cell*i+k] = vertex_ids[ refinement.child_vertices[per_cell*i+k] ];
+
+      if (!parent_regions.empty())
+        cell_region_ids[i] = parent_regions[ refinement.child_parents[i] ];
+    }
+    cell_vertex_offsets[child_count] = per_cell*child_count;
+
+    viennagrid_mesh_element_batch_create( output.internal(),
+                                          child_count, &element_types[0],
+                                          &cell_vertex_offsets[0], &cell_vertex_ids[0],
+                                          cell_region_ids.empty() ? NULL : &cell_region_ids[0], NULL );
+  }
+
+
+  // Transfers a quantity field of the input mesh to the refined mesh. Vertex
+  // quantities are interpolated linearly onto the new points, cell
+  // quantities are inherited by the children. Returns false for quantity
+  // fields on other elements.
+  inline bool transfer_refined_quantities(simplex_cells const & cells, simplex_refinement const & refinement,
+                                          viennagrid::quantity_field const & src, viennagrid::quantity_field & dst)
+  {
+    typedef simplex_refinement::index_type index_type;
+
+    int topologic_dimension = src.topologic_dimension();
+    if (topologic_dimension != 0 && topologic_dimension != cells.cell_dimension)
+      return false;
+
+    int values = src.values_per_quantity();
+    dst.init( topologic_dimension, values );
+    dst.set_name( src.get_name() );
+
+    if (topologic_dimension == 0)
+    {
+      index_type kept_count = refinement.kept_vertices.size();
+      for (index_type i = 0; i != kept_count; ++i)
+      {
+        void * value;
+        if (viennagrid_quantity_field_value_get(src.internal(), refinement.kept_vertices[i], &value) == VIENNAGRID_SUCCESS && value)
+          viennagrid_quantity_field_value_set(dst.internal(), i, value);
+      }
+
+      std::vector<viennagrid_numeric> interpolated(values);
+      for (index_type p = 0; p != static_cast<index_type>(refinement.point_weights.size()); ++p)
+      {
+        void * v0;
+        void * v1;
+        if (viennagrid_quantity_field_value_get(src.internal(), refinement.point_edges[2*p+0], &v0) != VIENNAGRID_SUCCESS || !v0 ||
+            viennagrid_quantity_field_value_get(src.internal(), refinement.point_edges[2*p+1], &v1) != VIENNAGRID_SUCCESS || !v1)
+          continue;
+
+        viennagrid_numeric w = refinement.point_weights[p];
+        for (int k = 0; k != values; ++k)
+          interpolated[k] = (1.0-w)*static_cast<viennagrid_numeric*>(v0)[k] + w*static_cast<viennagrid_numeric*>(v1)[k];
+
+        viennagrid_quantity_field_value_set(dst.internal(), kept_count+p, &interpolated[0]);
+      }
+    }
+    else
+    {
+      for (index_type i = 0; i != refinement.child_count(); ++i)
+      {
+        void * value;
+        index_type parent = viennagrid_index_from_element_id( cells.cell_ids[refinement.child_parents[i]] );
+        if (viennagrid_quantity_field_value_get(src.internal(), parent, &value) == VIENNAGRID_SUCCESS && value)
+          viennagrid_quantity_field_value_set(dst.internal(), i, value);
+      }
+    }
+
+    return true;
+  }
+
+
+  // Transfers all quantity fields of an optional "quantities" input of an
+  // algorithm to its "quantities" output
+  inline void transfer_refined_quantities(plugin_algorithm & algorithm,
+                                          simplex_cells const & cells, simplex_refinement const & refinement)
+  {
+    quantity_field_handle src_quantity_fields = algorithm.get_input<viennagrid::quantity_field>("quantities");
+    if (!src_quantity_fields.valid())
+      return;
+
+    quantity_field_handle dst_quantity_fields = algorithm.make_data<viennagrid::quantity_field>();
+
+    for (int i = 0; i != src_quantity_fields.size(); ++i)
+    {
+      viennagrid::quantity_field src_qf = src_quantity_fields(i);
+      viennagrid::quantity_field dst_qf;
+
+      if (!transfer_refined_quantities(cells, refinement, src_qf, dst_qf))
+      {
+        info(1) << "Quantity field \"" << src_qf.get_name() << "\" has unsupported topologic dimension = "
+                << (int)src_qf.topologic_dimension() << " -> skipping" << std::endl;
+        continue;
+      }
+
+      dst_quantity_fields.push_back(dst_qf);
+    }
+
+    algorithm.set_output( "quantities", dst_quantity_fields );
+  }
+
+}
+
+#endif
@@ -13,9 +13,26 @@
 =============================================================================== */
 
 #include "split_mesh.hpp"
+#include <map>
 
 namespace viennamesh
 {
+  namespace
+  {
+    typedef viennagrid_int index_type;
+
+    // The cells and the used vertices of one region. Vertices are
+    // renumbered in the order of their first use.
+    struct region_part
+    {
+      std::vector<index_type> vertices;
+      std::vector<viennagrid_element_type> cell_types;
+      std::vector<viennagrid_int> cell_vertex_offsets;
+      std::vector<index_type> cell_vertices;
+    };
+  }
+
+
   split_mesh::split_mesh() {}
   std::string split_mesh::name() { return "split_mesh"; }
 
@@ -24,7 +41,10 @@ namespace viennamesh
     mesh_handle input_mesh = get_required_input<mesh_handle>("mesh");
 
     typedef viennagrid::mesh                                          MeshType;
+    typedef viennagrid::result_of::point<MeshType>::type              PointType;
+    typedef viennagrid::result_of::element<MeshType>::type            ElementType;
     typedef viennagrid::result_of::region_range<MeshType>::type       RegionRangeType;
+    typedef viennagrid::result_of::region_range<ElementType>::type    ElementRegionRangeType;
     typedef viennagrid::result_of::iterator<RegionRangeType>::type    RegionRangeIterator;
 
     RegionRangeType regions( input_mesh() );
@@ -33,21 +53,135 @@ namespace viennamesh
       mesh_handle output_mesh = make_data<mesh_handle>();
       viennagrid::copy( input_mesh(), output_mesh() );
       set_output( "mesh", output_mesh );
+      return true;
+    }
+
+    viennagrid_mesh mesh = input_mesh().internal();
+    int geometric_dimension = viennagrid::geometric_dimension( input_mesh() );
+    int cell_dimension = viennagrid::cell_dimension( input_mesh() );
+
+    viennagrid_element_id * vertices_begin;
+    viennagrid_element_id * vertices_end;
+    viennagrid_mesh_elements_get(mesh, 0, &vertices_begin, &vertices_end);
+    index_type vertex_count = vertices_end - vertices_begin;
+
+    viennagrid_numeric * coords;
+    viennagrid_mesh_vertex_coords_pointer(mesh, &coords);
+
+    viennagrid_element_id * cells_begin;
+    viennagrid_element_id * cells_end;
+    viennagrid_mesh_elements_get(mesh, cell_dimension, &cells_begin, &cells_end);
+    index_type cell_count = cells_end - cells_begin;
+
+
+    std::map<viennagrid_region_id, int> region_indices;
+    for (RegionRangeIterator rit = regions.begin(); rit != regions.end(); ++rit)
+    {
+      int index = region_indices.size();
+      region_indices[(*rit).id()] = index;
+    }
+    int region_count = region_indices.size();
+
+    // cells of each region in CSR layout, a cell is part of every region it
+    // belongs to
+    std::vector<index_type> region_cell_offsets(region_count+1, 0);
+    std::vector<index_type> cell_region_offsets(cell_count+1, 0);
+    std::vector<int> cell_regions;
+    for (index_type c = 0; c != cell_count; ++c)
+    {
+      ElementRegionRangeType element_regions( ElementType(input_mesh(), cells_begin[c]) );
+      for (RegionRangeIterator rit = element_regions.begin(); rit != element_regions.end(); ++rit)
+      {
+        int region = region_indices[(*rit).id()];
+        cell_regions.push_back(region);
+        ++region_cell_offsets[region+1];
+      }
+      cell_region_offsets[c+1] = cell_regions.size();
     }
-    else
+
+    for (int r = 0; r != region_count; ++r)
+      region_cell_offsets[r+1] += region_cell_offsets[r];
+
+    std::vector<index_type> region_cells( region_cell_offsets[region_count] );
+    std::vector<index_type> region_fill( region_cell_offsets.begin(), region_cell_offsets.end()-1 );
+    for (index_type c = 0; c != cell_count; ++c)
+      for (index_type i = cell_region_offsets[c]; i != cell_region_offsets[c+1]; ++i)
+        region_cells[ region_fill[cell_regions[i]]++ ] = c;
+
+
+    // all regions are gathered in one parallel pass, every thread renumbers
+    // the vertices of its regions with its own scratch array
+    std::vector<region_part> parts(region_count);
+
+    #pragma omp parallel
     {
-      int region_index = 0;
-      for (RegionRangeIterator rit = regions.begin(); rit != regions.end(); ++rit, ++region_index)
+      std::vector<index_type> vertex_map(vertex_count, -1);
+
+      #pragma omp for schedule(dynamic, 1)
+      for (int r = 0; r < region_count; ++r)
       {
-        mesh_handle output_mesh = make_data<mesh_handle>();
-        viennagrid::result_of::element_copy_map<>::type copy_map( output_mesh(), false );
-        viennagrid::copy(copy_map, *rit, output_mesh(), viennagrid::true_functor());
-        set_output( "mesh[" + lexical_cast<std::string>(region_index) + "]", output_mesh );
+        region_part & part = parts[r];
+        index_type count = region_cell_offsets[r+1] - region_cell_offsets[r];
+        part.cell_types.resize(count);
+        part.cell_vertex_offsets.resize(count+1);
+        part.cell_vertex_offsets[0] = 0;
+
+        for (index_type i = 0; i != count; ++i)
+        {
+          viennagrid_element_id cell = cells_begin[ region_cells[region_cell_offsets[r]+i] ];
+          viennagrid_element_type_get(mesh, cell, &part.cell_types[i]);
+
+          viennagrid_element_id * cell_vertices_begin;
+          viennagrid_element_id * cell_vertices_end;
+          viennagrid_element_boundary_elements(mesh, cell, 0, &cell_vertices_begin, &cell_vertices_end);
+
+          for (viennagrid_element_id * vit = cell_vertices_begin; vit != cell_vertices_end; ++vit)
+          {
+            index_type vertex = viennagrid_index_from_element_id(*vit);
+            if (vertex_map[vertex] < 0)
+            {
+              vertex_map[vertex] = part.vertices.size();
+              part.vertices.push_back(vertex);
+            }
+            part.cell_vertices.push_back( vertex_map[vertex] );
+          }
+
+          part.cell_vertex_offsets[i+1] = part.cell_vertices.size();
+        }
+
+        for (std::size_t i = 0; i != part.vertices.size(); ++i)
+          vertex_map[ part.vertices[i] ] = -1;
       }
+    }
+
 
-      info(1) << "Split mesh into " << region_index << " meshes" << std::endl;
+    int region_index = 0;
+    for (RegionRangeIterator rit = regions.begin(); rit != regions.end(); ++rit, ++region_index)
+    {
+      region_part & part = parts[region_index];
+      mesh_handle output_mesh = make_data<mesh_handle>();
+
+      std::vector<viennagrid_element_id> vertex_ids( part.vertices.size() );
+      for (std::size_t i = 0; i != part.vertices.size(); ++i)
+        vertex_ids[i] = viennagrid::make_vertex( output_mesh(), PointType(geometric_dimension, coords + geometric_dimension*part.vertices[i]) ).id().internal();
+
+      if (!part.cell_types.empty())
+      {
+        std::vector<viennagrid_element_id> cell_vertex_ids( part.cell_vertices.size() );
+        for (std::size_t i = 0; i != part.cell_vertices.size(); ++i)
+          cell_vertex_ids[i] = vertex_ids[ part.cell_vertices[i] ];
+
+        viennagrid_mesh_element_batch_create( output_mesh().internal(),
+                                              part.cell_types.size(), &part.cell_types[0],
+                                              &part.cell_vertex_offsets[0], &cell_vertex_ids[0],
+                                              NULL, NULL );
+      }
+
+      set_output( "mesh[" + lexical_cast<std::string>(region_index) + "]", output_mesh );
     }
 
+    info(1) << "Split mesh into " << region_index << " meshes" << std::endl;
+
     return true;
   }
 
@@ -0,0 +1,301 @@
+#ifndef VIENNAMESH_ALGORITHM_VIENNAGRID_TRIANGLE_ADJACENCY_HPP
+#define VIENNAMESH_ALGORITHM_VIENNAGRID_TRIANGLE_ADJACENCY_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "viennagrid/viennagrid.hpp"
+#include "viennameshpp/union_find.hpp"
+
+namespace viennamesh
+{
+
+  // Adjacency of all triangles of a mesh, built once from flat arrays. Edges
+  // are found by hashing each triangle edge into the bucket of its smaller
+  // vertex, so construction is linear and runs in parallel. Triangles are
+  // addressed by their position in the triangle range of the mesh, vertices
+  // by their element index.
+  class triangle_adjacency
+  {
+  public:
+
+    typedef viennagrid_int index_type;
+
+    explicit triangle_adjacency(viennagrid_mesh mesh_) { init(mesh_); }
+
+    void init(viennagrid_mesh mesh_)
+    {
+      mesh = mesh_;
+
+      viennagrid_element_id * triangles_begin;
+      viennagrid_element_id * triangles_end;
+      viennagrid_mesh_elements_get(mesh, 2, &triangles_begin, &triangles_end);
+      triangle_ids.assign(triangles_begin, triangles_end);
+      index_type count = triangle_count();
+
+      index_type max_index = -1;
+      for (index_type t = 0; t != count; ++t)
+        max_index = std::max(max_index, viennagrid_index_from_element_id(triangle_ids[t]));
+      triangle_positions.assign(max_index+1, -1);
+
+      vertices.resize(3*count);
+      index_type max_vertex = -1;
+
+      #pragma omp parallel for reduction(max:max_vertex)
+      for (index_type t = 0; t < count; ++t)
+      {
+        triangle_positions[ viennagrid_index_from_element_id(triangle_ids[t]) ] = t;
+
+        viennagrid_element_id * vertices_begin;
+        viennagrid_element_id * vertices_end;
+        viennagrid_element_boundary_elements(mesh, triangle_ids[t], 0, &vertices_begin, &vertices_end);
+
+        for (int k = 0; k != 3; ++k)
+        {
+          vertices[3*t+k] = viennagrid_index_from_element_id(vertices_begin[k]);
+          max_vertex = std::max(max_vertex, vertices[3*t+k]);
+        }
+      }
+
+      vertex_count_ = max_vertex+1;
+      build_edges();
+    }
+
+
+    viennagrid_mesh internal() const { return mesh; }
+
+    index_type triangle_count() const { return triangle_ids.size(); }
+    index_type vertex_count() const { return vertex_count_; }
+
+    viennagrid_element_id triangle_id(index_type t) const { return triangle_ids[t]; }
+    index_type triangle_index(viennagrid_element_id id) const
+    { return triangle_positions[ viennagrid_index_from_element_id(id) ]; }
+
+    // the three vertex indices of triangle t in the order of the mesh
+    index_type const * triangle_vertices(index_type t) const { return &vertices[3*t]; }
+
+
+    index_type edge_count() const { return edge_offsets.size()-1; }
+    index_type edge_vertex(index_type e, int i) const { return edge_vertices[2*e+i]; }
+
+    // number of co-boundary triangles of edge e
+    index_type edge_triangle_count(index_type e) const { return edge_offsets[e+1]-edge_offsets[e]; }
+
+    // the i-th co-boundary triangle of edge e
+    index_type edge_triangle(index_type e, index_type i) const { return edge_triangles[edge_offsets[e]+i]; }
+
+    // true if the i-th co-boundary triangle of edge e traverses the edge from
+    // edge_vertex(e,0) to edge_vertex(e,1). Two triangles sharing an edge are
+    // consistently oriented if they traverse the edge in opposite directions.
+    bool edge_triangle_forward(index_type e, index_type i) const { return edge_forward[edge_offsets[e]+i] != 0; }
+
+
+    // Builds the vertex to triangle incidence, needed for vertex neighbors
+    void build_vertex_triangles()
+    {
+      index_type count = triangle_count();
+      std::vector< std::atomic<index_type> > fill(vertex_count_);
+
+      #pragma omp parallel for
+      for (index_type v = 0; v < vertex_count_; ++v)
+        fill[v].store(0, std::memory_order_relaxed);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < 3*count; ++i)
+        fill[ vertices[i] ].fetch_add(1, std::memory_order_relaxed);
+
+      vertex_triangle_offsets.resize(vertex_count_+1);
+      vertex_triangle_offsets[0] = 0;
+      for (index_type v = 0; v != vertex_count_; ++v)
+      {
+        vertex_triangle_offsets[v+1] = vertex_triangle_offsets[v] + fill[v].load(std::memory_order_relaxed);
+        fill[v].store(vertex_triangle_offsets[v], std::memory_order_relaxed);
+      }
+
+      vertex_triangles.resize(3*count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < 3*count; ++i)
+        vertex_triangles[ fill[vertices[i]].fetch_add(1, std::memory_order_relaxed) ] = i/3;
+
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type v = 0; v < vertex_count_; ++v)
+        std::sort( vertex_triangles.begin() + vertex_triangle_offsets[v], vertex_triangles.begin() + vertex_triangle_offsets[v+1] );
+    }
+
+    // Writes all triangles sharing at least one vertex with triangle t
+    // (without t itself) sorted to neighbors, requires build_vertex_triangles()
+    void vertex_neighbors(index_type t, std::vector<index_type> & neighbors) const
+    {
+      neighbors.clear();
+      for (int k = 0; k != 3; ++k)
+      {
+        index_type v = vertices[3*t+k];
+        for (index_type i = vertex_triangle_offsets[v]; i != vertex_triangle_offsets[v+1]; ++i)
+          if (vertex_triangles[i] != t)
+            neighbors.push_back( vertex_triangles[i] );
+      }
+
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase( std::unique(neighbors.begin(), neighbors.end()), neighbors.end() );
+    }
+
+  private:
+
+    struct edge_record
+    {
+      index_type other_vertex;
+      index_type triangle;
+      bool forward;
+
+      bool operator<(edge_record const & rhs) const
+      {
+        return other_vertex < rhs.other_vertex ||
+               (other_vertex == rhs.other_vertex && triangle < rhs.triangle);
+      }
+    };
+
+    void build_edges()
+    {
+      index_type count = triangle_count();
+
+      // bucket every triangle edge by its smaller vertex
+      std::vector< std::atomic<index_type> > fill(vertex_count_);
+
+      #pragma omp parallel for
+      for (index_type v = 0; v < vertex_count_; ++v)
+        fill[v].store(0, std::memory_order_relaxed);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < 3*count; ++i)
+      {
+        index_type a = vertices[i];
+        index_type b = vertices[3*(i/3) + (i%3+1)%3];
+        fill[ std::min(a,b) ].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      std::vector<index_type> bucket_offsets(vertex_count_+1);
+      bucket_offsets[0] = 0;
+      for (index_type v = 0; v != vertex_count_; ++v)
+      {
+        bucket_offsets[v+1] = bucket_offsets[v] + fill[v].load(std::memory_order_relaxed);
+        fill[v].store(bucket_offsets[v], std::memory_order_relaxed);
+      }
+
+      std::vector<edge_record> records(3*count);
+
+      #pragma omp parallel for
+      for (index_type i = 0; i < 3*count; ++i)
+      {
+        index_type a = vertices[i];
+        index_type b = vertices[3*(i/3) + (i%3+1)%3];
+
+        edge_record record;
+        record.other_vertex = std::max(a,b);
+        record.triangle = i/3;
+        record.forward = (a < b);
+        records[ fill[std::min(a,b)].fetch_add(1, std::memory_order_relaxed) ] = record;
+      }
+
+      // within a bucket, records of the same edge become consecutive
+      std::vector<index_type> bucket_edge_count(vertex_count_+1, 0);
+
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type v = 0; v < vertex_count_; ++v)
+      {
+        std::sort( records.begin() + bucket_offsets[v], records.begin() + bucket_offsets[v+1] );
+
+        index_type edges = 0;
+        for (index_type i = bucket_offsets[v]; i != bucket_offsets[v+1]; ++i)
+          if (i == bucket_offsets[v] || records[i].other_vertex != records[i-1].other_vertex)
+            ++edges;
+        bucket_edge_count[v+1] = edges;
+      }
+
+      for (index_type v = 0; v != vertex_count_; ++v)
+        bucket_edge_count[v+1] += bucket_edge_count[v];
+
+      index_type edges = bucket_edge_count[vertex_count_];
+      edge_offsets.resize(edges+1);
+      edge_vertices.resize(2*edges);
+      edge_triangles.resize(3*count);
+      edge_forward.resize(3*count);
+      edge_offsets[edges] = 3*count;
+
+      #pragma omp parallel for schedule(dynamic, 1024)
+      for (index_type v = 0; v < vertex_count_; ++v)
+      {
+        index_type e = bucket_edge_count[v];
+        for (index_type i = bucket_offsets[v]; i != bucket_offsets[v+1]; ++i)
+        {
+          if (i == bucket_offsets[v] || records[i].other_vertex != records[i-1].other_vertex)
+          {
+            edge_offsets[e] = i;
+            edge_vertices[2*e+0] = v;
+            edge_vertices[2*e+1] = records[i].other_vertex;
+            ++e;
+          }
+
+          edge_triangles[i] = records[i].triangle;
+          edge_forward[i] = records[i].forward;
+        }
+      }
+    }
+
+    viennagrid_mesh mesh;
+
+    std::vector<viennagrid_element_id> triangle_ids;
+    std::vector<index_type> triangle_positions;
+    std::vector<index_type> vertices;
+    index_type vertex_count_;
+
+    std::vector<index_type> edge_offsets;
+    std::vector<index_type> edge_vertices;
+    std::vector<index_type> edge_triangles;
+    std::vector<char> edge_forward;
+
+    std::vector<index_type> vertex_triangle_offsets;
+    std::vector<index_type> vertex_triangles;
+  };
+
+
+
+  // Labels the patches of triangles which are connected over edges with
+  // exactly two co-boundary triangles (non-manifold edges and boundary edges
+  // separate patches). Labels are consecutive and ordered by the smallest
+  // triangle of each patch; returns the number of patches.
+  inline triangle_adjacency::index_type label_manifold_patches(triangle_adjacency const & adjacency,
+                                                               std::vector<triangle_adjacency::index_type> & labels)
+  {
+    typedef triangle_adjacency::index_type index_type;
+
+    concurrent_union_find patches( adjacency.triangle_count() );
+
+    #pragma omp parallel for
+    for (index_type e = 0; e < adjacency.edge_count(); ++e)
+    {
+      if (adjacency.edge_triangle_count(e) == 2)
+        patches.unite( adjacency.edge_triangle(e, 0), adjacency.edge_triangle(e, 1) );
+    }
+
+    return patches.labels(labels);
+  }
+
+}
+
+#endif
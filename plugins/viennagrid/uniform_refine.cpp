@@ -13,12 +13,119 @@
 =============================================================================== */
 
 #include "uniform_refine.hpp"
+#include "simplex_refinement.hpp"
 #include "viennagrid/viennagrid.hpp"
 #include "viennagrid/algorithm/refine.hpp"
 
 namespace viennamesh
 {
 
+  namespace
+  {
+    typedef simplex_refinement::index_type index_type;
+
+    inline viennagrid_numeric squared_distance(simplex_cells const & cells, simplex_refinement const & refinement,
+                                               index_type p0, index_type p1)
+    {
+      viennagrid_numeric c0[3];
+      viennagrid_numeric c1[3];
+      refined_point(cells, refinement, p0, c0);
+      refined_point(cells, refinement, p1, c1);
+
+      viennagrid_numeric result = 0;
+      for (int d = 0; d != cells.geometric_dimension; ++d)
+        result += (c1[d]-c0[d])*(c1[d]-c0[d]);
+      return result;
+    }
+
+    // Writes the children of a cell given its vertices v and its edge
+    // midpoints m (both as output vertex indices, midpoints in local edge
+    // order). All children except the inner tetrahedra are scaled copies of
+    // their parent and keep its orientation.
+    inline void emit_children(simplex_cells const & cells, simplex_refinement const & refinement,
+                              index_type const * v, index_type const * m, index_type * children)
+    {
+      if (cells.cell_dimension == 1)
+      {
+        index_type tmp[] = { v[0], m[0],
+                             m[0], v[1] };
+        std::copy(tmp, tmp+4, children);
+      }
+      else if (cells.cell_dimension == 2)
+      {
+        // midpoints: m01, m02, m12
+        index_type tmp[] = { v[0], m[0], m[1],
+                             m[0], v[1], m[2],
+                             m[1], m[2], v[2],
+                             m[0], m[2], m[1] };
+        std::copy(tmp, tmp+12, children);
+      }
+      else
+      {
+        // midpoints: m01, m02, m03, m12, m13, m23
+        index_type corners[] = { v[0], m[0], m[1], m[2],
+                                 m[0], v[1], m[3], m[4],
+                                 m[1], m[3], v[2], m[5],
+                                 m[2], m[4], m[5], v[3] };
+        std::copy(corners, corners+16, children);
+
+        // the inner octahedron is split along its shortest diagonal, the
+        // remaining midpoints form a cycle around it
+        static const int diagonals[3][2] = { {0,5}, {1,4}, {2,3} };
+        static const int cycles[3][4] = { {1,2,4,3}, {0,3,5,2}, {0,1,5,4} };
+
+        int best = 0;
+        viennagrid_numeric best_length = -1;
+        for (int d = 0; d != 3; ++d)
+        {
+          // midpoints are the output points after the input vertices
+          viennagrid_numeric length = squared_distance(cells, refinement,
+                                                       m[diagonals[d][0]] - cells.vertex_count,
+                                                       m[diagonals[d][1]] - cells.vertex_count);
+          if (best_length < 0 || length < best_length)
+          {
+            best = d;
+            best_length = length;
+          }
+        }
+
+        // the four inner tetrahedra share one orientation
+        for (int k = 0; k != 4; ++k)
+        {
+          index_type * child = children + 16 + 4*k;
+          child[0] = m[diagonals[best][0]];
+          child[1] = m[diagonals[best][1]];
+          child[2] = m[cycles[best][k]];
+          child[3] = m[cycles[best][(k+1)%4]];
+        }
+      }
+    }
+
+    inline viennagrid_numeric orientation(simplex_cells const & cells, simplex_refinement const & refinement,
+                                          index_type const * tet)
+    {
+      viennagrid_numeric c[4][3];
+      for (int i = 0; i != 4; ++i)
+      {
+        if (tet[i] < cells.vertex_count)
+          std::copy( cells.vertex_coords(tet[i]), cells.vertex_coords(tet[i])+3, c[i] );
+        else
+          refined_point(cells, refinement, tet[i]-cells.vertex_count, c[i]);
+      }
+
+      viennagrid_numeric a[3], b[3], d[3];
+      for (int k = 0; k != 3; ++k)
+      {
+        a[k] = c[1][k]-c[0][k];
+        b[k] = c[2][k]-c[0][k];
+        d[k] = c[3][k]-c[0][k];
+      }
+
+      return a[0]*(b[1]*d[2]-b[2]*d[1]) - a[1]*(b[0]*d[2]-b[2]*d[0]) + a[2]*(b[0]*d[1]-b[1]*d[0]);
+    }
+  }
+
+
   uniform_refine::uniform_refine() {}
   std::string uniform_refine::name() { return "uniform_refine"; }
 
@@ -34,7 +141,78 @@ namespace viennamesh
     if (output_mesh == input_mesh)
       return false;
 
-    viennagrid::cell_refine_uniformly(input_mesh(), output_mesh());
+    simplex_cells cells;
+    if (!cells.init( input_mesh().internal() ) || (cells.cell_dimension == 3 && cells.geometric_dimension != 3))
+    {
+      info(1) << "Mesh has non-simplex cells, using generic refinement" << std::endl;
+      viennagrid::cell_refine_uniformly(input_mesh(), output_mesh());
+      set_output( "mesh", output_mesh );
+      return true;
+    }
+
+    index_type cell_count = cells.cell_count();
+    int per_cell = cells.vertices_per_cell();
+    int edges_per_cell = simplex_edge_count(cells.cell_dimension);
+    int children_per_cell = 1 << cells.cell_dimension;
+
+
+    // every edge gets exactly one midpoint, numbered after the input vertices
+    edge_point_table midpoints( edges_per_cell*cell_count );
+    std::vector<index_type> slots( edges_per_cell*cell_count );
+
+    #pragma omp parallel for
+    for (index_type c = 0; c < cell_count; ++c)
+    {
+      index_type const * v = cells.cell_vertices(c);
+      for (int e = 0; e != edges_per_cell; ++e)
+        slots[edges_per_cell*c+e] = midpoints.insert( v[simplex_edge_vertex(cells.cell_dimension, e, 0)],
+                                                      v[simplex_edge_vertex(cells.cell_dimension, e, 1)],
+                                                      edges_per_cell*c+e );
+    }
+
+    simplex_refinement refinement;
+    refinement.kept_vertices.resize(cells.vertex_count);
+    for (index_type i = 0; i != cells.vertex_count; ++i)
+      refinement.kept_vertices[i] = i;
+
+    index_type point_count = midpoints.assign_points(slots, cells.vertex_count, refinement.point_edges);
+    refinement.point_weights.assign(point_count, 0.5);
+
+
+    // every cell has a fixed number of children, so the offset of its
+    // children is known without a prefix sum over the cells
+    refinement.child_vertices.resize( children_per_cell*per_cell*cell_count );
+    refinement.child_parents.resize( children_per_cell*cell_count );
+
+    #pragma omp parallel for
+    for (index_type c = 0; c < cell_count; ++c)
+    {
+      index_type m[6];
+      for (int e = 0; e != edges_per_cell; ++e)
+        m[e] = midpoints.point( slots[edges_per_cell*c+e] );
+
+      index_type * children = &refinement.child_vertices[children_per_cell*per_cell*c];
+      emit_children(cells, refinement, cells.cell_vertices(c), m, children);
+
+      if (cells.cell_dimension == 3)
+      {
+        if ( (orientation(cells, refinement, children + 16) > 0) !=
+             (orientation(cells, refinement, cells.cell_vertices(c)) > 0) )
+        {
+          for (int k = 4; k != 8; ++k)
+            std::swap( children[4*k+2], children[4*k+3] );
+        }
+      }
+
+      for (int k = 0; k != children_per_cell; ++k)
+        refinement.child_parents[children_per_cell*c+k] = c;
+    }
+
+    info(1) << "Refined " << cell_count << " cells into " << refinement.child_count() << " cells, created "
+            << point_count << " new vertices" << std::endl;
+
+    write_refined_mesh(cells, refinement, output_mesh().internal());
+    transfer_refined_quantities(*this, cells, refinement);
 
     set_output( "mesh", output_mesh );
 
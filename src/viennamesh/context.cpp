@@ -1,12 +1,20 @@
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
 #include <dirent.h>
+#include <sys/stat.h>
 
 #include "viennagrid/viennagrid.h"
 #include "context.hpp"
 
 
-viennamesh_context_t::viennamesh_context_t() : use_count_(1)
+viennamesh_context_t::viennamesh_context_t() : lazy_plugin_loading(true), recorded_manifest(0), plugin_loading_time_(0), use_count_(1)
 {
+  // plugins can be forced to be loaded up front, e.g. to check all plugins for loading errors
+  char const * eager_plugin_loading = std::getenv("VIENNAMESH_EAGER_PLUGIN_LOADING");
+  if (eager_plugin_loading && std::string(eager_plugin_loading) != "0")
+    lazy_plugin_loading = false;
+
 #ifdef VIENNAMESH_BACKEND_RETAIN_RELEASE_LOGGING
   std::cout << "New context at " << this << std::endl;
 #endif
@@ -35,6 +43,9 @@ std::string const & viennamesh_context_t::registered_data_type_name(int index_)
 viennamesh::data_template_t & viennamesh_context_t::get_data_type(std::string const & data_type_name_)
 {
   std::map<std::string, viennamesh::data_template_t>::iterator it = data_types.find(data_type_name_);
+  if (it == data_types.end() && load_pending_plugin(pending_data_types, data_type_name_))
+    it = data_types.find(data_type_name_);
+
   if (it == data_types.end())
     VIENNAMESH_ERROR( VIENNAMESH_ERROR_DATA_TYPE_NOT_REGISTERED, "Data type \"" + data_type_name_ + "\" is not registered" );
 
@@ -56,6 +67,9 @@ void viennamesh_context_t::register_data_type(std::string const & data_type_name
     it->second.name() = data_type_name_;
     it->second.set_context(this);
     it->second.set_make_delete_function(make_function_, delete_function_);
+
+    if (recorded_manifest)
+      recorded_manifest->data_types.push_back(data_type_name_);
   }
 
   viennamesh::backend::info(10) << "Data type \"" << data_type_name_ << "\" sucessfully registered" << std::endl;
@@ -105,6 +119,9 @@ viennamesh_data_wrapper viennamesh_context_t::convert_to(viennamesh_data_wrapper
 viennamesh::algorithm_template viennamesh_context_t::get_algorithm_template(std::string const & algorithm_name_)
 {
   std::map<std::string, viennamesh::algorithm_template_t>::iterator it = algorithm_templates.find(algorithm_name_);
+  if (it == algorithm_templates.end() && load_pending_plugin(pending_algorithms, algorithm_name_))
+    it = algorithm_templates.find(algorithm_name_);
+
   if (it == algorithm_templates.end())
     VIENNAMESH_ERROR(VIENNAMESH_ERROR_ALGORITHM_NOT_REGISTERED, "Algorithm \"" + algorithm_name_ + "\" not registered");
 
@@ -116,6 +133,25 @@ viennamesh_plugin viennamesh_context_t::load_plugin(std::string const & plugin_f
 {
   viennamesh::backend::LoggingStack stack("Loading plugin \"" + plugin_filename + "\"", 10);
 
+  // the plugin registers everything itself, drop its pending names
+  for (std::map<std::string, std::string>::iterator it = pending_algorithms.begin(); it != pending_algorithms.end();)
+  {
+    if (it->second == plugin_filename)
+      pending_algorithms.erase(it++);
+    else
+      ++it;
+  }
+  for (std::map<std::string, std::string>::iterator it = pending_data_types.begin(); it != pending_data_types.end();)
+  {
+    if (it->second == plugin_filename)
+      pending_data_types.erase(it++);
+    else
+      ++it;
+  }
+
+  viennautils::Timer timer;
+  timer.start();
+
   void * dl = dlopen(plugin_filename.c_str(), RTLD_NOW);
   if (!dl)
   {
@@ -153,6 +189,8 @@ viennamesh_plugin viennamesh_context_t::load_plugin(std::string const & plugin_f
   init_function( this );
   loaded_plugins.insert(dl);
 
+  plugin_loading_time_ += timer.get();
+
 //   viennamesh::backend::info(1) << "Plugin \"" << plugin_filename << "\" successfully loaded" << std::endl;
 
   return dl;
@@ -193,7 +231,11 @@ void viennamesh_context_t::load_plugins_in_directory(std::string directory_name)
 
     viennamesh::backend::LoggingStack stack("Loading all plugins in directory \"" + directory_name + "\"", 10);
     for (std::size_t i = 0; i != plugins_in_directory.size(); ++i)
-      load_plugin(directory_name + plugins_in_directory[i]);
+    {
+      std::string plugin_filename = directory_name + plugins_in_directory[i];
+      if (!lazy_plugin_loading || !register_plugin_manifest(plugin_filename))
+        load_plugin(plugin_filename);
+    }
   }
   else
   {
@@ -203,4 +245,100 @@ void viennamesh_context_t::load_plugins_in_directory(std::string directory_name)
 
 
 
+int viennamesh_context_t::pending_plugin_count() const
+{
+  std::set<std::string> pending_plugins;
+  for (std::map<std::string, std::string>::const_iterator it = pending_algorithms.begin(); it != pending_algorithms.end(); ++it)
+    pending_plugins.insert(it->second);
+  for (std::map<std::string, std::string>::const_iterator it = pending_data_types.begin(); it != pending_data_types.end(); ++it)
+    pending_plugins.insert(it->second);
+  return pending_plugins.size();
+}
+
+
+bool viennamesh_context_t::load_pending_plugin(std::map<std::string, std::string> const & pending, std::string const & name)
+{
+  std::map<std::string, std::string>::const_iterator it = pending.find(name);
+  if (it == pending.end())
+    return false;
+
+  // load_plugin erases the entry
+  std::string plugin_filename = it->second;
+  viennamesh::backend::info(10) << "\"" << name << "\" is provided by plugin \"" << plugin_filename << "\" -> loading" << std::endl;
+  return load_plugin(plugin_filename) != 0;
+}
+
+
+bool viennamesh_context_t::register_plugin_manifest(std::string const & plugin_filename)
+{
+  std::string manifest_filename = plugin_filename + ".manifest";
 
+  // a manifest older than its plugin may be outdated
+  struct stat plugin_stat;
+  struct stat manifest_stat;
+  if (stat(plugin_filename.c_str(), &plugin_stat) != 0 ||
+      stat(manifest_filename.c_str(), &manifest_stat) != 0 ||
+      manifest_stat.st_mtime < plugin_stat.st_mtime)
+    return false;
+
+  std::ifstream file(manifest_filename.c_str());
+  if (!file)
+    return false;
+
+  std::map<std::string, std::string> manifest_algorithms;
+  std::map<std::string, std::string> manifest_data_types;
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::stringstream ss(line);
+    std::string kind;
+    std::string name;
+
+    if (!(ss >> kind) || kind[0] == '#')
+      continue;
+
+    if (!(ss >> name))
+      return false;
+
+    if (kind == "algorithm")
+      manifest_algorithms[name] = plugin_filename;
+    else if (kind == "data_type")
+      manifest_data_types[name] = plugin_filename;
+    else
+    {
+      viennamesh::backend::warning(10) << "Invalid plugin manifest \"" << manifest_filename << "\" -> loading plugin" << std::endl;
+      return false;
+    }
+  }
+
+  pending_algorithms.insert(manifest_algorithms.begin(), manifest_algorithms.end());
+  pending_data_types.insert(manifest_data_types.begin(), manifest_data_types.end());
+
+  viennamesh::backend::info(10) << "Registered plugin \"" << plugin_filename << "\" from manifest (" << manifest_algorithms.size() << " algorithms, " << manifest_data_types.size() << " data types)" << std::endl;
+  return true;
+}
+
+
+void viennamesh_context_t::write_plugin_manifest(std::string const & plugin_filename,
+                                                 std::string const & manifest_filename)
+{
+  plugin_manifest manifest;
+
+  recorded_manifest = &manifest;
+  viennamesh_plugin plugin = load_plugin(plugin_filename);
+  recorded_manifest = 0;
+
+  if (!plugin)
+    VIENNAMESH_ERROR(VIENNAMESH_ERROR_INVALID_ARGUMENT, "Could not load plugin \"" + plugin_filename + "\" for writing its manifest");
+
+  std::ofstream file(manifest_filename.c_str());
+  if (!file)
+    VIENNAMESH_ERROR(VIENNAMESH_ERROR_INVALID_ARGUMENT, "Could not open plugin manifest \"" + manifest_filename + "\" for writing");
+
+  file << "# ViennaMesh plugin manifest for " << plugin_filename << std::endl;
+  for (std::size_t i = 0; i != manifest.data_types.size(); ++i)
+    file << "data_type " << manifest.data_types[i] << std::endl;
+  for (std::size_t i = 0; i != manifest.algorithms.size(); ++i)
+    file << "algorithm " << manifest.algorithms[i] << std::endl;
+}
@@ -2,6 +2,7 @@
 #define _VIENNAMESH_BACKEND_CONTEXT_HPP_
 
 #include <set>
+#include <map>
 #include <dlfcn.h>
 
 #include "forwards.hpp"
@@ -61,6 +62,9 @@ public:
                             make_function, delete_function,
                             init_function, run_function);
 
+    if (recorded_manifest)
+      recorded_manifest->algorithms.push_back(algorithm_id);
+
     viennamesh::backend::info(10) << "Algorithm \"" << algorithm_id << "\" sucessfully registered" << std::endl;
   }
 
@@ -119,6 +123,18 @@ public:
   viennamesh_plugin load_plugin(std::string const & plugin_filename);
   void load_plugins_in_directory(std::string directory_name);
 
+  // Plugins with an up-to-date manifest (<plugin>.manifest, written at build
+  // time by write_plugin_manifest) are not loaded up front. Their algorithm and
+  // data type names are registered as pending and the plugin is loaded when one
+  // of these names is used for the first time.
+  bool register_plugin_manifest(std::string const & plugin_filename);
+  void write_plugin_manifest(std::string const & plugin_filename,
+                             std::string const & manifest_filename);
+
+  int loaded_plugin_count() const { return loaded_plugins.size(); }
+  int pending_plugin_count() const;
+  double plugin_loading_time() const { return plugin_loading_time_; }
+
 
   void retain() { ++use_count_; }
   bool release()
@@ -150,8 +166,24 @@ private:
     delete this;
   }
 
+  struct plugin_manifest
+  {
+    std::vector<std::string> data_types;
+    std::vector<std::string> algorithms;
+  };
+
+  bool load_pending_plugin(std::map<std::string, std::string> const & pending, std::string const & name);
+
   std::set<viennamesh_plugin> loaded_plugins;
 
+  // algorithm/data type name -> filename of the plugin providing it
+  std::map<std::string, std::string> pending_algorithms;
+  std::map<std::string, std::string> pending_data_types;
+  bool lazy_plugin_loading;
+
+  plugin_manifest * recorded_manifest;
+  double plugin_loading_time_;
+
   int use_count_;
 };
 
@@ -26,7 +26,11 @@ namespace viennamesh
 
     int Logger::register_file_callback( std::string const & filename )
     {
+#ifndef _WIN32
+      return register_callback( new AsyncFileStreamCallback<FileStreamFormater>(filename) );
+#else
       return register_callback( new FileStreamCallback<FileStreamFormater>(filename) );
+#endif
     }
 
     Logger & logger()
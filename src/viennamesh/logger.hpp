@@ -22,10 +22,14 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <atomic>
+#include <mutex>
 
 #ifndef _WIN32
 #include <fcntl.h>
 #include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
 #endif
 
 #include "viennautils/timer.hpp"
@@ -119,23 +123,32 @@ namespace viennamesh
       typedef std::ostringstream collector_stream_type;
 
       log_instance(Logger & logger_obj_,
-                   int log_level_) :
-        os_( new collector_stream_type() ),
-        logger_obj(logger_obj_),
-        log_level(log_level_) {}
+                   int log_level_);
 
       ~log_instance();
 
       template <typename T>
-      collector_stream_type & operator<<(const T & x )
+      std::ostream & operator<<(const T & x )
       {
         get() << x;
         return get();
       }
 
+      std::ostream & operator<<( std::ostream & (*manipulator)(std::ostream &) )
+      {
+        return manipulator( get() );
+      }
+
     private:
 
-      collector_stream_type & get() { return *os_; }
+      // suppressed messages are streamed into a stream without buffer
+      static std::ostream & null_stream()
+      {
+        static thread_local std::ostream stream(0);
+        return stream;
+      }
+
+      std::ostream & get() { return os_ ? *os_ : null_stream(); }
 
       log_instance & operator =(const log_instance &) { return *this; }
 
@@ -208,6 +221,9 @@ namespace viennamesh
 
       virtual void write(std::string const & message) = 0;
 
+      // writes everything passed to write() so far
+      virtual void flush() {}
+
       template<typename LoggingTagT>
       void log(Logger const & logger,
               int log_level,
@@ -263,9 +279,181 @@ namespace viennamesh
         stream << message;
       }
 
+      virtual void flush()
+      {
+        stream.flush();
+      }
+
+      std::ofstream stream;
+      OutputFormaterT formater;
+    };
+
+
+
+#ifndef _WIN32
+    // Bounded single producer, single consumer ring buffer of messages. The
+    // producer side is serialized by the logger, the consumer is the writer
+    // thread of an asynchronous log file, so neither side takes a lock.
+    class log_ring_buffer
+    {
+    public:
+
+      explicit log_ring_buffer(std::size_t capacity) : slots(capacity), head(0), tail(0) {}
+
+      // returns false if the buffer is full, message is swapped into the buffer
+      bool push(std::string & message)
+      {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == slots.size())
+          return false;
+
+        slots[h % slots.size()].swap(message);
+        head.store(h+1, std::memory_order_release);
+        return true;
+      }
+
+      bool pop(std::string & message)
+      {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+          return false;
+
+        std::string & slot = slots[t % slots.size()];
+        message.swap(slot);
+        slot.clear();
+        tail.store(t+1, std::memory_order_release);
+        return true;
+      }
+
+      std::size_t pushed() const { return head.load(std::memory_order_acquire); }
+      std::size_t popped() const { return tail.load(std::memory_order_acquire); }
+
+      // drops all messages, only valid if there is no consumer
+      void clear()
+      {
+        tail.store( head.load(std::memory_order_relaxed), std::memory_order_release );
+      }
+
+    private:
+      std::vector<std::string> slots;
+      std::atomic<std::size_t> head;
+      std::atomic<std::size_t> tail;
+    };
+
+
+    // File log which hands formatted messages to a background writer thread,
+    // logging threads only pay for formatting and a ring buffer push. If the
+    // writer falls behind, producers wait for free slots instead of dropping
+    // messages.
+    template<typename OutputFormaterT>
+    struct AsyncFileStreamCallback : public BaseCallback
+    {
+      AsyncFileStreamCallback(std::string const & filename) :
+          stream(filename.c_str()), messages(4096), running(false), written(0)
+      {
+        start_writer();
+      }
+
+      ~AsyncFileStreamCallback()
+      {
+        // in a forked child without own writer the pending messages belong
+        // to the parent
+        running.store(false);
+        if (writer_pid == getpid())
+          pthread_join(writer_thread, NULL);
+      }
+
+      virtual std::string make(
+                Logger const & logger,
+                std::string const & tag_name,
+                std::string const & colored_tag_name,
+                int log_level,
+                std::string const & message) const
+      {
+        return formater.make(logger, tag_name, colored_tag_name, log_level, message);
+      }
+
+      virtual void write(std::string const & message)
+      {
+        // the writer thread does not survive a fork, the child gets its own
+        if (writer_pid != getpid())
+          restart_after_fork();
+
+        std::string tmp(message);
+        while (!messages.push(tmp))
+          sched_yield();
+      }
+
+      virtual void flush()
+      {
+        if (writer_pid != getpid())
+          restart_after_fork();
+
+        std::size_t pushed = messages.pushed();
+        while (written.load(std::memory_order_acquire) < pushed)
+          sched_yield();
+      }
+
+    private:
+
+      void start_writer()
+      {
+        writer_pid = getpid();
+        running.store(true);
+        pthread_create( &writer_thread, NULL, &writer, (void*)(this) );
+      }
+
+      void restart_after_fork()
+      {
+        // pending messages belong to the parent, which writes them itself
+        messages.clear();
+        written.store( messages.pushed() );
+        start_writer();
+      }
+
+      bool write_pending()
+      {
+        std::string message;
+        bool any = false;
+        while (messages.pop(message))
+        {
+          stream << message;
+          any = true;
+        }
+
+        if (any)
+        {
+          stream.flush();
+          written.store( messages.popped(), std::memory_order_release );
+        }
+        return any;
+      }
+
+      static void * writer(void * data)
+      {
+        AsyncFileStreamCallback & callback = *(AsyncFileStreamCallback*)(data);
+
+        while (callback.running.load())
+        {
+          if (!callback.write_pending())
+            usleep(1000);
+        }
+
+        callback.write_pending();
+        return NULL;
+      }
+
       std::ofstream stream;
       OutputFormaterT formater;
+
+      log_ring_buffer messages;
+      std::atomic<bool> running;
+      std::atomic<std::size_t> written;
+
+      pthread_t writer_thread;
+      pid_t writer_pid;
     };
+#endif
 
 
 
@@ -304,18 +492,50 @@ namespace viennamesh
 
 
 
+      // Messages are collected per thread until a line is complete, so lines
+      // of concurrently logging threads do not interleave and the callbacks
+      // are only locked once per line
       template<typename LoggingTagT>
       void log( int log_level,
                     std::string const & message )
       {
+        if (log_level > get_log_level<LoggingTagT>())
+          return;
+
+        line_buffer & buffer = thread_line_buffer();
+        if (buffer.dispatch_function != &Logger::dispatch<LoggingTagT> || buffer.log_level != log_level)
+          buffer.flush();
+
+        buffer.logger_obj = this;
+        buffer.dispatch_function = &Logger::dispatch<LoggingTagT>;
+        buffer.log_level = log_level;
+        buffer.text += message;
+
+        std::string::size_type pos = buffer.text.find_last_of('\n');
+        if (pos != std::string::npos)
+        {
+          std::string lines = buffer.text.substr(0, pos+1);
+          buffer.text.erase(0, pos+1);
+          dispatch<LoggingTagT>(log_level, lines);
+        }
+      }
+
+      // writes the incomplete line of the calling thread and waits for all
+      // callbacks to finish writing
+      void flush()
+      {
+        thread_line_buffer().flush();
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
         for (std::vector< BaseCallback * >::iterator it = callbacks.begin(); it != callbacks.end(); ++it)
-          (*it)->log<LoggingTagT>(*this, log_level, message);
+          (*it)->flush();
       }
 
       int register_color_cout_callback();
       int register_file_callback( std::string const & filename );
       void unregister_callback( int callback_handle )
       {
+        std::lock_guard<std::mutex> lock(callback_mutex);
         delete callbacks[callback_handle];
         callbacks.erase( callbacks.begin()+callback_handle );
       }
@@ -335,8 +555,43 @@ namespace viennamesh
 
     private:
 
+      typedef void (Logger::*dispatch_function_type)(int, std::string const &);
+
+      struct line_buffer
+      {
+        line_buffer() : logger_obj(0), dispatch_function(0), log_level(0) {}
+        ~line_buffer() { flush(); }
+
+        void flush()
+        {
+          if (!text.empty() && logger_obj)
+            (logger_obj->*dispatch_function)(log_level, text);
+          text.clear();
+        }
+
+        Logger * logger_obj;
+        dispatch_function_type dispatch_function;
+        int log_level;
+        std::string text;
+      };
+
+      static line_buffer & thread_line_buffer()
+      {
+        static thread_local line_buffer buffer;
+        return buffer;
+      }
+
+      template<typename LoggingTagT>
+      void dispatch( int log_level, std::string const & message )
+      {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        for (std::vector< BaseCallback * >::iterator it = callbacks.begin(); it != callbacks.end(); ++it)
+          (*it)->log<LoggingTagT>(*this, log_level, message);
+      }
+
       int register_callback( BaseCallback * callback )
       {
+        std::lock_guard<std::mutex> lock(callback_mutex);
         callbacks.push_back( callback );
         return callbacks.size()-1;
       }
@@ -344,16 +599,26 @@ namespace viennamesh
       int indentation_count_;
       LoggingLevels< int > log_levels_;
 
+      std::mutex callback_mutex;
       std::vector<BaseCallback *> callbacks;
     };
 
 
 
+      template<typename LoggingTagT>
+      log_instance<LoggingTagT>::log_instance(Logger & logger_obj_, int log_level_) :
+        os_( log_level_ <= logger_obj_.template get_log_level<LoggingTagT>() ? new collector_stream_type() : 0 ),
+        logger_obj(logger_obj_),
+        log_level(log_level_) {}
+
       template<typename LoggingTagT>
       log_instance<LoggingTagT>::~log_instance()
       {
-        logger_obj.template log<LoggingTagT>( log_level, os_->str() );
-        delete os_;
+        if (os_)
+        {
+          logger_obj.template log<LoggingTagT>( log_level, os_->str() );
+          delete os_;
+        }
       }
 
 
@@ -702,6 +967,11 @@ namespace viennamesh
 
       void write(std::string const & message);
 
+      virtual void flush()
+      {
+        std::cout.flush();
+      }
+
       OutputFormaterT formater;
     };
 
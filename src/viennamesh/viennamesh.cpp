@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "viennamesh/viennamesh.h"
 #include "viennagrid/viennagrid.hpp"
 
@@ -154,6 +156,47 @@ viennamesh_error viennamesh_context_load_plugins_in_directory(viennamesh_context
 
 
 
+viennamesh_error viennamesh_context_write_plugin_manifest(viennamesh_context context,
+                                                         const char * plugin_filename,
+                                                         const char * manifest_filename)
+{
+  if (!context)
+    return VIENNAMESH_ERROR_INVALID_CONTEXT;
+
+  try
+  {
+    context->write_plugin_manifest(plugin_filename, manifest_filename);
+  }
+  catch (...)
+  {
+    return viennamesh::handle_error(context);
+  }
+
+  return VIENNAMESH_SUCCESS;
+}
+
+viennamesh_error viennamesh_context_get_plugin_statistics(viennamesh_context context,
+                                                          int * loaded_plugin_count,
+                                                          int * pending_plugin_count,
+                                                          double * plugin_loading_time)
+{
+  if (!context)
+    return VIENNAMESH_ERROR_INVALID_CONTEXT;
+
+  if (loaded_plugin_count)
+    *loaded_plugin_count = context->loaded_plugin_count();
+  if (pending_plugin_count)
+    *pending_plugin_count = context->pending_plugin_count();
+  if (plugin_loading_time)
+    *plugin_loading_time = context->plugin_loading_time();
+
+  return VIENNAMESH_SUCCESS;
+}
+
+
+
+
+
 viennamesh_error viennamesh_context_get_error(viennamesh_context context,
                                               viennamesh_error * error_code,
                                               const char ** error_function,
@@ -996,15 +1039,27 @@ viennamesh_error viennamesh_log_decrease_indentation()
   return VIENNAMESH_SUCCESS;
 }
 
+// capturing redirects the process wide stdout/stderr, nested or concurrent
+// capture requests (e.g. meshers running in parallel) share one capture
+namespace
+{
+  std::mutex capture_mutex;
+  int capture_count = 0;
+}
+
 viennamesh_error viennamesh_log_enable_capturing()
 {
-  viennamesh::backend::StdCapture::get().start();
+  std::lock_guard<std::mutex> lock(capture_mutex);
+  if (capture_count++ == 0)
+    viennamesh::backend::StdCapture::get().start();
   return VIENNAMESH_SUCCESS;
 }
 
 viennamesh_error viennamesh_log_disable_capturing()
 {
-  viennamesh::backend::StdCapture::get().finish();
+  std::lock_guard<std::mutex> lock(capture_mutex);
+  if (capture_count > 0 && --capture_count == 0)
+    viennamesh::backend::StdCapture::get().finish();
   return VIENNAMESH_SUCCESS;
 }
 
@@ -1088,3 +1143,9 @@ viennamesh_error viennamesh_log_add_logging_file(char const * filename, vienname
   return VIENNAMESH_SUCCESS;
 }
 
+viennamesh_error viennamesh_log_flush()
+{
+  viennamesh::backend::logger().flush();
+  return VIENNAMESH_SUCCESS;
+}
+
@@ -7,6 +7,16 @@ namespace viennamesh
 {
 
   context_handle::context_handle() : ctx(0)
+  {
+    init(true);
+  }
+
+  context_handle::context_handle(bool load_default_plugins) : ctx(0)
+  {
+    init(load_default_plugins);
+  }
+
+  void context_handle::init(bool load_default_plugins)
   {
     make();
 
@@ -27,7 +37,8 @@ namespace viennamesh
       register_conversion<double,int>();
     }
 
-    load_plugins_in_directories(VIENNAMESH_DEFAULT_PLUGIN_DIRECTORY, ";");
+    if (load_default_plugins)
+      load_plugins_in_directories(VIENNAMESH_DEFAULT_PLUGIN_DIRECTORY, ";");
   }
 
   context_handle::context_handle(viennamesh_context ctx_) : ctx(ctx_) { retain(); }
@@ -104,6 +115,14 @@ namespace viennamesh
   }
 
 
+  void context_handle::write_plugin_manifest(std::string const & plugin_filename, std::string const & manifest_filename)
+  {
+    handle_error(
+      viennamesh_context_write_plugin_manifest(ctx, plugin_filename.c_str(), manifest_filename.c_str()),
+      ctx);
+  }
+
+
   viennamesh_context context_handle::internal() const
   {
     return const_cast<viennamesh_context>(ctx);
@@ -0,0 +1,60 @@
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+                    http://viennamesh.sourceforge.net/
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include "viennameshpp/core.hpp"
+#include <tclap/CmdLine.h>
+#include <cstdio>
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("Writes the manifest of a plugin, which allows the plugin to be loaded on first use", ' ', "1.0");
+
+    TCLAP::ValueArg<std::string> manifest_filename("o","output", "Manifest file name (default is <plugin>.manifest)", false, "", "string");
+    cmd.add( manifest_filename );
+
+    TCLAP::UnlabeledValueArg<std::string> plugin_filename( "filename", "Plugin file name", true, "", "PluginFile"  );
+    cmd.add( plugin_filename );
+
+    cmd.parse( argc, argv );
+
+    viennamesh_log_set_info_level(-1);
+    viennamesh_log_set_warning_level(-1);
+    viennamesh_log_set_debug_level(-1);
+    viennamesh_log_set_stack_level(-1);
+
+    std::string output_filename = manifest_filename.getValue();
+    if (output_filename.empty())
+      output_filename = plugin_filename.getValue() + ".manifest";
+
+    // an outdated manifest must not survive a failed run
+    std::remove( output_filename.c_str() );
+
+    try
+    {
+      viennamesh::context_handle context(false);
+      context.write_plugin_manifest( plugin_filename.getValue(), output_filename );
+    }
+    catch (viennamesh::exception const & e)
+    {
+      // without a manifest the plugin is loaded up front, so this is not fatal
+      std::remove( output_filename.c_str() );
+      std::cerr << "warning: no manifest written for plugin \"" << plugin_filename.getValue() << "\": " << e.what() << std::endl;
+    }
+  }
+  catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+  }
+
+  return 0;
+}
@@ -13,8 +13,157 @@
 =============================================================================== */
 
 #include "viennameshpp/algorithm_pipeline.hpp"
+#include "viennameshpp/timer.hpp"
+#include "vmesh_batch.hpp"
+#include "vmesh_server.hpp"
 #include <tclap/CmdLine.h>
 
+int run_batch(viennamesh::context_handle & context,
+              pugi::xml_document const & pipeline_xml,
+              std::string const & base_path,
+              std::vector<std::string> const & input_patterns,
+              std::string const & input_list,
+              int concurrency,
+              std::string const & output_dir,
+              std::string const & log_dir)
+{
+  std::vector<std::string> inputs;
+  viennamesh::batch::expand_inputs(input_patterns, inputs);
+  if (!input_list.empty() && !viennamesh::batch::read_input_list(input_list, inputs))
+  {
+    viennamesh::error(1) << "Error reading batch input list " << input_list << std::endl;
+    return 1;
+  }
+
+  if (inputs.empty())
+  {
+    viennamesh::error(1) << "No batch inputs given" << std::endl;
+    return 1;
+  }
+
+  std::vector<viennamesh::batch::job> jobs(inputs.size());
+  for (std::size_t i = 0; i != inputs.size(); ++i)
+    jobs[i].input = inputs[i];
+
+  viennamesh::batch::runner runner(context, pipeline_xml, base_path);
+  runner.set_concurrency(concurrency);
+  runner.set_output_directory(output_dir);
+  runner.set_log_directory(log_dir);
+
+  if (!runner.prepare())
+  {
+    viennamesh::error(1) << "Error loading creating pipeline from XML" << std::endl;
+    return 1;
+  }
+
+  viennautils::Timer timer;
+  timer.start();
+  std::size_t failed = runner.run(jobs);
+  double wall_time = timer.get();
+
+  double job_time = 0.0;
+  for (std::size_t i = 0; i != jobs.size(); ++i)
+    job_time += jobs[i].time;
+
+  std::cout << "Batch summary" << std::endl;
+  std::cout << "  Jobs:               " << jobs.size() << " (" << concurrency << " concurrent)" << std::endl;
+  std::cout << "  Succeeded:          " << jobs.size()-failed << std::endl;
+  std::cout << "  Failed:             " << failed << std::endl;
+  std::cout << "  Wall time:          " << wall_time << "sec" << std::endl;
+  std::cout << "  Throughput:         " << (wall_time > 0 ? jobs.size() / wall_time : 0.0) << " jobs/sec" << std::endl;
+  std::cout << "  Average job time:   " << job_time / jobs.size() << "sec" << std::endl;
+
+  for (std::size_t i = 0; i != jobs.size(); ++i)
+  {
+    if (jobs[i].success)
+      continue;
+
+    std::cout << "  FAILED " << jobs[i].input << ": " << jobs[i].message;
+    if (!jobs[i].log_filename.empty())
+      std::cout << " (see " << jobs[i].log_filename << ")";
+    std::cout << std::endl;
+  }
+
+  return failed == 0 ? 0 : 1;
+}
+
+// executes the pipeline of a server request in the warm context
+struct serve_pipeline
+{
+  serve_pipeline(viennamesh::context_handle & context_) : context(context_) {}
+
+  bool operator()(std::string const & xml, std::string const & base_path, double & time)
+  {
+    viennautils::Timer timer;
+    timer.start();
+
+    pugi::xml_document pipeline_xml;
+    pugi::xml_parse_result result = pipeline_xml.load_buffer( xml.c_str(), xml.size() );
+    if (!result)
+    {
+      viennamesh::error(1) << "XML error: " << result.description() << std::endl;
+      return false;
+    }
+
+    bool success = false;
+    try
+    {
+      viennamesh::algorithm_pipeline pipeline(context);
+      if (pipeline.from_xml( pipeline_xml ))
+      {
+        if (!base_path.empty())
+          pipeline.set_base_path(base_path);
+        success = pipeline.run( true );
+      }
+      else
+        viennamesh::error(1) << "Error loading creating pipeline from XML" << std::endl;
+    }
+    catch (viennamesh::exception const & ex)
+    {
+      viennamesh::error(1) << "Pipeline failed: " << ex.what() << std::endl;
+    }
+
+    time = timer.get();
+
+    // the output is captured until the worker returns
+    viennamesh::flush_log();
+    return success;
+  }
+
+  viennamesh::context_handle & context;
+};
+
+int serve(std::string const & socket_path, std::string const & warmup_filename, int concurrency)
+{
+  // a server pays plugin loading once at startup instead of once per request
+  setenv("VIENNAMESH_EAGER_PLUGIN_LOADING", "1", 0);
+  viennamesh::context_handle context;
+
+  if (!warmup_filename.empty())
+  {
+    pugi::xml_document pipeline_xml;
+    if (pipeline_xml.load_file( warmup_filename.c_str() ))
+    {
+      viennamesh::algorithm_pipeline pipeline(context);
+      pipeline.from_xml( pipeline_xml );
+    }
+    else
+      viennamesh::warning(1) << "Error loading warm-up pipeline " << warmup_filename << std::endl;
+  }
+
+  viennamesh::server::unix_socket_server<serve_pipeline> server( socket_path, serve_pipeline(context) );
+  server.set_concurrency(concurrency);
+  if (!server.listen())
+  {
+    viennamesh::error(1) << "Error listening on socket " << socket_path << std::endl;
+    return 1;
+  }
+
+  viennamesh::info(1) << "Serving pipelines on " << socket_path << std::endl;
+  server.run();
+  return 0;
+}
+
 int main(int argc, char **argv)
 {
   try
@@ -28,7 +177,28 @@ int main(int argc, char **argv)
     cmd.add( info_loglevel );
 
 
-    TCLAP::UnlabeledValueArg<std::string> pipeline_filename( "filename", "Pipeline file name", true, "", "PipelineFile"  );
+    TCLAP::SwitchArg profile("p","profile", "Print startup and run time statistics", false);
+    cmd.add( profile );
+
+    TCLAP::MultiArg<std::string> batch_inputs("b","batch-input", "Run the pipeline as template for each input file (glob patterns allowed)", false, "string");
+    cmd.add( batch_inputs );
+
+    TCLAP::ValueArg<std::string> batch_list("","batch-list", "File with one batch input file per line", false, "", "string");
+    cmd.add( batch_list );
+
+    TCLAP::ValueArg<int> jobs("j","jobs", "Number of concurrent batch jobs or server workers (default is the number of processors)", false, 0, "int");
+    cmd.add( jobs );
+
+    TCLAP::ValueArg<std::string> output_dir("","output-dir", "Output directory for batch jobs (default is the directory of each input)", false, "", "string");
+    cmd.add( output_dir );
+
+    TCLAP::ValueArg<std::string> log_dir("","log-dir", "Directory for per-job log files of batch jobs", false, "", "string");
+    cmd.add( log_dir );
+
+    TCLAP::ValueArg<std::string> serve_socket("","serve", "Serve pipelines on the given Unix domain socket, the optional pipeline file is used to warm up the server", false, "", "string");
+    cmd.add( serve_socket );
+
+    TCLAP::UnlabeledValueArg<std::string> pipeline_filename( "filename", "Pipeline file name", false, "", "PipelineFile"  );
     cmd.add( pipeline_filename );
 
     cmd.parse( argc, argv );
@@ -38,9 +208,25 @@ int main(int argc, char **argv)
 
     viennamesh_log_set_info_level( info_loglevel.getValue() );
 
+    int concurrency = jobs.getValue();
+    if (concurrency <= 0)
+      concurrency = static_cast<int>( sysconf(_SC_NPROCESSORS_ONLN) );
+
+    if ( !serve_socket.getValue().empty() )
+      return serve( serve_socket.getValue(), pipeline_filename.getValue(), concurrency );
+
+    if ( pipeline_filename.getValue().empty() )
+    {
+      viennamesh::error(1) << "No pipeline file given" << std::endl;
+      return 1;
+    }
+
+    viennautils::Timer timer;
+    timer.start();
 
     pugi::xml_document pipeline_xml;
     pugi::xml_parse_result result = pipeline_xml.load_file( pipeline_filename.getValue().c_str() );
+    double xml_time = timer.get();
 
     if (!result)
     {
@@ -51,6 +237,16 @@ int main(int argc, char **argv)
 
     viennamesh::context_handle context;
 //     context.load_plugins_in_directory(VIENNAMESH_DEFAULT_PLUGIN_DIRECTORY);
+    double context_time = timer.get();
+
+    std::string path = viennamesh::extract_path( pipeline_filename.getValue() );
+
+    if ( !batch_inputs.getValue().empty() || !batch_list.getValue().empty() )
+    {
+      return run_batch( context, pipeline_xml, path, batch_inputs.getValue(), batch_list.getValue(),
+                        concurrency, output_dir.getValue(), log_dir.getValue() );
+    }
+
     viennamesh::algorithm_pipeline pipeline(context);
 
     if (!pipeline.from_xml( pipeline_xml ))
@@ -59,11 +255,30 @@ int main(int argc, char **argv)
       return 0;
     }
 
-    std::string path = viennamesh::extract_path( pipeline_filename.getValue() );
     if (!path.empty())
       pipeline.set_base_path(path);
 
+    double setup_time = timer.get();
+
     pipeline.run( true );
+    double run_time = timer.get();
+
+    if (profile.getValue())
+    {
+      int loaded_plugin_count;
+      int pending_plugin_count;
+      double plugin_loading_time;
+      viennamesh_context_get_plugin_statistics( context.internal(), &loaded_plugin_count, &pending_plugin_count, &plugin_loading_time );
+
+      std::cout << "Profile" << std::endl;
+      std::cout << "  XML parsing:        " << xml_time << "sec" << std::endl;
+      std::cout << "  Context creation:   " << context_time - xml_time << "sec" << std::endl;
+      std::cout << "  Pipeline creation:  " << setup_time - context_time << "sec" << std::endl;
+      std::cout << "  Pipeline run:       " << run_time - setup_time << "sec" << std::endl;
+      std::cout << "  Total:              " << run_time << "sec" << std::endl;
+      std::cout << "  Plugins loaded:     " << loaded_plugin_count << " (" << pending_plugin_count << " not needed)" << std::endl;
+      std::cout << "  Plugin loading:     " << plugin_loading_time << "sec" << std::endl;
+    }
   }
   catch (TCLAP::ArgException &e)  // catch any exceptions
   {
@@ -0,0 +1,400 @@
+#ifndef VIENNAMESH_TOOLS_VMESH_BATCH_HPP
+#define VIENNAMESH_TOOLS_VMESH_BATCH_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+
+#include <glob.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "viennameshpp/algorithm_pipeline.hpp"
+#include "viennameshpp/timer.hpp"
+
+namespace viennamesh
+{
+  namespace batch
+  {
+
+    struct job
+    {
+      job() : index(0), success(false), time(0.0) {}
+
+      std::size_t index;
+      std::string input;
+
+      std::string log_filename;
+      std::string message;
+      bool success;
+      double time;
+    };
+
+
+    inline std::string absolute_path(std::string const & path)
+    {
+      if (path.empty() || path[0] == '/')
+        return path;
+
+      char buffer[PATH_MAX];
+      if (!getcwd(buffer, PATH_MAX))
+        return path;
+
+      return std::string(buffer) + "/" + path;
+    }
+
+    inline std::string stem(std::string const & path)
+    {
+      std::string filename = extract_filename(path);
+      std::size_t pos = filename.find_last_of('.');
+      if (pos == std::string::npos || pos == 0)
+        return filename;
+      return filename.substr(0, pos);
+    }
+
+
+    // Expands each pattern with glob(3), patterns without a match are taken
+    // as they are so that missing files show up as failed jobs
+    inline void expand_inputs(std::vector<std::string> const & patterns, std::vector<std::string> & inputs)
+    {
+      for (std::size_t i = 0; i != patterns.size(); ++i)
+      {
+        glob_t result;
+        if (glob(patterns[i].c_str(), 0, NULL, &result) == 0)
+        {
+          for (std::size_t j = 0; j != result.gl_pathc; ++j)
+            inputs.push_back( result.gl_pathv[j] );
+        }
+        else
+          inputs.push_back( patterns[i] );
+        globfree(&result);
+      }
+    }
+
+    // Reads one input path per line, empty lines and lines starting with '#'
+    // are ignored
+    inline bool read_input_list(std::string const & filename, std::vector<std::string> & inputs)
+    {
+      std::ifstream file( filename.c_str() );
+      if (!file)
+        return false;
+
+      std::string line;
+      while (std::getline(file, line))
+      {
+        std::size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+          continue;
+        std::size_t end = line.find_last_not_of(" \t\r");
+        inputs.push_back( line.substr(begin, end-begin+1) );
+      }
+
+      return true;
+    }
+
+
+
+    // Placeholders which can be used in the parameters of a pipeline template:
+    //   {input}       absolute path of the input file
+    //   {basename}    file name of the input file
+    //   {stem}        file name of the input file without extension
+    //   {dir}         directory of the input file
+    //   {index}       index of the job
+    //   {output_dir}  output directory of the batch run
+    class substitution
+    {
+    public:
+
+      substitution(job const & j, std::string const & output_dir)
+      {
+        std::string input = absolute_path(j.input);
+        std::ostringstream index;
+        index << j.index;
+
+        values["{input}"] = input;
+        values["{basename}"] = extract_filename(input);
+        values["{stem}"] = stem(input);
+        values["{dir}"] = extract_path(input);
+        values["{index}"] = index.str();
+        values["{output_dir}"] = output_dir.empty() ? extract_path(input) : absolute_path(output_dir) + "/";
+      }
+
+      std::string operator()(std::string str) const
+      {
+        for (std::map<std::string, std::string>::const_iterator it = values.begin(); it != values.end(); ++it)
+        {
+          std::size_t pos = 0;
+          while ((pos = str.find(it->first, pos)) != std::string::npos)
+          {
+            str.replace(pos, it->first.size(), it->second);
+            pos += it->second.size();
+          }
+        }
+        return str;
+      }
+
+      std::string const & value(std::string const & key) const
+      {
+        return values.find(key)->second;
+      }
+
+    private:
+      std::map<std::string, std::string> values;
+    };
+
+
+    inline bool has_placeholders(pugi::xml_node const & node)
+    {
+      static char const * keys[] = { "{input}", "{basename}", "{stem}", "{dir}", "{index}", "{output_dir}" };
+
+      for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling())
+      {
+        if (child.type() == pugi::node_pcdata || child.type() == pugi::node_cdata)
+        {
+          std::string value = child.value();
+          for (std::size_t i = 0; i != sizeof(keys)/sizeof(keys[0]); ++i)
+            if (value.find(keys[i]) != std::string::npos)
+              return true;
+        }
+
+        if (has_placeholders(child))
+          return true;
+      }
+
+      return false;
+    }
+
+    inline void substitute_placeholders(pugi::xml_node node, substitution const & subst)
+    {
+      for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling())
+      {
+        if (child.type() == pugi::node_pcdata || child.type() == pugi::node_cdata)
+          child.set_value( subst(child.value()).c_str() );
+        else
+          substitute_placeholders(child, subst);
+      }
+    }
+
+    // Used for templates without placeholders: the filename of every mesh
+    // reader is replaced by the input and the filename of every writer is
+    // prefixed with the stem of the input and moved to the output directory
+    inline void substitute_io(pugi::xml_node root, substitution const & subst)
+    {
+      for (pugi::xml_node algorithm = root.child("algorithm"); algorithm; algorithm = algorithm.next_sibling("algorithm"))
+      {
+        std::string type = algorithm.attribute("type").as_string();
+        bool is_reader = (type == "mesh_reader");
+        bool is_writer = type.size() > 7 && type.compare(type.size()-7, 7, "_writer") == 0;
+
+        if (!is_reader && !is_writer)
+          continue;
+
+        for (pugi::xml_node parameter = algorithm.child("parameter"); parameter; parameter = parameter.next_sibling("parameter"))
+        {
+          if (std::string(parameter.attribute("name").as_string()) != "filename")
+            continue;
+
+          if (is_reader)
+            parameter.text().set( subst.value("{input}").c_str() );
+          else
+          {
+            std::string filename = subst.value("{output_dir}") + subst.value("{stem}") + "_" +
+                                   extract_filename( parameter.text().as_string() );
+            parameter.text().set( filename.c_str() );
+          }
+        }
+      }
+    }
+
+
+
+    // Runs a pipeline template over many inputs. Each job is executed in a
+    // forked worker process which inherits the context of the batch runner,
+    // so plugins are loaded and the template is parsed only once. Workers
+    // are isolated from each other: a crashing job only fails itself and the
+    // output of every job goes to its own log file.
+    class runner
+    {
+    public:
+
+      runner(context_handle & context_, pugi::xml_document const & pipeline_template_, std::string const & base_path_) :
+          context(context_), base_path(base_path_), concurrency(1)
+      {
+        pipeline_template.reset(pipeline_template_);
+        use_placeholders = has_placeholders(pipeline_template);
+      }
+
+      void set_concurrency(int concurrency_) { concurrency = concurrency_ > 0 ? concurrency_ : 1; }
+      void set_output_directory(std::string const & output_dir_) { output_dir = output_dir_; }
+      void set_log_directory(std::string const & log_dir_) { log_dir = log_dir_; }
+
+      // Creates the template pipeline once in the runner process, this loads
+      // all plugins needed by the pipeline before the workers are forked
+      bool prepare()
+      {
+        algorithm_pipeline pipeline(context);
+        return pipeline.from_xml(pipeline_template);
+      }
+
+      // Runs all jobs and returns the number of failed jobs
+      std::size_t run(std::vector<job> & jobs)
+      {
+        std::map<pid_t, std::size_t> running;
+        std::map<pid_t, viennautils::Timer> timers;
+        std::size_t next = 0;
+        std::size_t failed = 0;
+
+        while (next != jobs.size() || !running.empty())
+        {
+          while (next != jobs.size() && running.size() < static_cast<std::size_t>(concurrency))
+          {
+            job & j = jobs[next];
+            j.index = next++;
+            if (!log_dir.empty())
+              j.log_filename = absolute_path(log_dir) + "/" + stem(j.input) + "_" + index_string(j.index) + ".log";
+
+            std::cout.flush();
+            std::cerr.flush();
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+              j.message = "fork failed";
+              ++failed;
+              continue;
+            }
+
+            if (pid == 0)
+              _exit( run_job(j) ? 0 : 1 );
+
+            running[pid] = j.index;
+            timers[pid].start();
+          }
+
+          int status;
+          pid_t pid = waitpid(-1, &status, 0);
+          if (pid < 0)
+            break;
+
+          std::map<pid_t, std::size_t>::iterator it = running.find(pid);
+          if (it == running.end())
+            continue;
+
+          job & j = jobs[it->second];
+          j.time = timers[pid].get();
+
+          if (WIFEXITED(status))
+          {
+            j.success = (WEXITSTATUS(status) == 0);
+            if (!j.success)
+              j.message = "pipeline failed";
+          }
+          else if (WIFSIGNALED(status))
+          {
+            std::ostringstream ss;
+            ss << "terminated by signal " << WTERMSIG(status);
+            j.message = ss.str();
+          }
+
+          if (!j.success)
+            ++failed;
+
+          running.erase(it);
+          timers.erase(pid);
+        }
+
+        return failed;
+      }
+
+    private:
+
+      static std::string index_string(std::size_t index)
+      {
+        std::ostringstream ss;
+        ss << index;
+        return ss.str();
+      }
+
+      // executed in the worker process
+      bool run_job(job const & j)
+      {
+        if (!j.log_filename.empty())
+        {
+          int fd = open(j.log_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+          if (fd >= 0)
+          {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+          }
+        }
+
+        substitution subst(j, output_dir);
+
+        pugi::xml_document pipeline_xml;
+        pipeline_xml.reset(pipeline_template);
+
+        if (use_placeholders)
+          substitute_placeholders(pipeline_xml, subst);
+        else
+          substitute_io(pipeline_xml, subst);
+
+        bool success = false;
+        try
+        {
+          algorithm_pipeline pipeline(context);
+          if (pipeline.from_xml(pipeline_xml))
+          {
+            if (!base_path.empty())
+              pipeline.set_base_path(base_path);
+            success = pipeline.run(true);
+          }
+          else
+            error(1) << "Error creating pipeline for input \"" << j.input << "\"" << std::endl;
+        }
+        catch (viennamesh::exception const & ex)
+        {
+          error(1) << "Job " << j.index << " (" << j.input << ") failed: " << ex.what() << std::endl;
+        }
+
+        // the worker leaves with _exit, which skips the logger shutdown
+        flush_log();
+        std::cout.flush();
+        std::cerr.flush();
+        return success;
+      }
+
+      context_handle & context;
+      pugi::xml_document pipeline_template;
+      std::string base_path;
+
+      bool use_placeholders;
+      int concurrency;
+      std::string output_dir;
+      std::string log_dir;
+    };
+
+  }
+}
+
+#endif
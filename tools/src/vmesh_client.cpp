@@ -0,0 +1,109 @@
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include "vmesh_server.hpp"
+#include <fstream>
+#include <iterator>
+#include <limits.h>
+#include <tclap/CmdLine.h>
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("ViennaMesh VMesh client, executes a pipeline on a running vmesh server (see vmesh --serve)", ' ', "1.0");
+
+    TCLAP::ValueArg<std::string> socket_path("s","socket", "Socket of the vmesh server", true, "", "string");
+    cmd.add( socket_path );
+
+    TCLAP::SwitchArg quiet("q","quiet", "Do not print the log of the pipeline", false);
+    cmd.add( quiet );
+
+    TCLAP::SwitchArg ping("","ping", "Checks if the server is running", false);
+    cmd.add( ping );
+
+    TCLAP::SwitchArg shutdown("","shutdown", "Shuts down the server", false);
+    cmd.add( shutdown );
+
+    TCLAP::UnlabeledValueArg<std::string> pipeline_filename( "filename", "Pipeline file name", false, "", "PipelineFile"  );
+    cmd.add( pipeline_filename );
+
+    cmd.parse( argc, argv );
+
+    viennamesh::server::message request;
+
+    if (ping.getValue())
+      request.set("command", "ping");
+    else if (shutdown.getValue())
+      request.set("command", "shutdown");
+    else
+    {
+      std::ifstream file( pipeline_filename.getValue().c_str() );
+      if (pipeline_filename.getValue().empty() || !file)
+      {
+        std::cerr << "error: cannot read pipeline file \"" << pipeline_filename.getValue() << "\"" << std::endl;
+        return 1;
+      }
+
+      request.set("command", "run");
+      request.body.assign( std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() );
+
+      // relative paths in the pipeline are resolved relative to the pipeline file
+      char buffer[PATH_MAX];
+      std::string path = pipeline_filename.getValue();
+      if (realpath(path.c_str(), buffer))
+        path = buffer;
+      std::size_t pos = path.find_last_of('/');
+      request.set("base_path", pos == std::string::npos ? std::string() : path.substr(0, pos+1));
+    }
+
+    int fd = viennamesh::server::connect( socket_path.getValue() );
+    if (fd < 0)
+    {
+      std::cerr << "error: cannot connect to vmesh server at \"" << socket_path.getValue() << "\"" << std::endl;
+      return 1;
+    }
+
+    // the server may reject a request before reading it completely, its
+    // error response is read even if sending the request failed
+    signal(SIGPIPE, SIG_IGN);
+    viennamesh::server::send_message(fd, request);
+
+    viennamesh::server::message response;
+    bool received = viennamesh::server::receive_message(fd, response);
+    close(fd);
+
+    if (!received)
+    {
+      std::cerr << "error: no response from vmesh server, the pipeline worker probably crashed" << std::endl;
+      return 1;
+    }
+
+    if (!quiet.getValue())
+      std::cout << response.body;
+
+    std::string status = response.get("status");
+    if (status != "ok")
+    {
+      std::cerr << "error: pipeline " << status << std::endl;
+      return 1;
+    }
+  }
+  catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+  }
+
+  return 0;
+}
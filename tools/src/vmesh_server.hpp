@@ -0,0 +1,595 @@
+#ifndef VIENNAMESH_TOOLS_VMESH_SERVER_HPP
+#define VIENNAMESH_TOOLS_VMESH_SERVER_HPP
+
+/* ============================================================================
+   Copyright (c) 2011-2014, Institute for Microelectronics,
+                            Institute for Analysis and Scientific Computing,
+                            TU Wien.
+
+                            -----------------
+                ViennaMesh - The Vienna Meshing Framework
+                            -----------------
+
+                    http://viennamesh.sourceforge.net/
+
+   License:         MIT (X11), see file LICENSE in the base directory
+=============================================================================== */
+
+#include <string>
+#include <map>
+#include <deque>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include <exception>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+namespace viennamesh
+{
+  namespace server
+  {
+
+    // A message consists of "key value" header lines, an empty line and a
+    // body whose size is given by the "length" header:
+    //
+    //   command run
+    //   base_path /home/user/pipelines/
+    //   length 1234
+    //
+    //   <algorithm type="mesh_reader" ...
+    //
+    // Requests have the commands "run" (body is the pipeline XML), "ping"
+    // and "shutdown". Responses have a "status" header ("ok", "failed" or
+    // "error"), the run time of the pipeline in "time" and the log output
+    // of the pipeline as body.
+    struct message
+    {
+      std::string get(std::string const & key, std::string const & default_value = "") const
+      {
+        std::map<std::string, std::string>::const_iterator it = header.find(key);
+        return it == header.end() ? default_value : it->second;
+      }
+
+      void set(std::string const & key, std::string const & value) { header[key] = value; }
+
+      std::map<std::string, std::string> header;
+      std::string body;
+    };
+
+
+    inline bool write_all(int fd, char const * data, std::size_t size)
+    {
+      while (size > 0)
+      {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return false;
+        }
+
+        data += written;
+        size -= written;
+      }
+
+      return true;
+    }
+
+    inline bool send_message(int fd, message const & msg)
+    {
+      std::ostringstream ss;
+      for (std::map<std::string, std::string>::const_iterator it = msg.header.begin(); it != msg.header.end(); ++it)
+        if (it->first != "length")
+          ss << it->first << " " << it->second << "\n";
+      ss << "length " << msg.body.size() << "\n\n";
+
+      std::string header = ss.str();
+      return write_all(fd, header.c_str(), header.size()) &&
+             write_all(fd, msg.body.c_str(), msg.body.size());
+    }
+
+    // limits of a received message, the defaults accept any message
+    struct receive_limits
+    {
+      receive_limits() : timeout(-1), max_line_length(4096), max_header_count(64),
+          max_body_size( std::numeric_limits<std::size_t>::max() ) {}
+
+      // time in milliseconds for receiving the whole message, negative for no limit
+      int timeout;
+      std::size_t max_line_length;
+      std::size_t max_header_count;
+      std::size_t max_body_size;
+    };
+
+    enum receive_result
+    {
+      received,
+      receive_failed,    // connection closed, read error or timeout
+      message_too_large  // a header line, the header count or the body exceeds the limits
+    };
+
+
+    inline long long monotonic_milliseconds()
+    {
+      timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return static_cast<long long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    }
+
+    // waits until fd is readable, returns false if the deadline (a
+    // monotonic_milliseconds time, negative for none) has passed
+    inline bool wait_readable(int fd, long long deadline)
+    {
+      if (deadline < 0)
+        return true;
+
+      while (true)
+      {
+        long long remaining = deadline - monotonic_milliseconds();
+        if (remaining <= 0)
+          return false;
+
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int count = poll(&pfd, 1, remaining < 1000000 ? static_cast<int>(remaining) : 1000000);
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count != 0)
+          return count > 0;
+      }
+    }
+
+    inline receive_result receive_message(int fd, message & msg, receive_limits const & limits)
+    {
+      msg.header.clear();
+      msg.body.clear();
+
+      long long deadline = limits.timeout < 0 ? -1 : monotonic_milliseconds() + limits.timeout;
+
+      // the header is read byte-wise so that nothing of the body is consumed
+      std::string line;
+      while (true)
+      {
+        if (!wait_readable(fd, deadline))
+          return receive_failed;
+
+        char c;
+        ssize_t count = ::read(fd, &c, 1);
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return receive_failed;
+
+        if (c != '\n')
+        {
+          if (line.size() >= limits.max_line_length)
+            return message_too_large;
+          line += c;
+          continue;
+        }
+
+        if (line.empty())
+          break;
+
+        if (msg.header.size() >= limits.max_header_count)
+          return message_too_large;
+
+        std::size_t pos = line.find(' ');
+        if (pos == std::string::npos)
+          msg.header[line] = "";
+        else
+          msg.header[line.substr(0, pos)] = line.substr(pos+1);
+        line.clear();
+      }
+
+      // strtoul saturates on overflow, so every oversized length is rejected
+      std::string length_string = msg.get("length", "0");
+      if (length_string.find('-') != std::string::npos)
+        return message_too_large;
+      unsigned long length = std::strtoul( length_string.c_str(), NULL, 10 );
+      if (length > limits.max_body_size || length > msg.body.max_size())
+        return message_too_large;
+      msg.body.resize(length);
+
+      std::size_t offset = 0;
+      while (offset < length)
+      {
+        if (!wait_readable(fd, deadline))
+          return receive_failed;
+
+        ssize_t count = ::read(fd, &msg.body[offset], length-offset);
+        if (count < 0 && errno == EINTR)
+          continue;
+        if (count <= 0)
+          return receive_failed;
+        offset += count;
+      }
+
+      return received;
+    }
+
+    inline bool receive_message(int fd, message & msg)
+    {
+      return receive_message(fd, msg, receive_limits()) == received;
+    }
+
+    inline void send_error(int fd, std::string const & text)
+    {
+      message response;
+      response.set("status", "error");
+      response.body = text + "\n";
+      send_message(fd, response);
+    }
+
+
+    // write end of the pipe which wakes up the server loop when a worker exits
+    inline int & child_exit_pipe()
+    {
+      static int fd = -1;
+      return fd;
+    }
+
+    inline void notify_child_exit(int)
+    {
+      int saved_errno = errno;
+      char c = 0;
+      if (::write(child_exit_pipe(), &c, 1) < 0) {}
+      errno = saved_errno;
+    }
+
+
+    inline bool make_address(std::string const & socket_path, sockaddr_un & address)
+    {
+      if (socket_path.size() >= sizeof(address.sun_path))
+        return false;
+
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      std::strcpy(address.sun_path, socket_path.c_str());
+      return true;
+    }
+
+    // returns the connected socket or -1
+    inline int connect(std::string const & socket_path)
+    {
+      sockaddr_un address;
+      if (!make_address(socket_path, address))
+        return -1;
+
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0)
+        return -1;
+
+      if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+      {
+        close(fd);
+        return -1;
+      }
+
+      return fd;
+    }
+
+
+
+    // Serves pipeline requests on a Unix domain socket. The context of the
+    // server keeps its plugins loaded, every run request is executed in a
+    // forked worker which inherits the warm context, so a request only pays
+    // for the fork and the pipeline itself. A crashing pipeline only takes
+    // down its worker; the client sees the connection closed without a
+    // response. At most concurrency workers run at the same time, further
+    // run requests are queued while ping and shutdown are answered at once.
+    template<typename RunFunctorT>
+    class unix_socket_server
+    {
+    public:
+
+      unix_socket_server(std::string const & socket_path_, RunFunctorT run_pipeline_) :
+          socket_path(socket_path_), listen_fd(-1), concurrency(1), receive_timeout(10),
+          max_request_size(64*1024*1024), max_queued(64), run_pipeline(run_pipeline_)
+      {
+        wake_fd[0] = wake_fd[1] = -1;
+      }
+
+      ~unix_socket_server()
+      {
+        if (listen_fd >= 0)
+        {
+          close(listen_fd);
+          unlink( socket_path.c_str() );
+        }
+      }
+
+      void set_concurrency(int concurrency_) { concurrency = concurrency_ > 0 ? concurrency_ : 1; }
+
+      // requests are read by the server loop itself, a client which does not
+      // send its complete request within the timeout (in seconds) is dropped,
+      // so a slow client delays the other clients by at most the timeout
+      void set_receive_timeout(int receive_timeout_) { receive_timeout = receive_timeout_ > 0 ? receive_timeout_ : 1; }
+
+      // larger requests are answered with an error status
+      void set_max_request_size(std::size_t max_request_size_) { max_request_size = max_request_size_; }
+
+      bool listen()
+      {
+        sockaddr_un address;
+        if (!make_address(socket_path, address))
+          return false;
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0)
+          return false;
+
+        // remove a stale socket of a previous server
+        unlink( socket_path.c_str() );
+
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            ::listen(listen_fd, 64) < 0)
+        {
+          close(listen_fd);
+          listen_fd = -1;
+          return false;
+        }
+
+        return true;
+      }
+
+      // serves requests until a shutdown request is received
+      void run()
+      {
+        signal(SIGPIPE, SIG_IGN);
+
+        // SIGCHLD writes to a pipe which is polled together with the
+        // listening socket, so finished workers are reaped without blocking
+        if (pipe(wake_fd) < 0)
+          return;
+        for (int i = 0; i < 2; ++i)
+          fcntl(wake_fd[i], F_SETFL, fcntl(wake_fd[i], F_GETFL) | O_NONBLOCK);
+        child_exit_pipe() = wake_fd[1];
+
+        struct sigaction action, old_action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = notify_child_exit;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_NOCLDSTOP;
+        sigaction(SIGCHLD, &action, &old_action);
+
+        int running = 0;
+        bool shutdown = false;
+        while (!shutdown)
+        {
+          while (waitpid(-1, NULL, WNOHANG) > 0)
+            --running;
+
+          while (running < concurrency && !queued.empty())
+          {
+            queued_request request = queued.front();
+            queued.pop_front();
+            if (start_worker(request))
+              ++running;
+          }
+
+          pollfd fds[2];
+          fds[0].fd = listen_fd;
+          fds[0].events = POLLIN;
+          fds[0].revents = 0;
+          fds[1].fd = wake_fd[0];
+          fds[1].events = POLLIN;
+          fds[1].revents = 0;
+
+          if (poll(fds, 2, -1) < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            break;
+          }
+
+          if (fds[1].revents)
+          {
+            char buffer[64];
+            while (::read(wake_fd[0], buffer, sizeof(buffer)) > 0) {}
+          }
+
+          if (!(fds[0].revents & POLLIN))
+            continue;
+
+          int fd = accept(listen_fd, NULL, NULL);
+          if (fd < 0)
+          {
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED)
+              continue;
+            break;
+          }
+
+          // a failing request must not take down the server
+          try
+          {
+            shutdown = handle_connection(fd);
+          }
+          catch (std::exception const & e)
+          {
+            send_error(fd, std::string("request failed: ") + e.what());
+            close(fd);
+          }
+        }
+
+        for (std::size_t i = 0; i < queued.size(); ++i)
+        {
+          send_error(queued[i].fd, "server shut down");
+          close(queued[i].fd);
+        }
+        queued.clear();
+
+        while (wait(NULL) > 0) {}
+
+        sigaction(SIGCHLD, &old_action, NULL);
+        child_exit_pipe() = -1;
+        close(wake_fd[0]);
+        close(wake_fd[1]);
+        wake_fd[0] = wake_fd[1] = -1;
+      }
+
+    private:
+
+      struct queued_request
+      {
+        int fd;
+        message request;
+      };
+
+      // reads and answers or queues a request, returns true on shutdown
+      bool handle_connection(int fd)
+      {
+        receive_limits limits;
+        limits.timeout = receive_timeout * 1000;
+        limits.max_body_size = max_request_size;
+
+        queued_request entry;
+        entry.fd = fd;
+
+        receive_result result = receive_message(fd, entry.request, limits);
+        if (result != received)
+        {
+          if (result == message_too_large)
+          {
+            std::ostringstream ss;
+            ss << "request exceeds the maximum size of " << max_request_size << " bytes";
+            send_error(fd, ss.str());
+          }
+          close(fd);
+          return false;
+        }
+
+        std::string command = entry.request.get("command", "run");
+        if (command == "shutdown" || command == "ping")
+        {
+          message response;
+          response.set("status", "ok");
+          send_message(fd, response);
+          close(fd);
+          return command == "shutdown";
+        }
+
+        if (command != "run")
+          send_error(fd, "Unknown command \"" + command + "\"");
+        else if (queued.size() >= max_queued)
+          send_error(fd, "server busy");
+        else
+        {
+          queued.push_back(entry);
+          return false;
+        }
+
+        close(fd);
+        return false;
+      }
+
+      bool start_worker(queued_request const & entry)
+      {
+        std::cout.flush();
+        std::cerr.flush();
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+          signal(SIGCHLD, SIG_DFL);
+          close(listen_fd);
+          close(wake_fd[0]);
+          close(wake_fd[1]);
+          for (std::size_t i = 0; i < queued.size(); ++i)
+            close(queued[i].fd);
+
+          // the worker must never return into the server loop
+          try
+          {
+            serve(entry.fd, entry.request);
+          }
+          catch (std::exception const & e)
+          {
+            send_error(entry.fd, std::string("pipeline failed: ") + e.what());
+          }
+          catch (...) {}
+          close(entry.fd);
+          _exit(0);
+        }
+
+        if (pid < 0)
+          send_error(entry.fd, "fork failed");
+        close(entry.fd);
+        return pid > 0;
+      }
+
+      // executed in the worker process, the output of the pipeline is
+      // captured in a temporary file and sent back as the response body
+      void serve(int fd, message const & request)
+      {
+        FILE * log_file = tmpfile();
+
+        int stdout_fd = dup(STDOUT_FILENO);
+        int stderr_fd = dup(STDERR_FILENO);
+        if (log_file)
+        {
+          dup2(fileno(log_file), STDOUT_FILENO);
+          dup2(fileno(log_file), STDERR_FILENO);
+        }
+
+        double time = 0.0;
+        bool success = run_pipeline(request.body, request.get("base_path"), time);
+
+        std::cout.flush();
+        std::cerr.flush();
+        dup2(stdout_fd, STDOUT_FILENO);
+        dup2(stderr_fd, STDERR_FILENO);
+        close(stdout_fd);
+        close(stderr_fd);
+
+        message response;
+        response.set("status", success ? "ok" : "failed");
+
+        std::ostringstream ss;
+        ss << time;
+        response.set("time", ss.str());
+
+        if (log_file)
+        {
+          std::rewind(log_file);
+          char buffer[4096];
+          std::size_t count;
+          while ((count = std::fread(buffer, 1, sizeof(buffer), log_file)) > 0)
+            response.body.append(buffer, count);
+          std::fclose(log_file);
+        }
+
+        send_message(fd, response);
+      }
+
+      std::string socket_path;
+      int listen_fd;
+      int wake_fd[2];
+      int concurrency;
+      int receive_timeout;
+      std::size_t max_request_size;
+      std::size_t max_queued;
+      std::deque<queued_request> queued;
+      RunFunctorT run_pipeline;
+    };
+
+  }
+}
+
+#endif